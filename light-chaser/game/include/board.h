@@ -0,0 +1,86 @@
+/******************************************************************************
+ * BOARD.H - Which Hardware Backends This Build Uses
+ *
+ * hardware.h is the game's one view of the hardware. Where one part of it
+ * can be wired more than one way, each wiring is a backend class (see
+ * leds.h), and this file picks one per build with a typedef. Nothing else
+ * names a backend: changing the LED wiring is one line here, and game.cpp
+ * and hardware.cpp don't change.
+ *
+ * THE CHOICES:
+ *
+ *   Part   Backend        When
+ *   LEDs   LedsUnoPorts   ATmega328P with the default wiring (env:uno)
+ *          LedsShift595   ATtiny85 (env:tiny85)
+ *          LedsPins       -DLEDS_PINS, any other board, the host simulator
+ *
+ * WHAT THE BOARD HAS:
+ * The rest of the firmware asks about parts, not chips. Only the timer
+ * drivers (timebase.cpp, tone_timer.cpp) and main.cpp test BOARD_TINY85.
+ *
+ *   Macro               Uno / host   ATtiny85   Without it
+ *   BOARD_HAS_I2C       yes          -          display_*() and expander_*()
+ *                                               do nothing, no LCD self-test
+ *   BOARD_HAS_COIN      yes          -          free play, no audit ledger
+ *   LEDS_74HC595        -            yes        (LED backend, above)
+ *   RULES_BUILTIN_ONLY  -            yes        no game modes from EEPROM:
+ *                                               saves rules.h's 150-byte image
+ *   GHOST_REPLAY        yes          -          attract mode doesn't replay the
+ *                                               record (ghost.h): saves the
+ *                                               212-byte recording buffer
+ *
+ * -DGHOST_OFF leaves GHOST_REPLAY out on the Uno and the host as well
+ * (libchaser follows it: without GHOST_REPLAY no run is kept).
+ *
+ * The ATtiny85 has 512 bytes of SRAM for everything, stack included, and
+ * 8 KB of flash. Its build keeps game.cpp, the button, animations, sound,
+ * EEPROM records and the self-test; the Uno-only drivers compile out.
+ *
+ * The sound, LCD and EEPROM drivers already come as one implementation per
+ * target, picked by the linker (tone_timer.cpp on the board, sim.cpp on the
+ * host; tone_timer.cpp has a Timer1 driver for the ATtiny85). The work
+ * behind each call (Timer2 registers, I2C bytes, EEPROM
+ * cells) is far larger than the call itself, so there is little to gain
+ * from inlining them.
+ *
+ * COMPARING BACKENDS:
+ * env:uno_led_pins is env:uno with the portable backend. Building both
+ * shows what the port backend saves:
+ *
+ *   pio run -e uno -e uno_led_pins -t size
+ *   avr-objdump -d .pio/build/uno/firmware.elf | less     (update_chase_position)
+ *
+ * Related files:
+ * - leds.h: The LED backends and what each must provide
+ * - hardware.h: led_set(), led_clear_all()
+ ******************************************************************************/
+
+#ifndef BOARD_H
+#define BOARD_H
+
+#if defined(__AVR_ATtiny85__)
+#define BOARD_TINY85
+#define LEDS_74HC595
+#define RULES_BUILTIN_ONLY
+#if defined(TRACE_ENABLED) || defined(TIMEBASE_STATS) || defined(RULES_UPLOAD) || defined(SNAPSHOT_DUMP) || defined(COIN_OP)
+#error "Trace, timebase stats, rules upload, snapshots and coin-op need the Uno (no UART, no coin pin)"
+#endif
+#else
+#define BOARD_HAS_I2C
+#define BOARD_HAS_COIN
+#ifndef GHOST_OFF
+#define GHOST_REPLAY
+#endif
+#endif
+
+#include "leds.h"
+
+#if defined(LEDS_74HC595)
+typedef LedsShift595 BoardLeds;
+#elif defined(__AVR_ATmega328P__) && !defined(LEDS_PINS)
+typedef LedsUnoPorts BoardLeds;
+#else
+typedef LedsPins BoardLeds;
+#endif
+
+#endif // BOARD_H
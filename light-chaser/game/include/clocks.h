@@ -0,0 +1,131 @@
+/******************************************************************************
+ * CLOCKS.H - Register Values Derived from F_CPU at Compile Time
+ *
+ * The same firmware runs on 16 MHz Unos and on the 3.3 V / 8 MHz Pro Minis
+ * of the handheld cabinets (env:pro8mhz). A timer reload worked out by hand
+ * for 16 MHz would play every note an octave low and every deadline twice as
+ * late on the Pro Mini. So nothing that turns a time, a frequency or a baud
+ * rate into a register value is written as a number: it is a constexpr of
+ * F_CPU, computed here.
+ *
+ * Each value is also checked against the register it goes into. A clock
+ * that the firmware can't support (a note with no prescaler that fits 8
+ * bits, a baud rate too far off) fails the build with a static_assert
+ * instead of running slow or garbling its output:
+ *
+ *   Timer1   timebase.cpp   µs per count (a whole number), sleep range
+ *   Timer2   tone_timer.h   prescaler + OCR2A per note, toggles per note
+ *   Timer1   tone_timer.h   the same, OCR1C, on the ATtiny85
+ *   Timer2   timebase.cpp   latency probe period (stats builds)
+ *   USART0   trace.cpp      trace and stats baud rates (≤ 2.5% error)
+ *   TWI      hardware.cpp   I2C bit rate (TWBR)
+ *
+ * The helpers are C++11 constexpr (one return statement each, recursion
+ * instead of loops), the language level of the Arduino AVR toolchain.
+ *
+ * The host simulator models an Uno: its Arduino.h defines F_CPU as 16 MHz,
+ * so the same values (and static_asserts) apply there.
+ *
+ * Related files:
+ * - tone_timer.h: Buzzer notes built from these helpers
+ * - platformio.ini: uno (16 MHz), pro8mhz and tiny85 (8 MHz) environments
+ ******************************************************************************/
+
+#ifndef CLOCKS_H
+#define CLOCKS_H
+
+#include <Arduino.h>
+
+/**
+ * timer2_prescaler - Clock divider selected by Timer2 clock-select bits @cs
+ * @param cs: TCCR2B CS22..CS20 (1-7; 0 stops the timer)
+ *
+ * Timer2 has more dividers than Timer0/1 (32 and 128 as well), which is why
+ * tone generation uses it.
+ */
+constexpr uint16_t timer2_prescaler(uint8_t cs) {
+    return cs == 1 ? 1 : cs == 2 ? 8 : cs == 3 ? 32 : cs == 4 ? 64 :
+           cs == 5 ? 128 : cs == 6 ? 256 : 1024;
+}
+
+/**
+ * ctc_top - Compare value that toggles a pin at @hz (rounded to nearest)
+ * @param prescaler: Timer clock divider
+ *
+ * In CTC mode the timer counts 0..top, so one toggle takes
+ * prescaler × (top + 1) CPU cycles; a full square wave period is two.
+ */
+constexpr uint32_t ctc_top(uint32_t hz, uint16_t prescaler) {
+    return (F_CPU + (uint32_t)prescaler * hz) / (2UL * prescaler * hz) - 1;
+}
+
+/**
+ * timer2_clock_select - Smallest Timer2 divider whose top fits 8 bits
+ * @return: CS22..CS20 bits, 0 if even clk/1024 is too fast for @hz
+ *
+ * The smallest divider gives the finest frequency steps.
+ */
+constexpr uint8_t timer2_clock_select(uint32_t hz, uint8_t cs = 1) {
+    return cs > 7 ? 0 :
+           ctc_top(hz, timer2_prescaler(cs)) <= 255 ? cs : timer2_clock_select(hz, cs + 1);
+}
+
+/**
+ * timer1_tiny_prescaler - ATtiny85 Timer1 divider for clock-select bits @cs
+ * @param cs: TCCR1 CS13..CS10 (1-15; 0 stops the timer)
+ *
+ * The ATtiny85's Timer1 is 8 bits wide but divides by any power of two up
+ * to 16384, so even a 100 Hz tick at 8 MHz fits its top.
+ */
+constexpr uint16_t timer1_tiny_prescaler(uint8_t cs) {
+    return (uint16_t)(1u << (cs - 1));
+}
+
+/**
+ * timer1_tiny_clock_select - Smallest ATtiny85 Timer1 divider whose top fits 8 bits
+ * @return: CS13..CS10 bits, 0 if even clk/16384 is too fast for @hz
+ */
+constexpr uint8_t timer1_tiny_clock_select(uint32_t hz, uint8_t cs = 1) {
+    return cs > 15 ? 0 :
+           ctc_top(hz, timer1_tiny_prescaler(cs)) <= 255 ? cs : timer1_tiny_clock_select(hz, cs + 1);
+}
+
+/**
+ * uart_ubrr - Baud rate register the Arduino core programs for @baud
+ *
+ * Same formula as HardwareSerial::begin() (double-speed mode, truncating),
+ * so the error checked below is the error the board actually gets.
+ */
+constexpr uint16_t uart_ubrr(uint32_t baud) {
+    return (uint16_t)((F_CPU / 4 / baud - 1) / 2);
+}
+
+/**
+ * uart_error_permille - How far the real baud rate is from @baud (‰)
+ *
+ * The limit is 2.5%: the core's own 115200 at 16 MHz is 2.1% off and is
+ * read fine by the USB serial bridges; 115200 at 8 MHz (3.5%) is not.
+ */
+constexpr uint32_t uart_error_permille(uint32_t baud) {
+    return F_CPU / 8 / (uart_ubrr(baud) + 1UL) > baud
+         ? (F_CPU / 8 / (uart_ubrr(baud) + 1UL) - baud) * 1000 / baud
+         : (baud - F_CPU / 8 / (uart_ubrr(baud) + 1UL)) * 1000 / baud;
+}
+
+const uint8_t UART_MAX_ERROR_PERMILLE = 25;
+
+/**
+ * twi_bit_rate - TWBR for an I2C clock of @hz (TWI prescaler 1)
+ *
+ * SCL = F_CPU / (16 + 2 × TWBR). The datasheet wants TWBR ≥ 10 in master
+ * mode, which caps the bus at 400 kHz on 16 MHz and 200 kHz on 8 MHz.
+ */
+constexpr uint32_t twi_bit_rate(uint32_t hz) {
+    return F_CPU / hz < 16 ? 0 : (F_CPU / hz - 16) / 2;
+}
+
+constexpr bool twi_bit_rate_valid(uint32_t hz) {
+    return twi_bit_rate(hz) >= 10 && twi_bit_rate(hz) <= 255;
+}
+
+#endif // CLOCKS_H
@@ -0,0 +1,60 @@
+/******************************************************************************
+ * COIN.H - Coin Mech Pulse Counter (Pin-Change Interrupt)
+ *
+ * A coin pulse is 20-50 ms long. loop() can be busy for longer than that:
+ * a full LCD update is ~40 ms, a ledger save ~35 ms. Polling the pin from
+ * loop() would miss pulses that start and end inside one of those; a
+ * pin-change interrupt sees both edges whatever loop() is doing:
+ *
+ *   COIN pin  ‾‾‾‾‾‾\_________/‾‾‾‾‾‾‾‾‾‾\__/‾‾‾‾‾‾
+ *                  │  35 ms  │          │2ms│
+ *   ISR            start     width OK   start width too short
+ *                            pulses++         rejects++
+ *   loop()    ──[ LCD update, 40 ms ]──────────────── coin_pulses() = 1
+ *
+ * The ISR only counts. Counters are 8-bit and free-running, so reading one
+ * is a single (atomic) load and there is nothing to reset: the caller
+ * remembers the last value it saw and takes the difference. Up to 255
+ * pulses can arrive between two reads without one being lost.
+ *
+ * Each counted pulse also ends the timebase sleep, so credits show up at
+ * once rather than at the next scheduled wake.
+ *
+ * Firmware only (coin.cpp uses AVR registers); the host simulator provides
+ * these functions in sim.cpp, with pulses injected by sim_coin_pulse().
+ * The interrupt handler itself is exercised under simavr
+ * (tools/simavr_coin.cpp).
+ *
+ * Related files:
+ * - config.h: COIN_PIN and the accepted pulse widths
+ * - hardware.cpp section 7: Credits and the audit ledger built on this
+ ******************************************************************************/
+
+#ifndef COIN_H
+#define COIN_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * coin_init - Start counting (call at the end of setup(), after timebase_init())
+ */
+void coin_init(void);
+
+/**
+ * coin_pulses - Pulses of an accepted width since boot (wraps at 256)
+ * coin_rejects - Pulses too short or too long since boot (wraps at 256)
+ */
+uint8_t coin_pulses(void);
+uint8_t coin_rejects(void);
+
+/**
+ * coin_pulse_valid - Is a LOW pulse of @width_us a coin?
+ *
+ * Shared by the ISR and the host simulator so both judge pulses alike.
+ */
+inline bool coin_pulse_valid(uint32_t width_us) {
+    return width_us >= COIN_PULSE_MIN_MS * 1000UL && width_us <= COIN_PULSE_MAX_MS * 1000UL;
+}
+
+#endif // COIN_H
@@ -42,8 +42,8 @@
  *         (No external resistor needed!)
  *
  * BUZZER (Pin 11):
- * PWM-capable pin for tone() function. Generates square waves at specified
- * frequencies to produce beeps and melodies.
+ * Timer2's OC2A output: tone_play() has the timer toggle it in hardware to
+ * generate square waves for beeps and melodies (see tone_timer.h).
  *
  * I2C LCD DISPLAY (Pins A4/A5):
  * I2C (Inter-Integrated Circuit) is a 2-wire protocol for communicating with
@@ -53,9 +53,28 @@
  *
  ******************************************************************************/
 
+#if defined(__AVR_ATtiny85__)
+/*
+ * ATtiny85 giveaway board (env:tiny85, see board.h): five I/O pins, so the
+ * LEDs hang off a 74HC595 (LED n = output Qn) and there is no LCD.
+ *
+ *   PB0 ── 595 RCLK (12)     PB3 ── [Button] ── GND
+ *   PB1 ── 595 SER (14)      PB4 ── Buzzer (Timer1's OC1B)
+ *   PB2 ── 595 SRCLK (11)
+ *
+ * PB1 and PB2 are the USI's DO and USCK: the USI shifts a frame out in
+ * hardware (leds.h).
+ */
+const uint8_t SR_LATCH_PIN = 0;
+const uint8_t SR_DATA_PIN = 1;
+const uint8_t SR_CLOCK_PIN = 2;
+const uint8_t BUTTON_PIN = 3;
+const uint8_t BUZZER_PIN = 4;
+#else
 const uint8_t LED_PIN_START = 2;   // First LED on pin 2, subsequent LEDs on pins 3-9
 const uint8_t BUTTON_PIN = 10;
 const uint8_t BUZZER_PIN = 11;
+#endif
 
 /******************************************************************************
  * LED CONFIGURATION
@@ -87,7 +106,20 @@ const uint8_t TARGET_ZONE_END = 4;    // Last green LED (bullseye zone)
  * DEBOUNCE_MS (50ms):
  * Physical buttons "bounce" when pressed, the contacts make/break rapidly for
  * 5-20ms before settling. Without debouncing, one press registers as multiple.
- * Solution: Ignore transitions within 50ms of the last detected press.
+ * The main button learns how long its own switch bounces (debounce.h) and
+ * only needs the line quiet for 1.5 × that + DEBOUNCE_MARGIN_US before a
+ * press, between DEBOUNCE_MIN_MS and DEBOUNCE_MS. Expander buttons keep the
+ * fixed DEBOUNCE_MS between presses: the MCP23017 latches one edge per
+ * interrupt, so their bounce can't be seen.
+ *
+ * BOUNCE LEARNING (debounce.h):
+ * - BOUNCE_WINDOW_MS: edges closer than this are one bounce burst (so the
+ *   longest bounce that can be measured)
+ * - BOUNCE_MIN_US / BOUNCE_MAX_US: bounds on the learned bounce time
+ * - BOUNCE_DEFAULT_US: until a profile is saved, assume the worst switch
+ * - BOUNCE_STEP_UP_US / BOUNCE_STEP_DOWN_US: 15:1, tracks the 94th
+ *   percentile of measured bursts
+ * - BOUNCE_SAVE_STEP_US: drift from the saved profile that earns a save
  *
  * CHASE SPEED (200ms initial, 50ms minimum):
  * Time between LED movements. Starts at 200ms (5 LEDs/sec), decreases by 10ms
@@ -99,7 +131,16 @@ const uint8_t TARGET_ZONE_END = 4;    // Last green LED (bullseye zone)
  * - Increase SPEED_DECREASE → difficulty ramps faster
  ******************************************************************************/
 
-const uint16_t DEBOUNCE_MS = 50;
+const uint16_t DEBOUNCE_MS = 50;           // Longest lockout (and the expander's)
+const uint16_t DEBOUNCE_MIN_MS = 3;        // Shortest lockout, however clean the switch
+const uint16_t DEBOUNCE_MARGIN_US = 2000;  // Added to 1.5 × the learned bounce
+const uint16_t BOUNCE_WINDOW_MS = 20;
+const uint16_t BOUNCE_MIN_US = 500;
+const uint16_t BOUNCE_MAX_US = 20000;
+const uint16_t BOUNCE_DEFAULT_US = BOUNCE_MAX_US;
+const uint16_t BOUNCE_STEP_UP_US = 480;
+const uint16_t BOUNCE_STEP_DOWN_US = 32;
+const uint16_t BOUNCE_SAVE_STEP_US = 1000;
 const uint16_t INITIAL_CHASE_SPEED = 200;  // Starting LED movement interval (ms)
 const uint16_t MIN_CHASE_SPEED = 50;       // Fastest possible LED movement (ms)
 const uint16_t SPEED_DECREASE = 10;         // Amount to speed up per successful hit (ms)
@@ -115,13 +156,45 @@ const uint16_t SPEED_DECREASE = 10;         // Amount to speed up per successful
 
 const uint8_t BULLSEYE_SCORE = 10;
 
+/******************************************************************************
+ * LATENCY CALIBRATION
+ *
+ * Every cabinet feels slightly different: switch travel, long wiring and the
+ * player's own ear/eye all shift when a press "feels" on time. Calibration
+ * mode (hold the button while powering on) plays a steady beat: LEDs flash
+ * and the buzzer clicks every CALIBRATION_BEAT_MS. The player taps along and
+ * the firmware measures how far the taps land from the beats.
+ *
+ * After CALIBRATION_TAPS taps it takes the median, drops taps further than
+ * CALIBRATION_OUTLIER_MS from it (a missed beat, a double tap) and stores
+ * the mean of the rest in EEPROM. If fewer than half the taps survive, the
+ * run is rejected and the old offset is kept.
+ *
+ * During play the offset is applied as ONE subtraction per press: the chase
+ * position is judged at (press time - offset) instead of the press time.
+ * A positive offset means presses arrive late, so the LED that was lit
+ * slightly earlier counts.
+ *
+ * LATENCY_OFFSET_MAX_MS is below MIN_CHASE_SPEED so the judged moment is at
+ * most one chase step away from now (see chase_position_at() in game.cpp).
+ ******************************************************************************/
+
+const uint16_t CALIBRATION_BEAT_MS = 500;          // 120 beats per minute
+const uint8_t CALIBRATION_LEAD_IN_BEATS = 4;       // Beats before taps count
+const uint8_t CALIBRATION_TAPS = 12;               // Taps measured per run
+const uint8_t CALIBRATION_OUTLIER_MS = 40;         // Max distance from the median
+const uint16_t CALIBRATION_FLASH_MS = 80;          // LEDs lit per beat
+const uint16_t CALIBRATION_RESULT_MS = 2000;       // Result screen, then ATTRACT
+const int8_t LATENCY_OFFSET_MAX_MS = 45;           // Stored offsets are clamped to ±this
+
 /******************************************************************************
  * SOUND FREQUENCIES (Hz) and DURATIONS (ms)
  *
  * PWM TONE GENERATION:
- * Arduino's tone() function generates square waves at specified frequencies
- * using PWM (Pulse Width Modulation). The buzzer vibrates at this frequency
- * to produce audible tones.
+ * Timer2 generates square waves at these frequencies (tone_timer.h). The
+ * buzzer vibrates at this frequency to produce audible tones. Each pair of
+ * frequency and duration becomes a ToneNote at compile time, so a frequency
+ * the board's F_CPU can't reach fails the build.
  *
  * FREQUENCY SELECTION:
  * These frequencies are chosen from the musical scale (in Hz):
@@ -151,49 +224,182 @@ const uint16_t FREQ_BULLSEYE_3 = 1200;
 const uint16_t FREQ_GAME_OVER_1 = 400;
 const uint16_t FREQ_GAME_OVER_2 = 300;
 const uint16_t FREQ_GAME_OVER_3 = 200;
+const uint16_t FREQ_CALIBRATION_BEAT = 1000;
 
 const uint16_t DURATION_TICK = 20;
 const uint16_t DURATION_HIT = 100;
 const uint16_t DURATION_BULLSEYE_NOTE = 100;
 const uint16_t DURATION_GAME_OVER_NOTE = 200;
+const uint16_t DURATION_CALIBRATION_BEAT = 30;
 
 /******************************************************************************
  * ANIMATION CONFIGURATION
  *
- * CELEBRATION_LED_DELAY (40ms per LED):
- * Speed of the "wave" effect during celebration. LEDs light sequentially
- * left-to-right. 40ms × 8 LEDs = 320ms per complete sweep.
+ * CELEBRATION_LED_DELAY (40ms per frame):
+ * Frame time of the celebration LED effect. Each new high score plays the
+ * next effect of the celebration playlist (effects.h); the first is the
+ * classic wave, 40ms × 8 LEDs = 320ms per complete sweep.
  *
- * CELEBRATION_SWEEPS (3 complete sweeps):
- * Total animation time: 3 sweeps × 320ms = 960ms (~1 second)
+ * CELEBRATION_SWEEPS (3 sweeps' worth of frames):
+ * Total animation time: 3 × 8 frames × 40ms = 960ms (~1 second), whichever
+ * effect is playing.
+ *
+ * ATTRACT_SHOW_PERIOD_MS (12 s):
+ * An idle attract mode plays an effect from the attract playlist this long
+ * after it starts, and again every period after that. The chase LED keeps
+ * moving underneath (hidden), so a game still starts wherever it is.
+ *
+ * ATTRACT_SHOW_FRAMES / ATTRACT_SHOW_FRAME_MS (64 × 60ms):
+ * Length of one showcase: ~3.8 s of effect, then the chase reappears.
+ *
+ * GHOST_END_HOLD_MS (1.5 s):
+ * Once the record has been set, every other showcase slot replays the
+ * game that set it instead (ghost.h). After its final miss the ghost holds
+ * the missed LED and its score this long, then attract mode carries on.
  *
  * GAME_OVER_LED_FLASH_DURATION (150ms):
  * All LEDs flash on/off together. 150ms on + 150ms off = 300ms per cycle.
  *
  * GAME_OVER_LED_FLASH_COUNT (5 cycles):
  * Total flash animation: 5 cycles × 300ms = 1500ms (1.5 seconds)
+ *
+ * RESTART_MIN_SHOW_MS (600ms):
+ * A press during GAME_OVER or CELEBRATION cuts the animation short and
+ * starts the next game at once, instead of waiting 1.5-2 s for ATTRACT and
+ * then a second press. Presses in the first 600ms are ignored: that is the
+ * player still reacting to the miss, and long enough to read the score.
  ******************************************************************************/
 
 const uint16_t GAME_OVER_LED_FLASH_DURATION = 150;  // milliseconds per flash state
 const uint8_t GAME_OVER_LED_FLASH_COUNT = 5;        // number of complete flash cycles
+const uint16_t RESTART_MIN_SHOW_MS = 600;           // end-of-game screen before a skip
 
-const uint16_t CELEBRATION_LED_DELAY = 40;  // milliseconds per LED in wave
-const uint8_t CELEBRATION_SWEEPS = 3;        // number of left-to-right sweeps
+const uint16_t CELEBRATION_LED_DELAY = 40;  // milliseconds per effect frame
+const uint8_t CELEBRATION_SWEEPS = 3;        // length in 8-frame sweeps
+
+const uint16_t ATTRACT_SHOW_PERIOD_MS = 12000;  // attract showcase every 12 s
+const uint8_t ATTRACT_SHOW_FRAMES = 64;         // frames per showcase
+const uint16_t ATTRACT_SHOW_FRAME_MS = 60;      // milliseconds per frame
+const uint16_t GHOST_END_HOLD_MS = 1500;        // ghost's final miss on screen
 
 /******************************************************************************
  * LCD DISPLAY CONFIGURATION
  *
- * I2C ADDRESS (0x27):
+ * I2C ADDRESS (0x27 or 0x3F):
  * Each I2C device on the bus has a unique 7-bit address (0x00-0x7F).
- * Most I2C LCD modules use address 0x27 or 0x3F.
+ * Most I2C LCD modules use address 0x27 (PCF8574) or 0x3F (PCF8574A).
+ * The power-on self-test probes both and remembers which one answered
+ * (EEPROM_LCD_ADDR_ADDR), so either backpack works without a rebuild.
  *
  * LCD DIMENSIONS:
- * Standard 16×2 character LCD (16 columns, 2 rows)
+ * Standard 16×2 character LCD (16 columns, 2 rows). Build with -DLCD_20X4
+ * (uno_20x4) for a 20×4: the screens are layout tables (layout.h) with a
+ * set for each size, so nothing else changes.
+ *
+ * SPECTATOR PANEL:
+ * Tournament cabinets add a second 16×2 facing the audience. It answers on
+ * whichever of the two addresses the main LCD doesn't use, is found at boot
+ * and mirrors the main screen (see hardware.cpp section 3).
+ *
+ * FLUSH BUDGET (5 ms):
+ * Screens are drawn into RAM and sent as differences. One loop() spends at
+ * most this long sending them (about 4 characters); what is left goes out
+ * on the next loop(), so a hit never stalls the game for a whole redraw.
+ *
+ * BUS SPEED (100 kHz):
+ * Standard-mode I2C, which every backpack supports. The bit-rate register
+ * is derived from F_CPU and range-checked at compile time (clocks.h), so the
+ * bus runs at the same speed on 16 MHz and 8 MHz boards.
  ******************************************************************************/
 
-const uint8_t LCD_ADDRESS = 0x27;  // Try 0x3F if 0x27 doesn't work
+const uint8_t LCD_ADDRESS = 0x27;      // Default backpack address
+const uint8_t LCD_ALT_ADDRESS = 0x3F;  // PCF8574A backpacks
+#ifdef LCD_20X4
+const uint8_t LCD_COLS = 20;
+const uint8_t LCD_ROWS = 4;
+#else
 const uint8_t LCD_COLS = 16;
 const uint8_t LCD_ROWS = 2;
+#endif
+const uint8_t LCD_PANELS = 2;                    // Main + spectator (mirrored)
+const uint16_t DISPLAY_FLUSH_BUDGET_US = 5000;   // Bus time per loop()
+const uint32_t I2C_CLOCK_HZ = 100000;
+
+/******************************************************************************
+ * MCP23017 INPUT EXPANDER (optional)
+ *
+ * 16 extra inputs on the same I2C bus as the LCD, found at boot if fitted:
+ *
+ *   MCP23017 (0x20)             Arduino
+ *   GPA0-GPA7 ── player buttons (any of them = "the button")
+ *   GPB0-GPB7 ── operator switches (levels, expander_switch_is_on())
+ *   INTA ─────────────────────── Pin 12 (pin-change interrupt)
+ *   SDA/SCL ──────────────────── A4/A5 (shared with the LCD)
+ *
+ * Every input is wired like the main button: switch to GND, pull-up in the
+ * expander. The expander is never polled: INTA going low says something
+ * changed, and one 4-byte burst read (INTCAPA..GPIOB) fetches what.
+ ******************************************************************************/
+
+const uint8_t EXPANDER_ADDRESS = 0x20;  // A0-A2 tied to GND
+const uint8_t EXPANDER_INT_PIN = 12;    // INTA (mirrored: either port)
+
+/******************************************************************************
+ * COIN MECH AND CREDITS
+ *
+ * A coin mech signals each accepted coin with a short pulse on an
+ * open-collector output (20-50 ms LOW; some send a burst of pulses for a
+ * high-value coin):
+ *
+ *   Coin mech COIN ─── Pin A0 (INPUT_PULLUP, pin-change interrupt)
+ *   Coin mech GND  ─── GND
+ *
+ * The pulse is timed by an interrupt, not by loop(), so none is lost while
+ * loop() is busy with the LCD or EEPROM (see coin.h). Pulses shorter than
+ * COIN_PULSE_MIN_MS are noise; longer than COIN_PULSE_MAX_MS, a jammed or
+ * strung coin. Neither gives credit.
+ *
+ * Build with -DCOIN_OP (uno_coin) to require a credit per game. Otherwise
+ * the game is on free play; coins and games are still counted in the
+ * ledger (see EEPROM_LEDGER_ADDR below).
+ ******************************************************************************/
+
+const uint8_t COIN_PIN = 14;                  // A0 (PCINT8)
+const uint16_t COIN_PULSE_MIN_MS = 10;
+const uint16_t COIN_PULSE_MAX_MS = 100;
+const uint8_t COIN_PULSES_PER_CREDIT = 1;
+const uint8_t COIN_MAX_CREDITS = 99;          // Further coins are kept by the mech
+const uint16_t COIN_LEDGER_SETTLE_MS = 500;   // Quiet time before a ledger save
+
+#ifdef COIN_OP
+const bool FREE_PLAY = false;
+#else
+const bool FREE_PLAY = true;
+#endif
+
+/******************************************************************************
+ * POWER-ON SELF-TEST (POST)
+ *
+ * lcd.init() spends about a second in delay() waiting for the LCD controller
+ * to power up. The Arduino core's delay() calls yield() while it waits, and
+ * the self-test runs its timed checks from there, so they cost no extra
+ * boot time:
+ *
+ *   hardware_init()
+ *   ├─ instant checks: EEPROM records, LED pin readback, I2C probe
+ *   ├─ lcd.init()  ──── ~1050 ms of delay() ────┐
+ *   │    yield() → LED sweep (8 × 50 ms)        │  overlapped
+ *   │    yield() → buzzer pin toggle count      │
+ *   └─ post_finish(): collect results ──────────┘
+ *
+ * POST_FAULT_HOLD_MS: How long game.cpp shows a failed self-test before
+ * going to attract mode (a button press skips it).
+ ******************************************************************************/
+
+const uint16_t POST_LED_STEP_MS = 50;      // Sweep: each LED lit for this long
+const uint16_t POST_BUZZER_MS = 100;       // Test tone length
+const uint16_t FREQ_POST_BUZZER = 2000;    // Test tone (toggles the pin 4000×/s)
+const uint16_t POST_FAULT_HOLD_MS = 3000;
 
 /******************************************************************************
  * EEPROM CONFIGURATION
@@ -219,9 +425,62 @@ const uint8_t LCD_ROWS = 2;
  * to occur randomly in uninitialised memory.
  *
  * See hardware.cpp:eeprom_read_high_score() for validation logic.
+ *
+ * EEPROM_LATENCY_ADDR (4):
+ * Button latency offset from calibration mode, 3 bytes:
+ *   Byte 4: Offset in ms (int8_t)
+ *   Byte 5: Magic byte (0xA5)
+ *   Byte 6: Checksum (XOR of bytes 4-5)
+ * Reads as 0 (no correction) until a calibration run has been saved.
+ *
+ * EEPROM_LCD_ADDR_ADDR (7):
+ * I2C address the LCD last answered on, 3 bytes:
+ *   Byte 7: Address (LCD_ADDRESS or LCD_ALT_ADDRESS)
+ *   Byte 8: Magic byte (0xA5)
+ *   Byte 9: Checksum (XOR of bytes 7-8)
+ * The self-test probes this address first. Only rewritten when it changes.
+ *
+ * EEPROM_BOUNCE_ADDR (10):
+ * The main button's learned bounce time (debounce.h), 4 bytes:
+ *   Bytes 10-11: Bounce time in µs (uint16_t, low byte first)
+ *   Byte 12:     Magic byte (0xA5)
+ *   Byte 13:     Checksum (XOR of bytes 10-12)
+ * Saved between games once the estimate has drifted BOUNCE_SAVE_STEP_US from
+ * the saved value. Reads as BOUNCE_DEFAULT_US until then.
+ *
+ * EEPROM_LEDGER_ADDR (16):
+ * Coin/credit audit ledger, LEDGER_SLOTS records of LEDGER_SLOT_SIZE bytes:
+ *   Byte 0:     Sequence number (newest slot = highest, modulo 256)
+ *   Bytes 1-4:  Coins accepted, all time (uint32_t, low byte first)
+ *   Bytes 5-8:  Games started, all time (uint32_t)
+ *   Byte 9:     Credits not yet played
+ *   Byte 10:    Magic byte (0xA5)
+ *   Byte 11:    Checksum (XOR of bytes 0-10)
+ * Each save goes to the slot after the newest one, so every byte is written
+ * once per LEDGER_SLOTS saves. A save cut short by power loss leaves the
+ * previous slot intact.
+ *
+ * EEPROM_RULES_ADDR (128):
+ * The game mode: a rule image (rules.h) of up to RULES_IMAGE_MAX (150)
+ * bytes, with its own magic byte, version and checksum. Erased EEPROM (or
+ * an image that fails rules_image_load()) means the built-in rules.
+ *
+ * EEPROM_GHOST_ADDR (288):
+ * The record-setting game, replayed in attract mode: an image (ghost.h) of
+ * up to GHOST_IMAGE_MAX (212) bytes, with its own magic byte, version and
+ * CRC-8. Rewritten only when the record is beaten, a few bytes per loop()
+ * between games; a write cut short fails the CRC and no ghost is played.
  ******************************************************************************/
 
 const uint16_t EEPROM_HIGH_SCORE_ADDR = 0;
+const uint16_t EEPROM_LATENCY_ADDR = 4;
+const uint16_t EEPROM_LCD_ADDR_ADDR = 7;
+const uint16_t EEPROM_BOUNCE_ADDR = 10;
+const uint16_t EEPROM_LEDGER_ADDR = 16;
+const uint16_t EEPROM_RULES_ADDR = 128;
+const uint16_t EEPROM_GHOST_ADDR = 288;
+const uint8_t LEDGER_SLOTS = 8;
+const uint8_t LEDGER_SLOT_SIZE = 12;
 const uint8_t EEPROM_MAGIC_BYTE = 0xA5;
 
 /******************************************************************************
@@ -235,6 +494,9 @@ const uint8_t EEPROM_MAGIC_BYTE = 0xA5;
  * STATE_RESULT: Brief pause after successful hit, then resume playing
  * STATE_CELEBRATION: New high score achieved! Play animation, then return to attract
  * STATE_GAME_OVER: Missed the target. Play sad animation, then return to attract
+ * STATE_CALIBRATION: Tap along to a beat to measure button latency (entered
+ *                    only by holding the button at power-on)
+ * STATE_SELF_TEST: Power-on self-test found a fault; show it, then attract
  *
  ******************************************************************************/
 
@@ -243,7 +505,9 @@ enum GameState {
     STATE_PLAYING,      // Active gameplay
     STATE_RESULT,       // Brief pause after successful hit
     STATE_CELEBRATION,  // New high score animation
-    STATE_GAME_OVER     // Miss animation, then return to attract
+    STATE_GAME_OVER,    // Miss animation, then return to attract
+    STATE_CALIBRATION,  // Latency calibration, then return to attract
+    STATE_SELF_TEST     // Self-test fault report, then return to attract
 };
 
 #endif // CONFIG_H
@@ -0,0 +1,135 @@
+/******************************************************************************
+ * DEBOUNCE.H - Self-Tuning Debounce: Learn How Long the Switch Bounces
+ *
+ * A fixed 50 ms lockout has to suit the worst switch that will ever be
+ * fitted. A new microswitch settles in about a millisecond; a worn leaf
+ * switch can chatter for 15. So every cabinet pays 50 ms on every press to
+ * cover a switch it may not have. This debouncer watches the switch it has,
+ * and sets the lockout from what it sees.
+ *
+ * WHAT ONE PRESS LOOKS LIKE (edges as the pin-change interrupt sees them):
+ *
+ *   pin   ‾‾‾‾\_/‾\__/‾\___________________/‾\_/‾‾‾‾‾‾‾‾‾
+ *             │ bounce │                    │bnc│
+ *             ├────────┤ burst: 5 edges,    ├───┤ burst: 3 edges
+ *                        ends pressed             ends released
+ *
+ * Edges closer together than BOUNCE_WINDOW_MS belong to one burst. A burst
+ * with an odd number of edges ended at the other level: it is one press or
+ * one release, and first edge → last edge is how long that switch bounced.
+ * A burst with an even number of edges went back where it started (a tap
+ * too quick to tell from bounce, or a glitch) and is not measured.
+ *
+ * THE ESTIMATE (bounce_us):
+ * Each measured burst moves the estimate a fixed step: up BOUNCE_STEP_UP_US
+ * if the burst was longer, down BOUNCE_STEP_DOWN_US if not. The steps are
+ * 15:1, so it settles where 1 burst in 16 is longer: a running 94th
+ * percentile. One freak burst (a kick to the cabinet) moves it one step
+ * whatever its length, and a clean switch (single-edge bursts, length 0)
+ * walks it down to BOUNCE_MIN_US.
+ *
+ * THE LOCKOUT (debounce_lockout_us()):
+ * 1.5 × the estimate + DEBOUNCE_MARGIN_US, clamped to DEBOUNCE_MIN_MS ..
+ * DEBOUNCE_MS. An edge to "pressed" is a press only if the line was quiet
+ * for the lockout before it. That is stricter than a lockout after each
+ * press: the bounce on release can never count as a new press.
+ *
+ * COST:
+ * debounce_edge() does a few 32-bit compares and adds, the same every
+ * time, with no loops: it runs inside the pin-change ISR. Nothing is
+ * measured between edges, so a switch that isn't moving costs nothing.
+ *
+ * Header-only so that libchaser (sim/chaser.cpp) runs the same code for its
+ * batched games; the firmware's edges come from timebase.cpp's PCINT0 ISR.
+ *
+ * Related files:
+ * - config.h: DEBOUNCE_* and BOUNCE_* tuning
+ * - hardware.cpp section 1: The main button on top of this
+ * - timebase.cpp: PCINT0_vect, which timestamps the edges
+ ******************************************************************************/
+
+#ifndef DEBOUNCE_H
+#define DEBOUNCE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+typedef struct {
+    uint32_t last_edge_us;     // Time of the latest edge
+    uint32_t burst_start_us;   // First edge of the current burst
+    uint16_t bounce_us;        // Learned bounce time (the estimate)
+    uint8_t burst_edges;       // 0 = no edge yet, then 1 = odd, 2 = even
+    bool down;                 // Level after the latest edge (true = pressed)
+} Debouncer;
+
+/**
+ * debounce_start - Forget all edges; the line is quiet at level @down
+ * @param bounce_us: Starting estimate (saved profile, or BOUNCE_DEFAULT_US)
+ */
+static inline void debounce_start(Debouncer *d, bool down, uint16_t bounce_us) {
+    d->last_edge_us = 0;
+    d->burst_start_us = 0;
+    d->bounce_us = bounce_us < BOUNCE_MIN_US ? BOUNCE_MIN_US
+                 : bounce_us > BOUNCE_MAX_US ? BOUNCE_MAX_US : bounce_us;
+    d->burst_edges = 0;
+    d->down = down;
+}
+
+/**
+ * debounce_lockout_us - Quiet time an edge to "pressed" must follow
+ */
+static inline uint32_t debounce_lockout_us(const Debouncer *d) {
+    uint32_t lockout = d->bounce_us + d->bounce_us / 2 + DEBOUNCE_MARGIN_US;
+    if (lockout < DEBOUNCE_MIN_MS * 1000UL) {
+        return DEBOUNCE_MIN_MS * 1000UL;
+    }
+    return lockout > DEBOUNCE_MS * 1000UL ? DEBOUNCE_MS * 1000UL : lockout;
+}
+
+/**
+ * debounce_learn - Move the estimate one step toward a burst of @sample_us
+ */
+static inline void debounce_learn(Debouncer *d, uint32_t sample_us) {
+    if (sample_us > d->bounce_us) {
+        uint32_t up = (uint32_t)d->bounce_us + BOUNCE_STEP_UP_US;
+        d->bounce_us = (uint16_t)(up > BOUNCE_MAX_US ? BOUNCE_MAX_US : up);
+    } else if (d->bounce_us >= BOUNCE_MIN_US + BOUNCE_STEP_DOWN_US) {
+        d->bounce_us -= BOUNCE_STEP_DOWN_US;
+    } else {
+        d->bounce_us = BOUNCE_MIN_US;
+    }
+}
+
+/**
+ * debounce_edge - The line changed to @down at @at_us
+ * @return: true if this edge is a press (to pressed, after a quiet lockout)
+ *
+ * Call once per change of level; a repeat of the current level is ignored.
+ * Timestamps must not go backwards.
+ */
+static inline bool debounce_edge(Debouncer *d, uint32_t at_us, bool down) {
+    if (down == d->down) {
+        return false;
+    }
+    d->down = down;
+
+    uint32_t gap = at_us - d->last_edge_us;
+    bool first = d->burst_edges == 0;
+    bool quiet = first || gap >= debounce_lockout_us(d);
+
+    if (first || gap >= BOUNCE_WINDOW_MS * 1000UL) {
+        // The previous burst is over: measure it if it changed level
+        if (d->burst_edges == 1) {
+            debounce_learn(d, d->last_edge_us - d->burst_start_us);
+        }
+        d->burst_start_us = at_us;
+        d->burst_edges = 1;
+    } else {
+        d->burst_edges = d->burst_edges == 1 ? 2 : 1;
+    }
+    d->last_edge_us = at_us;
+
+    return down && quiet;
+}
+
+#endif // DEBOUNCE_H
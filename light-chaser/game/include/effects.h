@@ -0,0 +1,210 @@
+/******************************************************************************
+ * EFFECTS.H - Procedural LED Effects
+ *
+ * A flipbook effect stores every frame: the celebration wave alone is 24
+ * frames, and each new effect would add its own table. These effects store
+ * no frames. Each is a small generator: a kind and two parameter bytes (an
+ * EffectPreset), plus three bytes of running state. From these it computes
+ * the next 8-LED frame on demand, in a few dozen cycles. A new look costs
+ * one preset line, and a playing effect costs 6 bytes of RAM whatever its
+ * length.
+ *
+ *   Kind              a                   b               Looks like
+ *   EFFECT_WAVE       -                   -               One LED sweeping 0 → 7
+ *   EFFECT_SPARKLE    density 1-3         -               Random twinkle (½, ¼, ⅛ lit)
+ *   EFFECT_AUTOMATON  rule (30, 90, ...)  first row       Elementary cellular automaton
+ *   EFFECT_BOUNCE     second pair lag     -               Pairs meeting in the middle
+ *   EFFECT_SCANNER    trail length        -               Knight Rider scanner with decay
+ *
+ * FRAMES:
+ * A frame is one byte, bit n = LED n (NUM_LEDS must be 8). effect_next()
+ * returns the frame to show now and advances the effect by one step; the
+ * caller decides how long a frame lasts.
+ *
+ * HOW THEY STAY CHEAP:
+ * - SPARKLE: a 16-bit xorshift (a fast LFSR, period 65535) gives 8 random
+ *   bits per clock; ANDing 1-3 of them sets the density
+ * - AUTOMATON: the 8 cells are a ring, and all 8 are updated at once with
+ *   shifts and masks (one AND/OR term per neighbourhood the rule turns on),
+ *   not cell by cell. A ring that dies out (rule 90 always does on 8 cells)
+ *   restarts from the first row
+ * - BOUNCE / SCANNER: positions come from a triangle wave of the step count;
+ *   the scanner's trail is just its own positions a few steps ago, so the
+ *   trail folds up at the ends by itself, and its last cell blinks out
+ *   every other frame (the decay)
+ *
+ * Header-only on purpose: libchaser (sim/chaser.cpp) runs these same
+ * functions for its batched games, so its LEDs match the firmware's bit for
+ * bit. The playlists at the end are shared the same way.
+ *
+ * Related files:
+ * - hardware.cpp section 2: Celebration and attract showcase animations
+ * - config.h: Frame timing (CELEBRATION_LED_DELAY, ATTRACT_SHOW_*)
+ * - sim/tools/effects_preview.cpp: Every preset printed frame by frame
+ ******************************************************************************/
+
+#ifndef EFFECTS_H
+#define EFFECTS_H
+
+#include <Arduino.h>
+#include "config.h"
+
+static_assert(NUM_LEDS == 8, "Effect frames are one byte: one bit per LED");
+
+enum LedEffectKind {
+    EFFECT_WAVE,
+    EFFECT_SPARKLE,
+    EFFECT_AUTOMATON,
+    EFFECT_BOUNCE,
+    EFFECT_SCANNER
+};
+
+typedef struct {
+    uint8_t kind;              // LedEffectKind
+    uint8_t a;                 // Parameters, see the table above
+    uint8_t b;
+} EffectPreset;
+
+typedef struct {
+    EffectPreset preset;
+    uint8_t step;              // Frames generated, mod EFFECT_STEP_WRAP
+    uint16_t state;            // SPARKLE: xorshift state, AUTOMATON: cells
+} LedEffect;
+
+// Every period the generators use (8 for the wave, 14 for an 8-LED triangle,
+// 6 for a 4-LED one) divides this, so wrapping the step never shows a jump
+const uint8_t EFFECT_STEP_WRAP = 168;
+
+/**
+ * effect_triangle - Position bouncing over 0..@span-1 at frame @step
+ *
+ * 0, 1, ... span-1, span-2, ... 1, then again: period 2 × (span - 1).
+ */
+static inline uint8_t effect_triangle(uint8_t step, uint8_t span) {
+    uint8_t period = (uint8_t)(2 * (span - 1));
+    uint8_t t = step % period;
+    return t < span ? t : (uint8_t)(period - t);
+}
+
+static inline uint16_t effect_xorshift(uint16_t x) {
+    x ^= (uint16_t)(x << 7);
+    x ^= (uint16_t)(x >> 9);
+    x ^= (uint16_t)(x << 8);
+    return x;
+}
+
+/**
+ * effect_automaton_step - Next generation of an elementary CA on an 8-cell ring
+ * @param cells: Bit n = cell n alive
+ * @param rule: Wolfram rule number; bit p set = neighbourhood p lives
+ *
+ * Neighbourhood p is (left << 2) | (self << 1) | right, with cell n - 1 on
+ * the left (the LED before it).
+ */
+static inline uint8_t effect_automaton_step(uint8_t cells, uint8_t rule) {
+    uint8_t left = (uint8_t)((cells << 1) | (cells >> 7));
+    uint8_t right = (uint8_t)((cells >> 1) | (cells << 7));
+    uint8_t next = 0;
+    for (uint8_t p = 0; p < 8; p++) {
+        if (rule & (1 << p)) {
+            next |= (uint8_t)(((p & 4) ? left : ~left) & ((p & 2) ? cells : ~cells) &
+                              ((p & 1) ? right : ~right));
+        }
+    }
+    return next;
+}
+
+/**
+ * effect_start - Begin @preset from its first frame
+ * @param seed: Randomness for SPARKLE (any value; millis() does nicely)
+ */
+static inline void effect_start(LedEffect *e, const EffectPreset *preset, uint16_t seed) {
+    e->preset = *preset;
+    e->step = 0;
+    if (preset->kind == EFFECT_AUTOMATON) {
+        e->state = preset->b;
+    } else {
+        e->state = (uint16_t)(seed | 1);   // xorshift must not start at 0
+    }
+}
+
+/**
+ * effect_next - The frame to show now; advances the effect by one step
+ */
+static inline uint8_t effect_next(LedEffect *e) {
+    uint8_t step = e->step;
+    uint8_t frame = 0;
+    e->step = (uint8_t)((step + 1) % EFFECT_STEP_WRAP);
+
+    switch (e->preset.kind) {
+        case EFFECT_WAVE:
+            frame = (uint8_t)(1 << (step % NUM_LEDS));
+            break;
+
+        case EFFECT_SPARKLE:
+            frame = 0xFF;
+            for (uint8_t i = 0; i < e->preset.a; i++) {
+                e->state = effect_xorshift(e->state);
+                frame &= (uint8_t)e->state;
+            }
+            break;
+
+        case EFFECT_AUTOMATON: {
+            frame = (uint8_t)e->state;
+            uint8_t next = effect_automaton_step(frame, e->preset.a);
+            e->state = next != 0 ? next : e->preset.b;   // Died out: start over
+            break;
+        }
+
+        case EFFECT_BOUNCE: {
+            uint8_t q = effect_triangle(step, NUM_LEDS / 2);
+            frame = (uint8_t)((1 << q) | (0x80 >> q));
+            if (e->preset.a != 0) {
+                q = effect_triangle((uint8_t)(step + e->preset.a), NUM_LEDS / 2);
+                frame |= (uint8_t)((1 << q) | (0x80 >> q));
+            }
+            break;
+        }
+
+        case EFFECT_SCANNER: {
+            frame = (uint8_t)(1 << effect_triangle(step, NUM_LEDS));
+            uint8_t trail = (step & 1) ? e->preset.a : (uint8_t)(e->preset.a - (e->preset.a != 0));
+            for (uint8_t k = 1; k <= trail; k++) {
+                uint8_t then = (uint8_t)((step + EFFECT_STEP_WRAP - k) % EFFECT_STEP_WRAP);
+                frame |= (uint8_t)(1 << effect_triangle(then, NUM_LEDS));
+            }
+            break;
+        }
+    }
+    return frame;
+}
+
+/******************************************************************************
+ * PLAYLISTS
+ *
+ * Each new high score shows the next celebration effect, and each attract
+ * showcase the next attract effect, round and round.
+ ******************************************************************************/
+
+static const EffectPreset celebration_effects[] = {
+    {EFFECT_WAVE, 0, 0},
+    {EFFECT_SCANNER, 3, 0},
+    {EFFECT_SPARKLE, 1, 0},
+    {EFFECT_AUTOMATON, 90, 0x18},
+    {EFFECT_BOUNCE, 2, 0}
+};
+
+static const EffectPreset attract_effects[] = {
+    {EFFECT_SCANNER, 2, 0},
+    {EFFECT_AUTOMATON, 30, 0x10},
+    {EFFECT_SPARKLE, 2, 0},
+    {EFFECT_BOUNCE, 0, 0},
+    {EFFECT_AUTOMATON, 90, 0x81},
+    {EFFECT_SPARKLE, 3, 0},
+    {EFFECT_BOUNCE, 3, 0}
+};
+
+const uint8_t CELEBRATION_EFFECT_COUNT = sizeof(celebration_effects) / sizeof(celebration_effects[0]);
+const uint8_t ATTRACT_EFFECT_COUNT = sizeof(attract_effects) / sizeof(attract_effects[0]);
+
+#endif // EFFECTS_H
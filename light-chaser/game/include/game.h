@@ -80,6 +80,7 @@
 
 #include <Arduino.h>
 #include "config.h"
+#include "snapshot.h"
 
 /******************************************************************************
  * STATE HANDLER STRUCTURE - Function Pointer Pattern
@@ -185,12 +186,14 @@
  *
  * See game.cpp:state_handlers[] for the actual table:
  *
- *   static const StateHandler state_handlers[5] = {
+ *   static const StateHandler state_handlers[7] = {
  *       [STATE_ATTRACT]     = {attract_enter,     attract_update,     attract_exit},
  *       [STATE_PLAYING]     = {playing_enter,     playing_update,     playing_exit},
  *       [STATE_RESULT]      = {result_enter,      result_update,      result_exit},
  *       [STATE_CELEBRATION] = {celebration_enter, celebration_update, celebration_exit},
- *       [STATE_GAME_OVER]   = {game_over_enter,   game_over_update,   game_over_exit}
+ *       [STATE_GAME_OVER]   = {game_over_enter,   game_over_update,   game_over_exit},
+ *       [STATE_CALIBRATION] = {calibration_enter, calibration_update, calibration_exit},
+ *       [STATE_SELF_TEST]   = {self_test_enter,   self_test_update,   self_test_exit}
  *   };
  *
  * Array index = GameState enum value. To call current state's update:
@@ -245,8 +248,8 @@ void game_init(void);
 /**
  * game_update - Execute one frame of game logic
  *
- * Called every iteration of main.cpp:loop() (typically 1000-20000 times/sec
- * depending on current game state).
+ * Called every iteration of main.cpp:loop(), which runs whenever something
+ * is due (game_ms_until_next_event()) or the button changes.
  *
  * Responsibilities:
  * - Call animation_update() to advance any playing animations
@@ -328,4 +331,83 @@ void game_update(void);
  */
 void game_transition_to(GameState new_state);
 
+/**
+ * GameStatus - Read-only copy of the core game variables
+ *
+ * game.cpp keeps its variables static, so nothing outside the file can
+ * change them. Tools that need to OBSERVE the game (the host simulator,
+ * the batched engine's equivalence check) get a copy through
+ * game_get_status() instead.
+ */
+typedef struct {
+    GameState state;         // current_state
+    uint8_t position;        // Chase LED index (0-7)
+    int8_t direction;        // +1 = right, -1 = left
+    uint16_t chase_speed;    // ms between LED movements
+    uint16_t score;          // Score for the current game
+    uint16_t high_score;     // High score (including an unsaved new record)
+} GameStatus;
+
+/**
+ * game_get_status - Copy the core game variables
+ * @param status: Filled in with the current values
+ *
+ * The firmware only calls it in a TIMEBASE_STATS build (main.cpp, to
+ * count idle time in attract mode); otherwise the linker drops it.
+ */
+void game_get_status(GameStatus *status);
+
+/**
+ * GameThroughput - How quickly one game follows another (since boot)
+ *
+ * Dead time runs from a miss to the next game's start: the end-of-game
+ * animation, ATTRACT, and the player's own pause. Pressing during the
+ * animation (a skip, see restart_update() in game.cpp) starts the next
+ * game without waiting for ATTRACT. A cabinet left alone after a game
+ * shows up as one long dead time.
+ */
+typedef struct {
+    uint16_t games;                  // Games started
+    uint16_t restarts;               // ... of them by a skip
+    uint16_t dead_ms_last;           // Dead time before the latest game (capped)
+    uint32_t dead_ms_total;          // Summed over all games after the first
+    uint32_t restart_latency_max_us; // Skip press -> next game running, worst
+} GameThroughput;
+
+/**
+ * game_get_throughput - Copy the throughput counters
+ * @param t: Filled in with the current values
+ *
+ * Like game_get_status(), for tools; the Uno build drops it.
+ */
+void game_get_throughput(GameThroughput *t);
+
+/**
+ * game_ms_until_next_event - How long game_update() will change nothing
+ * @return: ms from now until the next chase step, state timeout, animation
+ *          step or unread button change (0 = due now), NO_PENDING_EVENT if
+ *          nothing is scheduled
+ *
+ * Calling game_update() any earlier than this is a no-op, which lets the
+ * firmware sleep until then (timebase_sleep() in main.cpp) and the host
+ * simulator jump its virtual clock from event to event (sim_run_until()).
+ */
+uint32_t game_ms_until_next_event(void);
+
+/**
+ * game_snapshot_write - Send a snapshot of the game and HAL (snapshot.h)
+ * @param out: Called for the header and each part, in order
+ * @param context: Passed to @out
+ *
+ * game_snapshot_load - Carry on from a snapshot (host simulator)
+ * @param data: A whole snapshot, as game_snapshot_write() sent it
+ * @return: SnapshotError; nothing is changed unless SNAPSHOT_OK
+ *
+ * Call between loop()s. The board calls game_snapshot_write() itself when
+ * asked over serial (SNAPSHOT_DUMP); game_snapshot_load() is for the host,
+ * after sim_power_on().
+ */
+void game_snapshot_write(SnapshotWriter out, void *context);
+uint8_t game_snapshot_load(const uint8_t *data, uint16_t size);
+
 #endif // GAME_H
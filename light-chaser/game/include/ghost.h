@@ -0,0 +1,190 @@
+/******************************************************************************
+ * GHOST.H - The Champion's Run, a Few Bytes per Hit
+ *
+ * Every game is recorded as it is played. When a game sets a new high
+ * score, its recording is stored in EEPROM, and attract mode plays it back
+ * between showcases: the same chase, the same presses at the same moments,
+ * the same hits and the same final miss (the "ghost"). A passer-by sees
+ * what the record looks like, and what it takes to beat it.
+ *
+ * WHAT IS RECORDED:
+ * The chase is already a function of where it started and how the presses
+ * fell: chase_next(), calculate_score() and the speed-up are the same code
+ * every time. So the ghost stores the starting point, and for each press
+ * only when it came, counted in chase steps:
+ *
+ *   steps   Chase steps since the rally started (the game started, or the
+ *           RESULT pause ended): the press came after this many steps
+ *   ms      Milliseconds after the last of those steps (or the rally start)
+ *
+ * Each rally begins at 0, so the counts are deltas from the previous press
+ * and stay small. Both are written as varints: 7 bits per byte, high bit
+ * set on every byte but the last. A step count under 128 is one byte, and
+ * so is a press under 128 ms after its step: usually 2 bytes per hit, 3 at
+ * the slow speeds of the first hits.
+ *
+ * Playback (game.cpp, STATE_ATTRACT) steps the chase and waits for step
+ * @steps, then judges the press at (that step + @ms - latency), exactly the
+ * moment the game judged it. The loop being late doesn't move it.
+ *
+ * THE IMAGE (EEPROM_GHOST_ADDR, and game.cpp's RAM copy):
+ *   Byte 0:        EEPROM_MAGIC_BYTE
+ *   Byte 1:        GHOST_VERSION
+ *   Byte 2:        Press data length (bytes)
+ *   Byte 3:        Chase position at the start
+ *   Byte 4:        Chase direction at the start (int8_t)
+ *   Byte 5:        Latency offset the game was judged with (int8_t)
+ *   Bytes 6-7:     RULE_RND seed (rule_random at the start)
+ *   Bytes 8-9:     Final score (the record)
+ *   Byte 10:       Game mode tag: ghost_crc8() of the rule parts
+ *   Byte 11:       CRC-8 of bytes 0-10 and the press data
+ *   Then:          The presses, steps then ms, the miss last
+ *
+ * WHY A CRC, NOT THE USUAL XOR CHECKSUM:
+ * The other records are 3-12 bytes; this one is up to 212, and an XOR
+ * misses any two flips in the same bit column. A CRC-8 (polynomial 0x07)
+ * catches every 1-, 2- and 3-bit error at this length, and every burst up
+ * to 8 bits. It is computed once per save and once per check, never per
+ * press. A half-finished save is caught before the CRC: it is written
+ * across many loop()s with the magic byte cleared first and written last
+ * (game.cpp, ghost_save_service()), so until then no ghost is stored.
+ *
+ * A ghost is only played while it still describes the record: its score
+ * must equal the high score and its tag the loaded game mode. Otherwise
+ * attract plays showcases alone.
+ *
+ * Header-only, like rules.h: sim/tools/ghost_check.cpp decodes images
+ * with the same functions.
+ *
+ * Related files:
+ * - game.cpp: Recording (playing_update()), playback (attract_update())
+ * - hardware.cpp section 4: eeprom_read_ghost() / eeprom_write_ghost()
+ * - board.h: GHOST_REPLAY (not on the ATtiny85)
+ * - sim/tools/ghost_check.cpp: Plays a record, then checks the replay
+ ******************************************************************************/
+
+#ifndef GHOST_H
+#define GHOST_H
+
+#include <Arduino.h>
+#include "config.h"
+
+const uint8_t GHOST_VERSION = 1;
+const uint8_t GHOST_HEADER_SIZE = 12;
+const uint8_t GHOST_DATA_MAX = 200;                  // ~80 presses
+const uint8_t GHOST_IMAGE_MAX = GHOST_HEADER_SIZE + GHOST_DATA_MAX;
+const uint8_t GHOST_SAVE_BYTES = 1;                  // Per loop(): one 3.3 ms EEPROM write
+const uint16_t GHOST_NO_PRESS = 0xFFFF;              // Decoded past the last press
+
+// Offsets in the image
+enum {
+    GHOST_MAGIC,
+    GHOST_VERSION_AT,
+    GHOST_LENGTH,
+    GHOST_POSITION,
+    GHOST_DIRECTION,
+    GHOST_LATENCY,
+    GHOST_SEED,                 // 2 bytes, low first
+    GHOST_SCORE = GHOST_SEED + 2,
+    GHOST_RULES = GHOST_SCORE + 2,
+    GHOST_CRC
+};
+
+/**
+ * ghost_crc8 - CRC-8 (polynomial 0x07) of @size bytes, continuing from @crc
+ */
+static inline uint8_t ghost_crc8(uint8_t crc, const uint8_t *data, uint8_t size) {
+    for (uint8_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * ghost_image_crc - The CRC of an image: every byte but GHOST_CRC
+ */
+static inline uint8_t ghost_image_crc(const uint8_t *image, uint8_t size) {
+    uint8_t crc = ghost_crc8(0, image, GHOST_CRC);
+    return ghost_crc8(crc, image + GHOST_HEADER_SIZE, (uint8_t)(size - GHOST_HEADER_SIZE));
+}
+
+/**
+ * ghost_image_size - Size of the image @image starts, from its header
+ * @return: 0 if the header isn't a ghost's (never written, another version)
+ */
+static inline uint8_t ghost_image_size(const uint8_t *image) {
+    if (image[GHOST_MAGIC] != EEPROM_MAGIC_BYTE || image[GHOST_VERSION_AT] != GHOST_VERSION ||
+        image[GHOST_LENGTH] > GHOST_DATA_MAX) {
+        return 0;
+    }
+    return (uint8_t)(GHOST_HEADER_SIZE + image[GHOST_LENGTH]);
+}
+
+/**
+ * ghost_image_check - Is @image (@size bytes) a whole, undamaged ghost?
+ * @return: @size if so, else 0
+ */
+static inline uint8_t ghost_image_check(const uint8_t *image, uint8_t size) {
+    if (size < GHOST_HEADER_SIZE || ghost_image_size(image) != size ||
+        image[GHOST_CRC] != ghost_image_crc(image, size)) {
+        return 0;
+    }
+    return size;
+}
+
+/**
+ * ghost_image_seal - Fill in the length and CRC of a recording @size long
+ */
+static inline void ghost_image_seal(uint8_t *image, uint8_t size) {
+    image[GHOST_MAGIC] = EEPROM_MAGIC_BYTE;
+    image[GHOST_VERSION_AT] = GHOST_VERSION;
+    image[GHOST_LENGTH] = (uint8_t)(size - GHOST_HEADER_SIZE);
+    image[GHOST_CRC] = ghost_image_crc(image, size);
+}
+
+/**
+ * ghost_put - Append @value as a varint at @image[@at]
+ * @return: The byte after it, or 0 if it doesn't fit in GHOST_IMAGE_MAX
+ *
+ * One byte under 128, two under 16384, three above: a loop iteration per
+ * 7 bits, a compare and a store each.
+ */
+static inline uint8_t ghost_put(uint8_t *image, uint8_t at, uint16_t value) {
+    while (value >= 0x80) {
+        if (at >= GHOST_IMAGE_MAX) {
+            return 0;
+        }
+        image[at++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    if (at >= GHOST_IMAGE_MAX) {
+        return 0;
+    }
+    image[at++] = (uint8_t)value;
+    return at;
+}
+
+/**
+ * ghost_get - Read the varint at @image[*@at], moving *@at past it
+ * @param end: First byte after the press data
+ * @return: The value, or GHOST_NO_PRESS at (or past) @end
+ */
+static inline uint16_t ghost_get(const uint8_t *image, uint8_t *at, uint8_t end) {
+    uint16_t value = 0;
+    for (uint8_t shift = 0; shift < 16; shift += 7) {
+        if (*at >= end) {
+            return GHOST_NO_PRESS;
+        }
+        uint8_t byte = image[(*at)++];
+        value |= (uint16_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    return GHOST_NO_PRESS;
+}
+
+#endif // GHOST_H
@@ -53,6 +53,9 @@
 #define HARDWARE_H
 
 #include <Arduino.h>
+#include "config.h"
+#include "board.h"
+#include "snapshot.h"
 
 /******************************************************************************
  * INITIALISATION
@@ -81,6 +84,52 @@
 
 void hardware_init(void);
 
+/******************************************************************************
+ * POWER-ON SELF-TEST
+ *
+ * hardware_init() runs the self-test while the LCD powers up (see config.h).
+ * Results stay available for the rest of the session.
+ *
+ * PostStatus - Outcome of one check
+ *   POST_OK       Passed
+ *   POST_BLANK    EEPROM record never written (normal on a new board)
+ *   POST_FAILED   Fault found
+ *   POST_NOT_RUN  Check needs time that boot did not take (host simulator,
+ *                 whose LCD init is instant)
+ *
+ * PostResult - Everything the self-test found
+ *   lcd_address: I2C address the LCD answered on, 0 = no LCD found
+ *   spectator_address: Address of a second (mirrored) LCD, 0 = none
+ *   led_faults:  Bit n set = LED n's pin does not follow its output (shorted)
+ *
+ * WHAT IT CAN'T SEE:
+ * An LED that is open-circuit still reads back correctly; the sweep lights
+ * each LED in turn so a person watching can spot it.
+ *
+ * post_get_result - Self-test results (valid after hardware_init())
+ * post_passed - true if nothing FAILED and the LCD was found
+ * display_show_post - Show the results (see display section below)
+ ******************************************************************************/
+
+enum PostStatus {
+    POST_OK,
+    POST_BLANK,
+    POST_FAILED,
+    POST_NOT_RUN
+};
+
+typedef struct {
+    uint8_t lcd_address;
+    uint8_t spectator_address;
+    uint8_t led_faults;
+    PostStatus buzzer;
+    PostStatus eeprom_high_score;
+    PostStatus eeprom_latency;
+} PostResult;
+
+const PostResult *post_get_result(void);
+bool post_passed(void);
+
 /******************************************************************************
  * LED CONTROL - Simple GPIO Output
  *
@@ -90,12 +139,17 @@ void hardware_init(void);
  *                  Red Red Red Grn Grn Red Red Red
  *
  * led_set - Turn a single LED on or off
- * @param position: LED index (0-7)
+ * @param position: LED index (0-7); anything past the last LED is ignored
  * @param state: true = ON (HIGH/5V), false = OFF (LOW/0V)
  *
  * led_clear_all - Turn off all LEDs
- * Bulk operation, equivalent to calling led_set(i, false) for all LEDs.
- * Used during state transitions and animations.
+ * Same result as calling led_set(i, false) for all LEDs, in one write
+ * where the wiring allows it. Used during state transitions and animations.
+ *
+ * BACKENDS:
+ * Both go straight to the LED backend board.h picked for this build (see
+ * leds.h), and are defined here so they inline into the caller: the chase
+ * step in game.cpp costs a port write on the Uno, not a call.
  *
  * EXAMPLE USAGE:
  *   led_set(3, true);   // Turn on LED 3 (first green LED)
@@ -103,8 +157,13 @@ void hardware_init(void);
  *   led_clear_all();    // Turn off all LEDs at once
  ******************************************************************************/
 
-void led_set(uint8_t position, bool state);
-void led_clear_all(void);
+static inline void led_set(uint8_t position, bool state) {
+    BoardLeds::set(position, state);
+}
+
+static inline void led_clear_all(void) {
+    BoardLeds::clear_all();
+}
 
 /******************************************************************************
  * BUTTON INPUT - Edge Detection with Debouncing
@@ -140,10 +199,15 @@ void led_clear_all(void);
  * Physical buttons "bounce," contacts make/break rapidly (~5-20ms) before
  * settling. Without debouncing, one press = multiple detected transitions.
  *
- * Our implementation enforces 50ms lockout between detected presses.
+ * Our implementation accepts a press only after the line has been quiet
+ * for a lockout learned from this switch's own bounce (3-50ms, debounce.h).
  * See hardware.cpp:button_just_pressed() for detailed implementation.
  *
- * button_clear_state - Reset edge detector to current physical state
+ * button_edge - The pin changed to @down at @at_us (pin-change ISR only)
+ * Times the edge, learns from it, and counts it if it is a press.
+ * The host simulator calls it from sim_set_button().
+ *
+ * button_clear_state - Forget presses not yet taken
  *
  * Called during state transitions to prevent "stale" button presses.
  *
@@ -154,17 +218,94 @@ void led_clear_all(void);
  * 4. STATE_PLAYING sees old press, immediately registers hit (unintended!)
  *
  * Solution: Call button_clear_state() in state exit functions.
+ *
+ * button_service - Save the learned bounce profile to EEPROM if it drifted
+ * @param save_ok: false while a save would be noticed (during a game)
+ *
+ * button_ms_until_next_event - 0 if button_service() would save now,
+ * NO_PENDING_EVENT otherwise
+ *
+ * button_is_down - Current button LEVEL (no edge detection, no debouncing)
+ * Only for the power-on check "is the button held?" (calibration mode).
+ *
+ * EXPANDER BUTTONS:
+ * If an input expander is fitted (below), a press on any of its player
+ * buttons is also "the button": button_just_pressed() returns it once, in
+ * the state update that follows the read. A state that doesn't ask misses
+ * it, as it would miss a tap on the main button.
  ******************************************************************************/
 
 bool button_just_pressed(void);
+void button_edge(uint32_t at_us, bool down);
 void button_clear_state(void);
+bool button_is_down(void);
+void button_service(bool save_ok);
+uint32_t button_ms_until_next_event(bool save_ok);
+
+/******************************************************************************
+ * INPUT EXPANDER - MCP23017 on the I2C Bus (optional)
+ *
+ * 8 player buttons and 8 operator switches for the price of one pin (INTA)
+ * plus the I2C bus the LCD already uses. Found at boot; without one, all of
+ * this does nothing. See config.h for wiring.
+ *
+ * INTERRUPT-DRIVEN, NEVER POLLED:
+ * A change on any expander input pulls INTA low and latches the port levels
+ * (INTCAP). The pin-change interrupt stamps the time and wakes loop(), and
+ * expander_service() does ONE burst read of INTCAPA, INTCAPB, GPIOA, GPIOB:
+ *
+ *   edge ──► INTA low ──► PCINT (timestamp) ──► burst read ──► press queue
+ *                                                    │
+ *                             INTCAP: levels at the edge (edge time)
+ *                             GPIO:   any later change (read time)
+ *
+ * No I2C traffic happens unless INTA says there is something to read.
+ *
+ * SHARING THE BUS WITH THE LCD:
+ * A screen update is ~30 I2C-heavy characters (~40 ms). Input goes first:
+ * the LCD object checks for a pending expander read before every character,
+ * so a press waits for at most one LCD byte, not a whole screen.
+ *
+ * expander_present - Did an MCP23017 answer at boot?
+ *
+ * expander_service - Burst-read the expander if INTA is asserted
+ * Called at the top of every game_update(); the LCD does the same read
+ * between characters. Also retires presses the last state update ignored.
+ *
+ * expander_input_pending - INTA asserted (the next game_update() will read)
+ *
+ * expander_switch_is_on - Level of operator switch @n (GPB0-GPB7)
+ * @return: true while the switch is closed
+ *
+ * expander_get_latency - Press latency measured by the firmware itself
+ * From the INTA edge to the burst read finishing (every read), and to
+ * button_just_pressed() handing the press to the game (presses only).
+ ******************************************************************************/
+
+typedef struct {
+    uint16_t reads;             // Burst reads (one per INTA interrupt)
+    uint32_t read_last_us;      // Edge -> burst read complete
+    uint32_t read_max_us;
+    uint32_t read_total_us;     // Mean = read_total_us / reads
+    uint16_t presses;           // Player presses handed to the game
+    uint32_t press_last_us;     // Edge -> button_just_pressed() returned it
+    uint32_t press_max_us;
+    uint32_t press_total_us;
+} ExpanderLatency;
+
+bool expander_present(void);
+void expander_service(void);
+bool expander_input_pending(void);
+bool expander_switch_is_on(uint8_t n);
+const ExpanderLatency *expander_get_latency(void);
 
 /******************************************************************************
  * SOUND EFFECTS - PWM Tone Generation
  *
  * HARDWARE SETUP:
- * Piezo buzzer connected to pin 11 (PWM-capable pin).
- * Arduino's tone() function generates square waves at specified frequencies.
+ * Piezo buzzer connected to pin 11 (Timer2's OC2A output).
+ * tone_play() (tone_timer.h) has Timer2 generate square waves at the note's
+ * frequency, with register values computed at compile time from F_CPU.
  *
  * buzzer_tick - Play brief tick sound (100 Hz, 20ms)
  * Used for each LED movement in chase animation.
@@ -172,16 +313,19 @@ void button_clear_state(void);
  * buzzer_hit - Play hit confirmation sound (500 Hz, 100ms)
  * Used for non-bullseye successful hits.
  *
+ * buzzer_beat - Play a short metronome click (1000 Hz, 30ms)
+ * Used for the calibration beat.
+ *
  * EMBEDDED CONCEPT: PWM (Pulse Width Modulation)
  * Arduino generates audio by rapidly toggling pin HIGH/LOW at audio frequencies.
  * Example: 1000 Hz tone = pin toggles HIGH/LOW 1000 times per second.
  * Buzzer membrane vibrates at this frequency → audible tone.
  *
  * NON-BLOCKING BEHAVIOUR:
- * Arduino's tone() returns IMMEDIATELY. The tone plays in the background
+ * tone_play() returns IMMEDIATELY. The tone plays in the background
  * using hardware timers. No delay() needed!
  *
- *   tone(pin, 500, 100);  // Start 500 Hz tone for 100ms
+ *   tone_play(TONE_HIT);  // Start 500 Hz tone for 100ms
  *   // Code continues immediately, tone plays independently
  *   led_set(0, true);     // Can do other work while tone plays
  *
@@ -190,6 +334,7 @@ void button_clear_state(void);
 
 void buzzer_tick(void);
 void buzzer_hit(void);
+void buzzer_beat(void);
 
 /******************************************************************************
  * LCD DISPLAY - I2C Character Display
@@ -210,7 +355,7 @@ void buzzer_hit(void);
  * @param high_score: High score to display
  * Display:
  *   ┌────────────────┐
- *   │Press to Play!  │
+ *   │Press to Play!  │   (coin-op: "Insert Coin" or "Credits: 2")
  *   │HiScore: 120    │
  *   └────────────────┘
  *
@@ -231,19 +376,94 @@ void buzzer_hit(void);
  *   │Score: 150      │
  *   └────────────────┘
  *
+ * display_show_calibration - Show calibration progress
+ * @param taps: Taps measured so far
+ * Display:
+ *   ┌────────────────┐
+ *   │Tap to the beat │
+ *   │Taps: 3/12      │
+ *   └────────────────┘
+ *
+ * display_show_latency - Show calibration result
+ * @param offset_ms: Measured offset (saved) or the kept old one (rejected)
+ * @param saved: false if the taps were too uneven to use
+ * Display:
+ *   ┌────────────────┐
+ *   │Latency: +12ms  │
+ *   │Saved           │   (or "Too uneven")
+ *   └────────────────┘
+ *
+ * display_show_post - Show self-test results (first fault, or all OK)
+ * Display:
+ *   ┌────────────────┐
+ *   │Self-test FAIL  │
+ *   │LED 3 shorted   │
+ *   └────────────────┘
+ *
+ * display_show_ghost - Show the attract replay of the record (ghost.h)
+ * @param score: The replayed game's score so far
+ * Display:
+ *   ┌────────────────┐
+ *   │Best run: 45    │
+ *   │Press to Play!  │   (coin-op: as on the attract screen)
+ *   └────────────────┘
+ *
  * display_clear - Clear display (blank screen, backlight remains on)
  *
+ * SCREEN LAYOUTS:
+ * The pictures above are the 16×2 screens. Each screen is a table of fields
+ * in layout.h, with a second set of tables for 20×4 LCDs (-DLCD_20X4).
+ *
  * PERFORMANCE NOTE:
- * I2C communication is relatively slow (~100 kHz clock = 10μs per bit).
- * Sending 32 characters (full 16×2 screen) takes ~3-4ms.
- * This is why display_show_game() only updates numbers, not labels.
+ * I2C communication is relatively slow (~100 kHz clock = 10μs per bit), and
+ * the backpack sends each character as several I2C writes: about 1 ms per
+ * character, ~35 ms for a full 16×2 screen.
+ *
+ * SHADOW FRAME AND MIRRORED PANELS:
+ * The display_show_*() functions draw into a RAM copy of the screen. Each
+ * LCD panel (main, plus the spectator panel if one was found) remembers what
+ * it is showing, and only the characters that differ are sent. Panels take
+ * turns, one character each, so they finish together. One loop() sends for
+ * at most DISPLAY_FLUSH_BUDGET_US; the rest is sent by display_service() on
+ * the following loop()s. A slow second panel costs the main one at most
+ * half of each budget, and an absent one (not found at boot) costs nothing.
+ *
+ * display_service - Send what the last budget didn't (once per game_update())
+ * display_pending - true while some panel differs from the frame
+ *                   (game_ms_until_next_event() returns 0 meanwhile)
+ * display_get_stats - Bus use since boot:
+ *   panels:         LCDs being driven (1, or 2 with a spectator panel)
+ *   chars:          Characters sent, all panels
+ *   cursor_moves:   setCursor() commands sent, all panels
+ *   flushes:        Budgeted flushes that sent something
+ *   flush_total_us: Time spent in them
+ *   flush_max_us:   Longest one (the worst loop() stall the display causes)
+ *   lag_max_us:     Per panel: frame change to panel up to date, worst case
  ******************************************************************************/
 
 void display_show_attract(uint16_t high_score);
 void display_show_game(uint16_t score, uint16_t high_score);
 void display_show_celebration(uint16_t score);
+void display_show_calibration(uint8_t taps);
+void display_show_latency(int8_t offset_ms, bool saved);
+void display_show_post(void);
+void display_show_ghost(uint16_t score);
 void display_clear(void);
 
+typedef struct {
+    uint8_t panels;
+    uint32_t chars;
+    uint32_t cursor_moves;
+    uint32_t flushes;
+    uint32_t flush_total_us;
+    uint32_t flush_max_us;
+    uint32_t lag_max_us[LCD_PANELS];
+} DisplayStats;
+
+void display_service(void);
+bool display_pending(void);
+const DisplayStats *display_get_stats(void);
+
 /******************************************************************************
  * NON-BLOCKING ANIMATION SYSTEM
  *
@@ -292,7 +512,8 @@ void display_clear(void);
  * animation_start_celebration - Start new high score celebration
  * Parallel animation:
  * - Buzzer: 5-note melody (C-E-G-C-E, 150-300ms each)
- * - LEDs: Wave effect sweeps left-to-right 3 times (40ms per LED)
+ * - LEDs: The next effect of the celebration playlist (effects.h), 24
+ *   frames of 40ms; the first celebration after boot is the classic wave
  * Demonstrates PARALLEL TIMING - two animations with independent timers.
  *
  * animation_start_game_over - Start game over animation
@@ -300,6 +521,11 @@ void display_clear(void);
  * - Buzzer: 3-note descending "sad trombone" (400→300→200 Hz, 200ms each)
  * - LEDs: All flash on/off 5 times (150ms per state)
  *
+ * animation_start_showcase - Start the next attract playlist effect
+ * LEDs only, ATTRACT_SHOW_FRAMES frames of ATTRACT_SHOW_FRAME_MS, then all
+ * off. The first frame is shown at once. Attract mode hides the chase LED
+ * while it plays.
+ *
  * animation_is_playing - Check if any animation is active
  * @return: true if animation playing, false if idle
  *
@@ -308,9 +534,13 @@ void display_clear(void);
  *       game_transition_to(STATE_ATTRACT);  // Animation done, change state
  *   }
  *
+ * animation_stop - Abandon any playing animation (back to idle)
+ * Called from hardware_init() so a (simulated) reset always starts silent.
+ * Does not touch the LEDs or a note that is already sounding.
+ *
  * IMPLEMENTATION PREVIEW:
  * See hardware.cpp lines 84-246 for full implementation using:
- * - AnimationState enum (IDLE, BULLSEYE, CELEBRATION, GAME_OVER)
+ * - AnimationState enum (IDLE, BULLSEYE, CELEBRATION, GAME_OVER, SHOWCASE)
  * - millis() timestamps for timing
  * - Step counters for sequence position
  * - Parallel timing variables for simultaneous buzzer + LED effects
@@ -320,7 +550,38 @@ bool animation_update(void);
 void animation_start_bullseye(void);
 void animation_start_celebration(void);
 void animation_start_game_over(void);
+void animation_start_showcase(void);
 bool animation_is_playing(void);
+void animation_stop(void);
+
+/******************************************************************************
+ * NEXT-EVENT QUERIES - "How long will nothing happen?"
+ *
+ * Every timer in the firmware has the form "if (now - last >= interval)".
+ * Between two such timers expiring, and while the button level stays the
+ * same, loop() changes nothing at all. These functions expose when the next
+ * change can happen. The firmware's tickless sleep uses them (loop() calls
+ * timebase_sleep(game_ms_until_next_event())) to idle until then, and the
+ * host simulator to jump its virtual clock straight there instead of
+ * running thousands of empty loop() calls.
+ *
+ * millis_until_elapsed - Time left on a "now - since >= interval" timer
+ * @return: 0 if already expired
+ *
+ * button_input_pending - true if a press is waiting, or the button level
+ * differs from what the debouncer last saw (button_just_pressed() will act)
+ *
+ * animation_ms_until_next_event - ms until animation_update() next acts
+ * @return: 0 = due now, NO_PENDING_EVENT = idle
+ *
+ * See game_ms_until_next_event() in game.h for the state machine's part.
+ ******************************************************************************/
+
+const uint32_t NO_PENDING_EVENT = 0xFFFFFFFF;
+
+uint32_t millis_until_elapsed(uint32_t since, uint32_t interval);
+bool button_input_pending(void);
+uint32_t animation_ms_until_next_event(void);
 
 /******************************************************************************
  * EEPROM PERSISTENT STORAGE
@@ -382,9 +643,131 @@ bool animation_is_playing(void);
  *
  * See hardware.cpp:eeprom_read_high_score() and eeprom_write_high_score()
  * for complete implementation with detailed validation logic.
+ *
+ * eeprom_read_latency_offset - Load the calibrated button latency (ms)
+ * @return: Offset, clamped to ±LATENCY_OFFSET_MAX_MS; 0 if never calibrated
+ *
+ * eeprom_write_latency_offset - Save a calibration result
+ * Same magic byte + checksum scheme as the high score (3 bytes at address 4).
+ *
+ * eeprom_read_bounce_profile - Load the main button's learned bounce (µs)
+ * @return: BOUNCE_DEFAULT_US if nothing has been learned yet
+ *
+ * eeprom_write_bounce_profile - Save it (4 bytes at address 10)
+ *
+ * eeprom_read_rules - Load the game mode image (rules.h) at address 128
+ * @param image: RULES_IMAGE_MAX bytes
+ * @return: Its size, or 0 if none is stored (built-in rules)
+ *
+ * eeprom_write_rules - Store a game mode image that passed rules_image_load()
+ *
+ * eeprom_read_ghost - Load the record's ghost image (ghost.h) at address 288
+ * @param image: GHOST_IMAGE_MAX bytes
+ * @return: Its size, or 0 if the header is not a ghost's
+ *
+ * eeprom_write_ghost - Store one byte of a ghost image, at offset @at
+ * (game.cpp writes a new one GHOST_SAVE_BYTES per loop(), between games,
+ * its magic byte cleared first and written last)
  ******************************************************************************/
 
 uint16_t eeprom_read_high_score(void);
 void eeprom_write_high_score(uint16_t score);
+int8_t eeprom_read_latency_offset(void);
+void eeprom_write_latency_offset(int8_t offset_ms);
+uint16_t eeprom_read_bounce_profile(void);
+void eeprom_write_bounce_profile(uint16_t bounce_us);
+uint8_t eeprom_read_rules(uint8_t *image);
+void eeprom_write_rules(const uint8_t *image, uint8_t size);
+uint8_t eeprom_read_ghost(uint8_t *image);
+void eeprom_write_ghost(uint8_t at, uint8_t value);
+
+/******************************************************************************
+ * CREDITS AND AUDIT LEDGER
+ *
+ * Turns coin pulses (coin.h) into credits, and keeps all-time totals for
+ * the operator: coins accepted and games started. The totals and unplayed
+ * credits live in an EEPROM ledger (layout in config.h) that survives power
+ * cycles.
+ *
+ * WHEN THE LEDGER IS SAVED:
+ * A save is ~10 EEPROM bytes, ~35 ms of blocked loop(). It waits until
+ * nothing has changed for COIN_LEDGER_SETTLE_MS (a burst of pulses, or a
+ * coin then a start, is one save) and until game.cpp says the time is
+ * right (ATTRACT, never mid-game). Coins keep counting during the save: the
+ * ISR doesn't wait for loop(). The one exception is paying for a game on
+ * coin-op: that saves at once, hidden behind the game screen's own LCD
+ * update, so a power cut mid-game can't hand the credit back.
+ *
+ * credit_service - Collect new coin pulses; save the ledger if due
+ * @param save_ok: false while a save would be noticed (during a game)
+ *
+ * credit_count - Credits available (always 0 on free play)
+ *
+ * credit_take - Pay for a game: one credit, or nothing on free play
+ * @return: false if coin-op and no credit (the game must not start)
+ *
+ * credit_ms_until_next_event - ms until credit_service() next acts
+ * @return: 0 = uncollected pulses, NO_PENDING_EVENT = nothing to save
+ *
+ * credit_get_ledger - Totals (ledger) and since-boot counters
+ ******************************************************************************/
+
+typedef struct {
+    uint32_t coins;        // Coin pulses accepted, all time
+    uint32_t games;        // Games started, all time
+    uint8_t credits;       // Credits not yet played
+    uint16_t rejects;      // Pulses of the wrong width since boot (not saved)
+    uint16_t saves;        // Ledger saves since boot
+} CreditLedger;
+
+void credit_service(bool save_ok);
+uint8_t credit_count(void);
+bool credit_take(void);
+uint32_t credit_ms_until_next_event(bool save_ok);
+const CreditLedger *credit_get_ledger(void);
+
+/******************************************************************************
+ * GAME MODE UPLOAD (RULES_UPLOAD builds only)
+ *
+ * rules_upload_service - Collect a rule image (rules.h) from the serial port
+ * @param save_ok: false while an EEPROM write would be noticed (during a game)
+ * @return: true if a checked image has just been stored in EEPROM (the
+ *          caller reloads its rules)
+ *
+ * Answers every complete image with "RULES OK ..." or "RULES ERR ...". A
+ * good image waits for save_ok: storing it takes up to ~0.5 s.
+ *
+ * rules_upload_ms_until_next_event - ms until rules_upload_service() must run
+ * @return: 0 = bytes waiting or an image to store, else RULES_UPLOAD_POLL_MS
+ *          (the receive buffer fills in ~70 ms)
+ ******************************************************************************/
+
+#ifdef RULES_UPLOAD
+bool rules_upload_service(bool save_ok);
+uint32_t rules_upload_ms_until_next_event(bool save_ok);
+#endif
+
+/******************************************************************************
+ * SNAPSHOTS (include/snapshot.h)
+ *
+ * hal_snapshot_save - Copy the HAL's state into @s (timestamps as ages)
+ * hal_snapshot_load - Put the HAL's state back from @s (host simulator)
+ *
+ * Only game.cpp calls these, for game_snapshot_write() / _load().
+ *
+ * SNAPSHOT_DUMP builds only:
+ * snapshot_requested - Has SNAPSHOT_COMMAND arrived? (drains the port)
+ * snapshot_ms_until_next_event - 0 = bytes waiting, else SNAPSHOT_POLL_MS
+ * snapshot_serial_write - SnapshotWriter for the serial port
+ ******************************************************************************/
+
+void hal_snapshot_save(HalSnapshot *s);
+void hal_snapshot_load(const HalSnapshot *s);
+
+#ifdef SNAPSHOT_DUMP
+bool snapshot_requested(void);
+uint32_t snapshot_ms_until_next_event(void);
+void snapshot_serial_write(const void *data, uint16_t size, void *context);
+#endif
 
 #endif // HARDWARE_H
@@ -0,0 +1,483 @@
+/******************************************************************************
+ * LAYOUT.H - Screens as Tables of Fields
+ *
+ * Each screen used to be a run of setCursor() and print() calls, written
+ * for 16×2, with "    " printed after a number to wipe a longer old one.
+ * Moving the score one column, or fitting a 20×4, meant rewriting code. A
+ * screen is now a table. Each field has a position, a width, an alignment
+ * and where its text comes from:
+ *
+ *   { row, col, width, LAYOUT_LEFT,  LAYOUT_TEXT,  "HiScore: " }
+ *   { row, col, width, LAYOUT_LEFT,  LAYOUT_HIGH_SCORE, ""     }
+ *
+ * layout_render() turns a table plus the current values (LayoutValues) into
+ * a whole screen of characters. A field fills its full width, padded with
+ * spaces, and cells outside every field are spaces. Leftovers from the last
+ * screen can't survive, whatever was on it. hardware.cpp copies the result
+ * into its shadow frame, and only the characters that changed go over the
+ * bus (section 3), so a redraw costs what changed and nothing more.
+ *
+ * IN FLASH:
+ * On the AVR a plain const table, and every string literal it points to,
+ * is copied into SRAM at startup. The 16x2 tables would take ~300 of the
+ * Uno's 2048 bytes, and every new screen more. So the tables, their
+ * labels and layout_format()'s own texts are PROGMEM, and layout_render()
+ * copies one field at a time onto the stack (memcpy_P()). Each label is
+ * stored in its field (LAYOUT_LABEL_SIZE bytes, whatever its length), not
+ * pointed to: a pointer in a PROGMEM table to a literal would still put
+ * the literal in SRAM. Adding a screen now costs flash only.
+ *
+ * SCREEN SIZES:
+ * One set of tables for each LCD: 16×2 by default, 20×4 with -DLCD_20X4
+ * (config.h). Only the set for the build's LCD_COLS × LCD_ROWS is
+ * compiled. static_asserts check every field of it at compile time: on
+ * the screen, and a fixed label no wider than its field. A layout that
+ * doesn't fit fails the build, not the cabinet.
+ *
+ * ADDING A SCREEN:
+ * A ScreenId, a table for each size, and a display_show_*() that fills in
+ * the values it uses. New data needs a LayoutSource and one case in
+ * layout_format().
+ *
+ * Header-only, like effects.h: sim/tools/layout_preview.cpp renders every
+ * table without the rest of the firmware.
+ *
+ * Related files:
+ * - config.h: LCD_COLS, LCD_ROWS (LCD_20X4)
+ * - hardware.cpp section 3: display_show_*(), shadow frame and flushing
+ * - sim/tools/layout_preview.cpp: Every screen, both sizes
+ ******************************************************************************/
+
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <Arduino.h>
+#include "config.h"
+
+enum LayoutAlign {
+    LAYOUT_LEFT,
+    LAYOUT_RIGHT,
+    LAYOUT_CENTER
+};
+
+// Where a field's text comes from (layout_format())
+enum LayoutSource {
+    LAYOUT_TEXT,          // The field's own text
+    LAYOUT_SCORE,         // values->score
+    LAYOUT_HIGH_SCORE,    // values->high_score
+    LAYOUT_PROMPT,        // "Press to Play!", or coin-op "Insert Coin" / "Credits: 2"
+    LAYOUT_TAPS,          // values->taps "/" CALIBRATION_TAPS
+    LAYOUT_LATENCY,       // values->latency_ms, signed, with "ms"
+    LAYOUT_TITLE,         // values->title (NULL = blank)
+    LAYOUT_DETAIL         // values->detail (NULL = blank)
+};
+
+const uint8_t LAYOUT_LABEL_SIZE = LCD_COLS + 1;   // A full row, terminated
+
+typedef struct {
+    uint8_t row;
+    uint8_t col;
+    uint8_t width;             // Cells the field owns (text is cut to fit)
+    uint8_t align;             // LayoutAlign
+    uint8_t source;            // LayoutSource
+    char text[LAYOUT_LABEL_SIZE]; // LAYOUT_TEXT: what to show; otherwise ""
+} LayoutField;
+
+typedef struct {
+    const LayoutField *fields;
+    uint8_t count;
+} Layout;
+
+// Everything a field can show; each screen fills in what its table uses
+typedef struct {
+    uint16_t score;
+    uint16_t high_score;
+    uint8_t credits;
+    uint8_t taps;
+    int8_t latency_ms;
+    const char *title;
+    const char *detail;
+} LayoutValues;
+
+enum ScreenId {
+    SCREEN_BLANK,
+    SCREEN_ATTRACT,
+    SCREEN_GAME,
+    SCREEN_CELEBRATION,
+    SCREEN_CALIBRATION,
+    SCREEN_LATENCY,
+    SCREEN_POST,
+    SCREEN_GHOST,
+    SCREEN_COUNT
+};
+
+// Longest text layout_format() produces: titles and details are cut here,
+// and every other source is shorter ("Credits: 99", "-128ms")
+const uint8_t LAYOUT_TEXT_MAX = LCD_COLS;
+
+/******************************************************************************
+ * COMPILE-TIME CHECKS
+ *
+ * C++11 constexpr functions are a single return statement, so these recurse
+ * instead of looping.
+ ******************************************************************************/
+
+constexpr uint8_t layout_text_length(const char *text) {
+    return *text == '\0' ? 0 : (uint8_t)(1 + layout_text_length(text + 1));
+}
+
+constexpr bool layout_field_fits(const LayoutField *f) {
+    return f->row < LCD_ROWS && f->width > 0 && f->col + f->width <= LCD_COLS
+        && (f->source != LAYOUT_TEXT || layout_text_length(f->text) <= f->width);
+}
+
+constexpr bool layout_fits(const LayoutField *fields, uint8_t count) {
+    return count == 0 || (layout_field_fits(fields) && layout_fits(fields + 1, (uint8_t)(count - 1)));
+}
+
+#define LAYOUT_COUNT(fields) ((uint8_t)(sizeof(fields) / sizeof(fields[0])))
+#define LAYOUT_CHECK(fields) \
+    static_assert(layout_fits(fields, LAYOUT_COUNT(fields)), #fields " doesn't fit the LCD")
+
+/******************************************************************************
+ * THE SCREENS
+ *
+ * Each table's picture is what it shows with example values.
+ ******************************************************************************/
+
+#ifndef LCD_20X4
+
+// ┌────────────────┐
+// │Press to Play!  │
+// │HiScore: 100    │
+// └────────────────┘
+constexpr LayoutField PROGMEM attract_fields[] = {
+    {0, 0, 16, LAYOUT_LEFT, LAYOUT_PROMPT, ""},
+    {1, 0, 9, LAYOUT_LEFT, LAYOUT_TEXT, "HiScore: "},
+    {1, 9, 7, LAYOUT_LEFT, LAYOUT_HIGH_SCORE, ""}
+};
+
+// ┌────────────────┐
+// │Score:   45     │
+// │HiScore: 100    │
+// └────────────────┘
+constexpr LayoutField PROGMEM game_fields[] = {
+    {0, 0, 9, LAYOUT_LEFT, LAYOUT_TEXT, "Score:   "},
+    {0, 9, 7, LAYOUT_LEFT, LAYOUT_SCORE, ""},
+    {1, 0, 9, LAYOUT_LEFT, LAYOUT_TEXT, "HiScore: "},
+    {1, 9, 7, LAYOUT_LEFT, LAYOUT_HIGH_SCORE, ""}
+};
+
+// ┌────────────────┐
+// │NEW HIGH SCORE! │
+// │Score: 150      │
+// └────────────────┘
+constexpr LayoutField PROGMEM celebration_fields[] = {
+    {0, 0, 16, LAYOUT_LEFT, LAYOUT_TEXT, "NEW HIGH SCORE!"},
+    {1, 0, 7, LAYOUT_LEFT, LAYOUT_TEXT, "Score: "},
+    {1, 7, 9, LAYOUT_LEFT, LAYOUT_SCORE, ""}
+};
+
+// ┌────────────────┐
+// │Tap to the beat │
+// │Taps: 3/12      │
+// └────────────────┘
+constexpr LayoutField PROGMEM calibration_fields[] = {
+    {0, 0, 16, LAYOUT_LEFT, LAYOUT_TEXT, "Tap to the beat"},
+    {1, 0, 6, LAYOUT_LEFT, LAYOUT_TEXT, "Taps: "},
+    {1, 6, 10, LAYOUT_LEFT, LAYOUT_TAPS, ""}
+};
+
+// ┌────────────────┐
+// │Latency: +12ms  │
+// │Saved           │
+// └────────────────┘
+constexpr LayoutField PROGMEM latency_fields[] = {
+    {0, 0, 9, LAYOUT_LEFT, LAYOUT_TEXT, "Latency: "},
+    {0, 9, 7, LAYOUT_LEFT, LAYOUT_LATENCY, ""},
+    {1, 0, 16, LAYOUT_LEFT, LAYOUT_DETAIL, ""}
+};
+
+// ┌────────────────┐
+// │Self-test FAIL  │
+// │LED 3 shorted   │
+// └────────────────┘
+constexpr LayoutField PROGMEM post_fields[] = {
+    {0, 0, 16, LAYOUT_LEFT, LAYOUT_TITLE, ""},
+    {1, 0, 16, LAYOUT_LEFT, LAYOUT_DETAIL, ""}
+};
+
+// ┌────────────────┐
+// │Best run: 45    │
+// │Press to Play!  │
+// └────────────────┘
+constexpr LayoutField PROGMEM ghost_fields[] = {
+    {0, 0, 10, LAYOUT_LEFT, LAYOUT_TEXT, "Best run: "},
+    {0, 10, 6, LAYOUT_LEFT, LAYOUT_SCORE, ""},
+    {1, 0, 16, LAYOUT_LEFT, LAYOUT_PROMPT, ""}
+};
+
+#else // LCD_20X4
+
+// ┌────────────────────┐
+// │    LIGHT CHASER    │
+// │   Press to Play!   │
+// │                    │
+// │High score      100 │
+// └────────────────────┘
+constexpr LayoutField PROGMEM attract_fields[] = {
+    {0, 0, 20, LAYOUT_CENTER, LAYOUT_TEXT, "LIGHT CHASER"},
+    {1, 0, 20, LAYOUT_CENTER, LAYOUT_PROMPT, ""},
+    {3, 0, 11, LAYOUT_LEFT, LAYOUT_TEXT, "High score"},
+    {3, 11, 8, LAYOUT_RIGHT, LAYOUT_HIGH_SCORE, ""}
+};
+
+// ┌────────────────────┐
+// │Score            45 │
+// │High score      100 │
+// │                    │
+// │ Stop it on green!  │
+// └────────────────────┘
+constexpr LayoutField PROGMEM game_fields[] = {
+    {0, 0, 11, LAYOUT_LEFT, LAYOUT_TEXT, "Score"},
+    {0, 11, 8, LAYOUT_RIGHT, LAYOUT_SCORE, ""},
+    {1, 0, 11, LAYOUT_LEFT, LAYOUT_TEXT, "High score"},
+    {1, 11, 8, LAYOUT_RIGHT, LAYOUT_HIGH_SCORE, ""},
+    {3, 0, 20, LAYOUT_CENTER, LAYOUT_TEXT, "Stop it on green!"}
+};
+
+// ┌────────────────────┐
+// │  NEW HIGH SCORE!   │
+// │                    │
+// │Score           150 │
+// │                    │
+// └────────────────────┘
+constexpr LayoutField PROGMEM celebration_fields[] = {
+    {0, 0, 20, LAYOUT_CENTER, LAYOUT_TEXT, "NEW HIGH SCORE!"},
+    {2, 0, 11, LAYOUT_LEFT, LAYOUT_TEXT, "Score"},
+    {2, 11, 8, LAYOUT_RIGHT, LAYOUT_SCORE, ""}
+};
+
+// ┌────────────────────┐
+// │Latency calibration │
+// │  Tap to the beat   │
+// │                    │
+// │Taps           3/12 │
+// └────────────────────┘
+constexpr LayoutField PROGMEM calibration_fields[] = {
+    {0, 0, 20, LAYOUT_CENTER, LAYOUT_TEXT, "Latency calibration"},
+    {1, 0, 20, LAYOUT_CENTER, LAYOUT_TEXT, "Tap to the beat"},
+    {3, 0, 11, LAYOUT_LEFT, LAYOUT_TEXT, "Taps"},
+    {3, 11, 8, LAYOUT_RIGHT, LAYOUT_TAPS, ""}
+};
+
+// ┌────────────────────┐
+// │Latency calibration │
+// │                    │
+// │Offset        +12ms │
+// │       Saved        │
+// └────────────────────┘
+constexpr LayoutField PROGMEM latency_fields[] = {
+    {0, 0, 20, LAYOUT_CENTER, LAYOUT_TEXT, "Latency calibration"},
+    {2, 0, 11, LAYOUT_LEFT, LAYOUT_TEXT, "Offset"},
+    {2, 11, 8, LAYOUT_RIGHT, LAYOUT_LATENCY, ""},
+    {3, 0, 20, LAYOUT_CENTER, LAYOUT_DETAIL, ""}
+};
+
+// ┌────────────────────┐
+// │   Self-test FAIL   │
+// │                    │
+// │   LED 3 shorted    │
+// │                    │
+// └────────────────────┘
+constexpr LayoutField PROGMEM post_fields[] = {
+    {0, 0, 20, LAYOUT_CENTER, LAYOUT_TITLE, ""},
+    {2, 0, 20, LAYOUT_CENTER, LAYOUT_DETAIL, ""}
+};
+
+// ┌────────────────────┐
+// │    LIGHT CHASER    │
+// │ Replay: best run   │
+// │Score            45 │
+// │   Press to Play!   │
+// └────────────────────┘
+constexpr LayoutField PROGMEM ghost_fields[] = {
+    {0, 0, 20, LAYOUT_CENTER, LAYOUT_TEXT, "LIGHT CHASER"},
+    {1, 0, 20, LAYOUT_CENTER, LAYOUT_TEXT, "Replay: best run"},
+    {2, 0, 11, LAYOUT_LEFT, LAYOUT_TEXT, "Score"},
+    {2, 11, 8, LAYOUT_RIGHT, LAYOUT_SCORE, ""},
+    {3, 0, 20, LAYOUT_CENTER, LAYOUT_PROMPT, ""}
+};
+
+#endif // LCD_20X4
+
+LAYOUT_CHECK(attract_fields);
+LAYOUT_CHECK(game_fields);
+LAYOUT_CHECK(celebration_fields);
+LAYOUT_CHECK(calibration_fields);
+LAYOUT_CHECK(latency_fields);
+LAYOUT_CHECK(post_fields);
+LAYOUT_CHECK(ghost_fields);
+
+// Indexed by ScreenId
+static const Layout screen_layouts[SCREEN_COUNT] PROGMEM = {
+    {NULL, 0},                                            // SCREEN_BLANK
+    {attract_fields, LAYOUT_COUNT(attract_fields)},
+    {game_fields, LAYOUT_COUNT(game_fields)},
+    {celebration_fields, LAYOUT_COUNT(celebration_fields)},
+    {calibration_fields, LAYOUT_COUNT(calibration_fields)},
+    {latency_fields, LAYOUT_COUNT(latency_fields)},
+    {post_fields, LAYOUT_COUNT(post_fields)},
+    {ghost_fields, LAYOUT_COUNT(ghost_fields)}
+};
+
+/******************************************************************************
+ * RENDERING
+ ******************************************************************************/
+
+// layout_format()'s own texts, in flash like the tables
+static const char layout_play_text[] PROGMEM = "Press to Play!";
+static const char layout_coin_text[] PROGMEM = "Insert Coin";
+static const char layout_credits_text[] PROGMEM = "Credits: ";
+static const char layout_ms_text[] PROGMEM = "ms";
+
+/**
+ * layout_put_text - Append @text at @out, stopping at @limit; @return the end
+ */
+static inline char *layout_put_text(char *out, const char *limit, const char *text) {
+    while (text != NULL && *text != '\0' && out < limit) {
+        *out++ = *text++;
+    }
+    return out;
+}
+
+/**
+ * layout_put_text_P - layout_put_text() for a PROGMEM @text
+ */
+static inline char *layout_put_text_P(char *out, const char *limit, const char *text) {
+    char c;
+    while (out < limit && (c = (char)pgm_read_byte(text++)) != '\0') {
+        *out++ = c;
+    }
+    return out;
+}
+
+/**
+ * layout_count - Fields in screen @id's table
+ */
+static inline uint8_t layout_count(ScreenId id) {
+    return pgm_read_byte(&screen_layouts[id].count);
+}
+
+/**
+ * layout_field - Copy field @i of screen @id out of flash into @field
+ */
+static inline void layout_field(ScreenId id, uint8_t i, LayoutField *field) {
+    Layout layout;
+    memcpy_P(&layout, &screen_layouts[id], sizeof(layout));
+    memcpy_P(field, &layout.fields[i], sizeof(*field));
+}
+
+/**
+ * layout_put_number - Append @value in decimal at @out; @return the end
+ */
+static inline char *layout_put_number(char *out, uint16_t value) {
+    char digits[5];
+    uint8_t n = 0;
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (n > 0) {
+        *out++ = digits[--n];
+    }
+    return out;
+}
+
+/**
+ * layout_format - The text @field (a copy in RAM) shows with @values
+ * @param buffer: LAYOUT_TEXT_MAX characters of room (not terminated)
+ * @return: Characters written to @buffer
+ */
+static inline uint8_t layout_format(const LayoutField *field, const LayoutValues *values,
+                                    char *buffer) {
+    char *end = buffer;
+    const char *limit = buffer + LAYOUT_TEXT_MAX;
+    switch (field->source) {
+        case LAYOUT_TEXT:
+            end = layout_put_text(end, limit, field->text);
+            break;
+        case LAYOUT_SCORE:
+            end = layout_put_number(end, values->score);
+            break;
+        case LAYOUT_HIGH_SCORE:
+            end = layout_put_number(end, values->high_score);
+            break;
+        case LAYOUT_PROMPT:
+            if (FREE_PLAY) {
+                end = layout_put_text_P(end, limit, layout_play_text);
+            } else if (values->credits == 0) {
+                end = layout_put_text_P(end, limit, layout_coin_text);
+            } else {
+                end = layout_put_text_P(end, limit, layout_credits_text);
+                end = layout_put_number(end, values->credits);
+            }
+            break;
+        case LAYOUT_TAPS:
+            end = layout_put_number(end, values->taps);
+            *end++ = '/';
+            end = layout_put_number(end, CALIBRATION_TAPS);
+            break;
+        case LAYOUT_LATENCY:
+            *end++ = values->latency_ms < 0 ? '-' : '+';
+            end = layout_put_number(end, (uint16_t)(values->latency_ms < 0 ? -values->latency_ms
+                                                                           : values->latency_ms));
+            end = layout_put_text_P(end, limit, layout_ms_text);
+            break;
+        case LAYOUT_TITLE:
+            end = layout_put_text(end, limit, values->title);
+            break;
+        case LAYOUT_DETAIL:
+            end = layout_put_text(end, limit, values->detail);
+            break;
+    }
+    return (uint8_t)(end - buffer);
+}
+
+/**
+ * layout_render - Draw screen @id with @values into @screen
+ *
+ * Every cell of @screen is written: fields with their text, aligned and
+ * padded to their width (cut if it is longer), everything else with a space.
+ */
+static inline void layout_render(ScreenId id, const LayoutValues *values,
+                                 char screen[LCD_ROWS][LCD_COLS]) {
+    for (uint8_t r = 0; r < LCD_ROWS; r++) {
+        for (uint8_t c = 0; c < LCD_COLS; c++) {
+            screen[r][c] = ' ';
+        }
+    }
+
+    uint8_t count = layout_count(id);
+    for (uint8_t i = 0; i < count; i++) {
+        LayoutField field;
+        layout_field(id, i, &field);
+        char text[LAYOUT_TEXT_MAX];
+        uint8_t length = layout_format(&field, values, text);
+        if (length > field.width) {
+            length = field.width;
+        }
+        uint8_t pad = (uint8_t)(field.width - length);
+        uint8_t col = field.col;
+        if (field.align == LAYOUT_RIGHT) {
+            col += pad;
+        } else if (field.align == LAYOUT_CENTER) {
+            col += pad / 2;
+        }
+        for (uint8_t k = 0; k < length; k++) {
+            screen[field.row][col + k] = text[k];
+        }
+    }
+}
+
+#endif // LAYOUT_H
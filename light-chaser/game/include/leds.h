@@ -0,0 +1,268 @@
+/******************************************************************************
+ * LEDS.H - LED Backends, Chosen at Compile Time
+ *
+ * led_set() runs on every chase step, and led_clear_all() and the
+ * animation frames write all eight LEDs at once. How the LEDs are wired
+ * (a pin each, a port each, a shift register) should not cost a runtime
+ * decision on every one of those calls. Each way of driving them is a
+ * backend class here; board.h picks one per build, and hardware.h's
+ * led_set() calls it directly. The compiler sees the whole backend, so
+ * led_set() inlines into game.cpp: no function pointer, no vtable, no
+ * #ifdef at the call site.
+ *
+ * HOW A BACKEND IS BUILT (static polymorphism, "CRTP"):
+ *
+ *   struct LedsPins : LedBank<LedsPins> {
+ *       static void begin(void);                    // Outputs, all off
+ *       static void write_one(uint8_t position, bool on);
+ *       static void write_frame(uint8_t frame);     // Bit n = LED n
+ *       static uint8_t read_frame(void);            // What is lit now
+ *       static uint8_t self_test(void);             // Optional
+ *   };
+ *
+ * LedBank<Backend> is the part every backend shares: the bounds check in
+ * set(), and clear_all() and show() in terms of write_frame(). It calls
+ * Backend::write_one() by name, which the compiler resolves while
+ * compiling, not while running. A backend that defines its own
+ * self_test() hides LedBank's; one that can't read its outputs back (a
+ * shift register) keeps LedBank's "no faults found".
+ *
+ * THE BACKENDS:
+ *
+ *   Backend        Wiring                  led_set()        All 8 LEDs
+ *   LedsPins       A pin each, any board   1 digitalWrite   8 digitalWrites
+ *   LedsUnoPorts   Uno pins 2-9            1 port update    2 port updates
+ *                  (PD2-PD7, PB0-PB1)
+ *   LedsShift595   74HC595 on the ATtiny   8-bit shift      8-bit shift
+ *                  USI (DO, USCK, latch)
+ *
+ * digitalWrite() looks the pin's port and bit up in three flash tables,
+ * turns off PWM on the pin's timer and saves, clears and restores the
+ * interrupt flag: about 50 cycles, on every call. LedsUnoPorts knows the
+ * port and bit at compile time and only does the write.
+ *
+ * LedsUnoPorts changes PORTB and PORTD with read-modify-write and no cli():
+ * no interrupt handler in this firmware writes either port (tone_timer.cpp
+ * only disconnects OC2A, and the button and INTA pull-ups are set once in
+ * hardware_init()). A new ISR that writes them would have to change that.
+ *
+ * LedsShift595 can't set one LED without sending all eight, so it keeps the
+ * frame it last sent and sends it again with one bit changed. That copy is
+ * also its read_frame(); the others read their output latches (snapshots,
+ * include/snapshot.h).
+ *
+ * Related files:
+ * - board.h: Which backend this build uses
+ * - hardware.h: led_set() and led_clear_all(), the game's LED API
+ * - config.h: LED_PIN_START, NUM_LEDS
+ ******************************************************************************/
+
+#ifndef LEDS_H
+#define LEDS_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * LedBank - What every LED backend does the same way
+ */
+template <class Backend>
+struct LedBank {
+    /**
+     * set - Turn LED @position on or off (positions past the last LED are ignored)
+     */
+    static void set(uint8_t position, bool on) {
+        if (position >= NUM_LEDS) {
+            return;
+        }
+        Backend::write_one(position, on);
+    }
+
+    static void clear_all(void) {
+        Backend::write_frame(0);
+    }
+
+    /**
+     * show - Light exactly the LEDs set in @frame (bit n = LED n)
+     */
+    static void show(uint8_t frame) {
+        Backend::write_frame(frame);
+    }
+
+    /**
+     * self_test - LEDs whose output did not follow a write (bit n = LED n)
+     *
+     * Backends that can't read their outputs back report none.
+     */
+    static uint8_t self_test(void) {
+        return 0;
+    }
+};
+
+#ifndef LEDS_74HC595
+/**
+ * LedsPins - One Arduino pin per LED, from LED_PIN_START up
+ *
+ * Works on any board the core supports, and in the host simulator, which
+ * watches digitalWrite().
+ */
+struct LedsPins : LedBank<LedsPins> {
+    static void begin(void) {
+        for (uint8_t i = 0; i < NUM_LEDS; i++) {
+            pinMode(LED_PIN_START + i, OUTPUT);
+            digitalWrite(LED_PIN_START + i, LOW);
+        }
+    }
+
+    static void write_one(uint8_t position, bool on) {
+        digitalWrite(LED_PIN_START + position, on ? HIGH : LOW);
+    }
+
+    static void write_frame(uint8_t frame) {
+        for (uint8_t i = 0; i < NUM_LEDS; i++) {
+            write_one(i, (frame >> i) & 1);
+        }
+    }
+
+    // An output pin reads back the level it drives
+    static uint8_t read_frame(void) {
+        uint8_t frame = 0;
+        for (uint8_t i = 0; i < NUM_LEDS; i++) {
+            if (digitalRead(LED_PIN_START + i) == HIGH) {
+                frame |= (uint8_t)(1 << i);
+            }
+        }
+        return frame;
+    }
+
+    /**
+     * self_test - Drive each pin HIGH then LOW and read it back
+     *
+     * A pin shorted to a rail (or to its neighbour) reads the wrong level.
+     */
+    static uint8_t self_test(void) {
+        uint8_t faults = 0;
+        for (uint8_t i = 0; i < NUM_LEDS; i++) {
+            uint8_t pin = LED_PIN_START + i;
+            digitalWrite(pin, HIGH);
+            bool follows_high = digitalRead(pin) == HIGH;
+            digitalWrite(pin, LOW);
+            bool follows_low = digitalRead(pin) == LOW;
+            if (!follows_high || !follows_low) {
+                faults |= (uint8_t)(1 << i);
+            }
+        }
+        return faults;
+    }
+};
+
+#if defined(__AVR_ATmega328P__)
+/**
+ * LedsUnoPorts - The Uno's pins 2-9, written as ports
+ *
+ * LEDs 0-5 are PD2-PD7 and LEDs 6-7 are PB0-PB1, so a whole frame is
+ * PORTD = frame << 2 and PORTB = frame >> 6 (keeping the other bits:
+ * serial on PD0/PD1, button, buzzer and INTA on PB2-PB4).
+ */
+struct LedsUnoPorts : LedBank<LedsUnoPorts> {
+    static_assert(LED_PIN_START == 2 && NUM_LEDS == 8,
+                  "LedsUnoPorts is wired for 8 LEDs on pins 2-9; use LedsPins (-DLEDS_PINS)");
+
+    static void begin(void) {
+        PORTD &= 0x03;           // Off before they become outputs: no flash at boot
+        PORTB &= 0xFC;
+        DDRD |= 0xFC;
+        DDRB |= 0x03;
+    }
+
+    static void write_one(uint8_t position, bool on) {
+        volatile uint8_t *port = position < 6 ? &PORTD : &PORTB;
+        uint8_t mask = (uint8_t)(position < 6 ? 1 << (position + 2) : 1 << (position - 6));
+        if (on) {
+            *port |= mask;
+        } else {
+            *port &= (uint8_t)~mask;
+        }
+    }
+
+    static void write_frame(uint8_t frame) {
+        PORTD = (uint8_t)((PORTD & 0x03) | (frame << 2));
+        PORTB = (uint8_t)((PORTB & 0xFC) | (frame >> 6));
+    }
+
+    static uint8_t read_frame(void) {
+        return (uint8_t)((PORTD >> 2) | (PORTB << 6));
+    }
+
+    /**
+     * self_test - LedsPins' check, reading the PIN registers
+     *
+     * A pin's level takes a cycle to reach PINx through the input
+     * synchroniser, so each write is followed by a nop before the read.
+     */
+    static uint8_t self_test(void) {
+        uint8_t faults = 0;
+        for (uint8_t i = 0; i < NUM_LEDS; i++) {
+            volatile uint8_t *pins = i < 6 ? &PIND : &PINB;
+            uint8_t mask = (uint8_t)(i < 6 ? 1 << (i + 2) : 1 << (i - 6));
+            write_one(i, true);
+            __asm__ __volatile__("nop");
+            bool follows_high = (*pins & mask) != 0;
+            write_one(i, false);
+            __asm__ __volatile__("nop");
+            bool follows_low = (*pins & mask) == 0;
+            if (!follows_high || !follows_low) {
+                faults |= (uint8_t)(1 << i);
+            }
+        }
+        return faults;
+    }
+};
+#endif // __AVR_ATmega328P__
+
+#else // LEDS_74HC595
+/**
+ * LedsShift595 - A 74HC595 on the ATtiny's USI, latched by SR_LATCH_PIN
+ *
+ * The USI in three-wire mode shifts USIDR out of DO, MSB first, one bit
+ * per pair of USITC strobes on USCK: 16 writes of USICR per frame, about
+ * 40 cycles in all. The last bit shifted lands on QA, so bit 0 (LED 0)
+ * comes out of QA and bit 7 out of QH. A rising edge on RCLK then moves
+ * the frame to the outputs at once, so no LED flickers while it shifts.
+ */
+struct LedsShift595 : LedBank<LedsShift595> {
+    static uint8_t &sent(void) {
+        static uint8_t frame = 0;   // What the 595's outputs show
+        return frame;
+    }
+
+    static void begin(void) {
+        pinMode(SR_LATCH_PIN, OUTPUT);
+        pinMode(SR_DATA_PIN, OUTPUT);
+        pinMode(SR_CLOCK_PIN, OUTPUT);
+        write_frame(0);
+    }
+
+    static void write_one(uint8_t position, bool on) {
+        uint8_t mask = (uint8_t)(1 << position);
+        write_frame(on ? (uint8_t)(sent() | mask) : (uint8_t)(sent() & ~mask));
+    }
+
+    static void write_frame(uint8_t frame) {
+        sent() = frame;
+        USIDR = frame;
+        USISR = _BV(USIOIF);                    // Clear the flag and the 4-bit counter
+        while (!(USISR & _BV(USIOIF))) {
+            USICR = _BV(USIWM0) | _BV(USICS1) | _BV(USICLK) | _BV(USITC);
+        }
+        PORTB |= _BV(SR_LATCH_PIN);             // Arduino pin n is PBn: sbi, cbi
+        PORTB &= (uint8_t)~_BV(SR_LATCH_PIN);
+    }
+
+    static uint8_t read_frame(void) {
+        return sent();
+    }
+};
+#endif // LEDS_74HC595
+
+#endif // LEDS_H
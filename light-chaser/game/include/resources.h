@@ -0,0 +1,283 @@
+/******************************************************************************
+ * RESOURCES.H - Compile-Time Registry of Timers, Interrupts and Pins
+ *
+ * The ATmega328P has three timers, a handful of interrupt vectors and 20
+ * pins, and every feature that does something on time wants some of them.
+ * Nothing in the chip or the compiler stops two drivers from programming the
+ * same timer: the second one silently reconfigures the first. Notes play an
+ * octave off, millis() stops, and the bug shows up long after the change
+ * that caused it. So every driver that touches a timer, a vector, a
+ * peripheral or a pin declares it here, in one table. A build where two
+ * features want the same thing fails with a static_assert that names the
+ * feature.
+ *
+ * THE MAP (default build):
+ *
+ *   Resource      Owner                    Free for a new feature
+ *   Timer0        Arduino core (fast PWM)  compare A/B (shared clock, PWM 6/5)
+ *     overflow    timebase (switched off)
+ *   Timer1        timebase (clk/256, free) compare B, capture (shared clock)
+ *     compare A   timebase (sleep deadline)
+ *   Timer2        tone_play() (CTC/note)   - (lent to the stats probe)
+ *     compare A   tone_play() (counts toggles)
+ *   PCINT0        timebase (button, INTA wake)
+ *   PCINT1        coin counter (A0)
+ *   TWI           LCDs and expander (A4/A5)
+ *   USART0        trace, stats or game mode upload builds only (D0/D1)
+ *   Watchdog      main.cpp (4 s reset)
+ *
+ * HOW A FEATURE USES A RESOURCE:
+ * - owns: it configures it and nobody else may. Owning a compare channel
+ *   or vector means defining its ISR.
+ * - shares: it uses a timer that another feature owns without
+ *   reconfiguring it. This is how one timer serves several features. The
+ *   owner sets the clock once and leaves the counter running. Each sharer
+ *   owns a compare channel of its own and schedules against the counter
+ *   (OCR1B = TCNT1 + delay). Only timers whose owner promises never to
+ *   stop, reset or re-time them may be shared (RES_SHAREABLE).
+ * - borrows: it takes over another feature's timer while that feature is
+ *   idle, and puts every register back afterwards. Only timers whose owner
+ *   is idle for long stretches may be lent (RES_LENDABLE).
+ *
+ * Timer2 is not shareable: tone_play() reprograms its period for every
+ * note, so a second user's interrupts would follow the melody.
+ *
+ * ADDING A FEATURE (e.g. a chase-step ISR on Timer1):
+ *   X(HW_CHASE_ISR, RES_TIMER1_COMPB, RES_TIMER1, 0, 0)
+ * It shares timebase's clock and gets compare B to itself. An input-capture
+ * feature would own RES_TIMER1_CAPT and pin 8 (ICP1), and the build would
+ * fail: pin 8 is an LED. A "PWM LEDs" feature wanting Timer1 outputs would
+ * need pins 9 (an LED) and 10 (the button): same again.
+ *
+ * The checks are C++11 constexpr, like clocks.h. They run in every file that
+ * includes this header, and main.cpp always includes it. Rows that depend
+ * on build flags (TRACE_ENABLED, TIMEBASE_STATS, TIMEBASE_TIMER0,
+ * RULES_UPLOAD, SNAPSHOT_DUMP) claim nothing when their flag is off. Any two of the serial
+ * features in one build fail the check: each owns USART0.
+ *
+ * Related files:
+ * - timebase.cpp, tone_timer.cpp, coin.cpp, trace.cpp: The drivers claimed for
+ * - config.h: Pin numbers
+ ******************************************************************************/
+
+#ifndef RESOURCES_H
+#define RESOURCES_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * Resource bits - Each timer takes five: the timer itself (clock and mode),
+ * its compare channels, overflow and (Timer1 only) input capture, each with
+ * its interrupt vector
+ */
+const uint32_t RES_TIMER0        = 1UL << 0;
+const uint32_t RES_TIMER0_COMPA  = 1UL << 1;
+const uint32_t RES_TIMER0_COMPB  = 1UL << 2;
+const uint32_t RES_TIMER0_OVF    = 1UL << 3;
+const uint32_t RES_TIMER1        = 1UL << 5;
+const uint32_t RES_TIMER1_COMPA  = 1UL << 6;
+const uint32_t RES_TIMER1_COMPB  = 1UL << 7;
+const uint32_t RES_TIMER1_OVF    = 1UL << 8;
+const uint32_t RES_TIMER1_CAPT   = 1UL << 9;
+const uint32_t RES_TIMER2        = 1UL << 10;
+const uint32_t RES_TIMER2_COMPA  = 1UL << 11;
+const uint32_t RES_TIMER2_COMPB  = 1UL << 12;
+const uint32_t RES_TIMER2_OVF    = 1UL << 13;
+const uint32_t RES_PCINT0        = 1UL << 15;   // Pin-change group D8-D13
+const uint32_t RES_PCINT1        = 1UL << 16;   // A0-A5
+const uint32_t RES_PCINT2        = 1UL << 17;   // D0-D7
+const uint32_t RES_INT0          = 1UL << 18;   // D2
+const uint32_t RES_INT1          = 1UL << 19;   // D3
+const uint32_t RES_USART0        = 1UL << 20;   // Serial
+const uint32_t RES_TWI           = 1UL << 21;   // Wire
+const uint32_t RES_SPI           = 1UL << 22;
+const uint32_t RES_ADC           = 1UL << 23;
+const uint32_t RES_WATCHDOG      = 1UL << 24;
+
+const uint8_t RES_TIMER_STRIDE = 5;
+const uint32_t RES_TIMERS = RES_TIMER0 | RES_TIMER1 | RES_TIMER2;
+
+// Timers whose owner keeps them running unchanged: others may share them
+const uint32_t RES_SHAREABLE = RES_TIMER0 | RES_TIMER1;
+// Timers whose owner is often idle: others may borrow them meanwhile
+const uint32_t RES_LENDABLE = RES_TIMER2;   // tone_play() is silent in ATTRACT
+
+/**
+ * res_pin - Bit for Arduino pin @pin (D0-D13 = 0-13, A0-A5 = 14-19)
+ */
+constexpr uint32_t res_pin(uint8_t pin) {
+    return 1UL << pin;
+}
+
+/**
+ * res_pins - Bits for @count pins from @first
+ */
+constexpr uint32_t res_pins(uint8_t first, uint8_t count) {
+    return count == 0 ? 0 : res_pin(first) | res_pins(first + 1, count - 1);
+}
+
+#ifdef TRACE_ENABLED
+const bool RES_TRACE = true;
+#else
+const bool RES_TRACE = false;
+#endif
+
+#ifdef TIMEBASE_STATS
+const bool RES_STATS = true;
+#else
+const bool RES_STATS = false;
+#endif
+
+#ifdef RULES_UPLOAD
+const bool RES_RULES_UPLOAD = true;
+#else
+const bool RES_RULES_UPLOAD = false;
+#endif
+
+#ifdef SNAPSHOT_DUMP
+const bool RES_SNAPSHOT = true;
+#else
+const bool RES_SNAPSHOT = false;
+#endif
+
+#ifdef TIMEBASE_TIMER0
+const bool RES_TICKLESS = false;   // The core's 1 kHz tick keeps millis()
+#else
+const bool RES_TICKLESS = true;
+#endif
+
+/**
+ * HW_RESOURCES - Every feature's claim: X(id, owns, shares, borrows, pins)
+ *
+ * Pins are claimed by the feature that drives or reads them, once. A
+ * pin-change group is claimed by the feature whose ISR serves it, even when
+ * the pins in it belong to other features.
+ */
+#define HW_RESOURCES(X)                                                           \
+    /* wiring.c: Timer0 in fast PWM for millis(), delay() and analogWrite() */    \
+    X(HW_CORE_TIMER0,   RES_TIMER0 | (RES_TICKLESS ? 0 : RES_TIMER0_OVF),         \
+                        0, 0, 0)                                                  \
+    /* Timer1 clock and sleep deadline; turns the Timer0 tick off */              \
+    X(HW_TIMEBASE,      RES_TICKLESS ? RES_TIMER1 | RES_TIMER1_COMPA |            \
+                                       RES_TIMER0_OVF | RES_PCINT0 : 0,           \
+                        RES_TICKLESS ? RES_TIMER0 : 0, 0, 0)                      \
+    /* Timer2 toggles OC2A per note. Tone.cpp's tone() would claim the same */    \
+    X(HW_TONE,          RES_TIMER2 | RES_TIMER2_COMPA, 0, 0, res_pin(BUZZER_PIN)) \
+    X(HW_LEDS,          0, 0, 0, res_pins(LED_PIN_START, NUM_LEDS))               \
+    X(HW_BUTTON,        0, 0, 0, res_pin(BUTTON_PIN))                             \
+    /* LCDs and the input expander share the bus (A4 = SDA, A5 = SCL) */          \
+    X(HW_I2C,           RES_TWI, 0, 0, res_pin(18) | res_pin(19))                 \
+    X(HW_EXPANDER_INT,  0, 0, 0, res_pin(EXPANDER_INT_PIN))                       \
+    X(HW_COIN,          RES_PCINT1, 0, 0, res_pin(COIN_PIN))                      \
+    X(HW_WATCHDOG,      RES_WATCHDOG, 0, 0, 0)                                    \
+    /* Serial: RX D0, TX D1 */                                                    \
+    X(HW_TRACE,         RES_TRACE ? RES_USART0 : 0, 0, 0,                         \
+                        RES_TRACE ? res_pins(0, 2) : 0)                           \
+    /* Serial report, and a 10 kHz probe on Timer2 compare B while silent */      \
+    X(HW_STATS,         RES_STATS ? RES_USART0 | RES_TIMER2_COMPB : 0, 0,         \
+                        RES_STATS ? RES_TIMER2 : 0,                               \
+                        RES_STATS ? res_pins(0, 2) : 0)                           \
+    /* Game mode images from the operator's laptop (hardware.cpp section 8) */    \
+    X(HW_RULES_UPLOAD,  RES_RULES_UPLOAD ? RES_USART0 : 0, 0, 0,                  \
+                        RES_RULES_UPLOAD ? res_pins(0, 2) : 0)                    \
+    /* State snapshots for bug reports (hardware.cpp section 9) */               \
+    X(HW_SNAPSHOT,      RES_SNAPSHOT ? RES_USART0 : 0, 0, 0,                      \
+                        RES_SNAPSHOT ? res_pins(0, 2) : 0)
+
+#define HW_RESOURCE_ID(id, owns, shares, borrows, pins) id,
+enum HwFeature {
+    HW_RESOURCES(HW_RESOURCE_ID)
+    HW_FEATURE_COUNT
+};
+#undef HW_RESOURCE_ID
+
+typedef struct {
+    uint32_t owns;
+    uint32_t shares;
+    uint32_t borrows;
+    uint32_t pins;
+} ResourceClaim;
+
+#define HW_RESOURCE_CLAIM(id, owns, shares, borrows, pins) {owns, shares, borrows, pins},
+constexpr ResourceClaim resource_claims[] = {
+    HW_RESOURCES(HW_RESOURCE_CLAIM)
+};
+#undef HW_RESOURCE_CLAIM
+
+/**
+ * resources_owned - Everything owned by features other than @skip
+ */
+constexpr uint32_t resources_owned(uint8_t skip, uint8_t i = 0) {
+    return i == HW_FEATURE_COUNT ? 0 :
+           (i == skip ? 0 : resource_claims[i].owns) | resources_owned(skip, i + 1);
+}
+
+/**
+ * resources_pins - Every pin claimed by features other than @skip
+ */
+constexpr uint32_t resources_pins(uint8_t skip, uint8_t i = 0) {
+    return i == HW_FEATURE_COUNT ? 0 :
+           (i == skip ? 0 : resource_claims[i].pins) | resources_pins(skip, i + 1);
+}
+
+/**
+ * resources_borrowed - Everything borrowed by features other than @skip
+ */
+constexpr uint32_t resources_borrowed(uint8_t skip, uint8_t i = 0) {
+    return i == HW_FEATURE_COUNT ? 0 :
+           (i == skip ? 0 : resource_claims[i].borrows) | resources_borrowed(skip, i + 1);
+}
+
+/**
+ * resource_timers_of - The timers that the channels and vectors in @mask
+ * belong to
+ */
+constexpr uint32_t resource_timers_of(uint32_t mask, uint8_t timer = 0) {
+    return timer == 3 ? 0 :
+           ((mask >> (timer * RES_TIMER_STRIDE)) & 0x1E ? RES_TIMER0 << (timer * RES_TIMER_STRIDE) : 0) |
+           resource_timers_of(mask, timer + 1);
+}
+
+/**
+ * resource_free - Is @mask still unclaimed by every feature?
+ *
+ * For code that picks what it can use: resource_free(RES_TIMER1_COMPB).
+ */
+constexpr bool resource_free(uint32_t mask) {
+    return (resources_owned(HW_FEATURE_COUNT) & mask) == 0;
+}
+
+constexpr bool resource_pin_free(uint8_t pin) {
+    return (resources_pins(HW_FEATURE_COUNT) & res_pin(pin)) == 0;
+}
+
+/**
+ * The checks, one set per feature so the message names it:
+ * 1. Nothing it owns is owned by another feature
+ * 2. No pin it claims is claimed by another feature
+ * 3. What it shares is owned by another feature, and shareable
+ * 4. What it borrows is owned by another feature, lendable, and borrowed
+ *    by no one else
+ * 5. Its compare channels and vectors are on timers it owns, shares or
+ *    borrows: programming OCR1B means little if nobody set Timer1's clock
+ */
+#define HW_RESOURCE_CHECK(id, o, s, b, p)                                                        \
+    static_assert((resource_claims[id].owns & resources_owned(id)) == 0,                         \
+                  #id ": owns a timer, channel, vector or peripheral that another feature owns"); \
+    static_assert((resource_claims[id].pins & resources_pins(id)) == 0,                          \
+                  #id ": claims a pin that another feature claims");                             \
+    static_assert((resource_claims[id].shares & ~(resources_owned(id) & RES_SHAREABLE)) == 0,    \
+                  #id ": shares a timer that no other feature owns, or whose owner can't share it"); \
+    static_assert((resource_claims[id].borrows & ~(resources_owned(id) & RES_LENDABLE)) == 0,    \
+                  #id ": borrows a timer that no other feature owns, or whose owner can't lend it"); \
+    static_assert((resource_claims[id].borrows & resources_borrowed(id)) == 0,                   \
+                  #id ": borrows a timer that another feature borrows too");                     \
+    static_assert((resource_timers_of(resource_claims[id].owns) &                                \
+                   ~(resource_claims[id].owns | resource_claims[id].shares |                     \
+                     resource_claims[id].borrows) & RES_TIMERS) == 0,                            \
+                  #id ": uses a compare channel or vector on a timer it doesn't own, share or borrow");
+HW_RESOURCES(HW_RESOURCE_CHECK)
+#undef HW_RESOURCE_CHECK
+
+#endif // RESOURCES_H
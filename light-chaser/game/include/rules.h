@@ -0,0 +1,441 @@
+/******************************************************************************
+ * RULES.H - Game Modes as Small Programs
+ *
+ * How the chase moves, what a press scores and how much faster the game
+ * gets are three small functions in game.cpp. A new mode ("wrap around
+ * instead of bouncing", "only LED 3 counts, for 25") used to mean a new
+ * firmware. Now a mode can be a rule program instead: a few dozen
+ * instructions for a tiny virtual machine, stored in EEPROM (or uploaded
+ * over serial, -DRULES_UPLOAD) and checked when it is loaded.
+ *
+ * THREE HOOKS:
+ * A program has up to three parts, one per hook. A part left empty keeps
+ * the built-in rule for that hook, so a mode can change just the scoring.
+ *
+ *   Hook         Called from               Reads        Writes
+ *   RULE_MOVE    update_chase_position()   r0-r3        r0 position, r1 direction
+ *   RULE_SCORE   calculate_score()         r0-r3        r4 points (0 = miss)
+ *   RULE_SPEED   playing_update(), on hit  r0-r4        r3 speed (ms per step)
+ *
+ * REGISTERS:
+ * Eight 16-bit signed registers. On entry to every hook:
+ *   r0 = position (0..NUM_LEDS-1)   r1 = direction   r2 = score (max 32767)
+ *   r3 = speed (ms per step)        r4 = points (RULE_SPEED: the hit's)
+ *   r5-r7 = 0 (scratch)
+ * Only the registers a hook writes (table above) are kept. game.cpp clamps
+ * them: position to the LEDs, direction to -1..1, points to 0-255, speed
+ * to MIN_CHASE_SPEED..RULES_SPEED_MAX_MS.
+ *
+ * INSTRUCTIONS (2 bytes: op << 3 | a, then b):
+ *
+ *   RULE_END          stop (falling off the end of a part stops too)
+ *   RULE_LDI  a, k    ra = k                 (k: signed byte)
+ *   RULE_MOV  a, b    ra = rb
+ *   RULE_ADD  a, b    ra += rb
+ *   RULE_SUB  a, b    ra -= rb
+ *   RULE_ADDI a, k    ra += k
+ *   RULE_MIN  a, b    ra = min(ra, rb)
+ *   RULE_MAX  a, b    ra = max(ra, rb)
+ *   RULE_SHL  a, n    ra <<= n               (n: 0-15)
+ *   RULE_SHR  a, n    ra >>= n (keeps sign)
+ *   RULE_ANDI a, m    ra &= m                (m: unsigned byte)
+ *   RULE_RND  a       ra = random 0-255      (not in RULE_MOVE)
+ *   RULE_SKLT a, b    skip the next instruction if ra < rb
+ *   RULE_SKGE a, b    ... if ra >= rb
+ *   RULE_SKEQ a, b    ... if ra == rb
+ *   RULE_SKNE a, b    ... if ra != rb
+ *   RULE_JMP  n       skip the next n instructions (n ≥ 1)
+ *
+ * WHY IT STAYS PREDICTABLE:
+ * Jumps only go forward, so there are no loops: every instruction runs at
+ * most once per call. rules_check() walks each part once from the end,
+ * adding up the worst case at every branch, and refuses a program whose
+ * worst case is over RULES_HOOK_BUDGET_CYCLES (each instruction's cost is
+ * in rule_op_cycles[]). It also refuses unknown opcodes, register numbers
+ * over 7, jumps out of the part, shifts over 15 and RND in RULE_MOVE.
+ * RULE_MOVE must be a plain function of its inputs: chase_position_at()
+ * runs it again to see where the LED is about to be. The game runs only a
+ * program that passed, so a mode can't hang the game or slow it past the
+ * budget, however it was written.
+ *
+ * THE IMAGE (EEPROM, or an upload):
+ *   Byte 0:        EEPROM_MAGIC_BYTE
+ *   Byte 1:        RULES_VERSION
+ *   Bytes 2-4:     Instructions in RULE_MOVE, RULE_SCORE, RULE_SPEED
+ *   Then:          The instructions, the three parts one after another
+ *   Last byte:     Checksum (XOR of every byte before it)
+ * An image with all three parts empty puts the built-in rules back.
+ *
+ * Header-only, like effects.h: sim/tools/rules_check.cpp checks and plays
+ * the built-in example modes below with the same code.
+ *
+ * Related files:
+ * - game.cpp: The hooks (rules_call())
+ * - hardware.cpp section 4: eeprom_read_rules() / eeprom_write_rules()
+ * - hardware.cpp section 8: Serial upload (RULES_UPLOAD builds)
+ * - sim/tools/rules_check.cpp: Checks, costs and plays every example mode
+ ******************************************************************************/
+
+#ifndef RULES_H
+#define RULES_H
+
+#include <Arduino.h>
+#include "config.h"
+
+enum RuleHook {
+    RULE_MOVE,
+    RULE_SCORE,
+    RULE_SPEED,
+    RULE_HOOK_COUNT
+};
+
+enum RuleOp {
+    RULE_END, RULE_LDI, RULE_MOV, RULE_ADD, RULE_SUB, RULE_ADDI, RULE_MIN, RULE_MAX,
+    RULE_SHL, RULE_SHR, RULE_ANDI, RULE_RND, RULE_SKLT, RULE_SKGE, RULE_SKEQ, RULE_SKNE,
+    RULE_JMP,
+    RULE_OP_COUNT
+};
+
+enum RulesError {
+    RULES_OK,
+    RULES_BAD_IMAGE,        // Magic, version, lengths or checksum wrong
+    RULES_TOO_LONG,         // A part over RULES_MAX_STEPS
+    RULES_BAD_OP,           // Unknown opcode
+    RULES_BAD_OPERAND,      // Register over 7, or shift over 15
+    RULES_BAD_JUMP,         // Skip or jump past the end of its part
+    RULES_RANDOM_MOVE,      // RULE_RND in RULE_MOVE
+    RULES_OVER_BUDGET       // Worst case over RULES_HOOK_BUDGET_CYCLES
+};
+
+const uint8_t RULES_VERSION = 1;
+const uint8_t RULE_REGS = 8;
+const uint8_t RULES_MAX_STEPS = 24;                  // Instructions per part
+const uint16_t RULES_HOOK_BUDGET_CYCLES = 1200;      // 75 µs at 16 MHz
+const uint16_t RULES_SPEED_MAX_MS = 1000;
+const uint32_t RULES_UPLOAD_BAUD = 9600;             // 64-byte receive buffer: ~67 ms
+const uint16_t RULES_UPLOAD_POLL_MS = 20;            // Empty it at least this often
+const uint16_t RULES_UPLOAD_TIMEOUT_MS = 500;        // Silence that drops a half image
+const uint8_t RULES_IMAGE_HEADER = 2 + RULE_HOOK_COUNT;
+const uint8_t RULES_IMAGE_MAX = RULES_IMAGE_HEADER + 2 * RULES_MAX_STEPS * RULE_HOOK_COUNT + 1;
+
+/**
+ * rule_op_cycles - Estimated AVR cycles for one instruction of each kind
+ *
+ * Fetch, decode and the switch's jump table (RULES_DISPATCH_CYCLES), plus
+ * the 16-bit work itself. RULE_SHL/SHR add RULES_SHIFT_CYCLES per bit.
+ */
+const uint8_t RULES_DISPATCH_CYCLES = 24;
+const uint8_t RULES_SHIFT_CYCLES = 4;
+static const uint8_t rule_op_cycles[RULE_OP_COUNT] = {
+    4,  /* END */   6,  /* LDI */   8,  /* MOV */   10, /* ADD */
+    10, /* SUB */   8,  /* ADDI */  14, /* MIN */   14, /* MAX */
+    6,  /* SHL */   6,  /* SHR */   6,  /* ANDI */  30, /* RND */
+    12, /* SKLT */  12, /* SKGE */  12, /* SKEQ */  12, /* SKNE */
+    6   /* JMP */
+};
+
+// One instruction, for writing programs in C: RULE(RULE_ADDI, 3, -10)
+#define RULE(op, a, b) (uint8_t)(((op) << 3) | (a)), (uint8_t)(b)
+
+typedef struct {
+    uint8_t length[RULE_HOOK_COUNT];   // Instructions per part (0 = built-in)
+    const uint8_t *code;               // The parts, one after another
+} RuleSet;
+
+typedef struct {
+    uint16_t cycles[RULE_HOOK_COUNT];  // Worst case per part
+    uint8_t hook;                      // Where the first error is
+    uint8_t step;
+} RulesReport;
+
+/**
+ * rules_part - First instruction of @hook's part in @set->code
+ */
+static inline const uint8_t *rules_part(const RuleSet *set, uint8_t hook) {
+    uint8_t start = 0;
+    for (uint8_t h = 0; h < hook; h++) {
+        start += set->length[h];
+    }
+    return set->code + 2 * start;
+}
+
+static inline bool rules_op_uses_register(uint8_t op) {
+    return op == RULE_MOV || op == RULE_ADD || op == RULE_SUB || op == RULE_MIN ||
+           op == RULE_MAX || (op >= RULE_SKLT && op <= RULE_SKNE);
+}
+
+/**
+ * rules_check - Is @set safe to run? Fills @report with worst-case cycles
+ * @return: RULES_OK, or the first problem (where: report->hook, ->step)
+ */
+static inline uint8_t rules_check(const RuleSet *set, RulesReport *report) {
+    for (uint8_t hook = 0; hook < RULE_HOOK_COUNT; hook++) {
+        uint8_t length = set->length[hook];
+        const uint8_t *code = rules_part(set, hook);
+        report->hook = hook;
+        report->cycles[hook] = 0;
+        if (length > RULES_MAX_STEPS) {
+            report->step = RULES_MAX_STEPS;
+            return RULES_TOO_LONG;
+        }
+        if (length == 0) {
+            continue;                  // Built-in rule: nothing to run
+        }
+
+        // worst[i]: most cycles from instruction i to the end of the part
+        uint16_t worst[RULES_MAX_STEPS + 1];
+        worst[length] = RULES_DISPATCH_CYCLES + rule_op_cycles[RULE_END];  // Falling off
+        for (uint8_t i = length; i-- > 0; ) {
+            uint8_t op = code[2 * i] >> 3;
+            uint8_t b = code[2 * i + 1];
+            report->step = i;
+            if (op >= RULE_OP_COUNT) {
+                return RULES_BAD_OP;
+            }
+            if ((rules_op_uses_register(op) && b >= RULE_REGS) ||
+                ((op == RULE_SHL || op == RULE_SHR) && b > 15)) {
+                return RULES_BAD_OPERAND;
+            }
+            if (op == RULE_RND && hook == RULE_MOVE) {
+                return RULES_RANDOM_MOVE;
+            }
+
+            uint16_t cost = RULES_DISPATCH_CYCLES + rule_op_cycles[op];
+            uint16_t after = worst[i + 1];
+            if (op == RULE_END) {
+                after = 0;
+            } else if (op == RULE_SHL || op == RULE_SHR) {
+                cost += (uint16_t)(b * RULES_SHIFT_CYCLES);
+            } else if (op >= RULE_SKLT && op <= RULE_SKNE) {
+                if (i + 2 > length) {
+                    return RULES_BAD_JUMP;
+                }
+                after = worst[i + 2] > after ? worst[i + 2] : after;
+            } else if (op == RULE_JMP) {
+                if (b == 0 || i + 1 + b > length) {
+                    return RULES_BAD_JUMP;
+                }
+                after = worst[i + 1 + b];
+            }
+            worst[i] = cost + after;
+        }
+        report->cycles[hook] = worst[0];
+        if (worst[0] > RULES_HOOK_BUDGET_CYCLES) {
+            report->step = 0;
+            return RULES_OVER_BUDGET;
+        }
+    }
+    return RULES_OK;
+}
+
+/**
+ * rules_image_size - Size of the image starting with @header
+ * @param have: Bytes of it available (a header arrives a byte at a time)
+ * @return: 0 if @have is too short to tell, RULES_IMAGE_MAX + 1 if the
+ *          header can't be right
+ */
+static inline uint8_t rules_image_size(const uint8_t *header, uint8_t have) {
+    if (have >= 1 && header[0] != EEPROM_MAGIC_BYTE) {
+        return RULES_IMAGE_MAX + 1;
+    }
+    if (have >= 2 && header[1] != RULES_VERSION) {
+        return RULES_IMAGE_MAX + 1;
+    }
+    if (have < RULES_IMAGE_HEADER) {
+        return 0;
+    }
+    uint8_t size = RULES_IMAGE_HEADER + 1;
+    for (uint8_t h = 0; h < RULE_HOOK_COUNT; h++) {
+        if (header[2 + h] > RULES_MAX_STEPS) {
+            return RULES_IMAGE_MAX + 1;
+        }
+        size += 2 * header[2 + h];
+    }
+    return size;
+}
+
+/**
+ * rules_image_checksum - XOR of the first @size bytes of @image
+ */
+static inline uint8_t rules_image_checksum(const uint8_t *image, uint8_t size) {
+    uint8_t sum = 0;
+    for (uint8_t i = 0; i < size; i++) {
+        sum ^= image[i];
+    }
+    return sum;
+}
+
+/**
+ * rules_image_load - Check the @size byte @image and point @set at its code
+ * @return: RULES_OK, or why it was refused (then @set is all built-in)
+ */
+static inline uint8_t rules_image_load(const uint8_t *image, uint8_t size, RuleSet *set,
+                                       RulesReport *report) {
+    for (uint8_t h = 0; h < RULE_HOOK_COUNT; h++) {
+        set->length[h] = 0;
+        report->cycles[h] = 0;
+    }
+    set->code = image + RULES_IMAGE_HEADER;
+    report->hook = 0;
+    report->step = 0;
+    if (size < RULES_IMAGE_HEADER + 1 || rules_image_size(image, size) != size ||
+        rules_image_checksum(image, (uint8_t)(size - 1)) != image[size - 1]) {
+        return RULES_BAD_IMAGE;
+    }
+
+    RuleSet candidate = {{image[2], image[3], image[4]}, set->code};
+    uint8_t error = rules_check(&candidate, report);
+    if (error == RULES_OK) {
+        *set = candidate;
+    }
+    return error;
+}
+
+/**
+ * rules_image_build - Write @set as an image at @image (RULES_IMAGE_MAX bytes)
+ * @return: Its size
+ */
+static inline uint8_t rules_image_build(const RuleSet *set, uint8_t *image) {
+    uint8_t steps = 0;
+    image[0] = EEPROM_MAGIC_BYTE;
+    image[1] = RULES_VERSION;
+    for (uint8_t h = 0; h < RULE_HOOK_COUNT; h++) {
+        image[2 + h] = set->length[h];
+        steps += set->length[h];
+    }
+    for (uint8_t i = 0; i < 2 * steps; i++) {
+        image[RULES_IMAGE_HEADER + i] = set->code[i];
+    }
+    uint8_t size = (uint8_t)(RULES_IMAGE_HEADER + 2 * steps);
+    image[size] = rules_image_checksum(image, size);
+    return (uint8_t)(size + 1);
+}
+
+/**
+ * rules_run - Run @hook of a checked @set on @reg
+ * @param random: xorshift state for RULE_RND (never 0)
+ *
+ * Only call this with a @set that passed rules_check(): nothing here
+ * checks operands or jump targets.
+ */
+static inline void rules_run(const RuleSet *set, uint8_t hook, int16_t reg[RULE_REGS],
+                             uint16_t *random) {
+    const uint8_t *pc = rules_part(set, hook);
+    const uint8_t *end = pc + 2 * set->length[hook];
+    while (pc < end) {
+        uint8_t op = pc[0] >> 3;
+        int16_t *ra = &reg[pc[0] & 7];
+        uint8_t b = pc[1];
+        int16_t rb = reg[b & 7];
+        pc += 2;
+
+        switch (op) {
+            case RULE_END:  return;
+            case RULE_LDI:  *ra = (int8_t)b; break;
+            case RULE_MOV:  *ra = rb; break;
+            case RULE_ADD:  *ra = (int16_t)(*ra + rb); break;
+            case RULE_SUB:  *ra = (int16_t)(*ra - rb); break;
+            case RULE_ADDI: *ra = (int16_t)(*ra + (int8_t)b); break;
+            case RULE_MIN:  *ra = rb < *ra ? rb : *ra; break;
+            case RULE_MAX:  *ra = rb > *ra ? rb : *ra; break;
+            case RULE_SHL:  *ra = (int16_t)((uint16_t)*ra << b); break;
+            case RULE_SHR:  *ra = (int16_t)(*ra >> b); break;
+            case RULE_ANDI: *ra = (int16_t)(*ra & b); break;
+            case RULE_RND: {
+                uint16_t x = *random;
+                x ^= (uint16_t)(x << 7);
+                x ^= (uint16_t)(x >> 9);
+                x ^= (uint16_t)(x << 8);
+                *random = x;
+                *ra = (int16_t)(x & 0xFF);
+                break;
+            }
+            case RULE_SKLT: pc += (*ra < rb) ? 2 : 0; break;
+            case RULE_SKGE: pc += (*ra >= rb) ? 2 : 0; break;
+            case RULE_SKEQ: pc += (*ra == rb) ? 2 : 0; break;
+            case RULE_SKNE: pc += (*ra != rb) ? 2 : 0; break;
+            case RULE_JMP:  pc += 2 * b; break;
+        }
+    }
+}
+
+/******************************************************************************
+ * EXAMPLE MODES
+ *
+ * Each is a RuleSet a cabinet can be given (sim/tools/rules_check.cpp
+ * writes the image). rules_classic is the built-in game written as a
+ * program: the checker runs it against game.cpp's own rules to show the
+ * VM and the native code agree.
+ ******************************************************************************/
+
+// The built-in rules: bounce at the ends, 10 for the green zone, 10 ms faster per hit
+static const uint8_t rules_classic_code[] = {
+    // RULE_MOVE: r0 += r1; turn round at either end
+    RULE(RULE_ADD, 0, 1),
+    RULE(RULE_LDI, 5, 0),
+    RULE(RULE_SKNE, 0, 5),
+    RULE(RULE_LDI, 1, 1),
+    RULE(RULE_LDI, 5, NUM_LEDS - 1),
+    RULE(RULE_SKNE, 0, 5),
+    RULE(RULE_LDI, 1, -1),
+    // RULE_SCORE: r4 = BULLSEYE_SCORE inside TARGET_ZONE_START..END, else 0
+    RULE(RULE_LDI, 4, 0),
+    RULE(RULE_LDI, 5, TARGET_ZONE_START),
+    RULE(RULE_SKGE, 0, 5),
+    RULE(RULE_END, 0, 0),
+    RULE(RULE_LDI, 5, TARGET_ZONE_END),
+    RULE(RULE_SKGE, 5, 0),
+    RULE(RULE_END, 0, 0),
+    RULE(RULE_LDI, 4, BULLSEYE_SCORE),
+    // RULE_SPEED: r3 = max(r3 - SPEED_DECREASE, MIN_CHASE_SPEED)
+    RULE(RULE_ADDI, 3, -(int)SPEED_DECREASE),
+    RULE(RULE_LDI, 5, MIN_CHASE_SPEED),
+    RULE(RULE_MAX, 3, 5)
+};
+static const RuleSet rules_classic = {{7, 8, 3}, rules_classic_code};
+
+// Wrap: the chase runs off one end and comes back at the other
+static const uint8_t rules_wrap_code[] = {
+    RULE(RULE_ADD, 0, 1),
+    RULE(RULE_ANDI, 0, NUM_LEDS - 1)     // NUM_LEDS is a power of two
+};
+static const RuleSet rules_wrap = {{2, 0, 0}, rules_wrap_code};
+
+// Sniper: only the first green LED counts, for 25; the speed-up is halved
+static const uint8_t rules_sniper_code[] = {
+    RULE(RULE_LDI, 4, 0),
+    RULE(RULE_LDI, 5, TARGET_ZONE_START),
+    RULE(RULE_SKNE, 0, 5),
+    RULE(RULE_LDI, 4, 25),
+    RULE(RULE_ADDI, 3, -(int)(SPEED_DECREASE / 2)),
+    RULE(RULE_LDI, 5, MIN_CHASE_SPEED),
+    RULE(RULE_MAX, 3, 5)
+};
+static const RuleSet rules_sniper = {{0, 4, 3}, rules_sniper_code};
+
+// Lucky: a green hit scores 10, or 30 one time in eight; speed follows the score
+static const uint8_t rules_lucky_code[] = {
+    RULE(RULE_LDI, 4, 0),
+    RULE(RULE_LDI, 5, TARGET_ZONE_START),
+    RULE(RULE_SKGE, 0, 5),
+    RULE(RULE_JMP, 0, 8),                 // Not green: to the end, r4 = 0
+    RULE(RULE_LDI, 5, TARGET_ZONE_END),
+    RULE(RULE_SKGE, 5, 0),
+    RULE(RULE_JMP, 0, 5),
+    RULE(RULE_LDI, 4, BULLSEYE_SCORE),
+    RULE(RULE_RND, 6, 0),
+    RULE(RULE_ANDI, 6, 7),
+    RULE(RULE_SKNE, 6, 7),                // r7 is 0: skip unless r6 == 0
+    RULE(RULE_LDI, 4, 3 * BULLSEYE_SCORE),
+    // RULE_SPEED: 200 ms minus score / 4, no faster than MIN_CHASE_SPEED
+    RULE(RULE_LDI, 3, 100),
+    RULE(RULE_SHL, 3, 1),
+    RULE(RULE_MOV, 5, 2),
+    RULE(RULE_SHR, 5, 2),
+    RULE(RULE_SUB, 3, 5),
+    RULE(RULE_LDI, 5, MIN_CHASE_SPEED),
+    RULE(RULE_MAX, 3, 5)
+};
+static const RuleSet rules_lucky = {{0, 12, 7}, rules_lucky_code};
+
+#endif // RULES_H
@@ -0,0 +1,185 @@
+/******************************************************************************
+ * SCRIPT.H - Stackless Coroutines for Animation Scripts
+ *
+ * An animation is a sequence: play a note, wait 150 ms, play the next one.
+ * Without threads, it used to be written inside out. Every call to
+ * animation_update() worked out where the sequence had got to from a set of
+ * counters (anim_step, flash_count, flash_state...) and a nest of ifs. A
+ * script is written in order instead, and it pauses where it waits:
+ *
+ *   SCRIPT(bullseye_notes) {
+ *       SCRIPT_BEGIN();
+ *       for (script->i = 0; script->i < 3; script->i++) {
+ *           SCRIPT_AWAIT_MS(DURATION_BULLSEYE_NOTE);
+ *           tone_play(bullseye_tones[script->i]);
+ *       }
+ *       SCRIPT_END();
+ *   }
+ *
+ * HOW IT PAUSES WITHOUT A STACK:
+ * A script is an ordinary function that returns at each wait. Before
+ * returning it stores the address of the statement after the wait (a GCC
+ * "label as value", &&label). The next call jumps straight there with one
+ * indirect jump: nothing is re-tested to find the place. This is the
+ * protothread idea. Protothreads resume through a switch. The AVR
+ * toolchain's C++11 has no C++20 coroutines, and avr-gcc and the host
+ * compiler both support label addresses.
+ *
+ * Local variables don't survive a wait: the function really returns. What
+ * a script must remember goes in its ScriptTrack (script->i, the loop
+ * counter) or in a static. A ScriptTrack is 10 bytes on the AVR.
+ *
+ * A resume address means nothing to another build. A track also counts
+ * its pauses, and that count does: script_seek() finds the same place again
+ * by running the script from the top until it has paused as often (how a
+ * snapshot restores a running animation, see snapshot.h).
+ *
+ * WAITING:
+ * - SCRIPT_AWAIT_MS(ms): carry on @ms after the previous wait ended (or
+ *   after script_start()). If that time has already passed, it doesn't
+ *   pause at all. The wait is measured from when the previous one actually
+ *   ended, which is how the hand-written animations timed their steps.
+ * - SCRIPT_AWAIT_STEP(): carry on at the next call (the next loop())
+ * - SCRIPT_END(): finished; further calls do nothing
+ *
+ * PARALLEL:
+ * Things that happen at the same time (a melody and an LED effect) are two
+ * scripts on two tracks. Each loop() resumes both, and the animation is
+ * over when both have ended (see animation_update() in hardware.cpp).
+ * script_resume() skips a script whose wait hasn't run out without even
+ * calling it. A track's since + wait is when it is next due, which is all
+ * the sleep scheduler needs to know.
+ *
+ * Related files:
+ * - hardware.cpp section 2: The animation scripts
+ ******************************************************************************/
+
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include <Arduino.h>
+
+const uint16_t SCRIPT_FOREVER = 0xFFFF;   // wait of a script that has ended
+
+typedef struct {
+    void *resume;           // Where to carry on; NULL = from the top
+    uint32_t since;         // When the last wait ended (ms)
+    uint16_t wait;          // Current wait (ms), SCRIPT_FOREVER once ended
+    uint8_t i;              // Loop counter for the script's own use
+    uint8_t pauses;         // Times it has waited, up to 255 (script_seek())
+} ScriptTrack;
+
+typedef void (*ScriptFn)(ScriptTrack *script, uint32_t now);
+
+/**
+ * SCRIPT - Define a script: SCRIPT(name) { SCRIPT_BEGIN(); ... SCRIPT_END(); }
+ *
+ * Inside, script is its track and now is the time it was resumed.
+ */
+#define SCRIPT(name) static void name(ScriptTrack *script, uint32_t now)
+
+#define SCRIPT_LABEL_(line) script_line_##line
+#define SCRIPT_LABEL(line) SCRIPT_LABEL_(line)
+
+// GCC 12+ takes a stored label address for a pointer to a local variable
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 12
+#define SCRIPT_SAVE(label)                                                  \
+    _Pragma("GCC diagnostic push")                                          \
+    _Pragma("GCC diagnostic ignored \"-Wdangling-pointer\"")                \
+    script->resume = &&label;                                               \
+    script->pauses++;                                                       \
+    _Pragma("GCC diagnostic pop")
+#else
+#define SCRIPT_SAVE(label) script->resume = &&label; script->pauses++;
+#endif
+
+#define SCRIPT_BEGIN()                                                      \
+    do {                                                                    \
+        if (script->resume != NULL) {                                       \
+            goto *script->resume;                                           \
+        }                                                                   \
+    } while (0)
+
+#define SCRIPT_AWAIT_MS(ms)                                                 \
+    do {                                                                    \
+        script->wait = (ms);                                                \
+        if (now - script->since < script->wait) {                           \
+            SCRIPT_SAVE(SCRIPT_LABEL(__LINE__))                             \
+            return;                                                         \
+        }                                                                   \
+    SCRIPT_LABEL(__LINE__):                                                 \
+        script->since = now;                                                \
+    } while (0)
+
+#define SCRIPT_AWAIT_STEP()                                                 \
+    do {                                                                    \
+        script->wait = 0;                                                   \
+        SCRIPT_SAVE(SCRIPT_LABEL(__LINE__))                                 \
+        return;                                                             \
+    SCRIPT_LABEL(__LINE__):                                                 \
+        script->since = now;                                                \
+    } while (0)
+
+#define SCRIPT_END()                                                        \
+    do {                                                                    \
+        script->wait = SCRIPT_FOREVER;                                      \
+        SCRIPT_SAVE(SCRIPT_LABEL(__LINE__))                                 \
+    SCRIPT_LABEL(__LINE__):                                                 \
+        return;                                                             \
+    } while (0)
+
+/**
+ * script_start - Put @track at the top of a script; its first wait counts
+ * from @now
+ */
+static inline void script_start(ScriptTrack *track, uint32_t now) {
+    track->resume = NULL;
+    track->since = now;
+    track->wait = 0;
+    track->i = 0;
+    track->pauses = 0;
+}
+
+/**
+ * script_stop - End @track without running the rest of its script
+ */
+static inline void script_stop(ScriptTrack *track) {
+    track->wait = SCRIPT_FOREVER;
+}
+
+static inline bool script_ended(const ScriptTrack *track) {
+    return track->wait == SCRIPT_FOREVER;
+}
+
+/**
+ * script_resume - Run @fn on @track if its wait is over
+ * @param fn: The script, or NULL for a track with nothing to do
+ * @return: true once the script has ended
+ */
+static inline bool script_resume(ScriptTrack *track, ScriptFn fn, uint32_t now) {
+    if (fn == NULL || script_ended(track)) {
+        return true;
+    }
+    if (now - track->since >= track->wait) {
+        fn(track, now);
+    }
+    return script_ended(track);
+}
+
+/**
+ * script_seek - Run @fn on @track from the top until it has paused @pauses
+ * times (or ended)
+ *
+ * Each wait is taken as ending exactly when due, so the script goes down the
+ * same path it did when it first paused that often. Its side effects
+ * (notes, LED frames) happen again on the way, all at once: the caller puts
+ * back whatever they changed, and since, wait and i of the original track.
+ */
+static inline void script_seek(ScriptTrack *track, ScriptFn fn, uint8_t pauses) {
+    script_start(track, 0);
+    while (fn != NULL && track->pauses < pauses && !script_ended(track)) {
+        fn(track, track->since + track->wait);
+    }
+}
+
+#endif // SCRIPT_H
@@ -0,0 +1,225 @@
+/******************************************************************************
+ * SNAPSHOT.H - The Whole Game in a Few Hundred Bytes, for Bug Reports
+ *
+ * When a cabinet misbehaves, the operator can describe the symptom ("the
+ * LED froze on 6 after a bullseye") but not the state behind it. A
+ * SNAPSHOT_DUMP build answers SNAPSHOT_COMMAND on its serial port with a
+ * snapshot: every variable game.cpp and hardware.cpp play with, taken
+ * between two loop()s. The host simulator loads it into its own copy of the
+ * firmware (sim/tools/snapshot_run.cpp) and carries on from that point,
+ * where it can be traced, stepped and replayed as often as needed.
+ *
+ *   stty -F /dev/ttyACM0 115200 raw && (printf S; sleep 1) > /dev/ttyACM0 &
+ *   head -c 440 /dev/ttyACM0 > cabinet.snap      # 16x2 (snapshot-run --size)
+ *   snapshot-run cabinet.snap --seconds 10 --press 500
+ *
+ * THE FORMAT:
+ * No encoder: three packed structs, sent byte for byte as they are in RAM.
+ *
+ *   SnapshotHeader   "LS", SNAPSHOT_VERSION, total size, layout hash, millis()
+ *   GameSnapshot     game.cpp: state, chase, scores, timers, calibration,
+ *                    the ghost being played or recorded (its whole image)
+ *   HalSnapshot      hardware.cpp: debouncer, presses, animation tracks and
+ *                    effect, lit LEDs, LCD frame and what the main LCD
+ *                    shows, expander queue, credits
+ *
+ * Only fixed-width fields, and no padding (packed): the AVR and a PC agree
+ * on every offset, and both are little-endian. Enums go in as uint8_t (an
+ * enum is 2 bytes on the AVR, 4 on a PC); bools as 0/1.
+ *
+ * LAYOUT HASH:
+ * Each struct is written once, as an X-macro list, and both the struct
+ * and SNAPSHOT_LAYOUT_HASH are generated from it. The hash covers every
+ * field's name, type, size and offset. Add, move or resize a field and the
+ * hash changes by itself; a snapshot from a firmware with another layout is
+ * refused rather than loaded into the wrong variables. SNAPSHOT_VERSION is
+ * for changes the hash can't see (a field that means something else now).
+ *
+ * TIMES:
+ * millis() and micros() on the cabinet have nothing to do with the
+ * simulator's clock, so every timestamp is stored as its age: now - t
+ * (ms fields end _age_ms, µs fields _age_us). Loading computes t = now - age
+ * against the loading clock, so every "now - t >= interval" comes out as it
+ * would have on the cabinet.
+ *
+ * WHAT ISN'T IN IT:
+ * - EEPROM (high score table, game mode, latency, ledger totals): copy
+ *   it separately. The live high score and latency offset are included.
+ * - A note in progress (≤ 300 ms), display statistics, the self-test
+ *   result, throughput counters, a half-received rule upload
+ * - Running animations are kept as how far each script has got (script.h,
+ *   script_seek()): loading plays the steps up to there again at once.
+ *   The notes go to the tone log and the LEDs end up as in the snapshot.
+ *
+ * Related files:
+ * - game.cpp: game_snapshot_write(), game_snapshot_load()
+ * - hardware.cpp section 9: hal_snapshot_save(), hal_snapshot_load(), the
+ *   serial command
+ * - sim/tools/snapshot_run.cpp: Loads a snapshot and carries on
+ ******************************************************************************/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <Arduino.h>
+#include <stddef.h>
+#include "config.h"
+#include "ghost.h"
+
+const uint8_t SNAPSHOT_VERSION = 1;
+const uint8_t SNAPSHOT_MAGIC_0 = 'L';
+const uint8_t SNAPSHOT_MAGIC_1 = 'S';
+const uint8_t SNAPSHOT_COMMAND = 'S';            // Byte that asks for one
+const uint32_t SNAPSHOT_BAUD = 115200;           // ~440 bytes: ~40 ms on the wire
+const uint16_t SNAPSHOT_POLL_MS = 50;            // Command seen within this
+const uint8_t SNAPSHOT_EXPANDER_QUEUE = 4;       // hardware.cpp EXPANDER_QUEUE_SIZE
+
+enum SnapshotError {
+    SNAPSHOT_OK,
+    SNAPSHOT_BAD_MAGIC,      // Not a snapshot
+    SNAPSHOT_BAD_VERSION,    // SNAPSHOT_VERSION differs
+    SNAPSHOT_BAD_LAYOUT,     // Another firmware's structs (or LCD size)
+    SNAPSHOT_BAD_SIZE,       // Truncated, or the size field disagrees
+    SNAPSHOT_BAD_STATE       // No such GameState
+};
+
+/**
+ * The fields: X(type, name, dims), dims empty or [count]
+ */
+#define SNAPSHOT_GAME_FIELDS(X)                                             \
+    X(uint8_t,  state, )                      /* GameState */               \
+    X(uint8_t,  position, )                                                 \
+    X(uint8_t,  previous_position, )                                        \
+    X(int8_t,   direction, )                                                \
+    X(uint16_t, chase_speed, )                                              \
+    X(uint32_t, chase_age_ms, )               /* last_chase_update */       \
+    X(int8_t,   latency_offset, )                                           \
+    X(uint32_t, calibration_beat_age_ms, )                                  \
+    X(uint8_t,  calibration_beats, )                                        \
+    X(uint8_t,  calibration_count, )                                        \
+    X(uint8_t,  calibration_lit, )                                          \
+    X(uint8_t,  calibration_done, )                                         \
+    X(int16_t,  calibration_taps, [CALIBRATION_TAPS])                       \
+    X(uint16_t, score, )                                                    \
+    X(uint16_t, high_score, )                                               \
+    X(uint8_t,  new_high_score, )                                           \
+    X(uint8_t,  attract_credits_shown, )                                    \
+    X(uint32_t, attract_show_age_ms, )                                      \
+    X(uint32_t, state_entry_age_ms, )                                       \
+    X(uint32_t, game_ended_age_ms, )                                        \
+    X(uint8_t,  game_ended, )                                               \
+    X(uint16_t, rule_random, )                                              \
+    X(uint16_t, rally_steps, )                /* The ghost (ghost.h) */     \
+    X(uint8_t,  ghost_phase, )                /* GhostPhase */              \
+    X(uint8_t,  attract_ghost_next, )                                       \
+    X(uint8_t,  ghost_read, )                                               \
+    X(uint16_t, ghost_press_steps, )                                        \
+    X(uint16_t, ghost_press_ms, )                                           \
+    X(uint32_t, ghost_paused_age_ms, )                                      \
+    X(uint8_t,  ghost_size, )                                               \
+    X(uint8_t,  ghost_unsaved, )                                            \
+    X(uint8_t,  ghost_record_at, )                                          \
+    X(uint8_t,  ghost_image, [GHOST_IMAGE_MAX])
+
+#define SNAPSHOT_TRACK_FIELDS(X, track)                                     \
+    X(uint32_t, track##_since_age_ms, )                                     \
+    X(uint16_t, track##_wait, )                                             \
+    X(uint8_t,  track##_i, )                                                \
+    X(uint8_t,  track##_pauses, )
+
+#define SNAPSHOT_HAL_FIELDS(X)                                              \
+    X(uint32_t, button_edge_age_us, )         /* Debouncer */               \
+    X(uint32_t, button_burst_age_us, )                                      \
+    X(uint16_t, button_bounce_us, )                                         \
+    X(uint8_t,  button_burst_edges, )                                       \
+    X(uint8_t,  button_down, )                                              \
+    X(uint8_t,  button_presses, )                                           \
+    X(uint8_t,  button_presses_seen, )                                      \
+    X(uint16_t, bounce_saved_us, )                                          \
+    X(uint8_t,  anim_state, )                 /* AnimationState */          \
+    SNAPSHOT_TRACK_FIELDS(X, buzzer)                                        \
+    SNAPSHOT_TRACK_FIELDS(X, led)                                           \
+    X(uint8_t,  effect_kind, )                /* LedEffect */               \
+    X(uint8_t,  effect_a, )                                                 \
+    X(uint8_t,  effect_b, )                                                 \
+    X(uint8_t,  effect_step, )                                              \
+    X(uint16_t, effect_state, )                                             \
+    X(uint8_t,  celebration_effect_next, )                                  \
+    X(uint8_t,  attract_effect_next, )                                      \
+    X(uint8_t,  leds, )                       /* Bit n = LED n lit */       \
+    X(char,     lcd, [LCD_ROWS * LCD_COLS])   /* The frame, row by row */   \
+    X(char,     lcd_shown, [LCD_ROWS * LCD_COLS]) /* On the main LCD */     \
+    X(uint8_t,  lcd_cursor, )                                               \
+    X(uint16_t, expander_levels, )                                          \
+    X(uint32_t, expander_queue_age_us, [SNAPSHOT_EXPANDER_QUEUE])           \
+    X(uint8_t,  expander_queue_head, )                                      \
+    X(uint8_t,  expander_queue_count, )                                     \
+    X(uint8_t,  expander_queue_unoffered, )                                 \
+    X(uint8_t,  expander_pressed_before, )                                  \
+    X(uint32_t, expander_last_press_age_us, )                               \
+    X(uint8_t,  credits, )                                                  \
+    X(uint8_t,  coin_pulses_toward_credit, )
+
+#define SNAPSHOT_FIELD(type, name, dims) type name dims;
+
+typedef struct __attribute__((packed)) {
+    uint8_t magic[2];
+    uint8_t version;
+    uint16_t size;           // Header included
+    uint32_t layout;         // SNAPSHOT_LAYOUT_HASH
+    uint32_t taken_ms;       // The cabinet's millis(), for the report
+} SnapshotHeader;
+
+typedef struct __attribute__((packed)) {
+    SNAPSHOT_GAME_FIELDS(SNAPSHOT_FIELD)
+} GameSnapshot;
+
+typedef struct __attribute__((packed)) {
+    SNAPSHOT_HAL_FIELDS(SNAPSHOT_FIELD)
+} HalSnapshot;
+
+#undef SNAPSHOT_FIELD
+
+const uint16_t SNAPSHOT_SIZE = sizeof(SnapshotHeader) + sizeof(GameSnapshot) + sizeof(HalSnapshot);
+
+/**
+ * snapshot_fnv - FNV-1a over a string, then over a 16-bit value
+ */
+constexpr uint32_t snapshot_fnv(const char *text, uint32_t hash) {
+    return *text == '\0' ? hash : snapshot_fnv(text + 1, (hash ^ (uint8_t)*text) * 16777619u);
+}
+
+constexpr uint32_t snapshot_fnv16(uint16_t value, uint32_t hash) {
+    return (((hash ^ (value & 0xFF)) * 16777619u) ^ (value >> 8)) * 16777619u;
+}
+
+/**
+ * snapshot_field_hash - One field's contribution to SNAPSHOT_LAYOUT_HASH
+ *
+ * The fields' hashes are added up: the sum doesn't depend on the order of
+ * the list, but each one includes its offset, so moving a field still shows.
+ */
+constexpr uint32_t snapshot_field_hash(const char *text, uint16_t size, uint16_t offset) {
+    return snapshot_fnv16(offset, snapshot_fnv16(size, snapshot_fnv(text, 2166136261u)));
+}
+
+#define SNAPSHOT_GAME_HASH(type, name, dims) \
+    + snapshot_field_hash("game " #type " " #name, sizeof(type dims), offsetof(GameSnapshot, name))
+#define SNAPSHOT_HAL_HASH(type, name, dims) \
+    + snapshot_field_hash("hal " #type " " #name, sizeof(type dims), offsetof(HalSnapshot, name))
+
+const uint32_t SNAPSHOT_LAYOUT_HASH =
+    0u SNAPSHOT_GAME_FIELDS(SNAPSHOT_GAME_HASH) SNAPSHOT_HAL_FIELDS(SNAPSHOT_HAL_HASH);
+
+#undef SNAPSHOT_GAME_HASH
+#undef SNAPSHOT_HAL_HASH
+
+/**
+ * SnapshotWriter - Where game_snapshot_write() sends each part
+ *
+ * The board: the serial port, a part at a time (no ~440-byte buffer on a
+ * 2 KB stack). The host: a memory buffer.
+ */
+typedef void (*SnapshotWriter)(const void *data, uint16_t size, void *context);
+
+#endif // SNAPSHOT_H
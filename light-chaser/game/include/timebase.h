@@ -0,0 +1,131 @@
+/******************************************************************************
+ * TIMEBASE.H - Tickless Timekeeping (Timer1 Read on Demand, Sleep to Deadline)
+ *
+ * The Arduino core keeps millis() with a Timer0 overflow interrupt that fires
+ * every 1.024 ms, whether or not anything is due. That is ~976 interrupts
+ * per second in which the CPU can't sleep, and ~5 µs of delay added to any
+ * other interrupt that happens to arrive during one (tone(), Serial, I2C).
+ *
+ * In ATTRACT the game only has something to do every 200 ms (one chase
+ * step), or when the button changes. The tickless timebase wakes for those
+ * and nothing else:
+ *
+ *   Timer0 tick:  |||||||||||||||||||||||||||||||||||||||  ~976 ISRs/s
+ *   Tickless:     |         |         |         |          ~5 ISRs/s
+ *                 chase     chase     chase     chase
+ *
+ * HOW IT WORKS:
+ * - "Now" comes from Timer1 running free at F_CPU/256 (16 µs per count at
+ *   16 MHz, 32 µs at 8 MHz). Nothing interrupts when it wraps; each read adds the counts
+ *   since the last read to a 32-bit µs / ms total.
+ * - After each loop(), game_ms_until_next_event() says how long nothing will
+ *   happen. timebase_sleep() arms Timer1's compare interrupt for that
+ *   deadline and idles. A pin-change interrupt on the button (and on the
+ *   input expander's INTA) ends the sleep early.
+ * - At the top of the next loop() timebase_sync() copies the Timer1 time
+ *   into the core's millis() counter, so game.cpp and hardware.cpp keep
+ *   calling millis() unchanged.
+ *
+ * Sleeps are capped at TIMEBASE_MAX_SLEEP_MS so the 16-bit counter can't
+ * wrap twice between reads, and so the 4 s watchdog is always fed. The host
+ * simulator has always worked this way (sim_run_until() jumps from event to
+ * event), so bench_clock's "loop() per game-s" is the firmware's wake rate.
+ *
+ * WHAT STOPS WORKING:
+ * With Timer0's overflow interrupt off, the core's delay() and micros() no
+ * longer advance. Nothing calls them after setup() (the LCD library's
+ * delays are all during lcd.init(), which runs before timebase_init());
+ * trace timestamps come from timebase_micros() instead. delayMicroseconds()
+ * is a busy loop and still works. Timer0 itself keeps running, so PWM is
+ * unaffected.
+ *
+ * MEASURING IT (uno_timebase_stats / uno_timebase_stats_timer0):
+ * Every 6 s in ATTRACT the stats build prints to Serial:
+ * - ISR wakeups per second (Timer0 overflows + timebase interrupts) over 5 s
+ * - The latency of a 10 kHz probe interrupt on Timer2 over 1 s, in CPU
+ *   cycles: the spread (max - min) is the jitter other interrupts see
+ * The _timer0 environment builds the same firmware with -DTIMEBASE_TIMER0,
+ * which leaves the core's Timer0 tick in charge and never sleeps, to give
+ * the "before" numbers on the same board.
+ *
+ * Related files:
+ * - timebase.cpp: Timer1 counter, compare and pin-change interrupts, stats
+ * - coin.cpp: Another pin-change interrupt that ends sleeps
+ * - main.cpp: loop() calls timebase_sync() and timebase_sleep()
+ * - game.cpp: game_ms_until_next_event() (the scheduler's next deadline)
+ ******************************************************************************/
+
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <Arduino.h>
+
+const uint16_t TIMEBASE_MAX_SLEEP_MS = 500;   // Longest single sleep (ms)
+// Serial speed of the stats build: 115200 is 3.5% off at 8 MHz (clocks.h)
+const uint32_t TIMEBASE_STATS_BAUD = F_CPU >= 16000000UL ? 115200 : 38400;
+
+/**
+ * timebase_init - Take over timekeeping from Timer0 (call at end of setup())
+ *
+ * Must run after hardware_init(): lcd.init() waits with delay(), which
+ * needs the Timer0 tick.
+ */
+void timebase_init(void);
+
+/**
+ * timebase_sync - Bring millis() up to date (call at the top of loop())
+ */
+void timebase_sync(void);
+
+/**
+ * timebase_sleep - Idle until @ms after the last timebase_sync()
+ * @param ms: Time until the next event (game_ms_until_next_event()),
+ *            0 = return at once, NO_PENDING_EVENT = sleep the maximum
+ *
+ * Returns early if the button or the expander's INTA changes. Other
+ * interrupts (Serial, the buzzer) are serviced without returning.
+ */
+void timebase_sleep(uint32_t ms);
+
+/**
+ * timebase_micros - Microseconds since boot (replaces micros())
+ */
+uint32_t timebase_micros(void);
+
+/**
+ * timebase_pin_change_us - When the last wake pin changed (timebase_micros())
+ *
+ * Stamped by the pin-change interrupt itself, so it is the time of the edge
+ * even if loop() was busy (an LCD update) when it happened. Wake pins are the
+ * button and the input expander's INTA; the stamp is whichever changed last.
+ * Must be read within a second of the edge (one Timer1 wrap). With
+ * -DTIMEBASE_TIMER0 there is no interrupt and this is just "now".
+ */
+uint32_t timebase_pin_change_us(void);
+
+/**
+ * timebase_isr_micros - timebase_micros() for interrupt handlers
+ *
+ * Doesn't update the running totals (that is main-context work), so it is
+ * only good to within one Timer1 wrap of the last loop(): fine for timing
+ * a pulse, not for a timestamp kept for seconds.
+ */
+uint32_t timebase_isr_micros(void);
+
+/**
+ * timebase_wake - End the current timebase_sleep() (call from an ISR)
+ *
+ * For interrupts other than the button and INTA that leave work for
+ * loop(), such as a counted coin pulse.
+ */
+void timebase_wake(void);
+
+#ifdef TIMEBASE_STATS
+/**
+ * timebase_stats_poll - Advance the measurement (call once per loop())
+ * @param attract: true while in STATE_ATTRACT; measurements only run then
+ */
+void timebase_stats_poll(bool attract);
+#endif
+
+#endif // TIMEBASE_H
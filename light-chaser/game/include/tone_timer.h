@@ -0,0 +1,121 @@
+/******************************************************************************
+ * TONE_TIMER.H - Buzzer Notes with Compile-Time Timer2 Settings
+ *
+ * Arduino's tone() works out its prescaler and compare value when it is
+ * called: a loop over the dividers with 32-bit divisions, plus a 32-bit
+ * multiply for the duration, every time a note starts. Every note this game
+ * plays is a constant, so all of that can be done by the compiler instead:
+ *
+ *   tone(11, 500, 100)        1000+ cycles of 32-bit division, then start
+ *   tone_play(TONE_HIT)       load 4 bytes, start
+ *
+ * A ToneNote holds the finished register values. TONE_NOTE() builds one
+ * from a frequency and duration and refuses to compile if this F_CPU can't
+ * play it (see clocks.h).
+ *
+ * HOW THE PIN IS DRIVEN:
+ * The buzzer is on D11, which is Timer2's OC2A output. In CTC mode with
+ * "toggle OC2A on compare match" the timer itself flips the pin; the
+ * compare interrupt only counts toggles down to the end of the note and then
+ * disconnects the pin (it falls back to LOW). tone() toggles the pin from
+ * software in the same interrupt, so this also removes pin jitter when
+ * another interrupt delays the ISR.
+ *
+ * The duration is counted with the note's real frequency (after rounding
+ * top), so a note lasts its duration at any clock speed.
+ *
+ * ATTINY85:
+ * Timer2 doesn't exist there. Timer1 does the same job on OC1B (PB4): CTC
+ * with OCR1C as top, and compare B toggling the pin at top. Its dividers
+ * are every power of two up to 16384 (clocks.h), so the note's clock
+ * select and top are worked out for those instead; ToneNote is unchanged.
+ *
+ * Related files:
+ * - tone_timer.cpp: Timer2 driver (firmware only)
+ * - sim/sim.cpp: Host version (logs each note's frequency)
+ * - clocks.h: Prescaler search and register range checks
+ ******************************************************************************/
+
+#ifndef TONE_TIMER_H
+#define TONE_TIMER_H
+
+#include "clocks.h"
+
+typedef struct {
+    uint16_t hz;             // Requested frequency (logged by the simulator)
+    uint8_t clock_select;    // TCCR2B CS22..CS20 (ATtiny85: TCCR1 CS13..CS10)
+    uint8_t top;             // OCR2A (ATtiny85: OCR1C)
+    uint16_t toggles;        // Compare matches until the note ends
+} ToneNote;
+
+/**
+ * tone_prescaler, tone_clock_select - The buzzer timer's dividers
+ *
+ * Timer2 on the ATmega328P (and in the host simulator), Timer1 on the
+ * ATtiny85.
+ */
+#if defined(__AVR_ATtiny85__)
+constexpr uint16_t tone_prescaler(uint8_t cs) {
+    return timer1_tiny_prescaler(cs);
+}
+
+constexpr uint8_t tone_clock_select(uint32_t hz) {
+    return timer1_tiny_clock_select(hz);
+}
+#else
+constexpr uint16_t tone_prescaler(uint8_t cs) {
+    return timer2_prescaler(cs);
+}
+
+constexpr uint8_t tone_clock_select(uint32_t hz) {
+    return timer2_clock_select(hz);
+}
+#endif
+
+/**
+ * tone_toggles - Compare matches in @ms at @hz with clock setting @cs
+ */
+constexpr uint32_t tone_toggles(uint32_t hz, uint16_t ms, uint8_t cs) {
+    return F_CPU / 1000 * ms / ((uint32_t)tone_prescaler(cs) * (ctc_top(hz, tone_prescaler(cs)) + 1));
+}
+
+/**
+ * tone_note_valid - Can this F_CPU play @hz for @ms?
+ *
+ * Needs a divider with an 8-bit top, and a toggle count that is not
+ * zero (a note too short to hear) and fits 16 bits.
+ */
+constexpr bool tone_note_valid(uint32_t hz, uint16_t ms) {
+    return tone_clock_select(hz) != 0 &&
+           tone_toggles(hz, ms, tone_clock_select(hz)) >= 1 &&
+           tone_toggles(hz, ms, tone_clock_select(hz)) <= 0xFFFF;
+}
+
+constexpr ToneNote tone_note(uint16_t hz, uint16_t ms) {
+    return ToneNote{hz, tone_clock_select(hz),
+                    (uint8_t)ctc_top(hz, tone_prescaler(tone_clock_select(hz))),
+                    (uint16_t)tone_toggles(hz, ms, tone_clock_select(hz))};
+}
+
+/**
+ * TONE_NOTE - Define a checked, compile-time note
+ *
+ *   TONE_NOTE(TONE_HIT, FREQ_HIT, DURATION_HIT);
+ */
+#define TONE_NOTE(name, hz, ms)                                                  \
+    static_assert(tone_note_valid((hz), (ms)), #name ": not playable at this F_CPU"); \
+    constexpr ToneNote name = tone_note((hz), (ms))
+
+/**
+ * tone_play - Start @note on the buzzer (replaces any note still playing)
+ *
+ * Returns at once; the note stops by itself after its duration.
+ */
+void tone_play(ToneNote note);
+
+/**
+ * tone_stop - Silence the buzzer now
+ */
+void tone_stop(void);
+
+#endif // TONE_TIMER_H
@@ -0,0 +1,155 @@
+/******************************************************************************
+ * TRACE.H - Timeline Tracing (Begin/End Events for Perfetto / chrome://tracing)
+ *
+ * Timing bugs in this game are usually several things overlapping: a chase
+ * step, an LCD I2C burst, a tone() re-arm and an EEPROM write all landing in
+ * the same loop(). A flat log can't show that; a timeline can.
+ *
+ * HOW IT WORKS:
+ * The firmware marks interesting code with TRACE_BEGIN / TRACE_END (spans)
+ * and TRACE_INSTANT (points in time). Each mark becomes an 8-byte record:
+ *
+ *   ┌──────┬───────┬───────┬─────┬──────────────────────┐
+ *   │ 0xA5 │ event │ phase │ arg │ micros() (u32, LE)   │
+ *   └──────┴───────┴───────┴─────┴──────────────────────┘
+ *   sync    TraceEvent  'B' 'E' 'i'  e.g. GameState
+ *
+ * Three places produce the same record stream, all through trace.cpp:
+ * - The board: records go out over Serial (TRACE_BAUD)
+ * - simavr: the same firmware, capture its UART output
+ * - The host simulator: its Serial shim writes to a file, and micros()
+ *   follows a modelled bus clock (LCD and EEPROM time, see sim.cpp)
+ *
+ * tools/trace_export.cpp turns any of them into Chrome Trace Event JSON,
+ * which both chrome://tracing and ui.perfetto.dev open directly.
+ *
+ * ZERO COST WHEN OFF:
+ * Without -DTRACE_ENABLED every macro expands to nothing (beyond a cast to
+ * void), so the normal firmware compiles to the same code as before. Build
+ * the uno_trace environment (platformio.ini) to get a tracing firmware.
+ *
+ * COST WHEN ON:
+ * One record = 8 bytes = 80 µs of serial time at 1 Mbaud. Serial.write()
+ * only blocks when its 64-byte buffer is full, so short bursts are cheap but
+ * a trace-heavy loop() will itself show up as extra time on the timeline.
+ *
+ * EMPTY SPANS ARE DROPPED:
+ * loop() runs thousands of times per second and almost every run does
+ * nothing. Sending game_update / animation_update / state update spans for
+ * all of them would swamp the serial port, so those events are marked
+ * "elide": their BEGIN is held back in RAM and only sent once something
+ * else is recorded inside the span. A span with nothing in it costs no
+ * serial traffic at all.
+ *
+ * INTERRUPTS:
+ * Serial can't be used from an ISR, so an interrupt handler only notes when
+ * it was entered (TRACE_ISR_ENTER, with timebase_isr_micros()). The next
+ * timebase_sync() sends that as a TRACE_ISR instant carrying the entry
+ * time, so it lands on the timeline where the interrupt happened even
+ * though it reaches the stream after records made later. One stamp is kept
+ * per vector: a burst between two loop()s shows as its first interrupt.
+ * The host simulator has no interrupts and records none (fidelity_check
+ * doesn't compare them).
+ *
+ * Related files:
+ * - trace.cpp: Record encoding, empty-span elision, Serial transport
+ * - sim/sim.cpp: Host Serial and micros() (bus cost model)
+ * - sim/tools/trace_export.cpp: Record stream -> JSON
+ ******************************************************************************/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+
+/**
+ * TRACE_EVENTS - Every trace point: X(id, name, track, elide)
+ *
+ * Listed once here so the firmware (ids) and the exporter (names, tracks)
+ * can't drift apart. Tracks become separate rows on the timeline.
+ * elide = 1: drop the span if nothing happens inside it (see above).
+ */
+#define TRACE_EVENTS(X)                                                     \
+    X(TRACE_GAME_UPDATE,      "game_update",        "game",        1)      \
+    X(TRACE_STATE_UPDATE,     "state update",       "game",        1)      \
+    X(TRACE_TRANSITION,       "game_transition_to", "game",        0)      \
+    X(TRACE_CHASE_STEP,       "chase step",         "game",        0)      \
+    X(TRACE_ANIMATION_UPDATE, "animation_update",   "animation",   1)      \
+    X(TRACE_ANIM_NOTE,        "note",               "animation",   0)      \
+    X(TRACE_ANIM_LEDS,        "LED step",           "animation",   0)      \
+    X(TRACE_ANIM_DONE,        "animation done",     "animation",   0)      \
+    X(TRACE_DISPLAY,          "display",            "I2C",         0)      \
+    X(TRACE_EXPANDER_READ,    "expander read",      "I2C",         0)      \
+    X(TRACE_EEPROM_WRITE,     "eeprom_write",       "EEPROM",      0)      \
+    X(TRACE_TONE,             "tone",               "buzzer",      0)      \
+    X(TRACE_ISR,              "ISR",                "interrupts",  0)
+
+#define TRACE_EVENT_ID(id, name, track, elide) id,
+enum TraceEvent {
+    TRACE_EVENTS(TRACE_EVENT_ID)
+    TRACE_EVENT_COUNT
+};
+#undef TRACE_EVENT_ID
+
+const uint8_t TRACE_SYNC = 0xA5;
+const uint8_t TRACE_RECORD_SIZE = 8;
+const uint32_t TRACE_BAUD = 1000000;
+
+/**
+ * Display call identifiers (arg of TRACE_DISPLAY)
+ */
+enum TraceDisplay {
+    TRACE_DISPLAY_ATTRACT,
+    TRACE_DISPLAY_GAME,
+    TRACE_DISPLAY_CELEBRATION,
+    TRACE_DISPLAY_CLEAR,
+    TRACE_DISPLAY_CALIBRATION,
+    TRACE_DISPLAY_POST,
+    TRACE_DISPLAY_FLUSH,         // display_service(): the rest of a screen
+    TRACE_DISPLAY_GHOST
+};
+
+/**
+ * Interrupt vectors (arg of TRACE_ISR)
+ */
+enum TraceIsr {
+    TRACE_ISR_TIMER1_COMPA,      // timebase.cpp: sleep deadline
+    TRACE_ISR_PCINT0,            // timebase.cpp: button / INTA edge
+    TRACE_ISR_PCINT1,            // coin.cpp: coin mech pulse edge
+    TRACE_ISR_COUNT
+};
+
+#ifdef TRACE_ENABLED
+
+/**
+ * trace_init - Start the trace transport (board: Serial.begin(TRACE_BAUD))
+ * trace_record - Emit one record, timestamped with timebase_micros()
+ * trace_isr_enter - Note an interrupt's entry time (call from the ISR)
+ * trace_isr_flush - Emit the noted entries as TRACE_ISR instants
+ *                   (main context: timebase_sync())
+ */
+void trace_init(void);
+void trace_record(uint8_t event, char phase, uint8_t arg);
+void trace_isr_enter(uint8_t vector);
+void trace_isr_flush(void);
+
+#define TRACE_INIT()              trace_init()
+#define TRACE_BEGIN(event, arg)   trace_record((event), 'B', (uint8_t)(arg))
+#define TRACE_END(event, arg)     trace_record((event), 'E', (uint8_t)(arg))
+#define TRACE_INSTANT(event, arg) trace_record((event), 'i', (uint8_t)(arg))
+#define TRACE_ISR_ENTER(vector)   trace_isr_enter(vector)
+#define TRACE_ISR_FLUSH()         trace_isr_flush()
+
+#else
+
+// "Use" arg so a variable kept only for tracing doesn't trigger a warning
+#define TRACE_INIT()              ((void)0)
+#define TRACE_BEGIN(event, arg)   ((void)(arg))
+#define TRACE_END(event, arg)     ((void)(arg))
+#define TRACE_INSTANT(event, arg) ((void)(arg))
+#define TRACE_ISR_ENTER(vector)   ((void)0)
+#define TRACE_ISR_FLUSH()         ((void)0)
+
+#endif // TRACE_ENABLED
+
+#endif // TRACE_H
@@ -0,0 +1,9 @@
+# PlatformIO extra script: link the env as a shared library instead of a
+# program. Only symbols marked CHASER_API (see src/sim/chaser.h) are exported.
+Import("env")
+
+env.Append(
+    CCFLAGS=["-fPIC", "-fvisibility=hidden"],
+    LINKFLAGS=["-shared"],
+)
+env.Replace(PROGNAME="libchaser", PROGSUFFIX=".so")
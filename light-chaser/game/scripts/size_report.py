@@ -0,0 +1,36 @@
+# PlatformIO extra script: after linking, print the firmware's flash and
+# static SRAM (.data + .bss) against the board's limits. What static SRAM
+# leaves is all the stack has. With custom_stack_reserve set in the env
+# (platformio.ini), the build fails when less than that is left: on a
+# 512-byte part a few new globals can reach the stack without any error.
+import subprocess
+
+Import("env")
+
+
+def size_report(source, target, env):
+    elf = str(target[0])
+    lines = subprocess.check_output([env.subst("$SIZETOOL"), elf]).decode().splitlines()
+    text, data, bss = [int(field) for field in lines[1].split()[:3]]
+
+    board = env.BoardConfig()
+    flash_max = int(board.get("upload.maximum_size"))
+    sram_max = int(board.get("upload.maximum_ram_size"))
+    reserve = int(env.GetProjectOption("custom_stack_reserve", "0"))
+    flash = text + data
+    sram = data + bss
+
+    print("Size (%s): flash %d of %d bytes (%d%%), static SRAM %d of %d bytes (%d%%), "
+          "%d left for the stack" % (env.subst("$PIOENV"), flash, flash_max,
+                                     100 * flash // flash_max, sram, sram_max,
+                                     100 * sram // sram_max, sram_max - sram))
+    if flash > flash_max:
+        print("Size: FAIL: %d bytes over flash" % (flash - flash_max))
+        env.Exit(1)
+    if reserve != 0 and sram_max - sram < reserve:
+        print("Size: FAIL: the stack needs %d bytes (custom_stack_reserve), %d are left"
+              % (reserve, sram_max - sram))
+        env.Exit(1)
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", size_report)
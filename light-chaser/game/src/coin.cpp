@@ -0,0 +1,84 @@
+/******************************************************************************
+ * COIN.CPP - Coin Mech Pulse Counter Implementation
+ *
+ * Firmware only (pin-change interrupt registers); see coin.h.
+ *
+ * The coin pin is alone in its pin-change group (PCINT1, A0-A5), so the ISR
+ * knows which pin changed without comparing against a saved port value. It
+ * reads the level to tell the edges apart: LOW = pulse start, HIGH = end.
+ * Two edges that come too close together for the ISR to see both (a glitch
+ * shorter than the ISR itself) look like no change at all, which is right:
+ * no coin.
+ *
+ * Related files:
+ * - coin.h: Why an interrupt, and the counter API
+ * - timebase.cpp: timebase_isr_micros() (pulse timing), timebase_wake(),
+ *   timebase_sync() (sends the ISR's trace entries, see trace.h)
+ * - board.h: BOARD_HAS_COIN (without it: free play, no pulses ever)
+ ******************************************************************************/
+
+#include "coin.h"
+#include "board.h"
+#include "timebase.h"
+#include "trace.h"
+
+#ifdef BOARD_HAS_COIN
+
+static_assert(digitalPinToPCICRbit(COIN_PIN) == 1, "The coin ISR is PCINT1_vect (A0-A5)");
+
+static volatile uint8_t pulses = 0;
+static volatile uint8_t rejects = 0;
+static volatile bool pulse_low = false;    // Saw the falling edge
+static volatile uint32_t pulse_start_us = 0;
+
+ISR(PCINT1_vect) {
+    uint32_t now = timebase_isr_micros();
+    TRACE_ISR_ENTER(TRACE_ISR_PCINT1);
+    if (digitalRead(COIN_PIN) == LOW) {
+        pulse_low = true;
+        pulse_start_us = now;
+    } else if (pulse_low) {
+        pulse_low = false;
+        if (coin_pulse_valid(now - pulse_start_us)) {
+            pulses++;
+            timebase_wake();
+        } else {
+            rejects++;
+        }
+    }
+}
+
+void coin_init(void) {
+    pinMode(COIN_PIN, INPUT_PULLUP);
+
+    uint8_t sreg = SREG;
+    cli();
+    pulse_low = false;
+    *digitalPinToPCMSK(COIN_PIN) |= _BV(digitalPinToPCMSKbit(COIN_PIN));
+    PCIFR = _BV(digitalPinToPCICRbit(COIN_PIN));
+    PCICR |= _BV(digitalPinToPCICRbit(COIN_PIN));
+    SREG = sreg;
+}
+
+uint8_t coin_pulses(void) {
+    return pulses;
+}
+
+uint8_t coin_rejects(void) {
+    return rejects;
+}
+
+#else // No coin mech: free play
+
+void coin_init(void) {
+}
+
+uint8_t coin_pulses(void) {
+    return 0;
+}
+
+uint8_t coin_rejects(void) {
+    return 0;
+}
+
+#endif // BOARD_HAS_COIN
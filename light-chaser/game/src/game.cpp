@@ -13,10 +13,14 @@
  *
  * ARCHITECTURE OVERVIEW:
  *
- * 5 game states × 3 lifecycle functions = 15 state handler functions
- * + 2 helper functions (update_chase_position, calculate_score)
+ * 7 game states × 3 lifecycle functions = 21 state handler functions
+ * + 13 helper functions (update_chase_position, chase_next, chase_position_at,
+ *   calculate_score, speed_up, rules_has, rules_load, rules_call,
+ *   calibration_finish, between_games, new_game_setup, note_game_start,
+ *   restart_update)
+ * + 13 attract ghost functions (ghost_*, see ghost.h)
  * + 3 public interface functions (game_init, game_update, game_transition_to)
- * = 20 functions total
+ * = 50 functions total
  *
  * READING GUIDE:
  * 1. Read static variable section to understand game data
@@ -36,18 +40,24 @@
  * PLAYING (continue game)
  *    ↓ Button press + miss target
  * CELEBRATION or GAME_OVER (depending on high score)
- *    ↓ Animation complete
- * ATTRACT (loop)
+ *    ↓ Animation complete            ↘ Button press (after 600ms): skip
+ * ATTRACT (loop)                       PLAYING (next game, no ATTRACT)
  *
  * Related files:
  * - game.h: StateHandler typedef and public interface
  * - hardware.cpp: All hardware operations called from this file
  * - config.h: All constants (BULLSEYE_SCORE, chase speeds, etc.)
+ * - rules.h: Game modes that replace the chase, scoring and speed-up rules
+ * - ghost.h: The record-setting game, recorded here and replayed in ATTRACT
  ******************************************************************************/
 
 #include "game.h"
 #include "hardware.h"
 #include "config.h"
+#include "rules.h"
+#include "ghost.h"
+#include "trace.h"
+#include "timebase.h"
 
 /******************************************************************************
  * STATIC VARIABLES - Game State Data
@@ -106,8 +116,9 @@
  *
  * RAM (Data memory, 2 KB):
  *   - Stack: ~200 bytes (grows downward)
- *   - Static/global variables: ~420 bytes
- *   - Remaining: ~1400 bytes free (no heap used!)
+ *   - Static/global variables in this file: ~520 bytes, of which
+ *     ghost_image is 212 and rule_image 150
+ *   - Remaining: ~1300 bytes, less the other modules' statics (no heap used!)
  *
  * See memory.md for full memory usage analysis.
  ******************************************************************************/
@@ -121,17 +132,80 @@ static uint8_t current_position = 0;        // LED index (0-7)
 static int8_t chase_direction = 1;          // Movement direction: +1 = right, -1 = left
 static uint16_t chase_speed = INITIAL_CHASE_SPEED;  // ms between LED movements (decreases as game progresses)
 static uint32_t last_chase_update = 0;      // Timestamp of last LED movement (for non-blocking timing)
+static uint8_t previous_position = 0;       // LED lit before last_chase_update (for latency correction)
+
+// Button latency correction (ms), from calibration mode via EEPROM
+// Presses are judged at (press time - latency_offset), see playing_update()
+static int8_t latency_offset = 0;
+
+// Calibration run (STATE_CALIBRATION only)
+static uint32_t calibration_beat_time = 0;  // When the most recent beat played
+static uint8_t calibration_beats = 0;       // Beats played so far
+static uint8_t calibration_count = 0;       // Taps measured so far
+static bool calibration_lit = false;        // Beat flash LEDs on
+static bool calibration_done = false;       // Showing the result screen
+static int16_t calibration_taps[CALIBRATION_TAPS];  // Tap - nearest beat (ms)
 
 // Score tracking
 static uint16_t current_score = 0;          // Score for current game (reset on new game)
 static uint16_t high_score = 0;             // All-time high score (loaded from EEPROM)
 static bool is_new_high_score = false;      // Flag: did we beat the high score this game?
 
+// Credits on the attract screen (redrawn when a coin changes them)
+static uint8_t attract_credits_shown = 0;
+
+// Attract LED showcase: start of attract mode, or of the last showcase
+static uint32_t attract_show_from = 0;
+
 // Generic state timing
 // Consolidated timing variable used by multiple states (RESULT, CELEBRATION)
 // Replaces previous scattered timing variables (result_state_start, celebration_start_time)
 static uint32_t state_entry_time = 0;       // Timestamp when we entered current state (millis())
 
+// Time between games: from a miss to the next game's start (see
+// game_get_throughput()). Skipping the end animation shortens it.
+static GameThroughput throughput;
+static uint32_t game_ended_at = 0;          // millis() of the last miss
+static bool game_ended = false;             // A miss not yet followed by a start
+
+// Game mode (rules.h): a checked rule image from EEPROM. A part of length 0
+// (all three when nothing is stored) keeps the built-in rule for its hook.
+// A RULES_BUILTIN_ONLY board (board.h) has no room for the image.
+#ifndef RULES_BUILTIN_ONLY
+static uint8_t rule_image[RULES_IMAGE_MAX];
+static RuleSet rules = {{0, 0, 0}, rule_image};
+#else
+static RuleSet rules = {{0, 0, 0}, NULL};
+#endif
+static uint16_t rule_random = 1;            // RULE_RND state (never 0)
+
+// The record's ghost (ghost.h). ghost_image holds the stored run, except
+// while a game is recorded over it: ghost_size is 0 from the game's start
+// until its miss, when it becomes the new ghost (a record) or the stored
+// one is read back. A GHOST_REPLAY-less board (board.h) has no room for it.
+#ifdef GHOST_REPLAY
+static uint8_t ghost_image[GHOST_IMAGE_MAX];
+static uint8_t ghost_size = 0;              // A whole, checked image (0 = none)
+static uint8_t ghost_unsaved = 0;           // EEPROM writes it still needs (0 = stored)
+static uint8_t ghost_record_at = 0;         // Next byte of the recording (0 = not recording)
+static uint16_t rally_steps = 0;            // Chase steps since PLAYING (or the ghost's rally) began
+
+// Playback in ATTRACT: chasing towards the next press, paused after a hit
+// (as RESULT), or holding the final miss
+enum GhostPhase { GHOST_IDLE, GHOST_CHASE, GHOST_PAUSE, GHOST_OVER };
+static uint8_t ghost_phase = GHOST_IDLE;
+static bool attract_ghost_next = true;      // The next showcase slot is the ghost's
+static uint8_t ghost_read = 0;              // Next press in ghost_image
+static uint16_t ghost_press_steps = 0;      // It comes after this many chase steps
+static uint16_t ghost_press_ms = 0;         // ...and this many ms after the last one
+static uint32_t ghost_paused_at = 0;        // Start of the pause or the final hold
+#endif
+
+// How long the timed states last (used by their update functions and by
+// game_ms_until_next_event(), so they are named rather than inline)
+static const uint16_t RESULT_PAUSE_MS = 300;        // RESULT -> PLAYING
+static const uint16_t CELEBRATION_HOLD_MS = 2000;   // CELEBRATION -> ATTRACT
+
 /******************************************************************************
  * FORWARD DECLARATIONS
  *
@@ -163,9 +237,41 @@ static void game_over_enter(void);
 static void game_over_update(void);
 static void game_over_exit(void);
 
+static void calibration_enter(void);
+static void calibration_update(void);
+static void calibration_exit(void);
+
+static void self_test_enter(void);
+static void self_test_update(void);
+static void self_test_exit(void);
+
 // Helper functions (private to this file)
 static void update_chase_position(void);
+static void chase_next(uint8_t *position, int8_t *direction);
+static bool rules_has(uint8_t hook);
+static void rules_load(void);
+static void rules_call(uint8_t hook, uint8_t position, int8_t direction, uint8_t points,
+                       int16_t reg[RULE_REGS]);
+static bool between_games(void);
+static void new_game_setup(void);
+static void note_game_start(void);
+static bool restart_update(void);
+static uint8_t chase_position_at(uint32_t time);
 static uint8_t calculate_score(uint8_t position);
+static void speed_up(uint8_t points);
+static void calibration_finish(void);
+
+// The attract ghost (ghost.h); without GHOST_REPLAY these do nothing
+static bool ghost_playing(void);
+static bool ghost_take_slot(void);
+static void ghost_update(void);
+static uint32_t ghost_ms_until_next_event(void);
+static void ghost_record_start(void);
+static void ghost_record_press(uint32_t now);
+static void ghost_record_end(bool record);
+static void ghost_load(void);
+static void ghost_save_service(bool save_ok);
+static uint32_t ghost_save_ms_until_next_event(bool save_ok);
 
 /******************************************************************************
  * STATE HANDLER TABLE - Heart of the State Machine
@@ -177,9 +283,9 @@ static uint8_t calculate_score(uint8_t position);
  *
  * SYNTAX BREAKDOWN:
  *
- * static const StateHandler state_handlers[5] = {
+ * static const StateHandler state_handlers[7] = {
  *   └┬┘  └──┬──┘ └────┬─────┘ └─────┬──────┘ └┬┘
- *    │      │          │             │          └─ Array size (5 states)
+ *    │      │          │             │          └─ Array size (7 states)
  *    │      │          │             └──────────── Array name
  *    │      │          └────────────────────────── Type (struct from game.h)
  *    │      └───────────────────────────────────── Immutable (stored in Flash)
@@ -228,7 +334,7 @@ static uint8_t calculate_score(uint8_t position);
  * 3. Add entry to this table:
  *      [STATE_PAUSED] = {paused_enter, paused_update, paused_exit},
  *
- * 4. Update array size [5] → [6]
+ * 4. Update array size [7] → [8]
  *
  * That's it! No changes needed to game_update() or game_transition_to().
  * They automatically work with the new state.
@@ -255,12 +361,14 @@ static uint8_t calculate_score(uint8_t position);
  * Table is actually FASTER, plus more scalable!
  ******************************************************************************/
 
-static const StateHandler state_handlers[5] = {
+static const StateHandler state_handlers[7] = {
     [STATE_ATTRACT]     = {attract_enter,     attract_update,     attract_exit},
     [STATE_PLAYING]     = {playing_enter,     playing_update,     playing_exit},
     [STATE_RESULT]      = {result_enter,      result_update,      result_exit},
     [STATE_CELEBRATION] = {celebration_enter, celebration_update, celebration_exit},
-    [STATE_GAME_OVER]   = {game_over_enter,   game_over_update,   game_over_exit}
+    [STATE_GAME_OVER]   = {game_over_enter,   game_over_update,   game_over_exit},
+    [STATE_CALIBRATION] = {calibration_enter, calibration_update, calibration_exit},
+    [STATE_SELF_TEST]   = {self_test_enter,   self_test_update,   self_test_exit}
 };
 
 /******************************************************************************
@@ -334,6 +442,8 @@ static const StateHandler state_handlers[5] = {
  ******************************************************************************/
 
 void game_transition_to(GameState new_state) {
+    TRACE_BEGIN(TRACE_TRANSITION, new_state);
+
     // Call current state's exit function (cleanup old state)
     if (state_handlers[current_state].exit != NULL) {
         state_handlers[current_state].exit();
@@ -346,6 +456,8 @@ void game_transition_to(GameState new_state) {
     if (state_handlers[current_state].enter != NULL) {
         state_handlers[current_state].enter();
     }
+
+    TRACE_END(TRACE_TRANSITION, new_state);
 }
 
 /******************************************************************************
@@ -390,6 +502,7 @@ void game_transition_to(GameState new_state) {
 void game_init(void) {
     // Initialise chase LED animation
     current_position = 0;
+    previous_position = 0;
     chase_direction = 1;
     chase_speed = INITIAL_CHASE_SPEED;
     last_chase_update = millis();
@@ -400,15 +513,164 @@ void game_init(void) {
     current_score = 0;
     is_new_high_score = false;
 
+    // Per-cabinet button latency (0 until calibrated)
+    latency_offset = eeprom_read_latency_offset();
+
+    // Game mode: the stored rule program, or the built-in rules
+    rules_load();
+
+    // Throughput counters start again at every boot
+    memset(&throughput, 0, sizeof(throughput));
+    game_ended = false;
+
     // Enter initial state (attract mode)
     current_state = STATE_ATTRACT;  // Set valid state first
     game_transition_to(STATE_ATTRACT);  // Properly enter state (calls attract_enter)
+
+#ifdef GHOST_REPLAY
+    // No replay under way, and the first showcase slot is the ghost's.
+    // setup() can run again without a reset (the host simulator powers on
+    // many times in one process), so nothing may carry over from last time
+    ghost_phase = GHOST_IDLE;
+    attract_ghost_next = true;
+    rally_steps = 0;
+    ghost_read = 0;
+    ghost_press_steps = 0;
+    ghost_press_ms = 0;
+    ghost_paused_at = 0;
+#endif
+
+    // Button held at power-on: run latency calibration instead.
+    // Otherwise, if the power-on self-test found a fault, report it first.
+    if (button_is_down()) {
+        game_transition_to(STATE_CALIBRATION);
+    } else if (!post_passed()) {
+        game_transition_to(STATE_SELF_TEST);
+    }
+
+    // The record's ghost, if one is stored and undamaged. After every
+    // transition: each leaves ATTRACT through attract_exit(), which starts
+    // recording over it
+    ghost_load();
+}
+
+/**
+ * game_get_status - Copy the core game variables for observers
+ * @param status: Filled in with the current values
+ *
+ * See game.h. A copy (not pointers to the statics) keeps the "only
+ * game_transition_to() changes state" guarantee intact.
+ */
+void game_get_status(GameStatus *status) {
+    status->state = current_state;
+    status->position = current_position;
+    status->direction = chase_direction;
+    status->chase_speed = chase_speed;
+    status->score = current_score;
+    status->high_score = high_score;
+}
+
+/**
+ * game_ms_until_next_event - How long game_update() will change nothing
+ * @return: ms from now until the next thing can happen (0 = due now),
+ *          NO_PENDING_EVENT if nothing is scheduled
+ *
+ * See game.h. Mirrors each state's update() condition by condition:
+ * a chase step or new button level in ATTRACT/PLAYING (or the ghost's next
+ * step, press or pause), the pause and hold timers in RESULT/CELEBRATION,
+ * the end of the animation in GAME_OVER, and a press (a skip to the next
+ * game) in CELEBRATION/GAME_OVER.
+ * An asserted expander INTA is due in every state: until game_update()
+ * reads the expander it stays asserted and can't signal the next change.
+ * So is an LCD that is behind the frame: display_service() sends the rest.
+ */
+uint32_t game_ms_until_next_event(void) {
+    uint32_t wait = NO_PENDING_EVENT;
+
+    if (expander_input_pending() || display_pending()) {
+        return 0;
+    }
+
+    switch (current_state) {
+        case STATE_ATTRACT:
+        case STATE_PLAYING:
+            // The button is read here and (for a skip) in CELEBRATION/GAME_OVER
+            if (button_input_pending()) {
+                wait = 0;
+            } else if (ghost_playing()) {
+                wait = ghost_ms_until_next_event();  // The chase stops while it pauses
+            } else {
+                wait = millis_until_elapsed(last_chase_update, chase_speed);
+            }
+            if (current_state == STATE_ATTRACT && !ghost_playing() && !animation_is_playing()) {
+                uint32_t show = millis_until_elapsed(attract_show_from, ATTRACT_SHOW_PERIOD_MS);
+                wait = show < wait ? show : wait;
+            }
+            break;
+        case STATE_RESULT:
+            wait = millis_until_elapsed(state_entry_time, RESULT_PAUSE_MS);
+            break;
+        case STATE_CELEBRATION:
+            // A press skips (or, too early, is dropped) in the next loop()
+            wait = button_input_pending() ? 0 : millis_until_elapsed(state_entry_time, CELEBRATION_HOLD_MS);
+            break;
+        case STATE_GAME_OVER:
+            // Leaves in the same loop() that the animation finishes in
+            wait = button_input_pending() || !animation_is_playing() ? 0 : NO_PENDING_EVENT;
+            break;
+        case STATE_CALIBRATION:
+            if (calibration_done) {
+                wait = millis_until_elapsed(state_entry_time, CALIBRATION_RESULT_MS);
+            } else if (button_input_pending()) {
+                wait = 0;
+            } else {
+                // Next beat, or the flash of the current one going out
+                wait = millis_until_elapsed(calibration_beat_time,
+                                            calibration_lit ? CALIBRATION_FLASH_MS : CALIBRATION_BEAT_MS);
+            }
+            break;
+        case STATE_SELF_TEST:
+            wait = button_input_pending() ? 0 : millis_until_elapsed(state_entry_time, POST_FAULT_HOLD_MS);
+            break;
+    }
+
+    // Uncollected coin pulses, a ledger save waiting to settle, or a bounce
+    // profile save (due at once)
+    uint32_t credit = credit_ms_until_next_event(between_games());
+    if (credit < wait) {
+        wait = credit;
+    }
+    if (button_ms_until_next_event(between_games()) == 0) {
+        wait = 0;
+    }
+    if (ghost_save_ms_until_next_event(between_games()) == 0) {
+        wait = 0;
+    }
+#ifdef RULES_UPLOAD
+    // Serial bytes must be collected before the receive buffer overflows
+    uint32_t upload = rules_upload_ms_until_next_event(between_games());
+    if (upload < wait) {
+        wait = upload;
+    }
+#endif
+#ifdef SNAPSHOT_DUMP
+    // A snapshot request is answered within SNAPSHOT_POLL_MS, even asleep
+    uint32_t snapshot = snapshot_ms_until_next_event();
+    if (snapshot < wait) {
+        wait = snapshot;
+    }
+#endif
+
+    // game_update() runs animation_update() first, so its events count too
+    uint32_t animation = animation_ms_until_next_event();
+    return animation < wait ? animation : wait;
 }
 
 /******************************************************************************
  * game_update - Main Game Loop (Per-Frame Update)
  *
- * Called every iteration of main.cpp:loop(), typically 1000-20000 times/sec.
+ * Called every iteration of main.cpp:loop(): whenever the next event from
+ * game_ms_until_next_event() is due or the button changes (see timebase.h).
  *
  * RESPONSIBILITIES:
  * 1. Update all animations (non-blocking)
@@ -452,16 +714,60 @@ void game_init(void) {
  ******************************************************************************/
 
 void game_update(void) {
+#ifdef SNAPSHOT_DUMP
+    // The operator asked for a snapshot: the state between two loop()s
+    if (snapshot_requested()) {
+        game_snapshot_write(snapshot_serial_write, NULL);
+    }
+#endif
+
+    TRACE_BEGIN(TRACE_GAME_UPDATE, current_state);
+
+    // Collect expander input first, so presses are queued before the state
+    // update asks for them (no-op without an expander or with INTA idle)
+    expander_service();
+
+    // Coins counted by the ISR since the last loop(); the ledger is only
+    // saved between games (a save blocks loop() for ~35 ms). The end-of-game
+    // animation counts: saving there means a skip to the next game finds
+    // nothing left to write
+    credit_service(between_games());
+
+    // The button's learned bounce profile, saved between games when it drifts
+    button_service(between_games());
+
+    // A new record's ghost, GHOST_SAVE_BYTES per loop() between games
+    ghost_save_service(between_games());
+
+#ifdef RULES_UPLOAD
+    // A game mode sent over serial: checked on arrival, stored between games
+    if (rules_upload_service(between_games())) {
+        rules_load();
+    }
+#endif
+
+    // The rest of the last screen change, if one loop() wasn't enough
+    // (sent DISPLAY_FLUSH_BUDGET_US at a time, to every LCD in turn)
+    display_service();
+
     // Always update animations first (non-blocking)
     // See hardware.cpp:animation_update() for state machine implementation
+    TRACE_BEGIN(TRACE_ANIMATION_UPDATE, 0);
     animation_update();
+    TRACE_END(TRACE_ANIMATION_UPDATE, 0);
 
     // Call current state's update function
     // This dynamically dispatches to the correct function based on current_state
     // Example: if current_state == STATE_PLAYING → calls playing_update()
+    // (The update may change current_state, so the trace end uses a copy.)
+    GameState updating = current_state;
+    TRACE_BEGIN(TRACE_STATE_UPDATE, updating);
     if (state_handlers[current_state].update != NULL) {
         state_handlers[current_state].update();
     }
+    TRACE_END(TRACE_STATE_UPDATE, updating);
+
+    TRACE_END(TRACE_GAME_UPDATE, updating);
 }
 
 /******************************************************************************
@@ -476,8 +782,14 @@ void game_update(void) {
  *         "HiScore: 100"
  *   LEDs: Bouncing chase LED at initial speed (200ms between movements)
  *
+ * Every ATTRACT_SHOW_PERIOD_MS something plays: an LED showcase, or every
+ * other time the ghost, the game that set the record played again from
+ * its recording (ghost.h). It runs on the game's own chase, scoring and
+ * speed-up code, shows "Best run: 45" and ends on its miss.
+ *
  * TRANSITIONS:
- *   → STATE_PLAYING (button pressed)
+ *   → STATE_PLAYING (button pressed, and a credit paid on coin-op builds;
+ *     a ghost replay stops there)
  ******************************************************************************/
 
 /**
@@ -497,6 +809,8 @@ void game_update(void) {
  */
 static void attract_enter(void) {
     chase_speed = INITIAL_CHASE_SPEED;  // Reset to easy difficulty
+    attract_credits_shown = credit_count();
+    attract_show_from = millis();       // First LED showcase one period from now
     display_show_attract(high_score);   // Show "Press to Play!" screen
 }
 
@@ -508,6 +822,9 @@ static void attract_enter(void) {
  * RESPONSIBILITIES:
  * - Animate chase LED (bouncing back and forth)
  * - Wait for button press to start game
+ * - Every ATTRACT_SHOW_PERIOD_MS, play an LED effect (the chase LED keeps
+ *   moving, hidden, until it ends), or every other time the record's ghost
+ *   (which moves the chase LED itself, ghost_update())
  *
  * LEARNING: Minimal State
  * This is one of the simplest update functions. Just animation + input check.
@@ -515,14 +832,37 @@ static void attract_enter(void) {
  * need to be complex.
  */
 static void attract_update(void) {
-    // Update chase LED position (non-blocking)
+    // Update chase LED position (non-blocking), or let the ghost move it
     // See update_chase_position() below for timing implementation
-    update_chase_position();
+    if (ghost_playing()) {
+        ghost_update();
+    } else {
+        update_chase_position();
+    }
+
+    // A coin arrived: show the new credit count (coin-op builds only; on
+    // free play credit_count() stays 0)
+    if (credit_count() != attract_credits_shown) {
+        attract_credits_shown = credit_count();
+        if (ghost_playing()) {
+            display_show_ghost(current_score);
+        } else {
+            display_show_attract(high_score);
+        }
+    }
 
     // Check for button press (edge detection, not level)
     // See hardware.cpp:button_just_pressed() for debouncing implementation
-    if (button_just_pressed()) {
+    // The credit gate: on coin-op a press without a credit does nothing
+    if (button_just_pressed() && credit_take()) {
+        note_game_start();
         game_transition_to(STATE_PLAYING);  // Start game!
+    } else if (!ghost_playing() && !animation_is_playing() &&
+               millis() - attract_show_from >= ATTRACT_SHOW_PERIOD_MS) {
+        attract_show_from = millis();
+        if (!ghost_take_slot()) {
+            animation_start_showcase();     // Next effect of the attract playlist
+        }
     }
 }
 
@@ -532,9 +872,9 @@ static void attract_update(void) {
  * Called when leaving STATE_ATTRACT (always transitioning to STATE_PLAYING).
  *
  * RESPONSIBILITIES:
- * - Reset current_score to 0 (starting fresh game)
- * - Clear is_new_high_score flag
  * - Clear button state to prevent stale edge detections
+ * - new_game_setup(): reset current_score to 0, clear is_new_high_score,
+ *   stop a showcase or ghost replay, start recording
  *
  * WHY RESET SCORE HERE (not in playing_enter)?
  *
@@ -546,11 +886,11 @@ static void attract_update(void) {
  * Correct flow:
  *   ATTRACT → PLAYING (attract_exit resets score to 0)
  *   PLAYING → RESULT → PLAYING (score preserved, no reset)
+ *   GAME_OVER → PLAYING (a skip: restart_update() resets it)
  */
 static void attract_exit(void) {
-    current_score = 0;           // New game starts with score = 0
-    is_new_high_score = false;   // Haven't beaten high score yet
     button_clear_state();        // Forget the button press that started the game
+    new_game_setup();            // Score 0, no record yet, showcase cut short
 }
 
 /******************************************************************************
@@ -607,6 +947,15 @@ static void playing_enter(void) {
     // Without this, LED might update immediately after entering state
     // (if time since last_chase_update > chase_speed)
     last_chase_update = millis();
+
+    // The lit LED has not moved during the pause, so a latency-corrected
+    // press judged "before last_chase_update" still sees this position
+    previous_position = current_position;
+
+#ifdef GHOST_REPLAY
+    // Presses are recorded as steps from here (ghost.h)
+    rally_steps = 0;
+#endif
 }
 
 /**
@@ -638,9 +987,16 @@ static void playing_update(void) {
 
     // Check for button press (edge detection with debouncing)
     if (button_just_pressed()) {
-        // Calculate score based on LED position when button pressed
+        // Calculate score based on LED position when button pressed,
+        // corrected for this cabinet's calibrated latency (one subtraction;
+        // with no calibration the offset is 0 and this is current_position)
         // Returns: 10 (bullseye), or 0 (miss)
-        uint8_t points = calculate_score(current_position);
+        uint32_t now = millis();
+        uint32_t pressed_at = now - (uint32_t)(int32_t)latency_offset;
+        uint8_t points = calculate_score(chase_position_at(pressed_at));
+
+        // For the ghost: when it came, in chase steps (hits and the miss)
+        ghost_record_press(now);
 
         if (points > 0) {
             /******************************************************************
@@ -669,13 +1025,7 @@ static void playing_update(void) {
             }
 
             // Increase difficulty: speed up chase LED
-            // Game gets 5ms faster after each hit, bottoming out at 50ms
-            if (chase_speed > MIN_CHASE_SPEED) {
-                chase_speed -= SPEED_DECREASE;
-                if (chase_speed < MIN_CHASE_SPEED) {
-                    chase_speed = MIN_CHASE_SPEED;  // Clamp to minimum
-                }
-            }
+            speed_up(points);
 
             // Transition to result state (brief pause, then resume)
             game_transition_to(STATE_RESULT);
@@ -685,6 +1035,9 @@ static void playing_update(void) {
              * MISS - Game Over
              ******************************************************************/
 
+            // The recording becomes the new ghost, or the old one comes back
+            ghost_record_end(is_new_high_score);
+
             // Check if we achieved a new high score during this game
             if (is_new_high_score) {
                 // Celebrate new high score, then return to attract
@@ -807,7 +1160,7 @@ static void result_update(void) {
     uint32_t now = millis();
 
     // Check if 300ms has elapsed since entering this state
-    if (now - state_entry_time >= 300) {
+    if (now - state_entry_time >= RESULT_PAUSE_MS) {
         // Resume playing
         game_transition_to(STATE_PLAYING);
 
@@ -824,13 +1177,14 @@ static void result_update(void) {
  * Called when leaving STATE_RESULT (always transitioning to STATE_PLAYING).
  *
  * RESPONSIBILITIES:
- * - None! (currently empty)
+ * - Forget button presses made during the pause
  *
- * No cleanup needed. Button state is already cleared (from playing_update
- * consuming the button press), score is preserved, display is already correct.
+ * The button ISR counts presses in every state. One made while the result
+ * was showing must not be judged the instant PLAYING resumes. Score is
+ * preserved, display is already correct.
  */
 static void result_exit(void) {
-    // No cleanup needed
+    button_clear_state();
 }
 
 /******************************************************************************
@@ -848,6 +1202,7 @@ static void result_exit(void) {
  *
  * TRANSITIONS:
  *   → STATE_ATTRACT (after 2 seconds)
+ *   → STATE_PLAYING (button pressed after RESTART_MIN_SHOW_MS: next game)
  ******************************************************************************/
 
 /**
@@ -869,6 +1224,8 @@ static void celebration_enter(void) {
     display_show_celebration(high_score);  // "NEW HIGH SCORE! Score: 150"
     animation_start_celebration();  // Start parallel LED wave + melody
     state_entry_time = millis();  // Record entry time for 2s minimum display
+    game_ended_at = state_entry_time;  // Dead time starts (game_get_throughput())
+    game_ended = true;
 }
 
 /**
@@ -877,7 +1234,8 @@ static void celebration_enter(void) {
  * Called every loop iteration while in STATE_CELEBRATION.
  *
  * RESPONSIBILITIES:
- * - Wait for minimum 2 seconds to elapse
+ * - Start the next game at once if the player presses (restart_update())
+ * - Otherwise wait for 2 seconds to elapse
  * - Then return to attract mode
  *
  * WHY 2 SECONDS?
@@ -893,8 +1251,13 @@ static void celebration_enter(void) {
 static void celebration_update(void) {
     uint32_t now = millis();
 
+    // A press (after the minimum show time) skips straight to the next game
+    if (restart_update()) {
+        return;
+    }
+
     // After 2 seconds, return to attract mode
-    if (now - state_entry_time >= 2000) {
+    if (now - state_entry_time >= CELEBRATION_HOLD_MS) {
         game_transition_to(STATE_ATTRACT);
     }
 }
@@ -902,7 +1265,8 @@ static void celebration_update(void) {
 /**
  * celebration_exit - Clean up celebration
  *
- * Called when leaving STATE_CELEBRATION (always transitioning to STATE_ATTRACT).
+ * Called when leaving STATE_CELEBRATION (to STATE_ATTRACT, or to
+ * STATE_PLAYING on a skip).
  *
  * RESPONSIBILITIES:
  * - Clear button state to prevent stale edge detections
@@ -930,6 +1294,7 @@ static void celebration_exit(void) {
  *
  * TRANSITIONS:
  *   → STATE_ATTRACT (after animation completes)
+ *   → STATE_PLAYING (button pressed after RESTART_MIN_SHOW_MS: next game)
  ******************************************************************************/
 
 /**
@@ -948,6 +1313,9 @@ static void celebration_exit(void) {
 static void game_over_enter(void) {
     animation_start_game_over();  // Start parallel descending tones + LED flash
     led_clear_all();  // Turn off chase LED before flash animation starts
+    state_entry_time = millis();  // For the minimum show time before a skip
+    game_ended_at = state_entry_time;  // Dead time starts (game_get_throughput())
+    game_ended = true;
 }
 
 /**
@@ -956,6 +1324,7 @@ static void game_over_enter(void) {
  * Called every loop iteration while in STATE_GAME_OVER.
  *
  * RESPONSIBILITIES:
+ * - Start the next game at once if the player presses (restart_update())
  * - Check if animation finished
  * - If yes, return to attract mode
  *
@@ -971,6 +1340,11 @@ static void game_over_enter(void) {
  * - Total: 1500ms (whichever finishes last)
  */
 static void game_over_update(void) {
+    // A press (after the minimum show time) skips straight to the next game
+    if (restart_update()) {
+        return;
+    }
+
     // Wait for animation to complete
     if (!animation_is_playing()) {
         game_transition_to(STATE_ATTRACT);  // Return to attract mode
@@ -980,7 +1354,8 @@ static void game_over_update(void) {
 /**
  * game_over_exit - Clean up game over
  *
- * Called when leaving STATE_GAME_OVER (always transitioning to STATE_ATTRACT).
+ * Called when leaving STATE_GAME_OVER (to STATE_ATTRACT, or to
+ * STATE_PLAYING on a skip).
  *
  * RESPONSIBILITIES:
  * - Reset score to 0 (ready for next game)
@@ -996,6 +1371,243 @@ static void game_over_exit(void) {
     button_clear_state();   // Forget any button presses during game over
 }
 
+/******************************************************************************
+ * HELPER FUNCTIONS: Starting the Next Game
+ *
+ * A new game starts from ATTRACT (attract_exit()), or straight from the
+ * end-of-game animation when the player presses during it (a "skip"). In a
+ * busy arcade the skip matters: a miss used to cost 1.5-2 s of animation,
+ * then ATTRACT, then a second press. Both paths reset the game the same way
+ * in new_game_setup().
+ ******************************************************************************/
+
+/**
+ * between_games - Is now a good time for an EEPROM save (~35 ms)?
+ *
+ * ATTRACT and the end-of-game animation. Never mid-game.
+ */
+static bool between_games(void) {
+    return current_state == STATE_ATTRACT || current_state == STATE_GAME_OVER ||
+           current_state == STATE_CELEBRATION;
+}
+
+/**
+ * new_game_setup - Reset for a new game, from ATTRACT or a skip
+ *
+ * - Score 0, no new record yet, initial chase speed (ATTRACT already set
+ *   it; a skip never went through ATTRACT)
+ * - Cut short whatever animation is playing: the game starts now
+ * - Stop a ghost replay, and start recording this game (after the RULE_RND
+ *   seed: the recording starts with it)
+ *
+ * attract_exit() also runs once at boot (game_init()), so the counting is
+ * left to note_game_start().
+ */
+static void new_game_setup(void) {
+    current_score = 0;
+    is_new_high_score = false;
+    chase_speed = INITIAL_CHASE_SPEED;
+    rule_random = (uint16_t)timebase_micros() | 1;  // A game mode's RULE_RND
+    if (animation_is_playing()) {
+        animation_stop();
+        led_clear_all();
+    }
+    ghost_record_start();
+}
+
+/**
+ * note_game_start - Count a game, and close the dead time the last miss started
+ */
+static void note_game_start(void) {
+    throughput.games++;
+    if (game_ended) {
+        uint32_t dead_ms = millis() - game_ended_at;
+        throughput.dead_ms_last = dead_ms > 0xFFFF ? 0xFFFF : (uint16_t)dead_ms;
+        throughput.dead_ms_total += dead_ms;
+        game_ended = false;
+    }
+}
+
+/**
+ * restart_update - Skip the end-of-game animation on a press
+ * @return: true if the next game has started (the caller must not go on)
+ *
+ * Called first thing by celebration_update() and game_over_update().
+ *
+ * For RESTART_MIN_SHOW_MS after the miss, presses are dropped: the player
+ * is still reacting to the miss, and the final score needs a moment on
+ * screen. After that, a press pays for the game (credit_take(), as in
+ * ATTRACT) and starts it in the same loop(). The EEPROM has been written
+ * by then: the high score before the celebration started, the ledger and
+ * bounce profile during the animation (game_update() lets them save in
+ * these states).
+ */
+static bool restart_update(void) {
+    if (millis() - state_entry_time < RESTART_MIN_SHOW_MS) {
+        button_clear_state();
+        return false;
+    }
+    if (!button_just_pressed() || !credit_take()) {
+        return false;
+    }
+
+    uint32_t pressed_us = timebase_pin_change_us();
+    note_game_start();
+    new_game_setup();
+    game_transition_to(STATE_PLAYING);  // *_exit() clears the button; the game screen is drawn
+    uint32_t latency_us = timebase_micros() - pressed_us;
+
+    throughput.restarts++;
+    if (latency_us > throughput.restart_latency_max_us) {
+        throughput.restart_latency_max_us = latency_us;
+    }
+    return true;
+}
+
+void game_get_throughput(GameThroughput *t) {
+    *t = throughput;
+}
+
+/******************************************************************************
+ * SNAPSHOTS (include/snapshot.h)
+ *
+ * game_snapshot_write() sends the header, this file's GameSnapshot and then
+ * hardware.cpp's HalSnapshot, each as soon as it is filled in, so the board
+ * never holds more than one part. game_snapshot_load() checks a whole
+ * snapshot, then puts both parts back.
+ *
+ * Loading doesn't go through game_transition_to(): the state's enter()
+ * would redraw the screen, restart its animation and reset its timers,
+ * and the snapshot has all three as they were.
+ ******************************************************************************/
+
+void game_snapshot_write(SnapshotWriter out, void *context) {
+    uint32_t now = millis();
+
+    SnapshotHeader header;
+    header.magic[0] = SNAPSHOT_MAGIC_0;
+    header.magic[1] = SNAPSHOT_MAGIC_1;
+    header.version = SNAPSHOT_VERSION;
+    header.size = SNAPSHOT_SIZE;
+    header.layout = SNAPSHOT_LAYOUT_HASH;
+    header.taken_ms = now;
+    out(&header, sizeof(header), context);
+
+    GameSnapshot game;
+    memset(&game, 0, sizeof(game));     // A board without the ghost sends zeros
+    game.state = (uint8_t)current_state;
+    game.position = current_position;
+    game.previous_position = previous_position;
+    game.direction = chase_direction;
+    game.chase_speed = chase_speed;
+    game.chase_age_ms = now - last_chase_update;
+    game.latency_offset = latency_offset;
+    game.calibration_beat_age_ms = now - calibration_beat_time;
+    game.calibration_beats = calibration_beats;
+    game.calibration_count = calibration_count;
+    game.calibration_lit = calibration_lit;
+    game.calibration_done = calibration_done;
+    for (uint8_t i = 0; i < CALIBRATION_TAPS; i++) {
+        game.calibration_taps[i] = calibration_taps[i];
+    }
+    game.score = current_score;
+    game.high_score = high_score;
+    game.new_high_score = is_new_high_score;
+    game.attract_credits_shown = attract_credits_shown;
+    game.attract_show_age_ms = now - attract_show_from;
+    game.state_entry_age_ms = now - state_entry_time;
+    game.game_ended_age_ms = now - game_ended_at;
+    game.game_ended = game_ended;
+    game.rule_random = rule_random;
+#ifdef GHOST_REPLAY
+    game.rally_steps = rally_steps;
+    game.ghost_phase = ghost_phase;
+    game.attract_ghost_next = attract_ghost_next;
+    game.ghost_read = ghost_read;
+    game.ghost_press_steps = ghost_press_steps;
+    game.ghost_press_ms = ghost_press_ms;
+    game.ghost_paused_age_ms = now - ghost_paused_at;
+    game.ghost_size = ghost_size;
+    game.ghost_unsaved = ghost_unsaved;
+    game.ghost_record_at = ghost_record_at;
+    memcpy(game.ghost_image, ghost_image, GHOST_IMAGE_MAX);
+#endif
+    out(&game, sizeof(game), context);
+
+    HalSnapshot hal;
+    hal_snapshot_save(&hal);
+    out(&hal, sizeof(hal), context);
+}
+
+uint8_t game_snapshot_load(const uint8_t *data, uint16_t size) {
+    SnapshotHeader header;
+    GameSnapshot game;
+    HalSnapshot hal;
+    if (size < sizeof(header)) {
+        return SNAPSHOT_BAD_SIZE;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (header.magic[0] != SNAPSHOT_MAGIC_0 || header.magic[1] != SNAPSHOT_MAGIC_1) {
+        return SNAPSHOT_BAD_MAGIC;
+    }
+    if (header.version != SNAPSHOT_VERSION) {
+        return SNAPSHOT_BAD_VERSION;
+    }
+    if (header.layout != SNAPSHOT_LAYOUT_HASH) {
+        return SNAPSHOT_BAD_LAYOUT;
+    }
+    if (header.size != SNAPSHOT_SIZE || size < SNAPSHOT_SIZE) {
+        return SNAPSHOT_BAD_SIZE;
+    }
+    memcpy(&game, data + sizeof(header), sizeof(game));
+    memcpy(&hal, data + sizeof(header) + sizeof(game), sizeof(hal));
+    if (game.state > STATE_SELF_TEST) {
+        return SNAPSHOT_BAD_STATE;
+    }
+
+    uint32_t now = millis();
+    current_state = (GameState)game.state;
+    current_position = game.position;
+    previous_position = game.previous_position;
+    chase_direction = game.direction;
+    chase_speed = game.chase_speed;
+    last_chase_update = now - game.chase_age_ms;
+    latency_offset = game.latency_offset;
+    calibration_beat_time = now - game.calibration_beat_age_ms;
+    calibration_beats = game.calibration_beats;
+    calibration_count = game.calibration_count;
+    calibration_lit = game.calibration_lit != 0;
+    calibration_done = game.calibration_done != 0;
+    for (uint8_t i = 0; i < CALIBRATION_TAPS; i++) {
+        calibration_taps[i] = game.calibration_taps[i];
+    }
+    current_score = game.score;
+    high_score = game.high_score;
+    is_new_high_score = game.new_high_score != 0;
+    attract_credits_shown = game.attract_credits_shown;
+    attract_show_from = now - game.attract_show_age_ms;
+    state_entry_time = now - game.state_entry_age_ms;
+    game_ended_at = now - game.game_ended_age_ms;
+    game_ended = game.game_ended != 0;
+    rule_random = game.rule_random != 0 ? game.rule_random : 1;
+#ifdef GHOST_REPLAY
+    rally_steps = game.rally_steps;
+    ghost_phase = game.ghost_phase <= GHOST_OVER ? game.ghost_phase : (uint8_t)GHOST_IDLE;
+    attract_ghost_next = game.attract_ghost_next != 0;
+    ghost_read = game.ghost_read;
+    ghost_press_steps = game.ghost_press_steps;
+    ghost_press_ms = game.ghost_press_ms;
+    ghost_paused_at = now - game.ghost_paused_age_ms;
+    memcpy(ghost_image, game.ghost_image, GHOST_IMAGE_MAX);
+    ghost_size = game.ghost_size <= GHOST_IMAGE_MAX ? game.ghost_size : 0;
+    ghost_unsaved = game.ghost_unsaved <= ghost_size + 1 ? game.ghost_unsaved : 0;
+    ghost_record_at = game.ghost_record_at <= GHOST_IMAGE_MAX ? game.ghost_record_at : 0;
+#endif
+
+    hal_snapshot_load(&hal);
+    return SNAPSHOT_OK;
+}
+
 /******************************************************************************
  * HELPER FUNCTION: update_chase_position
  *
@@ -1111,23 +1723,31 @@ static void update_chase_position(void) {
         // even if this code takes time to execute
         last_chase_update = now;
 
+        // An attract showcase owns the LEDs while it plays: keep moving,
+        // but don't draw (a ghost's bullseye melody leaves them alone)
+        bool hidden = current_state == STATE_ATTRACT && animation_is_playing() && !ghost_playing();
+
         // Turn off current LED
-        led_clear_all();
+        if (!hidden) {
+            led_clear_all();
+        }
 
-        // Update position (move in current direction)
-        current_position += chase_direction;
+        // Update position (move in current direction, bounce at the edges)
+        previous_position = current_position;
+        chase_next(&current_position, &chase_direction);
 
-        // Check boundaries and reverse direction if needed
-        if (current_position == 0) {
-            // Hit left edge, start moving right
-            chase_direction = 1;
-        } else if (current_position == NUM_LEDS - 1) {
-            // Hit right edge, start moving left
-            chase_direction = -1;
+        // Turn on LED at new position
+        if (!hidden) {
+            led_set(current_position, true);
         }
+        TRACE_INSTANT(TRACE_CHASE_STEP, current_position);
 
-        // Turn on LED at new position
-        led_set(current_position, true);
+#ifdef GHOST_REPLAY
+        // What the ghost counts its presses in (stops short of GHOST_NO_PRESS)
+        if (rally_steps < GHOST_NO_PRESS - 1) {
+            rally_steps++;
+        }
+#endif
 
         // Play tick sound (audio feedback for movement)
         buzzer_tick();
@@ -1135,6 +1755,66 @@ static void update_chase_position(void) {
     // If not enough time elapsed, return immediately (non-blocking!)
 }
 
+/**
+ * chase_position_at - Which LED was (or will be) lit at @time
+ * @param time: A millis() value within LATENCY_OFFSET_MAX_MS of now
+ * @return: LED position
+ *
+ * Latency correction moves the judged moment slightly into the past (late
+ * presses) or future (early presses). Because LATENCY_OFFSET_MAX_MS is less
+ * than MIN_CHASE_SPEED, that moment is at most one step away:
+ *
+ *   previous_position │ current_position │ next position
+ *   ──────────────────┼──────────────────┼──────────────────► time
+ *              last_chase_update   last_chase_update + chase_speed
+ *
+ * The next position is the step update_chase_position() is about to take,
+ * worked out on copies by the same chase_next(). (That is why a game mode's
+ * RULE_MOVE may not use RULE_RND: it has to give the same answer twice.)
+ */
+static uint8_t chase_position_at(uint32_t time) {
+    int32_t since_step = (int32_t)(time - last_chase_update);  // Signed: may be before it
+
+    if (since_step < 0) {
+        return previous_position;
+    }
+    if ((uint32_t)since_step >= chase_speed) {
+        uint8_t position = current_position;
+        int8_t direction = chase_direction;
+        chase_next(&position, &direction);
+        return position;
+    }
+    return current_position;
+}
+
+/**
+ * chase_next - One chase step from @position, moving @direction
+ *
+ * The built-in rule bounces: move one LED, and turn round on reaching
+ * either end, so the step after is always on the strip. A game mode's
+ * RULE_MOVE replaces it; its answer is clamped onto the strip.
+ */
+static void chase_next(uint8_t *position, int8_t *direction) {
+    if (rules_has(RULE_MOVE)) {
+        int16_t reg[RULE_REGS];
+        rules_call(RULE_MOVE, *position, *direction, 0, reg);
+        *position = reg[0] < 0 ? 0 : reg[0] > NUM_LEDS - 1 ? NUM_LEDS - 1 : (uint8_t)reg[0];
+        *direction = reg[1] < 0 ? -1 : reg[1] > 0 ? 1 : 0;
+        return;
+    }
+
+    *position += *direction;
+
+    // Check boundaries and reverse direction if needed
+    if (*position == 0) {
+        // Hit left edge, start moving right
+        *direction = 1;
+    } else if (*position == NUM_LEDS - 1) {
+        // Hit right edge, start moving left
+        *direction = -1;
+    }
+}
+
 /******************************************************************************
  * HELPER FUNCTION: calculate_score
  *
@@ -1170,6 +1850,13 @@ static void update_chase_position(void) {
  * Drawback: Uses 8 bytes of Flash (negligible on our system)
  */
 static uint8_t calculate_score(uint8_t position) {
+    // A game mode's RULE_SCORE, if it has one (rules.h)
+    if (rules_has(RULE_SCORE)) {
+        int16_t reg[RULE_REGS];
+        rules_call(RULE_SCORE, position, chase_direction, 0, reg);
+        return reg[4] < 0 ? 0 : reg[4] > 255 ? 255 : (uint8_t)reg[4];
+    }
+
     // Check if position is in bullseye zone (green LEDs)
     if (position >= TARGET_ZONE_START && position <= TARGET_ZONE_END) {
         return BULLSEYE_SCORE;  // 10 points
@@ -1178,3 +1865,589 @@ static uint8_t calculate_score(uint8_t position) {
     // All other positions are misses
     return 0;  // Game over
 }
+
+/**
+ * speed_up - Make the chase faster after a hit worth @points
+ *
+ * Game gets 5ms faster after each hit, bottoming out at 50ms (unless the
+ * game mode has its own RULE_SPEED, see rules.h). Shared by playing_update()
+ * and the ghost's replay of it.
+ */
+static void speed_up(uint8_t points) {
+    if (rules_has(RULE_SPEED)) {
+        int16_t reg[RULE_REGS];
+        rules_call(RULE_SPEED, current_position, chase_direction, points, reg);
+        chase_speed = reg[3] < (int16_t)MIN_CHASE_SPEED ? MIN_CHASE_SPEED
+                    : reg[3] > (int16_t)RULES_SPEED_MAX_MS ? RULES_SPEED_MAX_MS
+                    : (uint16_t)reg[3];
+    } else if (chase_speed > MIN_CHASE_SPEED) {
+        chase_speed -= SPEED_DECREASE;
+        if (chase_speed < MIN_CHASE_SPEED) {
+            chase_speed = MIN_CHASE_SPEED;  // Clamp to minimum
+        }
+    }
+}
+
+/******************************************************************************
+ * HELPER FUNCTIONS: Game Modes (rules.h)
+ *
+ * The three rules above (chase_next(), calculate_score() and speed_up())
+ * each check for a part of the loaded game mode first. Without one the
+ * built-in code runs, unchanged: a part costs one compare when it isn't
+ * there, and at most RULES_HOOK_BUDGET_CYCLES when it is (checked when the
+ * image was loaded, not here).
+ ******************************************************************************/
+
+/**
+ * rules_has - Does the loaded game mode replace @hook's built-in rule?
+ *
+ * Always false on a RULES_BUILTIN_ONLY board, which the compiler can see:
+ * the rules_call() branches and rules.h's interpreter compile out.
+ */
+static bool rules_has(uint8_t hook) {
+#ifdef RULES_BUILTIN_ONLY
+    (void)hook;
+    return false;
+#else
+    return rules.length[hook] != 0;
+#endif
+}
+
+/**
+ * rules_load - Use the game mode stored in EEPROM, if it passes rules_check()
+ *
+ * Nothing stored, a bad checksum or a program that fails the check all
+ * leave every part empty: the built-in rules.
+ */
+static void rules_load(void) {
+#ifndef RULES_BUILTIN_ONLY
+    RulesReport report;
+    uint8_t size = eeprom_read_rules(rule_image);
+    rules_image_load(rule_image, size, &rules, &report);
+#endif
+}
+
+/**
+ * rules_call - Run @hook of the game mode on the game's variables
+ * @param reg: Left holding the hook's results (rules.h, REGISTERS)
+ */
+static void rules_call(uint8_t hook, uint8_t position, int8_t direction, uint8_t points,
+                       int16_t reg[RULE_REGS]) {
+    reg[0] = position;
+    reg[1] = direction;
+    reg[2] = current_score > 32767 ? 32767 : (int16_t)current_score;
+    reg[3] = (int16_t)chase_speed;
+    reg[4] = points;
+    reg[5] = 0;
+    reg[6] = 0;
+    reg[7] = 0;
+    rules_run(&rules, hook, reg, &rule_random);
+}
+
+/******************************************************************************
+ * HELPER FUNCTIONS: The Attract Ghost (ghost.h)
+ *
+ * RECORDING:
+ * Every game is recorded into ghost_image as it is played. Per chase step
+ * that is one increment (rally_steps); per press, two varints appended
+ * (ghost_record_press(): a few compares and stores). The header is filled
+ * in when the game starts, the length and CRC at its miss, and only a
+ * record's miss keeps it. Any other miss reads the stored ghost back
+ * (~1 ms: 212 EEPROM reads and the CRC, next to the miss's own work).
+ *
+ * PLAYBACK:
+ * Runs inside STATE_ATTRACT rather than through PLAYING and RESULT: those
+ * would count a game, take a credit, save a high score and draw the game
+ * screen. ghost_update() does what playing_update() and result_update()
+ * do, with the same update_chase_position(), chase_position_at(),
+ * calculate_score() and speed_up(), and the recorded press in place of
+ * button_just_pressed(). Per press: two varints read. Per loop(): one
+ * compare, and one subtraction once the press's step has come.
+ *
+ * SAVING:
+ * A record's ghost is written GHOST_SAVE_BYTES per loop() while
+ * between_games() (its CELEBRATION, then ATTRACT): ~0.2 s for a typical
+ * 60-byte run. A game started before it is all written goes unrecorded,
+ * so the buffer stays as it is until the save has finished. The stored
+ * ghost is gone from the first write to the last (its magic byte), so a
+ * reset in between loads none, as if the record had no ghost.
+ ******************************************************************************/
+
+#ifdef GHOST_REPLAY
+
+/**
+ * ghost_playing - Is the ghost replaying the record (STATE_ATTRACT only)?
+ */
+static bool ghost_playing(void) {
+    return ghost_phase != GHOST_IDLE;
+}
+
+/**
+ * ghost_rules_tag - GHOST_RULES for the loaded game mode
+ *
+ * A ghost recorded under another game mode wouldn't replay the same game.
+ */
+static uint8_t ghost_rules_tag(void) {
+    uint8_t steps = (uint8_t)(rules.length[RULE_MOVE] + rules.length[RULE_SCORE] +
+                              rules.length[RULE_SPEED]);
+    uint8_t crc = ghost_crc8(0, rules.length, RULE_HOOK_COUNT);
+    return ghost_crc8(crc, rules.code, (uint8_t)(2 * steps));
+}
+
+/**
+ * ghost_next_press - Read the next press (GHOST_NO_PRESS after the last)
+ */
+static void ghost_next_press(void) {
+    ghost_press_steps = ghost_get(ghost_image, &ghost_read, ghost_size);
+    ghost_press_ms = ghost_get(ghost_image, &ghost_read, ghost_size);
+    if (ghost_press_ms == GHOST_NO_PRESS) {
+        ghost_press_steps = GHOST_NO_PRESS;
+    }
+}
+
+/**
+ * ghost_press_due - Has the chase reached the moment of the next press?
+ */
+static bool ghost_press_due(void) {
+    return rally_steps == ghost_press_steps && millis() - last_chase_update >= ghost_press_ms;
+}
+
+/**
+ * ghost_take_slot - A showcase slot has come round: the ghost's turn?
+ * @return: true if the replay has started
+ *
+ * Every other slot, if there is a ghost and it still describes the record
+ * (its score is the high score, its tag the loaded game mode). It starts
+ * as the recorded game did, from new_game_setup() and playing_enter().
+ */
+static bool ghost_take_slot(void) {
+    bool turn = attract_ghost_next;
+    attract_ghost_next = !turn;
+
+    uint16_t score = (uint16_t)(ghost_image[GHOST_SCORE] | ghost_image[GHOST_SCORE + 1] << 8);
+    if (!turn || ghost_size == 0 || score != high_score ||
+        ghost_image[GHOST_RULES] != ghost_rules_tag()) {
+        return false;
+    }
+
+    current_position = ghost_image[GHOST_POSITION];
+    chase_direction = (int8_t)ghost_image[GHOST_DIRECTION];
+    rule_random = (uint16_t)(ghost_image[GHOST_SEED] | ghost_image[GHOST_SEED + 1] << 8);
+    chase_speed = INITIAL_CHASE_SPEED;
+    current_score = 0;
+    ghost_read = GHOST_HEADER_SIZE;
+    ghost_next_press();
+
+    ghost_phase = GHOST_CHASE;
+    last_chase_update = millis();
+    previous_position = current_position;
+    rally_steps = 0;
+    led_clear_all();
+    led_set(current_position, true);
+    display_show_ghost(0);
+    return true;
+}
+
+/**
+ * ghost_update - One loop() of the replay (from attract_update())
+ *
+ * playing_update() and result_update() in one: the chase runs until the
+ * recorded press is due, the press is judged at the recorded moment, and
+ * a hit pauses RESULT_PAUSE_MS before the next rally. The miss is held
+ * GHOST_END_HOLD_MS, then attract mode carries on from the missed LED.
+ */
+static void ghost_update(void) {
+    uint32_t now = millis();
+
+    if (ghost_phase == GHOST_PAUSE && now - ghost_paused_at >= RESULT_PAUSE_MS) {
+        // The next rally, started as result_update() and playing_enter() do
+        ghost_phase = ghost_press_steps == GHOST_NO_PRESS ? GHOST_OVER : GHOST_CHASE;
+        last_chase_update = now;
+        previous_position = current_position;
+        rally_steps = 0;
+    }
+    if (ghost_phase == GHOST_OVER && now - ghost_paused_at >= GHOST_END_HOLD_MS) {
+        ghost_phase = GHOST_IDLE;
+        chase_speed = INITIAL_CHASE_SPEED;
+        last_chase_update = now;
+        attract_show_from = now;
+        display_show_attract(high_score);
+        return;
+    }
+    if (ghost_phase != GHOST_CHASE) {
+        return;
+    }
+
+    // Step the chase unless the press is already due (a late loop() must
+    // not take the step after it first), then look again: the game may
+    // have judged the press in the loop() that took its step
+    if (!ghost_press_due()) {
+        update_chase_position();
+        if (!ghost_press_due()) {
+            return;
+        }
+    }
+
+    // The press, judged at the moment the game judged it
+    uint32_t pressed_at = last_chase_update + ghost_press_ms -
+                          (uint32_t)(int32_t)(int8_t)ghost_image[GHOST_LATENCY];
+    uint8_t points = calculate_score(chase_position_at(pressed_at));
+    ghost_paused_at = millis();
+
+    if (points > 0) {
+        current_score += points;
+        display_show_ghost(current_score);
+        if (points == BULLSEYE_SCORE) {
+            animation_start_bullseye();
+        } else {
+            buzzer_hit();
+        }
+        speed_up(points);
+        ghost_next_press();
+        ghost_phase = GHOST_PAUSE;
+    } else {
+        ghost_phase = GHOST_OVER;
+    }
+}
+
+/**
+ * ghost_ms_until_next_event - ms until ghost_update() next changes something
+ *
+ * The pause or the final hold ending, else the next chase step or the
+ * press, whichever comes first.
+ */
+static uint32_t ghost_ms_until_next_event(void) {
+    if (ghost_phase == GHOST_PAUSE) {
+        return millis_until_elapsed(ghost_paused_at, RESULT_PAUSE_MS);
+    }
+    if (ghost_phase == GHOST_OVER) {
+        return millis_until_elapsed(ghost_paused_at, GHOST_END_HOLD_MS);
+    }
+    uint32_t step = millis_until_elapsed(last_chase_update, chase_speed);
+    if (rally_steps == ghost_press_steps) {
+        uint32_t press = millis_until_elapsed(last_chase_update, ghost_press_ms);
+        return press < step ? press : step;
+    }
+    return step;
+}
+
+/**
+ * ghost_record_start - A game starts: stop a replay, record over the buffer
+ *
+ * Not while a record's ghost is still being written from the buffer: that
+ * game goes unrecorded (ghost_record_at stays 0).
+ */
+static void ghost_record_start(void) {
+    ghost_phase = GHOST_IDLE;
+    ghost_record_at = 0;
+    if (ghost_unsaved != 0) {
+        return;
+    }
+
+    ghost_size = 0;
+    ghost_image[GHOST_POSITION] = current_position;
+    ghost_image[GHOST_DIRECTION] = (uint8_t)chase_direction;
+    ghost_image[GHOST_LATENCY] = (uint8_t)latency_offset;
+    ghost_image[GHOST_SEED] = (uint8_t)rule_random;
+    ghost_image[GHOST_SEED + 1] = (uint8_t)(rule_random >> 8);
+    ghost_image[GHOST_RULES] = ghost_rules_tag();
+    ghost_record_at = GHOST_HEADER_SIZE;
+}
+
+/**
+ * ghost_record_press - Append a press at @now: steps this rally, ms since the last
+ *
+ * A game longer than GHOST_DATA_MAX bytes stops recording (and, if it
+ * sets the record, has no ghost).
+ */
+static void ghost_record_press(uint32_t now) {
+    if (ghost_record_at != 0) {
+        uint8_t at = ghost_put(ghost_image, ghost_record_at, rally_steps);
+        ghost_record_at = at == 0 ? 0 : ghost_put(ghost_image, at, (uint16_t)(now - last_chase_update));
+    }
+}
+
+/**
+ * ghost_record_end - The game's miss: keep the recording if @record
+ */
+static void ghost_record_end(bool record) {
+    if (record && ghost_record_at != 0) {
+        ghost_image[GHOST_SCORE] = (uint8_t)current_score;
+        ghost_image[GHOST_SCORE + 1] = (uint8_t)(current_score >> 8);
+        ghost_image_seal(ghost_image, ghost_record_at);
+        ghost_size = ghost_record_at;
+        ghost_unsaved = (uint8_t)(ghost_size + 1);  // ghost_save_service() writes it
+    } else if (ghost_size == 0) {
+        ghost_load();                   // Recorded over it: read it back
+    }
+    ghost_record_at = 0;
+}
+
+/**
+ * ghost_load - Read the stored ghost, if it is whole and undamaged
+ */
+static void ghost_load(void) {
+    ghost_size = ghost_image_check(ghost_image, eeprom_read_ghost(ghost_image));
+    ghost_unsaved = 0;
+    ghost_record_at = 0;
+}
+
+/**
+ * ghost_save_service - Do the next GHOST_SAVE_BYTES writes of a new ghost
+ * @param save_ok: false while an EEPROM write would be noticed (during a game)
+ *
+ * ghost_size + 1 writes: the stored magic byte is cleared first, then
+ * bytes 1 onwards are written, and the magic byte last. Until that last
+ * write EEPROM holds no ghost at all, so a reset part-way through leaves
+ * none to load, never a mix of the old run and the new one for the CRC
+ * to catch (it would miss one in 256).
+ */
+static void ghost_save_service(bool save_ok) {
+    for (uint8_t i = 0; save_ok && ghost_unsaved != 0 && i < GHOST_SAVE_BYTES; i++) {
+        uint8_t at = (uint8_t)(ghost_size + 1 - ghost_unsaved);
+        if (at == 0) {
+            eeprom_write_ghost(GHOST_MAGIC, (uint8_t)~EEPROM_MAGIC_BYTE);
+        } else if (at == ghost_size) {
+            eeprom_write_ghost(GHOST_MAGIC, ghost_image[GHOST_MAGIC]);
+        } else {
+            eeprom_write_ghost(at, ghost_image[at]);
+        }
+        ghost_unsaved--;
+    }
+}
+
+/**
+ * ghost_save_ms_until_next_event - 0 while ghost_save_service() has bytes to write
+ */
+static uint32_t ghost_save_ms_until_next_event(bool save_ok) {
+    return save_ok && ghost_unsaved != 0 ? 0 : NO_PENDING_EVENT;
+}
+
+#else // No ghost (ATtiny85, GHOST_OFF): nothing recorded, showcases only
+
+static bool ghost_playing(void) {
+    return false;
+}
+
+static bool ghost_take_slot(void) {
+    return false;
+}
+
+static void ghost_update(void) {
+}
+
+static uint32_t ghost_ms_until_next_event(void) {
+    return NO_PENDING_EVENT;
+}
+
+static void ghost_record_start(void) {
+}
+
+static void ghost_record_press(uint32_t now) {
+    (void)now;
+}
+
+static void ghost_record_end(bool record) {
+    (void)record;
+}
+
+static void ghost_load(void) {
+}
+
+static void ghost_save_service(bool save_ok) {
+    (void)save_ok;
+}
+
+static uint32_t ghost_save_ms_until_next_event(bool save_ok) {
+    (void)save_ok;
+    return NO_PENDING_EVENT;
+}
+
+#endif // GHOST_REPLAY
+
+/******************************************************************************
+ * STATE_CALIBRATION - Button Latency Calibration
+ *
+ * PURPOSE:
+ * Measure how late (or early) presses arrive on this cabinet. The player taps
+ * along to a steady beat; the average distance between tap and beat is the
+ * latency offset used to judge every press afterwards (see config.h).
+ *
+ * VISUAL:
+ *   LCD:  "Tap to the beat" / "Taps: 3/12", then the result
+ *   LEDs: Green LEDs flash on each beat
+ *   Audio: Short click on each beat
+ *
+ * ENTRY:
+ *   Hold the button while powering on (checked once in game_init()).
+ *
+ * TRANSITIONS:
+ *   → STATE_ATTRACT (CALIBRATION_RESULT_MS after the last tap)
+ *
+ * TAP MEASUREMENT:
+ * Each tap is compared with the NEAREST beat, so early taps count too:
+ *
+ *   beat               beat               beat
+ *    │                  │                  │
+ *    ├──── +35 ms ─┐    │                  │
+ *    │         tap ┘    │          ┌ -20 ms┤
+ *    │                  │          └ tap   │
+ *
+ * The first CALIBRATION_LEAD_IN_BEATS beats only set the tempo; taps during
+ * them are ignored.
+ ******************************************************************************/
+
+/**
+ * calibration_enter - Start a calibration run
+ *
+ * Beats start one full period after entry, giving the player time to
+ * release the button that was held at power-on.
+ */
+static void calibration_enter(void) {
+    calibration_beat_time = millis();
+    calibration_beats = 0;
+    calibration_count = 0;
+    calibration_lit = false;
+    calibration_done = false;
+    animation_stop();
+    led_clear_all();
+    display_show_calibration(0);
+}
+
+/**
+ * calibration_update - Play the beat, measure taps, then show the result
+ */
+static void calibration_update(void) {
+    uint32_t now = millis();
+
+    if (calibration_done) {
+        if (now - state_entry_time >= CALIBRATION_RESULT_MS) {
+            game_transition_to(STATE_ATTRACT);
+        }
+        return;
+    }
+
+    // Beat: flash the green LEDs and click
+    if (now - calibration_beat_time >= CALIBRATION_BEAT_MS) {
+        calibration_beat_time = now;
+        if (calibration_beats < 255) {
+            calibration_beats++;
+        }
+        for (uint8_t i = TARGET_ZONE_START; i <= TARGET_ZONE_END; i++) {
+            led_set(i, true);
+        }
+        buzzer_beat();
+        calibration_lit = true;
+    } else if (calibration_lit && now - calibration_beat_time >= CALIBRATION_FLASH_MS) {
+        led_clear_all();
+        calibration_lit = false;
+    }
+
+    if (button_just_pressed() && calibration_beats >= CALIBRATION_LEAD_IN_BEATS) {
+        // Distance to the nearest beat: the last one, or the one coming up
+        int16_t offset = (int16_t)(now - calibration_beat_time);
+        if (offset > (int16_t)(CALIBRATION_BEAT_MS / 2)) {
+            offset -= CALIBRATION_BEAT_MS;
+        }
+        calibration_taps[calibration_count++] = offset;
+        display_show_calibration(calibration_count);
+
+        if (calibration_count == CALIBRATION_TAPS) {
+            calibration_finish();
+        }
+    }
+}
+
+/**
+ * calibration_finish - Turn the taps into an offset (median + outlier cut)
+ *
+ * 1. Insertion-sort the taps (12 values: simpler and smaller than anything
+ *    cleverer) and take the median (the upper one of the middle pair)
+ * 2. Average only the taps within CALIBRATION_OUTLIER_MS of the median
+ * 3. Save if at least half the taps were kept, otherwise keep the old offset
+ */
+static void calibration_finish(void) {
+    for (uint8_t i = 1; i < CALIBRATION_TAPS; i++) {
+        int16_t tap = calibration_taps[i];
+        uint8_t j = i;
+        while (j > 0 && calibration_taps[j - 1] > tap) {
+            calibration_taps[j] = calibration_taps[j - 1];
+            j--;
+        }
+        calibration_taps[j] = tap;
+    }
+    int16_t median = calibration_taps[CALIBRATION_TAPS / 2];
+
+    int16_t sum = 0;
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < CALIBRATION_TAPS; i++) {
+        int16_t distance = calibration_taps[i] - median;
+        if (distance >= -CALIBRATION_OUTLIER_MS && distance <= CALIBRATION_OUTLIER_MS) {
+            sum += calibration_taps[i];
+            kept++;
+        }
+    }
+
+    bool saved = kept * 2 >= CALIBRATION_TAPS;
+    if (saved) {
+        // Round to nearest (sum may be negative), then clamp
+        int16_t half = sum < 0 ? -(int16_t)(kept / 2) : (int16_t)(kept / 2);
+        int16_t mean = (sum + half) / kept;
+        if (mean > LATENCY_OFFSET_MAX_MS) {
+            mean = LATENCY_OFFSET_MAX_MS;
+        } else if (mean < -LATENCY_OFFSET_MAX_MS) {
+            mean = -LATENCY_OFFSET_MAX_MS;
+        }
+        latency_offset = (int8_t)mean;
+        eeprom_write_latency_offset(latency_offset);
+    }
+
+    led_clear_all();
+    display_show_latency(latency_offset, saved);
+    calibration_done = true;
+    state_entry_time = millis();  // Start the result screen timer
+}
+
+/**
+ * calibration_exit - Clean up calibration
+ *
+ * Same as the other states that return to attract: forget button presses
+ * made on the result screen.
+ */
+static void calibration_exit(void) {
+    led_clear_all();
+    button_clear_state();
+}
+
+/******************************************************************************
+ * STATE_SELF_TEST - Self-Test Fault Report
+ *
+ * PURPOSE:
+ * hardware_init() runs a power-on self-test (see hardware.cpp section 5).
+ * If it found a fault, show it long enough to read before the game starts.
+ * A passing self-test skips this state entirely, so boot time is unchanged.
+ *
+ * VISUAL:
+ *   LCD:  "Self-test FAIL" / first fault (e.g. "LED 3 shorted")
+ *
+ * TRANSITIONS:
+ *   → STATE_ATTRACT (after POST_FAULT_HOLD_MS, or on a button press)
+ *
+ * The game still runs afterwards: most faults (one dead LED, a corrupted
+ * high score) leave it playable, and the cabinet is better up than down.
+ ******************************************************************************/
+
+static void self_test_enter(void) {
+    display_show_post();
+    state_entry_time = millis();
+}
+
+static void self_test_update(void) {
+    if (button_just_pressed() || millis() - state_entry_time >= POST_FAULT_HOLD_MS) {
+        game_transition_to(STATE_ATTRACT);
+    }
+}
+
+static void self_test_exit(void) {
+    button_clear_state();  // The skip press must not start a game
+}
@@ -20,30 +20,59 @@
  *
  * 1. GPIO CONTROL (Lines 60-165)
  *    - hardware_init(): Pin configuration
- *    - LED control: led_set(), led_clear_all()
+ *    - LED control: set up by the board.h backend (led_set() is inline)
  *    - Button input: button_just_pressed(), button_clear_state()
  *    - Basic sound: buzzer_tick(), buzzer_hit()
  *
  * 2. NON-BLOCKING ANIMATION SYSTEM (Lines 167-370) ⭐ MOST COMPLEX
- *    - AnimationState enum: IDLE, BULLSEYE, CELEBRATION, GAME_OVER
+ *    - AnimationState enum: IDLE, BULLSEYE, CELEBRATION, GAME_OVER, SHOWCASE
+ *    - Animation scripts (script.h): melody and LED sequences written in order
  *    - animation_update(): Main animation dispatcher (called every frame)
  *    - animation_start_*(): Animation initialisation functions
  *    - DEMONSTRATES: Parallel timing, state machines, cooperative multitasking
  *
  * 3. LCD DISPLAY (Lines 372-420)
- *    - I2C communication with 16×2 character LCD
- *    - display_show_*(): Different screen layouts
+ *    - I2C communication with 16×2 (or 20×4) character LCD
+ *    - display_show_*(): Screens drawn from layout tables (layout.h)
  *    - Flicker reduction techniques
+ *    - Shadow frame, mirrored spectator panel, budgeted flushes
+ *    - Stubs on a board without I2C (board.h's BOARD_HAS_I2C)
  *
  * 4. EEPROM PERSISTENCE (Lines 422-500)
  *    - eeprom_read_high_score(): Load and validate persistent data
  *    - eeprom_write_high_score(): Save with magic byte + checksum
  *    - DEMONSTRATES: Data validation, corruption detection, wear levelling
  *
+ * 5. POWER-ON SELF-TEST
+ *    - post_begin() / post_finish(): Checks run around lcd.init()
+ *    - yield(): Runs the timed checks inside lcd.init()'s delay() calls
+ *    - DEMONSTRATES: Using a library's blocking wait for useful work
+ *
+ * 6. INPUT EXPANDER
+ *    - expander_service(): One I2C burst read per INTA interrupt
+ *    - Press queue feeding button_just_pressed(), operator switch levels
+ *    - DEMONSTRATES: Interrupt-driven I2C input, bus priority over the LCD
+ *    - No expander, so nothing to read, without BOARD_HAS_I2C
+ *
+ * 7. CREDITS AND AUDIT LEDGER
+ *    - credit_service(): Coin pulses (counted by coin.cpp's ISR) to credits
+ *    - Ledger in a ring of EEPROM slots, saved when the game is idle
+ *    - DEMONSTRATES: Wear spreading, crash-safe record replacement
+ *
+ * 8. GAME MODE UPLOAD (RULES_UPLOAD builds only)
+ *    - rules_upload_service(): Rule images (rules.h) from the serial port
+ *    - Checked with rules_image_load() before they reach EEPROM
+ *
+ * 9. SNAPSHOTS (end of file)
+ *    - hal_snapshot_save() / hal_snapshot_load(): This file's state as a
+ *      packed struct (snapshot.h), sent on request in SNAPSHOT_DUMP builds
+ *    - DEMONSTRATES: Portable state capture, timestamps as ages
+ *
  * ARCHITECTURE HIGHLIGHTS:
  *
  * Non-Blocking Design:
- * - No delay() calls anywhere in this file
+ * - No delay() calls anywhere in this file (the LCD library's own delays at
+ *   power-up are put to use by the self-test, see section 5)
  * - All timing uses millis() timestamps
  * - Animations run as state machines
  * - Functions return immediately (< 100μs execution time)
@@ -78,8 +107,23 @@
 
 #include "hardware.h"
 #include "config.h"
-#include <LiquidCrystal_I2C.h>
+#include "trace.h"
+#include "timebase.h"
+#include "coin.h"
+#include "tone_timer.h"
+#include "effects.h"
+#include "script.h"
+#include "debounce.h"
+#include "layout.h"
+#include "rules.h"
+#include "ghost.h"
+#include "snapshot.h"
+#include "clocks.h"
 #include <EEPROM.h>
+#ifdef BOARD_HAS_I2C
+#include <LiquidCrystal_I2C.h>
+#include <Wire.h>
+#endif
 
 /******************************************************************************
  * SECTION 1: GPIO CONTROL - Basic Input/Output
@@ -89,13 +133,56 @@
  * (apply voltage). Arduino Uno has 14 digital GPIO pins (D0-D13).
  ******************************************************************************/
 
-// Button state tracking for edge detection
+// Button edges are judged as they happen, in the pin-change ISR (see
+// button_edge()); loop() only collects the presses it counted.
 // Static variables persist between function calls (not on stack)
-static bool last_button_state = false;      // Previous button reading
-static uint32_t last_debounce_time = 0;     // Timestamp of last detected press
+static Debouncer button_debouncer;              // Edge timing, learned bounce
+static volatile uint8_t button_presses = 0;     // Presses since boot (wraps)
+static uint8_t button_presses_seen = 0;         // Last count loop() took
+static uint16_t bounce_saved_us = BOUNCE_DEFAULT_US;  // EEPROM profile
+
+#ifdef BOARD_HAS_I2C
+/**
+ * ArbitratedLcd - The LCD, giving way to expander input on the shared bus
+ *
+ * print() sends every character through the virtual write(). Serving a
+ * pending expander interrupt first means a press waits for at most one LCD
+ * byte instead of a whole screen update (see section 6).
+ */
+static void expander_read_changes(void);
+
+class ArbitratedLcd : public LiquidCrystal_I2C {
+public:
+    ArbitratedLcd(uint8_t address, uint8_t cols, uint8_t rows)
+        : LiquidCrystal_I2C(address, cols, rows) {}
 
-// LCD object (I2C communication)
-static LiquidCrystal_I2C lcd(LCD_ADDRESS, LCD_COLS, LCD_ROWS);
+    size_t write(uint8_t value) override {
+        expander_read_changes();
+        return LiquidCrystal_I2C::write(value);
+    }
+};
+
+// LCD objects (I2C communication), one per possible backpack address.
+// The library fixes the address at construction, so the self-test picks one
+// of these as the main panel (lcd) and, if the other address answers too,
+// the other as the spectator panel. Section 3 draws on both.
+static ArbitratedLcd lcd_primary(LCD_ADDRESS, LCD_COLS, LCD_ROWS);
+static ArbitratedLcd lcd_alternate(LCD_ALT_ADDRESS, LCD_COLS, LCD_ROWS);
+static LiquidCrystal_I2C *lcd = &lcd_primary;
+static LiquidCrystal_I2C *spectator = NULL;
+#endif
+
+// Display (section 3), self-test (section 5) and expander (section 6),
+// called from hardware_init()
+static void display_begin(void);
+static void animation_rewind_playlists(void);
+static void post_begin(void);
+static void post_finish(void);
+static void expander_begin(void);
+static bool expander_take_press(void);
+static void expander_flush_presses(void);
+static bool expander_presses_queued(void);
+static void ledger_load(void);
 
 /**
  * hardware_init - One-time hardware initialisation
@@ -144,93 +231,63 @@ static LiquidCrystal_I2C lcd(LCD_ADDRESS, LCD_COLS, LCD_ROWS);
  * Button released: Pin pulled to 5V by resistor → reads HIGH
  * Button pressed: Pin connected to GND → reads LOW
  *
- * LED INITIALISATION PATTERN:
+ * LED INITIALISATION:
  *
- * We have 8 LEDs on consecutive pins (2-9). Instead of 8 separate pinMode()
- * calls, we use a loop:
+ * The LED backend (board.h, leds.h) makes its outputs and turns them off.
+ * With a pin per LED that is a loop over the pins:
  *
- *   for (uint8_t i = 0; i < 8; i++) {
+ *   for (uint8_t i = 0; i < NUM_LEDS; i++) {
  *       pinMode(LED_PIN_START + i, OUTPUT);  // Configure pin 2, 3, ..., 9
  *   }
  *
  * This is more maintainable. To change to 10 LEDs, just update NUM_LEDS in
- * config.h. No code changes needed here.
+ * config.h (and build with LedsPins: -DLEDS_PINS).
  */
 void hardware_init(void) {
-    // Initialise LED pins as outputs
-    for (uint8_t i = 0; i < NUM_LEDS; i++) {
-        pinMode(LED_PIN_START + i, OUTPUT);  // Set pin as output
-        digitalWrite(LED_PIN_START + i, LOW);  // Start with LED off (0V)
-    }
+    // Initialise LED outputs, all off (0V)
+    BoardLeds::begin();
 
     // Initialise button with internal pull-up resistor (active-low)
     // See button wiring diagram above for how this works
     pinMode(BUTTON_PIN, INPUT_PULLUP);
 
-    // Initialise button edge detection state to current physical state
-    // This prevents detecting a "press" on boot if button happens to be held
-    last_button_state = digitalRead(BUTTON_PIN);
+    // Start the debouncer at the current physical level, so a button held
+    // at boot is not a "press", with the bounce profile this switch had
+    bounce_saved_us = eeprom_read_bounce_profile();
+    noInterrupts();
+    debounce_start(&button_debouncer, button_is_down(), bounce_saved_us);
+    button_presses_seen = button_presses;
+    interrupts();
 
     // Initialise buzzer pin as output
     pinMode(BUZZER_PIN, OUTPUT);
-    noTone(BUZZER_PIN);  // Ensure no tone playing (stop any residual PWM)
+    tone_stop();         // Ensure no tone playing (stop any residual PWM)
+    animation_stop();    // No half-finished melody (matters for host sim resets)
+    animation_rewind_playlists();
 
-    // Initialise I2C LCD display
-    // I2C pins (A4/A5) are automatically configured by Wire library
-    lcd.init();       // Initialise LCD controller, establish I2C communication
-    lcd.backlight();  // Turn on backlight LED (makes display visible)
-    lcd.clear();      // Clear display buffer (blank screen)
-}
+    // Self-test: instant checks, LCD address detection, start timed checks
+    post_begin();
 
-/**
- * led_set - Turn a single LED on or off
- * @param position: LED index (0-7)
- * @param state: true = ON (5V), false = OFF (0V)
- *
- * BOUNDS CHECKING:
- *
- * We validate position < NUM_LEDS before accessing hardware. Why?
- *
- * Without checking:
- *   led_set(10, true);  // position 10 doesn't exist!
- *   digitalWrite(LED_PIN_START + 10, HIGH);  // Write to pin 12 (wrong!)
- *   // Might be unconnected, or worse, connected to something else!
- *
- * With checking:
- *   if (position >= NUM_LEDS) return;  // Silently ignore invalid positions
- *   // Safe: won't corrupt other pins or crash
- *
- * EMBEDDED SAFETY PRINCIPLE:
- * Always validate inputs from higher-level code. Embedded systems have no
- * memory protection - invalid access doesn't throw an exception, it corrupts
- * hardware state or memory. Defensive programming is essential.
- */
-void led_set(uint8_t position, bool state) {
-    // Bounds checking (prevent invalid pin access)
-    if (position >= NUM_LEDS) {
-        return;  // Silently ignore invalid positions (fail-safe)
-    }
+    // Initialise the I2C LCD(s): main panel, and the spectator panel if the
+    // self-test found one. I2C pins (A4/A5) are configured by the Wire library.
+    // Each init() waits ~1 s for its LCD to power up; the timed self-test
+    // checks run inside that wait (see yield() in section 5)
+    display_begin();
 
-    // Calculate physical pin number: LED 0 = pin 2, LED 1 = pin 3, etc.
-    uint8_t pin = LED_PIN_START + position;
+    post_finish();
 
-    // Set pin voltage: HIGH = 5V (LED on), LOW = 0V (LED off)
-    digitalWrite(pin, state ? HIGH : LOW);
-}
+    // Optional MCP23017: probe, configure, read the starting levels
+    expander_begin();
 
-/**
- * led_clear_all - Turn off all LEDs
- *
- * Bulk operation equivalent to calling led_set(i, false) for all LEDs.
- * Used during:
- * - State transitions (clean visual state)
- * - Chase LED updates (turn off old position before lighting new)
- * - Game over animation (stop chase before flash begins)
- */
-void led_clear_all(void) {
-    for (uint8_t i = 0; i < NUM_LEDS; i++) {
-        digitalWrite(LED_PIN_START + i, LOW);
-    }
+    // Coin totals and unplayed credits from the last ledger save
+    ledger_load();
+
+#ifdef RULES_UPLOAD
+    Serial.begin(RULES_UPLOAD_BAUD);   // Game modes arrive here (section 8)
+#endif
+#ifdef SNAPSHOT_DUMP
+    Serial.begin(SNAPSHOT_BAUD);       // Snapshot requests (section 9)
+#endif
 }
 
 /******************************************************************************
@@ -306,70 +363,99 @@ void led_clear_all(void) {
  *
  * SOLUTION: Time-based debouncing
  *
- * After detecting an edge, ignore all transitions for 50ms:
+ * A press counts only if the line was quiet for a while before it. The
+ * bounce edges that follow come too soon after the press edge, and so do
+ * the ones on release:
  *
- *   last_debounce_time = 0ms
- *   ↓
- *   Press detected at 100ms → return true, set last_debounce_time = 100ms
+ *   lockout = 10ms (this switch bounces ~5ms)
  *   ↓
- *   Bounce at 105ms → Ignored (105 - 100 = 5ms < 50ms threshold)
- *   Bounce at 110ms → Ignored (110 - 100 = 10ms < 50ms)
- *   Bounce at 115ms → Ignored (115 - 100 = 15ms < 50ms)
- *   ↓
- *   Next press at 200ms → Allowed (200 - 100 = 100ms > 50ms)
- *
- * WHY 50MS DEBOUNCE TIME?
- * - Too short (10ms): Might not filter all bounces
- * - Too long (200ms): User can't press button rapidly
- * - 50ms is sweet spot: Filters bounces, feels responsive
+ *   Press edge at 100ms, quiet since 60ms → PRESS
+ *   Bounce at 102ms, 104ms → Ignored (2ms since the last edge < 10ms)
+ *   Release at 300ms, bounce at 301ms, 303ms → Ignored (not presses)
+ *   Next press at 400ms, quiet since 303ms → PRESS
+ *
+ * HOW LONG IS "A WHILE"?
+ * - Too short: Bounce gets through (one press counts twice)
+ * - Too long: Quick double taps are lost
+ * - The right value depends on the switch: ~1ms for a new microswitch,
+ *   15ms or more for a worn one
+ *
+ * So the firmware measures it. The pin-change interrupt times every edge,
+ * and debounce.h learns how long this switch's bursts of edges last. The
+ * lockout is that plus a margin (3-50ms), and it is saved in EEPROM so the
+ * next power-on starts from it. This work happens in the ISR, as the edges
+ * come: loop() just counts the presses the ISR accepted.
  *
  * ═══════════════════════════════════════════════════════════════════════════
  * IMPLEMENTATION BELOW
  * ═══════════════════════════════════════════════════════════════════════════
  ******************************************************************************/
 
+/**
+ * button_edge - The button pin changed (pin-change ISR)
+ * @param at_us: When, from timebase_isr_micros()
+ * @param down: The level now (true = pressed)
+ *
+ * Called from timebase.cpp's PCINT0_vect, which also fires for INTA: a
+ * call at an unchanged level does nothing. Constant time, no bus access.
+ * The host simulator calls it from sim_set_button().
+ */
+void button_edge(uint32_t at_us, bool down) {
+    if (debounce_edge(&button_debouncer, at_us, down)) {
+        button_presses++;
+    }
+}
+
+/**
+ * button_catch_up - Feed the debouncer an edge the ISR didn't report
+ *
+ * With the pin-change interrupt, the debouncer's level already matches the
+ * pin and this does nothing. Builds without it (TIMEBASE_TIMER0) see the
+ * edges here instead, at loop() rate.
+ */
+static void button_catch_up(void) {
+    bool down = button_is_down();
+    noInterrupts();
+    if (down != button_debouncer.down) {
+        button_edge(timebase_isr_micros(), down);
+    }
+    interrupts();
+}
+
 /**
  * button_just_pressed - Detect button press event with debouncing
  * @return: true if button just pressed (rising edge), false otherwise
  *
- * CALL THIS EVERY FRAME. It maintains internal state to track edges.
+ * CALL THIS EVERY FRAME. Each press the ISR accepted is returned once.
  *
  * ACTIVE-LOW LOGIC:
  * INPUT_PULLUP makes unpressed button read HIGH, pressed reads LOW.
- * We invert the reading so our code works with natural logic:
- *   current_state = !digitalRead(BUTTON_PIN);
+ * button_is_down() inverts the reading so our code works with natural logic:
+ *   down = !digitalRead(BUTTON_PIN);
  *   // true = pressed, false = released (natural!)
+ *
+ * The press counter is 8 bits: one load, so reading it while the ISR may
+ * add to it needs no interrupt lock.
  */
 bool button_just_pressed(void) {
-    uint32_t now = millis();  // Current time (milliseconds since boot)
-
-    // Read button state and invert (INPUT_PULLUP is active-low)
-    // digitalRead returns: HIGH (unpressed), LOW (pressed)
-    // We invert: false (unpressed), true (pressed)
-    bool current_state = !digitalRead(BUTTON_PIN);
+    button_catch_up();
 
-    // Detect rising edge (unpressed → pressed transition)
     bool pressed = false;
-    if (current_state && !last_button_state) {
-        // Edge detected! But is it valid or just a bounce?
-
-        // Check debounce timeout: has 50ms elapsed since last detected press?
-        if (now - last_debounce_time >= DEBOUNCE_MS) {
-            // Valid press! Enough time has passed.
-            pressed = true;  // Signal press event to caller
-            last_debounce_time = now;  // Lock out further presses for 50ms
-        }
-        // If timeout not met, ignore this edge (it's a bounce)
+    if (button_presses != button_presses_seen) {
+        button_presses_seen++;   // One press per call, oldest first
+        pressed = true;
     }
 
-    // Remember current state for next edge detection
-    last_button_state = current_state;
+    // Expander player buttons are debounced as they are queued (section 6)
+    if (!pressed) {
+        pressed = expander_take_press();
+    }
 
     return pressed;
 }
 
 /**
- * button_clear_state - Reset edge detector to current physical state
+ * button_clear_state - Forget presses not yet taken
  *
  * Called during state transitions to prevent "stale" button presses from
  * carrying over between states.
@@ -377,45 +463,117 @@ bool button_just_pressed(void) {
  * PROBLEM WITHOUT CLEARING:
  *
  * Scenario:
- * 1. User presses button in STATE_ATTRACT (starts game)
- * 2. Transition to STATE_PLAYING occurs
- * 3. User still holding button from step 1
- * 4. User releases button in STATE_PLAYING
- * 5. Edge detector sees LOW → HIGH transition (release)
- * 6. Wait... user presses again
- * 7. Edge detector sees HIGH → LOW transition (press)
- * 8. But last_button_state might still be LOW from the held button!
- * 9. False press detected or missed press
+ * 1. User presses button in STATE_RESULT (which doesn't read the button)
+ * 2. The ISR counts the press anyway
+ * 3. Transition to STATE_PLAYING occurs
+ * 4. STATE_PLAYING takes the old press and judges the LED position at once
  *
  * SOLUTION:
- * Call button_clear_state() in state exit functions. This resets the edge
- * detector to match the current physical button state, ensuring only NEW
- * presses in the NEW state are detected.
+ * Call button_clear_state() in state exit functions. Only presses made in
+ * the NEW state are returned. A button still held from the old state is not
+ * a press either: it has no new edge.
  */
 void button_clear_state(void) {
-    // Sync edge detector to current physical state
-    last_button_state = !digitalRead(BUTTON_PIN);  // Invert (active-low)
+    button_catch_up();
+    button_presses_seen = button_presses;
+
+    // Expander presses made in the old state are stale too
+    expander_flush_presses();
+}
+
+/**
+ * button_is_down - Read the raw button level
+ * @return: true while the button is held
+ */
+bool button_is_down(void) {
+    return !digitalRead(BUTTON_PIN);  // Invert (active-low)
+}
+
+/**
+ * button_input_pending - Is there a press (or an edge) loop() hasn't seen?
+ * @return: true if the next button_just_pressed() call will see a new level
+ *          or take a press
+ *
+ * While this returns false, calling button_just_pressed() is a no-op (used
+ * to sleep, or skip idle milliseconds in the host simulator).
+ */
+bool button_input_pending(void) {
+    return button_is_down() != button_debouncer.down ||
+           button_presses != button_presses_seen || expander_presses_queued();
+}
+
+/**
+ * button_service - Save the learned bounce profile if it has drifted
+ * @param save_ok: false while a save would be noticed (during a game)
+ *
+ * Four EEPROM bytes (~13 ms of loop()), and only once the estimate is
+ * BOUNCE_SAVE_STEP_US away from the saved one: a settled switch is saved
+ * a handful of times, then not again.
+ */
+void button_service(bool save_ok) {
+    if (button_ms_until_next_event(save_ok) != 0) {
+        return;
+    }
+    noInterrupts();
+    uint16_t bounce_us = button_debouncer.bounce_us;
+    interrupts();
+    eeprom_write_bounce_profile(bounce_us);
+    bounce_saved_us = bounce_us;
+}
+
+uint32_t button_ms_until_next_event(bool save_ok) {
+    noInterrupts();
+    uint16_t bounce_us = button_debouncer.bounce_us;
+    interrupts();
+    uint16_t drift = bounce_us > bounce_saved_us ? bounce_us - bounce_saved_us
+                                                 : bounce_saved_us - bounce_us;
+    return save_ok && drift >= BOUNCE_SAVE_STEP_US ? 0 : NO_PENDING_EVENT;
+}
 
-    // Reset debounce timer to prevent immediate press detection
-    last_debounce_time = millis();
+/**
+ * millis_until_elapsed - Time left on a "now - since >= interval" timer
+ * @param since: Timestamp the timer was started (millis())
+ * @param interval: Timer length (ms)
+ * @return: ms until the timer expires, 0 if it already has
+ *
+ * Same unsigned subtraction as the timers themselves, so millis() rollover
+ * is handled identically.
+ */
+uint32_t millis_until_elapsed(uint32_t since, uint32_t interval) {
+    uint32_t elapsed = millis() - since;
+    return elapsed >= interval ? 0 : interval - elapsed;
 }
 
+/*
+ * Every note the game plays, with its Timer2 settings worked out by the
+ * compiler for this board's F_CPU (see tone_timer.h)
+ */
+TONE_NOTE(TONE_TICK, FREQ_TICK, DURATION_TICK);
+TONE_NOTE(TONE_HIT, FREQ_HIT, DURATION_HIT);
+TONE_NOTE(TONE_BEAT, FREQ_CALIBRATION_BEAT, DURATION_CALIBRATION_BEAT);
+TONE_NOTE(TONE_BULLSEYE_1, FREQ_BULLSEYE_1, DURATION_BULLSEYE_NOTE);
+TONE_NOTE(TONE_BULLSEYE_2, FREQ_BULLSEYE_2, DURATION_BULLSEYE_NOTE);
+TONE_NOTE(TONE_BULLSEYE_3, FREQ_BULLSEYE_3, DURATION_BULLSEYE_NOTE);
+TONE_NOTE(TONE_GAME_OVER_1, FREQ_GAME_OVER_1, DURATION_GAME_OVER_NOTE);
+TONE_NOTE(TONE_GAME_OVER_2, FREQ_GAME_OVER_2, DURATION_GAME_OVER_NOTE);
+TONE_NOTE(TONE_GAME_OVER_3, FREQ_GAME_OVER_3, DURATION_GAME_OVER_NOTE);
+TONE_NOTE(TONE_POST, FREQ_POST_BUZZER, POST_BUZZER_MS);
+
 /**
  * buzzer_tick - Play brief tick sound
  *
  * Used for: Chase LED movement feedback (every LED step)
  *
- * Arduino tone() function:
- *   tone(pin, frequency_hz, duration_ms);
+ * tone_play(note) starts a square wave on the buzzer pin: Timer2 toggles
+ * the pin HIGH/LOW at the note's frequency.
+ * Example: 100 Hz = 100 full HIGH/LOW cycles per second
  *
- * PWM generation: Toggles pin HIGH/LOW at specified frequency.
- * Example: 100 Hz = pin toggles 100 times/second
- *
- * NON-BLOCKING: tone() returns immediately! Sound plays in background using
- * hardware timer. No delay() needed.
+ * NON-BLOCKING: tone_play() returns immediately! Sound plays in background
+ * using the hardware timer. No delay() needed.
  */
 void buzzer_tick(void) {
-    tone(BUZZER_PIN, FREQ_TICK, DURATION_TICK);  // 100 Hz, 20ms
+    tone_play(TONE_TICK);  // 100 Hz, 20ms
+    TRACE_INSTANT(TRACE_TONE, 0);
 }
 
 /**
@@ -424,7 +582,18 @@ void buzzer_tick(void) {
  * Used for: Non-bullseye successful hits
  */
 void buzzer_hit(void) {
-    tone(BUZZER_PIN, FREQ_HIT, DURATION_HIT);  // 500 Hz, 100ms
+    tone_play(TONE_HIT);  // 500 Hz, 100ms
+    TRACE_INSTANT(TRACE_TONE, 1);
+}
+
+/**
+ * buzzer_beat - Play calibration metronome click
+ *
+ * Short and high so its start is sharp: the player taps to its onset.
+ */
+void buzzer_beat(void) {
+    tone_play(TONE_BEAT);  // 1000 Hz, 30ms
+    TRACE_INSTANT(TRACE_TONE, 2);
 }
 
 /******************************************************************************
@@ -476,20 +645,30 @@ void buzzer_hit(void) {
  *
  * OUR IMPLEMENTATION:
  *
- * Animation state machine with independent timing:
+ * Each animation is written as scripts that read top to bottom, with waits
+ * (script.h):
+ *
+ *   SCRIPT(bullseye_notes) {
+ *       SCRIPT_BEGIN();
+ *       for (script->i = 0; script->i < 3; script->i++) {
+ *           SCRIPT_AWAIT_MS(DURATION_BULLSEYE_NOTE);   // Returns to loop()
+ *           tone_play(bullseye_tones[script->i]);      // Carries on here
+ *       }
+ *       SCRIPT_END();
+ *   }
+ *
+ * A script returns at each wait and resumes after it on a later call, with
+ * one jump. Its place and loop counter live in a ScriptTrack, so nothing has
+ * to work out "which step am I on?" from a set of counters.
  *
  * 1. animation_start_*() - Initialise animation state
  *    - Set anim_state to target animation type
- *    - Reset step counters (anim_step = 0)
- *    - Reset timing variables (anim_last_update = millis())
+ *    - Put the buzzer and LED tracks at the top of their scripts
  *    - Returns immediately
  *
  * 2. animation_update() - Advance animation (called every loop)
- *    - Check current animation state
- *    - Check if enough time elapsed for next step
- *    - If yes: advance to next step, play next note/update LEDs
- *    - If no: return immediately (nothing to do yet)
- *    - Returns true if animation complete
+ *    - Resume each track whose wait is over; it runs to its next wait
+ *    - Returns true if both tracks have ended (animation complete)
  *
  * 3. animation_is_playing() - Query animation status
  *    - Returns: true if busy, false if idle
@@ -503,10 +682,10 @@ void buzzer_hit(void) {
  * - Buzzer plays melody
  * - LEDs play visual effect
  *
- * Each has INDEPENDENT timing:
+ * Each is its own script on its own track, with INDEPENDENT timing:
  *
- *   anim_last_update: Buzzer timing (note intervals)
- *   led_last_update: LED timing (sweep/flash intervals)
+ *   buzzer_track: Melody script (note intervals)
+ *   led_track: LED script (frame/flash intervals)
  *
  * Timeline example (CELEBRATION):
  *
@@ -518,10 +697,19 @@ void buzzer_hit(void) {
  *             └─40ms┘─40ms┘─40ms┘─40ms┘─40ms┘─40ms┘
  *
  * Notice: Note plays every 150ms, LED advances every 40ms.
- * Completely independent! Handled by separate timer checks:
+ * Completely independent! Each track waits on its own:
+ *
+ *   buzzer_track: SCRIPT_AWAIT_MS(note gap); tone_play(note);
+ *   led_track:    SCRIPT_AWAIT_MS(40); led_show(effect_next(...));
  *
- *   if (now - anim_last_update >= note_duration) { play_note(); }
- *   if (now - led_last_update >= led_delay) { advance_led(); }
+ * PROCEDURAL LED EFFECTS:
+ *
+ * The celebration LEDs (and the attract showcase, ANIM_SHOWCASE) don't
+ * store their frames: each frame comes from effect_next(), a generator from
+ * effects.h (wave, sparkle, cellular automaton, bouncing pairs, scanner).
+ * The animation only decides when a frame is due and how many to show, so
+ * every effect fits the same timing, and each celebration plays the next
+ * effect of its playlist.
  *
  * WATCHDOG TIMER SAFETY:
  *
@@ -546,27 +734,226 @@ void buzzer_hit(void) {
  *
  * ANIM_IDLE: No animation playing (default state)
  * ANIM_BULLSEYE: 3-note ascending melody (800→1000→1200 Hz)
- * ANIM_CELEBRATION: Complex multi-sensory (buzzer melody + LED wave)
+ * ANIM_CELEBRATION: Complex multi-sensory (buzzer melody + LED effect)
  * ANIM_GAME_OVER: Descending tones + LED flash
+ * ANIM_SHOWCASE: Attract mode LED effect (silent)
  */
 enum AnimationState {
     ANIM_IDLE,         // No animation playing
     ANIM_BULLSEYE,     // Bullseye hit animation
     ANIM_CELEBRATION,  // New high score celebration
-    ANIM_GAME_OVER     // Game over animation
+    ANIM_GAME_OVER,    // Game over animation
+    ANIM_SHOWCASE      // Attract mode effect
 };
 
-// Animation state variables (persist between animation_update() calls)
+// Animation state (persists between animation_update() calls): which
+// animation is playing, and one track per part that plays in parallel
 static AnimationState anim_state = ANIM_IDLE;  // Current animation
-static uint8_t anim_step = 0;                  // Current step in sequence (note counter)
-static uint32_t anim_last_update = 0;          // Timestamp of last buzzer update (ms)
+static ScriptTrack buzzer_track;               // Melody script
+static ScriptTrack led_track;                  // LED script
+
+// LED effect being played (celebration and showcase, see effects.h)
+static LedEffect led_effect;
+
+// Next effect of each playlist (effects.h)
+static uint8_t celebration_effect_next = 0;
+static uint8_t attract_effect_next = 0;
+
+// Frame ticks in a celebration; the last one turns the LEDs off
+static const uint8_t CELEBRATION_FRAMES = CELEBRATION_SWEEPS * NUM_LEDS;
+
+/**
+ * led_show - Light exactly the LEDs set in @frame (bit n = LED n)
+ */
+static void led_show(uint8_t frame) {
+    BoardLeds::show(frame);
+}
+
+static const ToneNote bullseye_tones[] = {TONE_BULLSEYE_1, TONE_BULLSEYE_2, TONE_BULLSEYE_3};
+static const ToneNote game_over_tones[] = {TONE_GAME_OVER_1, TONE_GAME_OVER_2, TONE_GAME_OVER_3};
+
+// Celebration melody (C5, E5, G5, C6, E6), last note longer
+static constexpr uint16_t celebration_durations[] = {150, 150, 150, 150, 300};
+TONE_NOTE(TONE_C5, 523, celebration_durations[0]);
+TONE_NOTE(TONE_E5, 659, celebration_durations[1]);
+TONE_NOTE(TONE_G5, 784, celebration_durations[2]);
+TONE_NOTE(TONE_C6, 1047, celebration_durations[3]);
+TONE_NOTE(TONE_E6, 1319, celebration_durations[4]);
+static const ToneNote celebration_tones[] = {TONE_C5, TONE_E5, TONE_G5, TONE_C6, TONE_E6};
+static const uint8_t CELEBRATION_NOTES = sizeof(celebration_tones) / sizeof(celebration_tones[0]);
+
+/**
+ * celebration_note_gap - Time from the previous note to celebration note @step
+ *
+ * The first note plays immediately, every later one waits for the previous
+ * note to finish plus 50ms of silence.
+ */
+static uint16_t celebration_note_gap(uint8_t step) {
+    return step == 0 ? 0 : celebration_durations[step - 1] + 50;
+}
+
+/**************************************************************************
+ * BULLSEYE ANIMATION - 3-Note Ascending Melody
+ *
+ * Timeline:
+ *   Time:  0ms      100ms     200ms     300ms
+ *   Note:  (start)  800Hz     1000Hz    1200Hz, done
+ *          └─100ms─┘└─100ms─┘└─100ms─┘
+ *
+ * No LED part: the chase LEDs carry on.
+ **************************************************************************/
+
+SCRIPT(bullseye_notes) {
+    SCRIPT_BEGIN();
+    for (script->i = 0; script->i < 3; script->i++) {
+        SCRIPT_AWAIT_MS(DURATION_BULLSEYE_NOTE);
+        tone_play(bullseye_tones[script->i]);
+        TRACE_INSTANT(TRACE_ANIM_NOTE, script->i);
+    }
+    SCRIPT_END();
+}
+
+/**************************************************************************
+ * CELEBRATION ANIMATION - Parallel Buzzer + LED Effect
+ *
+ * BUZZER SEQUENCE (5 notes):
+ *   Note 0: C5 (523 Hz) for 150ms
+ *   Note 1: E5 (659 Hz) for 150ms
+ *   Note 2: G5 (784 Hz) for 150ms
+ *   Note 3: C6 (1047 Hz) for 150ms
+ *   Note 4: E6 (1319 Hz) for 300ms (finale)
+ *   Each note starts 50ms after the previous one ends: ~1100ms
+ *
+ * LED SEQUENCE (procedural effect, see effects.h):
+ *   One frame every 40ms from this celebration's effect (the first
+ *   is the wave: 0→1→2→...→7, then repeat)
+ *   3 sweeps' worth of frames (3 × 8 × 40ms = 960ms), then all off
+ *
+ * The two scripts run side by side, each with its own waits:
+ *
+ *   Time:     0ms   40ms  80ms  120ms 160ms 200ms ...
+ *   Buzzer:   C5    (C5)  (C5)  (C5)  (  )  E5    ...
+ *             └──150ms note + 50ms gap──┘
+ *   LEDs:     (   ) [1]   [2]   [3]   [4]   [5]  ...
+ *             └40ms┘└40ms┘└40ms┘└40ms┘└40ms┘
+ *
+ * The animation is over when both have ended.
+ **************************************************************************/
+
+SCRIPT(celebration_notes) {
+    SCRIPT_BEGIN();
+    for (script->i = 0; script->i < CELEBRATION_NOTES; script->i++) {
+        SCRIPT_AWAIT_MS(celebration_note_gap(script->i));
+        tone_play(celebration_tones[script->i]);
+        TRACE_INSTANT(TRACE_ANIM_NOTE, script->i);
+    }
+    SCRIPT_END();
+}
+
+SCRIPT(celebration_leds) {
+    SCRIPT_BEGIN();
+    for (script->i = 1; script->i < CELEBRATION_FRAMES; script->i++) {
+        SCRIPT_AWAIT_MS(CELEBRATION_LED_DELAY);
+        uint8_t frame = effect_next(&led_effect);
+        led_show(frame);
+        TRACE_INSTANT(TRACE_ANIM_LEDS, frame);
+    }
+    SCRIPT_AWAIT_MS(CELEBRATION_LED_DELAY);
+    led_clear_all();
+    TRACE_INSTANT(TRACE_ANIM_LEDS, 0);
+    SCRIPT_END();
+}
+
+/**************************************************************************
+ * SHOWCASE ANIMATION - Attract Mode LED Effect (silent)
+ *
+ * ATTRACT_SHOW_FRAMES frames of the next attract playlist effect,
+ * ATTRACT_SHOW_FRAME_MS apart, then all LEDs off. The first frame shows
+ * from animation_start_showcase() itself. game.cpp keeps the chase LED
+ * dark meanwhile.
+ **************************************************************************/
+
+SCRIPT(showcase_leds) {
+    SCRIPT_BEGIN();
+    for (script->i = 0; script->i < ATTRACT_SHOW_FRAMES; script->i++) {
+        uint8_t frame = effect_next(&led_effect);
+        led_show(frame);
+        TRACE_INSTANT(TRACE_ANIM_LEDS, frame);
+        SCRIPT_AWAIT_MS(ATTRACT_SHOW_FRAME_MS);
+    }
+    led_clear_all();
+    SCRIPT_END();
+}
+
+/**************************************************************************
+ * GAME_OVER ANIMATION - Descending Tones + LED Flash
+ *
+ * BUZZER SEQUENCE (3 notes, "sad trombone"):
+ *   400 Hz, 300 Hz, 200 Hz, one every 200ms from the start
+ *
+ * LED SEQUENCE (synchronised flash):
+ *   All 8 LEDs flash on/off together, 150ms per state
+ *   Over as the 5th flash lights (the LEDs are cleared at once)
+ *
+ * Timeline:
+ *   Time:     0ms   150ms 200ms 300ms 400ms 450ms 600ms 750ms ... 1350ms
+ *   Buzzer:               400Hz       300Hz       200Hz
+ *   LEDs:     (off) ON          OFF         ON    OFF   ON    ... ON, done
+ *   Flash:          1st                     2nd         3rd       5th
+ **************************************************************************/
+
+SCRIPT(game_over_notes) {
+    SCRIPT_BEGIN();
+    for (script->i = 0; script->i < 3; script->i++) {
+        SCRIPT_AWAIT_MS(DURATION_GAME_OVER_NOTE);
+        tone_play(game_over_tones[script->i]);
+        TRACE_INSTANT(TRACE_ANIM_NOTE, script->i);
+    }
+    SCRIPT_END();
+}
+
+SCRIPT(game_over_leds) {
+    SCRIPT_BEGIN();
+    for (script->i = 0; script->i < GAME_OVER_LED_FLASH_COUNT; ) {
+        SCRIPT_AWAIT_MS(GAME_OVER_LED_FLASH_DURATION);
+        TRACE_INSTANT(TRACE_ANIM_LEDS, 1);
+        led_show(0xFF);
+        script->i++;  // Counted as it lights (complete on/off cycles)
+        if (script->i >= GAME_OVER_LED_FLASH_COUNT) {
+            break;
+        }
+        SCRIPT_AWAIT_MS(GAME_OVER_LED_FLASH_DURATION);
+        TRACE_INSTANT(TRACE_ANIM_LEDS, 0);
+        led_clear_all();
+    }
+    led_clear_all();
+    SCRIPT_END();
+}
+
+/**
+ * animation_scripts - What plays on each track, by AnimationState
+ *
+ * NULL = nothing on that track (counts as ended).
+ */
+static const struct {
+    ScriptFn buzzer;
+    ScriptFn leds;
+} animation_scripts[] = {
+    {NULL, NULL},                              // ANIM_IDLE
+    {bullseye_notes, NULL},                    // ANIM_BULLSEYE
+    {celebration_notes, celebration_leds},     // ANIM_CELEBRATION
+    {game_over_notes, game_over_leds},         // ANIM_GAME_OVER
+    {NULL, showcase_leds}                      // ANIM_SHOWCASE
+};
 
-// LED animation state (separate from buzzer for parallel timing)
-static uint8_t led_sweep = 0;                  // Celebration: which sweep (0-2)
-static uint8_t led_pos = 0;                    // Celebration: LED position in sweep
-static uint8_t flash_count = 0;                // Game over: number of flashes completed
-static bool flash_state = false;               // Game over: current flash state (on/off)
-static uint32_t led_last_update = 0;           // Timestamp of last LED update (ms)
+/**
+ * animation_play - Start @state's scripts from the top
+ */
+static void animation_play(AnimationState state, uint32_t now) {
+    anim_state = state;
+    script_start(&buzzer_track, now);
+    script_start(&led_track, now);
+}
 
 /**
  * animation_update - Advance current animation state
@@ -574,9 +961,8 @@ static uint32_t led_last_update = 0;           // Timestamp of last LED update (
  *
  * CALL THIS EVERY LOOP ITERATION (from game_update()).
  *
- * This function checks the current animation state and advances it if enough
- * time has elapsed. It handles all animation logic in one place using a big
- * switch statement.
+ * Resumes the animation's buzzer and LED scripts, each only if its wait is
+ * over. The animation is done in the call where the later of the two ends.
  *
  * EXECUTION TIME: ~50-100μs (very fast, even when animating)
  */
@@ -587,211 +973,14 @@ bool animation_update(void) {
     }
 
     uint32_t now = millis();  // Current time (check once per frame)
+    bool done = script_resume(&buzzer_track, animation_scripts[anim_state].buzzer, now);
+    done = script_resume(&led_track, animation_scripts[anim_state].leds, now) && done;
 
-    switch (anim_state) {
-
-        /**************************************************************************
-         * BULLSEYE ANIMATION - 3-Note Ascending Melody
-         *
-         * Sequence:
-         *   Step 0: 800 Hz for 100ms
-         *   Step 1: 1000 Hz for 100ms
-         *   Step 2: 1200 Hz for 100ms
-         *   Step 3: Complete (transition to IDLE)
-         *
-         * Timeline:
-         *   Time:  0ms      100ms     200ms     300ms
-         *   Step:  0        1         2         IDLE
-         *   Note:  800Hz    1000Hz    1200Hz    (silence)
-         *          └─100ms─┘└─100ms─┘└─100ms─┘
-         *
-         * Logic:
-         * - Wait for note duration to elapse (100ms)
-         * - Play next note
-         * - Increment step
-         * - If step >= 3, animation complete
-         **************************************************************************/
-
-        case ANIM_BULLSEYE:
-            // Check if time for next note
-            if (now - anim_last_update >= DURATION_BULLSEYE_NOTE) {
-                anim_last_update = now;  // Reset timer for next note
-
-                // Play note based on current step
-                switch(anim_step) {
-                    case 0: tone(BUZZER_PIN, FREQ_BULLSEYE_1, DURATION_BULLSEYE_NOTE); break;
-                    case 1: tone(BUZZER_PIN, FREQ_BULLSEYE_2, DURATION_BULLSEYE_NOTE); break;
-                    case 2: tone(BUZZER_PIN, FREQ_BULLSEYE_3, DURATION_BULLSEYE_NOTE); break;
-                }
-
-                anim_step++;  // Advance to next note
-
-                // Check if sequence complete
-                if (anim_step >= 3) {
-                    anim_state = ANIM_IDLE;  // Return to idle state
-                    return true;  // Signal completion
-                }
-            }
-            break;
-
-        /**************************************************************************
-         * CELEBRATION ANIMATION - Parallel Buzzer + LED Wave
-         *
-         * BUZZER SEQUENCE (5 notes):
-         *   Note 0: C5 (523 Hz) for 150ms
-         *   Note 1: E5 (659 Hz) for 150ms
-         *   Note 2: G5 (784 Hz) for 150ms
-         *   Note 3: C6 (1047 Hz) for 150ms
-         *   Note 4: E6 (1319 Hz) for 300ms (finale)
-         *   Total: ~900ms
-         *
-         * LED SEQUENCE (wave effect):
-         *   Light LEDs 0→1→2→3→4→5→6→7, then repeat
-         *   Each LED lit for 40ms
-         *   3 complete sweeps (3 × 8 LEDs × 40ms = 960ms)
-         *
-         * PARALLEL TIMING:
-         * Buzzer and LEDs use separate timers (anim_last_update, led_last_update).
-         * They advance independently:
-         *
-         *   Time:     0ms   40ms  80ms  120ms 160ms 200ms ...
-         *   Buzzer:   C5    (C5)  (C5)  (C5)  E5    (E5)  ...
-         *             └────150ms────┘    └────150ms────┘
-         *   LEDs:     [0]   [1]   [2]   [3]   [4]   [5]  ...
-         *             └40ms┘└40ms┘└40ms┘└40ms┘└40ms┘
-         *
-         * COMPLETION:
-         * Animation complete when BOTH sequences finish:
-         * - anim_step >= 5 (all notes played)
-         * - led_sweep >= 3 (all sweeps complete)
-         **************************************************************************/
-
-        case ANIM_CELEBRATION: {
-            // Buzzer sequence (5 notes with varying durations)
-            const uint16_t freqs[] = {523, 659, 784, 1047, 1319};  // C5, E5, G5, C6, E6
-            const uint16_t durations[] = {150, 150, 150, 150, 300};  // Last note longer
-
-            // Check if time for next note
-            // First note plays immediately (anim_step == 0), others wait for duration
-            if (anim_step < 5 && now - anim_last_update >= (anim_step == 0 ? 0 : durations[anim_step-1] + 50)) {
-                tone(BUZZER_PIN, freqs[anim_step], durations[anim_step]);
-                anim_last_update = now;
-                anim_step++;
-            }
-
-            // LED sweep animation (parallel, independent timing)
-            if (now - led_last_update >= CELEBRATION_LED_DELAY) {
-                led_last_update = now;
-
-                if (led_sweep < CELEBRATION_SWEEPS) {
-                    // Turn off previous LED
-                    led_set(led_pos, false);
-
-                    // Advance position
-                    led_pos++;
-
-                    // Check if sweep complete (reached end of LED strip)
-                    if (led_pos >= NUM_LEDS) {
-                        led_pos = 0;       // Wrap to start
-                        led_sweep++;       // Increment sweep counter
-                    }
-
-                    // Turn on LED at new position (if still sweeping)
-                    if (led_sweep < CELEBRATION_SWEEPS) {
-                        led_set(led_pos, true);
-                    } else {
-                        // Final sweep complete, clear all LEDs
-                        led_clear_all();
-                    }
-                }
-            }
-
-            // Check if BOTH animations complete
-            if (anim_step >= 5 && led_sweep >= CELEBRATION_SWEEPS) {
-                anim_state = ANIM_IDLE;  // Return to idle
-                led_sweep = 0;           // Reset for next time
-                led_pos = 0;
-                return true;  // Signal completion
-            }
-            break;
-        }
-
-        /**************************************************************************
-         * GAME_OVER ANIMATION - Descending Tones + LED Flash
-         *
-         * BUZZER SEQUENCE (3 notes, "sad trombone"):
-         *   Note 0: 400 Hz for 200ms
-         *   Note 1: 300 Hz for 200ms
-         *   Note 2: 200 Hz for 200ms
-         *   Total: 600ms
-         *
-         * LED SEQUENCE (synchronised flash):
-         *   All 8 LEDs flash on/off together
-         *   5 complete cycles (on+off = 1 cycle)
-         *   150ms per state (150ms on, 150ms off)
-         *   Total: 5 cycles × 300ms = 1500ms
-         *
-         * Timeline:
-         *   Time:     0ms   150ms 300ms 450ms 600ms 750ms 900ms ...
-         *   Buzzer:   400Hz (400) 300Hz (300) 200Hz (200) (off)
-         *             └─200ms─┘   └─200ms─┘   └─200ms─┘
-         *   LEDs:     ON    OFF   ON    OFF   ON    OFF   ON   ...
-         *             └150ms┘150ms└150ms┘150ms└150ms┘150ms└150ms
-         *   Flash:    1st   1st   2nd   2nd   3rd   3rd   4th  ...
-         *
-         * COMPLETION:
-         * Animation complete when flash_count >= 5 (5 on/off cycles)
-         **************************************************************************/
-
-        case ANIM_GAME_OVER:
-            // Buzzer sequence (descending tones)
-            if (now - anim_last_update >= DURATION_GAME_OVER_NOTE) {
-                anim_last_update = now;
-
-                if (anim_step < 3) {
-                    // Play note based on step
-                    switch(anim_step) {
-                        case 0: tone(BUZZER_PIN, FREQ_GAME_OVER_1, DURATION_GAME_OVER_NOTE); break;
-                        case 1: tone(BUZZER_PIN, FREQ_GAME_OVER_2, DURATION_GAME_OVER_NOTE); break;
-                        case 2: tone(BUZZER_PIN, FREQ_GAME_OVER_3, DURATION_GAME_OVER_NOTE); break;
-                    }
-                    anim_step++;
-                }
-            }
-
-            // LED flash animation (parallel, independent timing)
-            if (now - led_last_update >= GAME_OVER_LED_FLASH_DURATION) {
-                led_last_update = now;
-
-                // Toggle flash state (on → off → on → ...)
-                flash_state = !flash_state;
-
-                if (flash_state) {
-                    // Flash ON: Light all LEDs
-                    for (uint8_t i = 0; i < NUM_LEDS; i++) {
-                        led_set(i, true);
-                    }
-                    flash_count++;  // Increment on rising edge (counts complete cycles)
-                } else {
-                    // Flash OFF: Clear all LEDs
-                    led_clear_all();
-                }
-
-                // Check if flash sequence complete
-                if (flash_count >= GAME_OVER_LED_FLASH_COUNT) {
-                    anim_state = ANIM_IDLE;  // Return to idle
-                    flash_count = 0;         // Reset for next time
-                    led_clear_all();         // Ensure LEDs off
-                    return true;  // Signal completion
-                }
-            }
-            break;
-
-        case ANIM_IDLE:
-        default:
-            return true;  // Nothing to do
+    if (done) {
+        TRACE_INSTANT(TRACE_ANIM_DONE, anim_state);
+        anim_state = ANIM_IDLE;
+        return true;  // Signal completion
     }
-
     return false;  // Still animating
 }
 
@@ -799,27 +988,21 @@ bool animation_update(void) {
  * animation_start_bullseye - Initialise bullseye animation
  *
  * Called from game.cpp when player hits bullseye zone.
- * Sets up state for 3-note ascending sequence.
  */
 void animation_start_bullseye(void) {
-    anim_state = ANIM_BULLSEYE;     // Set animation type
-    anim_step = 0;                  // Start at first note
-    anim_last_update = millis();    // Record start time
+    animation_play(ANIM_BULLSEYE, millis());
 }
 
 /**
  * animation_start_celebration - Initialise celebration animation
  *
  * Called from game.cpp when new high score achieved.
- * Sets up state for parallel buzzer melody + LED wave.
+ * Sets up state for parallel buzzer melody + the next celebration effect.
  */
 void animation_start_celebration(void) {
-    anim_state = ANIM_CELEBRATION;  // Set animation type
-    anim_step = 0;                  // Start at first note
-    led_sweep = 0;                  // Start at first sweep
-    led_pos = 0;                    // Start at first LED
-    anim_last_update = millis();    // Record start time (buzzer)
-    led_last_update = millis();     // Record start time (LEDs)
+    effect_start(&led_effect, &celebration_effects[celebration_effect_next], (uint16_t)millis());
+    celebration_effect_next = (uint8_t)((celebration_effect_next + 1) % CELEBRATION_EFFECT_COUNT);
+    animation_play(ANIM_CELEBRATION, millis());
 }
 
 /**
@@ -829,12 +1012,21 @@ void animation_start_celebration(void) {
  * Sets up state for parallel descending tones + LED flash.
  */
 void animation_start_game_over(void) {
-    anim_state = ANIM_GAME_OVER;    // Set animation type
-    anim_step = 0;                  // Start at first note
-    flash_count = 0;                // No flashes yet
-    flash_state = false;            // Start with LEDs off
-    anim_last_update = millis();    // Record start time (buzzer)
-    led_last_update = millis();     // Record start time (LEDs)
+    animation_play(ANIM_GAME_OVER, millis());
+}
+
+/**
+ * animation_start_showcase - Play the next attract effect on the LEDs
+ *
+ * Called from game.cpp's attract mode every ATTRACT_SHOW_PERIOD_MS. The
+ * first frame shows at once, replacing the chase LED.
+ */
+void animation_start_showcase(void) {
+    uint32_t now = millis();
+    effect_start(&led_effect, &attract_effects[attract_effect_next], (uint16_t)now);
+    attract_effect_next = (uint8_t)((attract_effect_next + 1) % ATTRACT_EFFECT_COUNT);
+    animation_play(ANIM_SHOWCASE, now);
+    script_resume(&led_track, showcase_leds, now);  // Up to its first wait
 }
 
 /**
@@ -850,10 +1042,63 @@ bool animation_is_playing(void) {
     return anim_state != ANIM_IDLE;
 }
 
+/**
+ * animation_stop - Abandon the current animation
+ *
+ * On the board, RAM is zeroed at reset so anim_state is already ANIM_IDLE.
+ * The host simulator re-runs setup() in the same process many times, so
+ * hardware_init() calls this to get the same clean start.
+ */
+void animation_stop(void) {
+    anim_state = ANIM_IDLE;
+    script_stop(&buzzer_track);
+    script_stop(&led_track);
+}
+
+/**
+ * animation_rewind_playlists - Next celebration/showcase plays the first effect
+ *
+ * Zeroed RAM does this on the board; hardware_init() calls it for the
+ * host simulator's resets (libchaser starts its lanes the same way).
+ */
+static void animation_rewind_playlists(void) {
+    celebration_effect_next = 0;
+    attract_effect_next = 0;
+}
+
+/**
+ * track_ms_until_due - Time until animation_update() resumes @track's script
+ */
+static uint32_t track_ms_until_due(const ScriptTrack *track, ScriptFn fn) {
+    if (fn == NULL || script_ended(track)) {
+        return NO_PENDING_EVENT;
+    }
+    return millis_until_elapsed(track->since, track->wait);
+}
+
+/**
+ * animation_ms_until_next_event - How long animation_update() will do nothing
+ * @return: ms from now until the next note or LED step is due (0 = due now),
+ *          NO_PENDING_EVENT when idle
+ *
+ * Each track is next due when its script's current wait runs out, so this
+ * is the earlier of the two. loop() sleeps until then (via
+ * game_ms_until_next_event()), and the host simulator jumps over the idle
+ * milliseconds.
+ */
+uint32_t animation_ms_until_next_event(void) {
+    if (anim_state == ANIM_IDLE) {
+        return NO_PENDING_EVENT;
+    }
+    uint32_t note = track_ms_until_due(&buzzer_track, animation_scripts[anim_state].buzzer);
+    uint32_t leds = track_ms_until_due(&led_track, animation_scripts[anim_state].leds);
+    return note < leds ? note : leds;
+}
+
 /******************************************************************************
  * SECTION 3: LCD DISPLAY - I2C Character Display
  *
- * HARDWARE: 16×2 character LCD with I2C backpack
+ * HARDWARE: 16×2 character LCD with I2C backpack (20×4 with -DLCD_20X4)
  *
  * I2C (Inter-Integrated Circuit) Protocol:
  * - 2-wire serial protocol (SDA = data, SCL = clock)
@@ -899,25 +1144,244 @@ bool animation_is_playing(void) {
  *   Row 1:  [HiScore: 100   ]
  *
  * lcd.setCursor(column, row) positions cursor before print
+ *
+ * SPECTATOR PANEL:
+ * A second LCD on the other backpack address (0x27 + 0x3F) shows the same
+ * screen, for the crowd behind the player. Both are driven from one shadow
+ * frame, below.
+ ******************************************************************************/
+
+/******************************************************************************
+ * SHADOW FRAME AND PANELS
+ *
+ * frame[][] is what the screen should show; each panel's shown[][] is what
+ * that LCD is showing now. The display_show_*() functions below only draw
+ * into frame[][] (display_draw(): a layout table from layout.h, rendered
+ * whole), then display_flush() sends the differences.
+ *
+ * WHY NOT JUST WRITE BOTH LCDs?
+ * The backpack needs ~1 ms per character, so a full screen is ~35 ms of
+ * bus time per LCD. Printing to both in turn would stall loop() for ~70 ms
+ * on every screen change, and leave the spectator panel a whole screen
+ * behind the main one. Instead:
+ *
+ *   - Unchanged characters are not sent (a score update is one or two
+ *     characters, where printing the row again sent 26)
+ *   - setCursor() is only sent when the next change isn't where the LCD's
+ *     cursor already is (it moves right by itself after each character)
+ *   - The panels take turns, one character each, so they finish together
+ *   - One loop() spends at most DISPLAY_FLUSH_BUDGET_US on the bus (plus
+ *     the character each panel was sending); display_service() continues
+ *     on the next loop()
+ *
+ * lcd->clear() is never sent: clearing the frame turns it to spaces, and
+ * only the cells that had text get a space. The old screen is overwritten
+ * in place instead of going blank first.
  ******************************************************************************/
 
+#ifdef BOARD_HAS_I2C
+static_assert(LCD_PANELS == 2, "One panel per backpack address (LCD_ADDRESS, LCD_ALT_ADDRESS)");
+static_assert(LCD_ROWS * LCD_COLS < 0xFF, "Cell numbers must fit a byte (0xFF = cursor unknown)");
+
+static const uint8_t LCD_CELLS = LCD_ROWS * LCD_COLS;
+static const uint8_t CURSOR_UNKNOWN = 0xFF;
+
+typedef struct {
+    LiquidCrystal_I2C *lcd;
+    char shown[LCD_ROWS][LCD_COLS];   // What this LCD is showing
+    uint8_t cursor;                   // Cell (row × LCD_COLS + col) its cursor is on
+    bool dirty;                       // shown[][] may differ from frame[][]
+    uint32_t changed_at;              // timebase_micros() of the oldest unsent change
+} LcdPanel;
+
+static char frame[LCD_ROWS][LCD_COLS];
+static LcdPanel panels[LCD_PANELS];
+static uint8_t panel_count = 1;
+static DisplayStats display_stats;
+
+/**
+ * frame_set - Draw one character into the frame
+ *
+ * A real change makes every panel dirty; the first one since a panel was
+ * last up to date starts its lag clock.
+ */
+static void frame_set(uint8_t row, uint8_t col, char c) {
+    if (frame[row][col] == c) {
+        return;
+    }
+    frame[row][col] = c;
+    for (uint8_t i = 0; i < panel_count; i++) {
+        if (!panels[i].dirty) {
+            panels[i].dirty = true;
+            panels[i].changed_at = timebase_micros();
+        }
+    }
+}
+
+/**
+ * display_begin - Start the LCD(s) with a blank frame (from hardware_init())
+ *
+ * Panel 0 is always the main LCD, even when the self-test found none: the
+ * writes then go unanswered, as they always have. Panel 1 is the spectator
+ * LCD, if the self-test found one on the other backpack address.
+ */
+static void display_begin(void) {
+    memset(frame, ' ', sizeof(frame));
+    memset(&display_stats, 0, sizeof(display_stats));
+    panels[0].lcd = lcd;
+    panels[1].lcd = spectator;
+    panel_count = (spectator != NULL) ? 2 : 1;
+
+    for (uint8_t i = 0; i < panel_count; i++) {
+        LcdPanel *panel = &panels[i];
+        panel->lcd->init();       // Initialise LCD controller, establish I2C communication
+        panel->lcd->backlight();  // Turn on backlight LED (makes display visible)
+        panel->lcd->clear();      // Blank screen, cursor home: matches shown[][]
+        memset(panel->shown, ' ', sizeof(panel->shown));
+        panel->cursor = 0;
+        panel->dirty = false;
+        panel->changed_at = 0;
+    }
+}
+
+/**
+ * panel_write_next - Send @panel its next out-of-date character
+ * @return: true if a character was sent, false if the panel is up to date
+ *
+ * Searches from the panel's cursor onwards (wrapping), so a run of changes
+ * goes out as one setCursor() and then characters. The HD44780 moves the
+ * cursor right after each character but not down to the next row: past the
+ * end of a row the cursor is unknown, and the next character needs a
+ * setCursor().
+ */
+static bool panel_write_next(LcdPanel *panel) {
+    if (!panel->dirty) {
+        return false;
+    }
+    uint8_t start = (panel->cursor == CURSOR_UNKNOWN) ? 0 : panel->cursor;
+    for (uint8_t i = 0; i < LCD_CELLS; i++) {
+        uint8_t cell = (uint8_t)((start + i) % LCD_CELLS);
+        uint8_t row = cell / LCD_COLS;
+        uint8_t col = cell % LCD_COLS;
+        char c = frame[row][col];
+        if (panel->shown[row][col] == c) {
+            continue;
+        }
+        if (cell != panel->cursor) {
+            panel->lcd->setCursor(col, row);
+            display_stats.cursor_moves++;
+        }
+        panel->lcd->write((uint8_t)c);   // ArbitratedLcd: expander input first
+        panel->shown[row][col] = c;
+        panel->cursor = (col + 1 < LCD_COLS) ? (uint8_t)(cell + 1) : CURSOR_UNKNOWN;
+        display_stats.chars++;
+        return true;
+    }
+
+    panel->dirty = false;
+    uint32_t lag = timebase_micros() - panel->changed_at;
+    uint8_t index = (uint8_t)(panel - panels);
+    if (lag > display_stats.lag_max_us[index]) {
+        display_stats.lag_max_us[index] = lag;
+    }
+    return false;
+}
+
+/**
+ * display_flush - Send frame changes to all panels, within the loop() budget
+ *
+ * One character per panel per pass, main panel first, until everything is
+ * sent or DISPLAY_FLUSH_BUDGET_US is used up. A panel that is up to date
+ * drops out of the pass, so the other gets the whole budget.
+ */
+static void display_flush(void) {
+    uint32_t start = timebase_micros();
+    bool sent_any = false;
+    bool sent;
+    do {
+        sent = false;
+        for (uint8_t i = 0; i < panel_count; i++) {
+            if (panel_write_next(&panels[i])) {
+                sent = true;
+            }
+        }
+        sent_any = sent_any || sent;
+    } while (sent && timebase_micros() - start < DISPLAY_FLUSH_BUDGET_US);
+
+    if (sent_any) {
+        uint32_t elapsed = timebase_micros() - start;
+        display_stats.flushes++;
+        display_stats.flush_total_us += elapsed;
+        if (elapsed > display_stats.flush_max_us) {
+            display_stats.flush_max_us = elapsed;
+        }
+    }
+}
+
+/**
+ * display_pending - Is any panel behind the frame?
+ */
+bool display_pending(void) {
+    for (uint8_t i = 0; i < panel_count; i++) {
+        if (panels[i].dirty) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * display_service - Continue sending the frame (called every game_update())
+ *
+ * Traced only when there is something to send, so an idle loop() adds no
+ * records.
+ */
+void display_service(void) {
+    if (!display_pending()) {
+        return;
+    }
+    TRACE_BEGIN(TRACE_DISPLAY, TRACE_DISPLAY_FLUSH);
+    display_flush();
+    TRACE_END(TRACE_DISPLAY, TRACE_DISPLAY_FLUSH);
+}
+
+const DisplayStats *display_get_stats(void) {
+    display_stats.panels = panel_count;
+    return &display_stats;
+}
+
+/**
+ * display_draw - Make the frame show screen @id with @values, and flush
+ *
+ * layout_render() writes every cell, so the frame holds exactly the new
+ * screen; frame_set() ignores the cells that already match, and only the
+ * rest go to the panels.
+ */
+static void display_draw(ScreenId id, const LayoutValues *values) {
+    char screen[LCD_ROWS][LCD_COLS];
+    layout_render(id, values, screen);
+    for (uint8_t r = 0; r < LCD_ROWS; r++) {
+        for (uint8_t c = 0; c < LCD_COLS; c++) {
+            frame_set(r, c, screen[r][c]);
+        }
+    }
+    display_flush();
+}
+
 /**
  * display_show_attract - Show attract mode screen
  * @param high_score: Current high score to display
  *
- * Screen layout:
- *   ┌────────────────┐
- *   │Press to Play!  │
- *   │HiScore: 100    │
- *   └────────────────┘
+ * Layout: attract_fields (layout.h). The prompt is "Press to Play!", or on
+ * a coin-op build "Insert Coin" / "Credits: N".
  */
 void display_show_attract(uint16_t high_score) {
-    lcd.clear();              // Clear entire display (removes old content)
-    lcd.setCursor(0, 0);      // Position: column 0, row 0 (top-left)
-    lcd.print("Press to Play!");
-    lcd.setCursor(0, 1);      // Position: column 0, row 1 (bottom-left)
-    lcd.print("HiScore: ");
-    lcd.print(high_score);    // Print number (right-justified by default)
+    TRACE_BEGIN(TRACE_DISPLAY, TRACE_DISPLAY_ATTRACT);
+    LayoutValues values = {};
+    values.high_score = high_score;
+    values.credits = credit_count();
+    display_draw(SCREEN_ATTRACT, &values);
+    TRACE_END(TRACE_DISPLAY, TRACE_DISPLAY_ATTRACT);
 }
 
 /**
@@ -925,80 +1389,225 @@ void display_show_attract(uint16_t high_score) {
  * @param score: Current game score
  * @param high_score: High score
  *
- * Screen layout:
- *   ┌────────────────┐
- *   │Score:   45     │
- *   │HiScore: 100    │
- *   └────────────────┘
+ * Layout: game_fields (layout.h).
  *
  * FLICKER REDUCTION TECHNIQUE:
  *
- * We DON'T call lcd.clear() here. Instead, we overwrite just the numbers.
- * This prevents screen flicker during gameplay.
+ * The LCD is never cleared. Clearing blanks the whole screen for ~3 ms
+ * before the text comes back, a visible flicker on every update. Instead
+ * the new screen is drawn over the old one, and only the characters that
+ * differ are sent: a score update is usually one or two digits.
  *
- * Without technique (flickers):
- *   lcd.clear();           // Entire screen goes blank for ~3ms
- *   lcd.print("Score:");   // Text reappears
- *   lcd.print(score);
- *   // Visible flicker every update!
- *
- * With technique (smooth):
- *   lcd.setCursor(8, 0);   // Jump to number position
- *   lcd.print(score);      // Overwrite just the number
- *   lcd.print("    ");     // Clear trailing digits (e.g., 100 → 99)
- *   // No flicker, smooth update
- *
- * Trailing spaces: If score decreases (100 → 99), old digit remains unless
- * we overwrite with spaces. lcd.print("    ") clears 4 character positions.
+ * A number that gets shorter (100 → 99) can't leave its old last digit
+ * behind: the field owns all its cells and pads the rest with spaces.
  */
 void display_show_game(uint16_t score, uint16_t high_score) {
-    // Update score (row 0)
-    lcd.setCursor(0, 0);
-    lcd.print("Score:   ");   // Label + spacing
-    lcd.print(score);
-    lcd.print("    ");        // Clear trailing digits (in case score decreased)
-
-    // Update high score (row 1)
-    lcd.setCursor(0, 1);
-    lcd.print("HiScore: ");
-    lcd.print(high_score);
-    lcd.print("    ");        // Clear trailing digits
+    TRACE_BEGIN(TRACE_DISPLAY, TRACE_DISPLAY_GAME);
+    LayoutValues values = {};
+    values.score = score;
+    values.high_score = high_score;
+    display_draw(SCREEN_GAME, &values);
+    TRACE_END(TRACE_DISPLAY, TRACE_DISPLAY_GAME);
 }
 
 /**
  * display_show_celebration - Show new high score screen
  * @param score: New high score value
  *
- * Screen layout:
- *   ┌────────────────┐
- *   │NEW HIGH SCORE! │
- *   │Score: 150      │
- *   └────────────────┘
+ * Layout: celebration_fields (layout.h).
  */
 void display_show_celebration(uint16_t score) {
-    lcd.clear();
-    lcd.setCursor(0, 0);
-    lcd.print("NEW HIGH SCORE!");
-    lcd.setCursor(0, 1);
-    lcd.print("Score: ");
-    lcd.print(score);
+    TRACE_BEGIN(TRACE_DISPLAY, TRACE_DISPLAY_CELEBRATION);
+    LayoutValues values = {};
+    values.score = score;
+    display_draw(SCREEN_CELEBRATION, &values);
+    TRACE_END(TRACE_DISPLAY, TRACE_DISPLAY_CELEBRATION);
 }
 
 /**
- * display_clear - Clear display (blank screen)
+ * display_show_calibration - Show calibration progress
+ * @param taps: Taps measured so far (of CALIBRATION_TAPS)
  *
- * Currently unused but provided for completeness.
+ * Layout: calibration_fields (layout.h). Only the tap count changes during
+ * a run, so each tap sends a character or two.
  */
-void display_clear(void) {
-    lcd.clear();
+void display_show_calibration(uint8_t taps) {
+    TRACE_BEGIN(TRACE_DISPLAY, TRACE_DISPLAY_CALIBRATION);
+    LayoutValues values = {};
+    values.taps = taps;
+    display_draw(SCREEN_CALIBRATION, &values);
+    TRACE_END(TRACE_DISPLAY, TRACE_DISPLAY_CALIBRATION);
 }
 
-/******************************************************************************
- * SECTION 4: EEPROM PERSISTENCE - Non-Volatile Storage
+/**
+ * display_show_latency - Show calibration result
+ * @param offset_ms: Offset now in use
+ * @param saved: true if this run's measurement was stored
  *
- * ═══════════════════════════════════════════════════════════════════════════
- * EEPROM OVERVIEW
- * ═══════════════════════════════════════════════════════════════════════════
+ * Layout: latency_fields (layout.h).
+ */
+void display_show_latency(int8_t offset_ms, bool saved) {
+    TRACE_BEGIN(TRACE_DISPLAY, TRACE_DISPLAY_CALIBRATION);
+    LayoutValues values = {};
+    values.latency_ms = offset_ms;
+    values.detail = saved ? "Saved" : "Too uneven";
+    display_draw(SCREEN_LATENCY, &values);
+    TRACE_END(TRACE_DISPLAY, TRACE_DISPLAY_CALIBRATION);
+}
+
+/**
+ * put_i2c_address - Write @address as "0x27" at @out; @return the end
+ */
+static char *put_i2c_address(char *out, uint8_t address) {
+    static const char hex_digits[] = "0123456789ABCDEF";
+    *out++ = '0';
+    *out++ = 'x';
+    *out++ = hex_digits[address >> 4];
+    *out++ = hex_digits[address & 0x0F];
+    return out;
+}
+
+/**
+ * display_show_post - Show self-test results
+ *
+ * Layout: post_fields (layout.h). The detail line is the first fault found,
+ * or where the LCD(s) were found:
+ *
+ *   Self-test FAIL      Self-test OK        Self-test OK
+ *   LED 3 shorted       LCD at 0x3F         LCDs 0x27+0x3F
+ */
+void display_show_post(void) {
+    const PostResult *post = post_get_result();
+    char detail[LAYOUT_TEXT_MAX + 1];
+    const char *limit = detail + LAYOUT_TEXT_MAX;
+    char *end = detail;
+
+    TRACE_BEGIN(TRACE_DISPLAY, TRACE_DISPLAY_POST);
+    if (post->lcd_address == 0) {
+        end = layout_put_text(end, limit, "No LCD found");  // For the record (trace, host simulator)
+    } else if (post->led_faults != 0) {
+        uint8_t led = 0;
+        while (!(post->led_faults & (1 << led))) {
+            led++;  // Lowest faulty LED
+        }
+        end = layout_put_text(end, limit, "LED ");
+        end = layout_put_number(end, led);
+        end = layout_put_text(end, limit, " shorted");
+    } else if (post->buzzer == POST_FAILED) {
+        end = layout_put_text(end, limit, "Buzzer timer");
+    } else if (post->eeprom_high_score == POST_FAILED || post->eeprom_latency == POST_FAILED) {
+        end = layout_put_text(end, limit, "EEPROM corrupt");
+    } else if (post->spectator_address != 0) {
+        end = layout_put_text(end, limit, "LCDs ");
+        end = put_i2c_address(end, post->lcd_address);
+        end = layout_put_text(end, limit, "+");
+        end = put_i2c_address(end, post->spectator_address);
+    } else {
+        end = layout_put_text(end, limit, "LCD at ");
+        end = put_i2c_address(end, post->lcd_address);
+    }
+    *end = '\0';
+
+    LayoutValues values = {};
+    values.title = post_passed() ? "Self-test OK" : "Self-test FAIL";
+    values.detail = detail;
+    display_draw(SCREEN_POST, &values);
+    TRACE_END(TRACE_DISPLAY, TRACE_DISPLAY_POST);
+}
+
+/**
+ * display_show_ghost - Show the attract replay of the record
+ * @param score: The replayed game's score so far
+ *
+ * Layout: ghost_fields (layout.h). The prompt is the attract screen's, so
+ * a passer-by knows a press still starts a game.
+ */
+void display_show_ghost(uint16_t score) {
+    TRACE_BEGIN(TRACE_DISPLAY, TRACE_DISPLAY_GHOST);
+    LayoutValues values = {};
+    values.score = score;
+    values.credits = credit_count();
+    display_draw(SCREEN_GHOST, &values);
+    TRACE_END(TRACE_DISPLAY, TRACE_DISPLAY_GHOST);
+}
+
+/**
+ * display_clear - Clear display (blank screen)
+ *
+ * Currently unused but provided for completeness.
+ */
+void display_clear(void) {
+    TRACE_BEGIN(TRACE_DISPLAY, TRACE_DISPLAY_CLEAR);
+    LayoutValues values = {};
+    display_draw(SCREEN_BLANK, &values);
+    TRACE_END(TRACE_DISPLAY, TRACE_DISPLAY_CLEAR);
+}
+
+#else // No I2C bus (ATtiny85): nothing to draw on
+
+/**
+ * display_begin - No LCD to wait for: give the self-test's timed checks
+ * (LED sweep, buzzer) the time the LCD's init() gives them on the Uno
+ */
+static void display_begin(void) {
+    uint32_t start = millis();
+    while (millis() - start < POST_LED_STEP_MS * (NUM_LEDS + 1UL)) {
+        yield();
+    }
+}
+
+bool display_pending(void) {
+    return false;
+}
+
+void display_service(void) {
+}
+
+const DisplayStats *display_get_stats(void) {
+    static DisplayStats none;
+    return &none;
+}
+
+void display_show_attract(uint16_t high_score) {
+    (void)high_score;
+}
+
+void display_show_game(uint16_t score, uint16_t high_score) {
+    (void)score;
+    (void)high_score;
+}
+
+void display_show_celebration(uint16_t score) {
+    (void)score;
+}
+
+void display_show_calibration(uint8_t taps) {
+    (void)taps;
+}
+
+void display_show_latency(int8_t offset_ms, bool saved) {
+    (void)offset_ms;
+    (void)saved;
+}
+
+void display_show_post(void) {
+}
+
+void display_show_ghost(uint16_t score) {
+    (void)score;
+}
+
+void display_clear(void) {
+}
+
+#endif // BOARD_HAS_I2C
+
+/******************************************************************************
+ * SECTION 4: EEPROM PERSISTENCE - Non-Volatile Storage
+ *
+ * ═══════════════════════════════════════════════════════════════════════════
+ * EEPROM OVERVIEW
+ * ═══════════════════════════════════════════════════════════════════════════
  *
  * EEPROM = Electrically Erasable Programmable Read-Only Memory
  *
@@ -1202,11 +1811,1155 @@ void eeprom_write_high_score(uint16_t score) {
 
     // Write all 4 bytes using update() for wear levelling
     // update() only writes if value differs from current EEPROM value
+    TRACE_BEGIN(TRACE_EEPROM_WRITE, 0);
     EEPROM.update(EEPROM_HIGH_SCORE_ADDR,     low_byte);           // Address 0
     EEPROM.update(EEPROM_HIGH_SCORE_ADDR + 1, high_byte);          // Address 1
     EEPROM.update(EEPROM_HIGH_SCORE_ADDR + 2, EEPROM_MAGIC_BYTE);  // Address 2
     EEPROM.update(EEPROM_HIGH_SCORE_ADDR + 3, checksum);           // Address 3
+    TRACE_END(TRACE_EEPROM_WRITE, 0);
 
     // Total execution time: ~3.3ms per byte written (max 13.2ms if all 4 bytes change)
     // Typical time: ~0ms (no bytes changed) to ~6.6ms (score + checksum changed)
 }
+
+/**
+ * eeprom_read_latency_offset - Load calibrated button latency
+ * @return: Offset in ms (±LATENCY_OFFSET_MAX_MS), or 0 if data invalid
+ *
+ * Same two validation layers as eeprom_read_high_score(). The clamp guards
+ * against a value written by a build with a different limit.
+ */
+int8_t eeprom_read_latency_offset(void) {
+    uint8_t value = EEPROM.read(EEPROM_LATENCY_ADDR);         // Address 4
+    uint8_t magic = EEPROM.read(EEPROM_LATENCY_ADDR + 1);     // Address 5
+    uint8_t checksum = EEPROM.read(EEPROM_LATENCY_ADDR + 2);  // Address 6
+
+    if (magic != EEPROM_MAGIC_BYTE || checksum != (value ^ magic)) {
+        return 0;  // Never calibrated (or corrupted): no correction
+    }
+
+    int8_t offset = (int8_t)value;
+    if (offset > LATENCY_OFFSET_MAX_MS) {
+        offset = LATENCY_OFFSET_MAX_MS;
+    } else if (offset < -LATENCY_OFFSET_MAX_MS) {
+        offset = -LATENCY_OFFSET_MAX_MS;
+    }
+    return offset;
+}
+
+/**
+ * eeprom_write_latency_offset - Save calibrated button latency
+ * @param offset_ms: Offset in ms (already clamped by the caller)
+ */
+void eeprom_write_latency_offset(int8_t offset_ms) {
+    uint8_t value = (uint8_t)offset_ms;
+
+    TRACE_BEGIN(TRACE_EEPROM_WRITE, 1);
+    EEPROM.update(EEPROM_LATENCY_ADDR,     value);                          // Address 4
+    EEPROM.update(EEPROM_LATENCY_ADDR + 1, EEPROM_MAGIC_BYTE);              // Address 5
+    EEPROM.update(EEPROM_LATENCY_ADDR + 2, value ^ EEPROM_MAGIC_BYTE);      // Address 6
+    TRACE_END(TRACE_EEPROM_WRITE, 1);
+}
+
+/**
+ * eeprom_read_bounce_profile - Load the main button's learned bounce time
+ * @return: Bounce time in µs, or BOUNCE_DEFAULT_US if data invalid
+ *
+ * debounce_start() clamps it to BOUNCE_MIN_US..BOUNCE_MAX_US.
+ */
+uint16_t eeprom_read_bounce_profile(void) {
+    uint8_t low_byte = EEPROM.read(EEPROM_BOUNCE_ADDR);        // Address 10
+    uint8_t high_byte = EEPROM.read(EEPROM_BOUNCE_ADDR + 1);   // Address 11
+    uint8_t magic = EEPROM.read(EEPROM_BOUNCE_ADDR + 2);       // Address 12
+    uint8_t checksum = EEPROM.read(EEPROM_BOUNCE_ADDR + 3);    // Address 13
+
+    if (magic != EEPROM_MAGIC_BYTE || checksum != (low_byte ^ high_byte ^ magic)) {
+        return BOUNCE_DEFAULT_US;  // Never learned (or corrupted): assume the worst
+    }
+    return (uint16_t)(low_byte | (high_byte << 8));
+}
+
+/**
+ * eeprom_write_bounce_profile - Save the learned bounce time (from button_service())
+ */
+void eeprom_write_bounce_profile(uint16_t bounce_us) {
+    uint8_t low_byte = (uint8_t)(bounce_us & 0xFF);
+    uint8_t high_byte = (uint8_t)(bounce_us >> 8);
+
+    TRACE_BEGIN(TRACE_EEPROM_WRITE, 3);
+    EEPROM.update(EEPROM_BOUNCE_ADDR,     low_byte);                        // Address 10
+    EEPROM.update(EEPROM_BOUNCE_ADDR + 1, high_byte);                       // Address 11
+    EEPROM.update(EEPROM_BOUNCE_ADDR + 2, EEPROM_MAGIC_BYTE);               // Address 12
+    EEPROM.update(EEPROM_BOUNCE_ADDR + 3, low_byte ^ high_byte ^ EEPROM_MAGIC_BYTE);  // Address 13
+    TRACE_END(TRACE_EEPROM_WRITE, 3);
+}
+
+/**
+ * eeprom_read_rules - Load the stored game mode image (rules.h) into @image
+ * @param image: RULES_IMAGE_MAX bytes
+ * @return: Its size, or 0 if the header is not a rule image
+ *
+ * Only the header is checked here; rules_image_load() checks the rest.
+ */
+uint8_t eeprom_read_rules(uint8_t *image) {
+    for (uint8_t i = 0; i < RULES_IMAGE_HEADER; i++) {
+        image[i] = EEPROM.read(EEPROM_RULES_ADDR + i);
+    }
+    uint8_t size = rules_image_size(image, RULES_IMAGE_HEADER);
+    if (size > RULES_IMAGE_MAX) {
+        return 0;  // Never written (or corrupted): the built-in rules
+    }
+    for (uint8_t i = RULES_IMAGE_HEADER; i < size; i++) {
+        image[i] = EEPROM.read(EEPROM_RULES_ADDR + i);
+    }
+    return size;
+}
+
+/**
+ * eeprom_write_rules - Store a game mode image (already checked by the caller)
+ *
+ * Up to RULES_IMAGE_MAX bytes, ~3.3 ms each that changed: only ever between
+ * games, when an upload arrives (section 8) or from a host tool.
+ */
+void eeprom_write_rules(const uint8_t *image, uint8_t size) {
+    TRACE_BEGIN(TRACE_EEPROM_WRITE, 4);
+    for (uint8_t i = 0; i < size; i++) {
+        EEPROM.update(EEPROM_RULES_ADDR + i, image[i]);
+    }
+    TRACE_END(TRACE_EEPROM_WRITE, 4);
+}
+
+/**
+ * eeprom_read_ghost - Load the stored ghost image (ghost.h) into @image
+ * @param image: GHOST_IMAGE_MAX bytes
+ * @return: Its size, or 0 if the header is not a ghost's
+ *
+ * Only the header is checked here; ghost_image_check() checks the CRC.
+ */
+uint8_t eeprom_read_ghost(uint8_t *image) {
+    for (uint8_t i = 0; i < GHOST_HEADER_SIZE; i++) {
+        image[i] = EEPROM.read(EEPROM_GHOST_ADDR + i);
+    }
+    uint8_t size = ghost_image_size(image);
+    for (uint8_t i = GHOST_HEADER_SIZE; i < size; i++) {
+        image[i] = EEPROM.read(EEPROM_GHOST_ADDR + i);
+    }
+    return size;
+}
+
+/**
+ * eeprom_write_ghost - Store @value as byte @at of the ghost image
+ *
+ * ~3.3 ms if it changed. game.cpp calls it GHOST_SAVE_BYTES times per
+ * loop(), between games, until a new record's ghost is all written (in
+ * its own order: see ghost_save_service()).
+ */
+void eeprom_write_ghost(uint8_t at, uint8_t value) {
+    TRACE_BEGIN(TRACE_EEPROM_WRITE, 5);
+    EEPROM.update(EEPROM_GHOST_ADDR + at, value);
+    TRACE_END(TRACE_EEPROM_WRITE, 5);
+}
+
+/******************************************************************************
+ * SECTION 5: POWER-ON SELF-TEST
+ *
+ * A dead LED, a missing LCD backpack or corrupted EEPROM otherwise only
+ * shows up as strange behaviour mid-game. The self-test catches them at
+ * power-on, without making boot any slower.
+ *
+ * WHERE THE TIME COMES FROM:
+ * LiquidCrystal_I2C::init() waits for the LCD controller with delay(50) and
+ * delay(1000). The Arduino core's delay() is a busy loop that calls yield()
+ * on every pass, and yield() is a weak, empty function that a sketch may
+ * replace. We replace it with post_poll(), so the LED sweep and the buzzer
+ * check run during that second instead of after it.
+ *
+ * CHECKS:
+ *
+ * ┌──────────────┬──────────────────────────────────┬────────────────────┐
+ * │ Check        │ How                              │ When               │
+ * ├──────────────┼──────────────────────────────────┼────────────────────┤
+ * │ EEPROM       │ Magic byte + checksum of each    │ post_begin()       │
+ * │              │ record (high score, latency)     │                    │
+ * │ LED pins     │ Drive HIGH then LOW, read back   │ post_begin()       │
+ * │ LCD address  │ I2C probe: cached, 0x27, 0x3F    │ post_begin()       │
+ * │ Spectator    │ I2C probe: the other address     │ post_begin()       │
+ * │ LED sweep    │ Light each LED in turn (visual)  │ yield() in init()  │
+ * │ Buzzer timer │ tone_play() must toggle the pin  │ yield() in init()  │
+ * └──────────────┴──────────────────────────────────┴────────────────────┘
+ *
+ * PIN READBACK:
+ * digitalRead() on an OUTPUT pin returns the real pin level (the PINx
+ * register), not what we wrote. A pin shorted to GND reads LOW while driven
+ * HIGH; one shorted to 5V reads HIGH while driven LOW.
+ *
+ * BUZZER TIMER:
+ * tone_play() has Timer2 toggle the buzzer pin in hardware. If the timer is
+ * not running (misconfigured, or a wrong clock select), the pin never
+ * changes, however often we look at it.
+ ******************************************************************************/
+
+#ifdef BOARD_HAS_I2C
+static_assert(twi_bit_rate_valid(I2C_CLOCK_HZ), "I2C_CLOCK_HZ out of TWBR range at this F_CPU");
+#endif
+
+static PostResult post_result;
+static bool post_active = false;           // Timed checks running (yield() works)
+static uint32_t post_start_time = 0;
+static uint8_t post_led_step = 0;          // LED currently lit by the sweep
+static uint8_t post_buzzer_toggles = 0;    // Buzzer pin changes seen
+static bool post_buzzer_level = false;
+
+/**
+ * post_check_record - Validate one EEPROM record (data, magic, checksum)
+ * @param address: First data byte
+ * @param data_length: Data bytes before the magic byte
+ * @return: POST_OK, POST_BLANK (no magic byte) or POST_FAILED (bad checksum)
+ *
+ * Every record in EEPROM uses this layout (see config.h).
+ */
+static PostStatus post_check_record(uint16_t address, uint8_t data_length) {
+    uint8_t checksum = 0;
+    for (uint8_t i = 0; i < data_length; i++) {
+        checksum ^= EEPROM.read(address + i);
+    }
+    uint8_t magic = EEPROM.read(address + data_length);
+    if (magic != EEPROM_MAGIC_BYTE) {
+        return POST_BLANK;
+    }
+    return EEPROM.read(address + data_length + 1) == (checksum ^ magic) ? POST_OK : POST_FAILED;
+}
+
+#ifdef BOARD_HAS_I2C
+/**
+ * i2c_probe - Does a device acknowledge @address?
+ *
+ * An empty write: just the address byte. endTransmission() returns 0 on ACK.
+ */
+static bool i2c_probe(uint8_t address) {
+    Wire.beginTransmission(address);
+    return Wire.endTransmission() == 0;
+}
+
+/**
+ * post_detect_lcd - Find the LCD backpack and pick the matching lcd object
+ * @return: Address that answered, 0 if none did
+ *
+ * The cached address is tried first, so a known cabinet needs one probe.
+ */
+static uint8_t post_detect_lcd(void) {
+    uint8_t cached = 0;
+    if (post_check_record(EEPROM_LCD_ADDR_ADDR, 1) == POST_OK) {
+        cached = EEPROM.read(EEPROM_LCD_ADDR_ADDR);
+    }
+
+    uint8_t found = 0;
+    if ((cached == LCD_ADDRESS || cached == LCD_ALT_ADDRESS) && i2c_probe(cached)) {
+        found = cached;
+    } else if (i2c_probe(LCD_ADDRESS)) {
+        found = LCD_ADDRESS;
+    } else if (i2c_probe(LCD_ALT_ADDRESS)) {
+        found = LCD_ALT_ADDRESS;
+    }
+
+    lcd = (found == LCD_ALT_ADDRESS) ? &lcd_alternate : &lcd_primary;
+
+    if (found != 0 && found != cached) {
+        // Only on a backpack change, so no EEPROM wear on normal boots
+        EEPROM.update(EEPROM_LCD_ADDR_ADDR,     found);
+        EEPROM.update(EEPROM_LCD_ADDR_ADDR + 1, EEPROM_MAGIC_BYTE);
+        EEPROM.update(EEPROM_LCD_ADDR_ADDR + 2, found ^ EEPROM_MAGIC_BYTE);
+    }
+    return found;
+}
+
+/**
+ * post_detect_spectator - Look for a second LCD on the other backpack address
+ * @param main_address: Address of the main LCD (0 = none)
+ * @return: Address of the spectator LCD, 0 if there is none
+ *
+ * Only with a main LCD: a lone backpack is always the main panel.
+ */
+static uint8_t post_detect_spectator(uint8_t main_address) {
+    uint8_t other = (main_address == LCD_ALT_ADDRESS) ? LCD_ADDRESS : LCD_ALT_ADDRESS;
+    spectator = NULL;
+    if (main_address == 0 || !i2c_probe(other)) {
+        return 0;
+    }
+    spectator = (other == LCD_ALT_ADDRESS) ? &lcd_alternate : &lcd_primary;
+    return other;
+}
+#endif // BOARD_HAS_I2C
+
+/**
+ * post_begin - Instant checks, then start the timed ones
+ *
+ * Called by hardware_init() after pin setup, before lcd->init().
+ */
+static void post_begin(void) {
+    post_result.eeprom_high_score = post_check_record(EEPROM_HIGH_SCORE_ADDR, 2);
+    post_result.eeprom_latency = post_check_record(EEPROM_LATENCY_ADDR, 1);
+
+    post_result.led_faults = BoardLeds::self_test();
+
+#ifdef BOARD_HAS_I2C
+    Wire.begin();
+    Wire.setClock(I2C_CLOCK_HZ);
+    post_result.lcd_address = post_detect_lcd();
+    post_result.spectator_address = post_detect_spectator(post_result.lcd_address);
+#endif
+
+    // Timed checks: advanced by post_poll() from yield()
+    post_result.buzzer = POST_NOT_RUN;
+    post_buzzer_toggles = 0;
+    post_buzzer_level = digitalRead(BUZZER_PIN);
+    tone_play(TONE_POST);
+    post_led_step = 0;
+    led_set(0, true);
+    post_start_time = millis();
+    post_active = true;
+}
+
+/**
+ * post_poll - Advance the timed checks (called from yield())
+ *
+ * Runs thousands of times per millisecond inside delay(), so it only looks
+ * at the clock and the buzzer pin. Must never call delay() itself.
+ */
+static void post_poll(void) {
+    if (!post_active) {
+        return;
+    }
+    uint32_t elapsed = millis() - post_start_time;
+
+    // LED sweep: one LED at a time, left to right, then all off
+    uint32_t step = elapsed / POST_LED_STEP_MS;
+    if (step != post_led_step && post_led_step < NUM_LEDS) {
+        led_set(post_led_step, false);
+        post_led_step = step < NUM_LEDS ? (uint8_t)step : NUM_LEDS;
+        led_set(post_led_step, true);  // Ignored once past the last LED
+    }
+
+    // Buzzer: count pin changes while the test tone plays
+    if (elapsed < POST_BUZZER_MS) {
+        bool level = digitalRead(BUZZER_PIN);
+        if (level != post_buzzer_level && post_buzzer_toggles < 255) {
+            post_buzzer_toggles++;
+        }
+        post_buzzer_level = level;
+    }
+}
+
+/**
+ * post_finish - Stop the timed checks and record their results
+ *
+ * Called by hardware_init() once lcd->init() has returned. On the board
+ * init() always takes longer than the checks; a check that did not get its
+ * full time (host simulator) is reported as POST_NOT_RUN rather than failed.
+ */
+static void post_finish(void) {
+    uint32_t elapsed = millis() - post_start_time;
+    post_active = false;
+
+    led_clear_all();
+    tone_stop();
+
+    if (elapsed >= POST_BUZZER_MS) {
+        post_result.buzzer = post_buzzer_toggles > 0 ? POST_OK : POST_FAILED;
+    }
+}
+
+/**
+ * yield - Arduino core hook, called by delay() while it waits
+ *
+ * Replaces the core's empty default (a weak symbol). Only does anything while
+ * the self-test is active, i.e. during lcd->init() in hardware_init().
+ */
+void yield(void) {
+    post_poll();
+}
+
+/**
+ * post_get_result - Self-test results
+ */
+const PostResult *post_get_result(void) {
+    return &post_result;
+}
+
+/**
+ * post_passed - Did every check pass (blank EEPROM and unrun checks are fine)?
+ *
+ * A board without an I2C bus has no LCD to find.
+ */
+bool post_passed(void) {
+#ifdef BOARD_HAS_I2C
+    if (post_result.lcd_address == 0) {
+        return false;
+    }
+#endif
+    return post_result.led_faults == 0 &&
+           post_result.buzzer != POST_FAILED &&
+           post_result.eeprom_high_score != POST_FAILED &&
+           post_result.eeprom_latency != POST_FAILED;
+}
+
+/******************************************************************************
+ * SECTION 6: INPUT EXPANDER - MCP23017 on the Shared I2C Bus
+ *
+ * REGISTERS USED (IOCON.BANK = 0, the power-on layout):
+ * ┌──────────┬──────┬──────────────────────────────────────────────────────┐
+ * │ Register │ Addr │ Use                                                  │
+ * ├──────────┼──────┼──────────────────────────────────────────────────────┤
+ * │ GPINTENA │ 0x04 │ Interrupt on change, A then B (all 16 inputs)        │
+ * │ IOCON    │ 0x0A │ MIRROR: INTA fires for either port                   │
+ * │ GPPUA    │ 0x0C │ Pull-ups, A then B (switches to GND, like the button)│
+ * │ INTCAPA  │ 0x10 │ Port levels latched at the interrupt; reading clears │
+ * │ GPIOA    │ 0x12 │ Port levels now                                      │
+ * └──────────┴──────┴──────────────────────────────────────────────────────┘
+ *
+ * Reads auto-increment (IOCON.SEQOP = 0), so INTCAPA, INTCAPB, GPIOA, GPIOB
+ * come back in one 4-byte transfer.
+ *
+ * TWO TIMESTAMPS PER READ:
+ * INTCAP holds the levels at the moment INTA fired, so edges found there
+ * get the interrupt's timestamp. While INTA is asserted the chip latches
+ * nothing new; a pin that changed again before the read only shows up in
+ * GPIO, and gets the read's own timestamp.
+ *
+ * PRESS QUEUE:
+ * Player button presses go into a small queue of edge times, which
+ * button_just_pressed() takes from. Debouncing happens on the way in, on
+ * edge times: a press within DEBOUNCE_MS of the last accepted one is a
+ * bounce. Operator switches are levels, kept in expander_levels.
+ *
+ * A press is offered to ONE state update, like a tap on the GPIO button is
+ * only seen by the state that reads it. If that state doesn't read the
+ * button (RESULT, CELEBRATION), the press is dropped at the top of the next
+ * game_update() rather than starting something a state later. Presses read
+ * between LCD characters haven't been offered yet, so they survive it.
+ ******************************************************************************/
+
+#ifdef BOARD_HAS_I2C
+static const uint8_t MCP_GPINTENA = 0x04;
+static const uint8_t MCP_IOCON = 0x0A;
+static const uint8_t MCP_GPPUA = 0x0C;
+static const uint8_t MCP_INTCAPA = 0x10;
+static const uint8_t MCP_IOCON_MIRROR = 0x40;
+
+static const uint16_t EXPANDER_PLAYER_MASK = 0x00FF;  // GPA0-GPA7
+static const uint8_t EXPANDER_QUEUE_SIZE = 4;
+
+static bool expander_found = false;
+static uint16_t expander_levels = 0;       // 1 = closed; bit n = GPAn, bit 8 + n = GPBn
+static uint32_t expander_queue[EXPANDER_QUEUE_SIZE];  // Edge times (µs) of presses
+static uint8_t expander_queue_head = 0;
+static uint8_t expander_queue_count = 0;
+static uint8_t expander_queue_unoffered = 0;  // Newest entries no update has seen
+static bool expander_pressed_before = false;
+static uint32_t expander_last_press_us = 0;
+static ExpanderLatency expander_latency;
+
+/**
+ * expander_write - Write @count registers starting at @reg (one transfer)
+ */
+static bool expander_write(uint8_t reg, const uint8_t *data, uint8_t count) {
+    Wire.beginTransmission(EXPANDER_ADDRESS);
+    Wire.write(reg);
+    for (uint8_t i = 0; i < count; i++) {
+        Wire.write(data[i]);
+    }
+    return Wire.endTransmission() == 0;
+}
+
+/**
+ * expander_read - Read @count registers starting at @reg
+ *
+ * Register pointer write, repeated start, then the burst.
+ */
+static bool expander_read(uint8_t reg, uint8_t *data, uint8_t count) {
+    Wire.beginTransmission(EXPANDER_ADDRESS);
+    Wire.write(reg);
+    if (Wire.endTransmission(false) != 0) {
+        return false;
+    }
+    if (Wire.requestFrom(EXPANDER_ADDRESS, count) != count) {
+        return false;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        data[i] = (uint8_t)Wire.read();
+    }
+    return true;
+}
+
+/**
+ * expander_levels_from - Two port bytes (active-low) to a "1 = closed" mask
+ */
+static uint16_t expander_levels_from(uint8_t port_a, uint8_t port_b) {
+    return (uint16_t)~(port_a | (port_b << 8));
+}
+
+/**
+ * expander_begin - Find and configure the expander (from hardware_init())
+ */
+static void expander_begin(void) {
+    pinMode(EXPANDER_INT_PIN, INPUT_PULLUP);  // Idle high with no expander fitted
+    expander_found = i2c_probe(EXPANDER_ADDRESS);
+    if (!expander_found) {
+        return;
+    }
+
+    // All pins are inputs after power-on; add pull-ups and interrupts.
+    // INTCON stays 0: interrupt on any change from the previous level.
+    static const uint8_t iocon = MCP_IOCON_MIRROR;
+    static const uint8_t both_ports[2] = {0xFF, 0xFF};
+    expander_write(MCP_IOCON, &iocon, 1);
+    expander_write(MCP_GPPUA, both_ports, 2);
+    expander_write(MCP_GPINTENA, both_ports, 2);
+
+    // Starting levels; the read also clears anything latched so far
+    uint8_t regs[4];
+    expander_found = expander_read(MCP_INTCAPA, regs, 4);
+    expander_levels = expander_levels_from(regs[2], regs[3]);
+}
+
+/**
+ * expander_edges - Compare new levels with the last known ones
+ * @param levels: Port levels ("1 = closed") seen at @time_us
+ *
+ * Player button presses are debounced and queued; everything else just
+ * updates expander_levels.
+ */
+static void expander_edges(uint16_t levels, uint32_t time_us) {
+    uint16_t pressed = levels & (uint16_t)~expander_levels & EXPANDER_PLAYER_MASK;
+    expander_levels = levels;
+    if (pressed == 0) {
+        return;
+    }
+    if (expander_pressed_before && time_us - expander_last_press_us < DEBOUNCE_MS * 1000UL) {
+        return;  // Bounce (or two buttons within the debounce time: one press)
+    }
+    expander_pressed_before = true;
+    expander_last_press_us = time_us;
+    if (expander_queue_count < EXPANDER_QUEUE_SIZE) {
+        uint8_t tail = (expander_queue_head + expander_queue_count) % EXPANDER_QUEUE_SIZE;
+        expander_queue[tail] = time_us;
+        expander_queue_count++;
+        expander_queue_unoffered++;
+    }
+}
+
+/**
+ * expander_read_changes - One burst read if INTA is asserted, else nothing
+ *
+ * Reading INTCAP releases INTA. A read that fails (expander unplugged)
+ * disables the expander rather than retrying on every loop().
+ */
+static void expander_read_changes(void) {
+    if (!expander_found || digitalRead(EXPANDER_INT_PIN) == HIGH) {
+        return;
+    }
+    uint32_t edge_us = timebase_pin_change_us();  // Before the read re-raises INTA
+
+    TRACE_BEGIN(TRACE_EXPANDER_READ, 0);
+    uint8_t regs[4];  // INTCAPA, INTCAPB, GPIOA, GPIOB
+    bool ok = expander_read(MCP_INTCAPA, regs, 4);
+    TRACE_END(TRACE_EXPANDER_READ, 0);
+    if (!ok) {
+        expander_found = false;
+        return;
+    }
+    uint32_t read_us = timebase_micros();
+
+    expander_edges(expander_levels_from(regs[0], regs[1]), edge_us);
+    expander_edges(expander_levels_from(regs[2], regs[3]), read_us);
+
+    uint32_t latency = read_us - edge_us;
+    expander_latency.reads++;
+    expander_latency.read_last_us = latency;
+    expander_latency.read_total_us += latency;
+    if (latency > expander_latency.read_max_us) {
+        expander_latency.read_max_us = latency;
+    }
+}
+
+/**
+ * expander_service - Once per game_update(), before the state update
+ *
+ * Drops presses the previous state update saw and didn't take, then reads.
+ */
+void expander_service(void) {
+    while (expander_queue_count > expander_queue_unoffered) {
+        expander_queue_head = (expander_queue_head + 1) % EXPANDER_QUEUE_SIZE;
+        expander_queue_count--;
+    }
+    expander_read_changes();
+    expander_queue_unoffered = 0;
+}
+
+/**
+ * expander_take_press - Hand the oldest queued press to button_just_pressed()
+ * @return: true if there was one
+ */
+static bool expander_take_press(void) {
+    if (expander_queue_count == 0) {
+        return false;
+    }
+    uint32_t edge_us = expander_queue[expander_queue_head];
+    expander_queue_head = (expander_queue_head + 1) % EXPANDER_QUEUE_SIZE;
+    expander_queue_count--;
+    if (expander_queue_unoffered > expander_queue_count) {
+        expander_queue_unoffered = expander_queue_count;
+    }
+
+    uint32_t latency = timebase_micros() - edge_us;
+    expander_latency.presses++;
+    expander_latency.press_last_us = latency;
+    expander_latency.press_total_us += latency;
+    if (latency > expander_latency.press_max_us) {
+        expander_latency.press_max_us = latency;
+    }
+    return true;
+}
+
+static void expander_flush_presses(void) {
+    expander_queue_count = 0;
+    expander_queue_unoffered = 0;
+}
+
+static bool expander_presses_queued(void) {
+    return expander_queue_count > 0;
+}
+
+bool expander_present(void) {
+    return expander_found;
+}
+
+bool expander_input_pending(void) {
+    return expander_found && digitalRead(EXPANDER_INT_PIN) == LOW;
+}
+
+bool expander_switch_is_on(uint8_t n) {
+    return n < 8 && (expander_levels >> (8 + n)) & 1;
+}
+
+const ExpanderLatency *expander_get_latency(void) {
+    return &expander_latency;
+}
+
+#else // No I2C bus (ATtiny85): no expander, the one button is the GPIO pin
+
+static void expander_begin(void) {
+}
+
+void expander_service(void) {
+}
+
+static bool expander_take_press(void) {
+    return false;
+}
+
+static void expander_flush_presses(void) {
+}
+
+static bool expander_presses_queued(void) {
+    return false;
+}
+
+bool expander_present(void) {
+    return false;
+}
+
+bool expander_input_pending(void) {
+    return false;
+}
+
+bool expander_switch_is_on(uint8_t n) {
+    (void)n;
+    return false;
+}
+
+const ExpanderLatency *expander_get_latency(void) {
+    static ExpanderLatency none;
+    return &none;
+}
+
+#endif // BOARD_HAS_I2C
+
+/******************************************************************************
+ * SECTION 7: CREDITS AND AUDIT LEDGER
+ *
+ * COLLECTING PULSES:
+ * coin.cpp's ISR counts pulses into a free-running 8-bit counter. Here we
+ * keep the value we saw last; the difference is the new pulses, however
+ * long loop() was away. COIN_PULSES_PER_CREDIT pulses make a credit.
+ *
+ * LEDGER RING:
+ * The ledger changes with every coin and every game, far more often than
+ * the high score. Rewriting one record in place would wear its bytes out
+ * after ~100,000 games. Instead each save goes to the next of LEDGER_SLOTS
+ * slots with a sequence number one higher:
+ *
+ *   slot:  0     1     2     3     4     5     6     7
+ *   seq:   17    18    19    20    13    14    15    16
+ *                            └ newest     └ next save goes to slot 4
+ *
+ * At boot the valid slot with the highest sequence wins (compared as a
+ * signed 8-bit difference, so 255 -> 0 still counts up). If power fails in
+ * the middle of a save, that slot's checksum is wrong and the previous one
+ * is used: at most one settle period of coins is lost, never the totals.
+ ******************************************************************************/
+
+static const uint8_t LEDGER_DATA_BYTES = LEDGER_SLOT_SIZE - 2;  // Before magic + checksum
+
+static CreditLedger ledger;
+static uint8_t ledger_slot = LEDGER_SLOTS - 1;  // Newest save (next goes to slot 0)
+static uint8_t ledger_seq = 0;
+static bool ledger_dirty = false;
+static uint32_t ledger_changed_at = 0;          // millis() of the last change
+static uint8_t coin_pulses_seen = 0;
+static uint8_t coin_rejects_seen = 0;
+static uint8_t coin_pulses_toward_credit = 0;
+
+static uint16_t ledger_slot_address(uint8_t slot) {
+    return EEPROM_LEDGER_ADDR + (uint16_t)slot * LEDGER_SLOT_SIZE;
+}
+
+static uint32_t ledger_read_u32(uint16_t address) {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        value |= (uint32_t)EEPROM.read(address + i) << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * ledger_load - Restore the newest valid slot (from hardware_init())
+ *
+ * A blank ledger (new board) starts from zero.
+ */
+static void ledger_load(void) {
+    bool found = false;
+    for (uint8_t slot = 0; slot < LEDGER_SLOTS; slot++) {
+        uint16_t address = ledger_slot_address(slot);
+        if (post_check_record(address, LEDGER_DATA_BYTES) != POST_OK) {
+            continue;
+        }
+        uint8_t seq = EEPROM.read(address);
+        if (!found || (int8_t)(seq - ledger_seq) > 0) {
+            found = true;
+            ledger_slot = slot;
+            ledger_seq = seq;
+        }
+    }
+
+    memset(&ledger, 0, sizeof(ledger));
+    if (found) {
+        uint16_t address = ledger_slot_address(ledger_slot);
+        ledger.coins = ledger_read_u32(address + 1);
+        ledger.games = ledger_read_u32(address + 5);
+        ledger.credits = FREE_PLAY ? 0 : EEPROM.read(address + 9);
+    }
+    ledger_dirty = false;
+    coin_pulses_seen = coin_pulses();
+    coin_rejects_seen = coin_rejects();
+    coin_pulses_toward_credit = 0;
+}
+
+/**
+ * ledger_save - Write the totals to the slot after the newest one
+ */
+static void ledger_save(void) {
+    uint8_t slot = (ledger_slot + 1) % LEDGER_SLOTS;
+    uint8_t data[LEDGER_DATA_BYTES];
+    data[0] = (uint8_t)(ledger_seq + 1);
+    for (uint8_t i = 0; i < 4; i++) {
+        data[1 + i] = (uint8_t)(ledger.coins >> (8 * i));
+        data[5 + i] = (uint8_t)(ledger.games >> (8 * i));
+    }
+    data[9] = ledger.credits;
+
+    uint16_t address = ledger_slot_address(slot);
+    uint8_t checksum = EEPROM_MAGIC_BYTE;
+    TRACE_BEGIN(TRACE_EEPROM_WRITE, 2);
+    for (uint8_t i = 0; i < LEDGER_DATA_BYTES; i++) {
+        EEPROM.update(address + i, data[i]);
+        checksum ^= data[i];
+    }
+    EEPROM.update(address + LEDGER_DATA_BYTES, EEPROM_MAGIC_BYTE);
+    EEPROM.update(address + LEDGER_DATA_BYTES + 1, checksum);
+    TRACE_END(TRACE_EEPROM_WRITE, 2);
+
+    ledger_slot = slot;
+    ledger_seq = data[0];
+    ledger_dirty = false;
+    ledger.saves++;
+}
+
+static void ledger_changed(void) {
+    ledger_dirty = true;
+    ledger_changed_at = millis();
+}
+
+void credit_service(bool save_ok) {
+    uint8_t pulses = coin_pulses();
+    uint8_t new_pulses = pulses - coin_pulses_seen;  // 8-bit: wraps like the counter
+    coin_pulses_seen = pulses;
+
+    uint8_t rejects = coin_rejects();
+    ledger.rejects += (uint8_t)(rejects - coin_rejects_seen);
+    coin_rejects_seen = rejects;
+
+    if (new_pulses > 0) {
+        ledger.coins += new_pulses;
+        if (!FREE_PLAY) {
+            coin_pulses_toward_credit += new_pulses;
+            while (coin_pulses_toward_credit >= COIN_PULSES_PER_CREDIT) {
+                coin_pulses_toward_credit -= COIN_PULSES_PER_CREDIT;
+                if (ledger.credits < COIN_MAX_CREDITS) {
+                    ledger.credits++;
+                }
+            }
+        }
+        ledger_changed();
+    }
+
+    if (save_ok && ledger_dirty && millis() - ledger_changed_at >= COIN_LEDGER_SETTLE_MS) {
+        ledger_save();
+    }
+}
+
+uint8_t credit_count(void) {
+    return ledger.credits;
+}
+
+bool credit_take(void) {
+    if (FREE_PLAY) {
+        ledger.games++;
+        ledger_changed();  // Saved with the next quiet spell in ATTRACT
+        return true;
+    }
+    if (ledger.credits == 0) {
+        return false;
+    }
+    ledger.credits--;
+    ledger.games++;
+    ledger_save();  // Now, so pulling the plug mid-game refunds nothing
+    return true;
+}
+
+uint32_t credit_ms_until_next_event(bool save_ok) {
+    if (coin_pulses() != coin_pulses_seen || coin_rejects() != coin_rejects_seen) {
+        return 0;
+    }
+    if (save_ok && ledger_dirty) {
+        return millis_until_elapsed(ledger_changed_at, COIN_LEDGER_SETTLE_MS);
+    }
+    return NO_PENDING_EVENT;
+}
+
+const CreditLedger *credit_get_ledger(void) {
+    return &ledger;
+}
+
+/******************************************************************************
+ * SECTION 8: GAME MODE UPLOAD (RULES_UPLOAD builds)
+ *
+ * An operator sends a rule image (rules.h) down the USB serial port, e.g.
+ * the one sim/tools/rules_check.cpp writes:
+ *
+ *   rules-check --image lucky > lucky.bin
+ *   stty -F /dev/ttyACM0 9600 raw && cat lucky.bin > /dev/ttyACM0
+ *
+ * Bytes are collected in every state: the core's receive buffer holds only
+ * 64, so game_ms_until_next_event() wakes loop() every RULES_UPLOAD_POLL_MS
+ * to empty it. The image's first byte is EEPROM_MAGIC_BYTE: anything before
+ * one is skipped, and a half-sent image is dropped after
+ * RULES_UPLOAD_TIMEOUT_MS of silence. A complete image gets the same
+ * rules_image_load() check as one read from EEPROM. One that passes waits
+ * (and the port is left unread) until game.cpp says the game is between
+ * games, then it is stored and game.cpp loads it: a mode never changes
+ * mid-game. Either way the port answers with one line:
+ *
+ *   RULES OK 76 156 0       worst-case cycles of RULE_MOVE, SCORE, SPEED
+ *   RULES ERR 7 1 0         RulesError, then the part and instruction
+ ******************************************************************************/
+
+#ifdef RULES_UPLOAD
+
+static uint8_t upload_image[RULES_IMAGE_MAX];
+static uint8_t upload_count = 0;
+static uint8_t upload_ready = 0;        // Size of a checked image waiting to be stored
+static RulesReport upload_report;
+static uint32_t upload_last_ms = 0;
+
+static void upload_reply(uint8_t error, const RulesReport *report) {
+    if (error == RULES_OK) {
+        Serial.print(F("RULES OK"));
+        for (uint8_t h = 0; h < RULE_HOOK_COUNT; h++) {
+            Serial.print(' ');
+            Serial.print(report->cycles[h]);
+        }
+    } else {
+        Serial.print(F("RULES ERR "));
+        Serial.print(error);
+        Serial.print(' ');
+        Serial.print(report->hook);
+        Serial.print(' ');
+        Serial.print(report->step);
+    }
+    Serial.println();
+}
+
+bool rules_upload_service(bool save_ok) {
+    if (upload_ready != 0) {
+        if (!save_ok) {
+            return false;  // Mid-game: hold it (and the bytes behind it)
+        }
+        eeprom_write_rules(upload_image, upload_ready);
+        upload_ready = 0;
+        upload_reply(RULES_OK, &upload_report);
+        return true;
+    }
+
+    uint32_t now = millis();
+    if (upload_count > 0 && now - upload_last_ms >= RULES_UPLOAD_TIMEOUT_MS) {
+        upload_count = 0;  // The rest never came
+    }
+
+    while (upload_ready == 0 && Serial.available() > 0) {
+        uint8_t byte = (uint8_t)Serial.read();
+        upload_last_ms = now;
+        if (upload_count == 0 && byte != EEPROM_MAGIC_BYTE) {
+            continue;  // Not the start of an image
+        }
+        upload_image[upload_count++] = byte;
+
+        uint8_t size = rules_image_size(upload_image, upload_count);
+        if (size > RULES_IMAGE_MAX) {
+            upload_count = 0;
+            upload_report.hook = 0;
+            upload_report.step = 0;
+            upload_reply(RULES_BAD_IMAGE, &upload_report);
+        } else if (size != 0 && upload_count == size) {
+            upload_count = 0;
+            RuleSet set;
+            uint8_t error = rules_image_load(upload_image, size, &set, &upload_report);
+            if (error == RULES_OK) {
+                upload_ready = size;  // Stored on a later call, between games
+            } else {
+                upload_reply(error, &upload_report);
+            }
+        }
+    }
+    return false;
+}
+
+uint32_t rules_upload_ms_until_next_event(bool save_ok) {
+    if ((upload_ready != 0 && save_ok) || (upload_ready == 0 && Serial.available() > 0)) {
+        return 0;
+    }
+    return RULES_UPLOAD_POLL_MS;
+}
+
+#endif // RULES_UPLOAD
+
+/******************************************************************************
+ * SECTION 9: SNAPSHOTS (include/snapshot.h)
+ *
+ * hal_snapshot_save() copies everything this file plays with into a
+ * HalSnapshot; hal_snapshot_load() puts one back. Times go in as ages
+ * (snapshot.h, TIMES). Both run in loop(), between game updates; the
+ * pin-change ISR is held off while the debouncer and press count are
+ * copied, so they are taken as one.
+ *
+ * A running animation is stored as far as each track has got: its pause
+ * count, plus since, wait and i. Loading runs both scripts up to that pause
+ * again (script_seek()), then puts back the effect, the lit LEDs and the
+ * track fields, and stops any note the replay started.
+ *
+ * The LCD goes in twice: the frame, and what the main panel shows with its
+ * cursor (a redraw starts from the cursor, so without it the same screen
+ * change would reach the glass in another order). Loading paints what the
+ * panel showed onto every panel at once, then lets display_service() send
+ * the rest of the frame as the cabinet would have.
+ *
+ * SNAPSHOT_DUMP builds listen on the serial port for SNAPSHOT_COMMAND
+ * (anything else is dropped) and game.cpp answers between loop()s. The
+ * reply is ~200 bytes: about 20 ms of loop() at 115200 baud while the
+ * 64-byte transmit buffer drains.
+ ******************************************************************************/
+
+/**
+ * track_load - Put @track back where the snapshot's track was
+ */
+static void track_load(ScriptTrack *track, ScriptFn fn, uint8_t pauses,
+                       uint32_t since, uint16_t wait, uint8_t i) {
+    script_seek(track, fn, pauses);
+    track->since = since;
+    track->wait = wait;
+    track->i = i;
+}
+
+void hal_snapshot_save(HalSnapshot *s) {
+    uint32_t now_ms = millis();
+    uint32_t now_us = timebase_micros();
+    noInterrupts();
+    Debouncer debouncer = button_debouncer;
+    uint8_t presses = button_presses;
+    interrupts();
+
+    s->button_edge_age_us = now_us - debouncer.last_edge_us;
+    s->button_burst_age_us = now_us - debouncer.burst_start_us;
+    s->button_bounce_us = debouncer.bounce_us;
+    s->button_burst_edges = debouncer.burst_edges;
+    s->button_down = debouncer.down;
+    s->button_presses = presses;
+    s->button_presses_seen = button_presses_seen;
+    s->bounce_saved_us = bounce_saved_us;
+
+    s->anim_state = (uint8_t)anim_state;
+    s->buzzer_since_age_ms = now_ms - buzzer_track.since;
+    s->buzzer_wait = buzzer_track.wait;
+    s->buzzer_i = buzzer_track.i;
+    s->buzzer_pauses = buzzer_track.pauses;
+    s->led_since_age_ms = now_ms - led_track.since;
+    s->led_wait = led_track.wait;
+    s->led_i = led_track.i;
+    s->led_pauses = led_track.pauses;
+    s->effect_kind = led_effect.preset.kind;
+    s->effect_a = led_effect.preset.a;
+    s->effect_b = led_effect.preset.b;
+    s->effect_step = led_effect.step;
+    s->effect_state = led_effect.state;
+    s->celebration_effect_next = celebration_effect_next;
+    s->attract_effect_next = attract_effect_next;
+    s->leds = BoardLeds::read_frame();
+
+#ifdef BOARD_HAS_I2C
+    static_assert(SNAPSHOT_EXPANDER_QUEUE == EXPANDER_QUEUE_SIZE,
+                  "snapshot.h's expander queue must match section 6");
+    memcpy(s->lcd, frame, sizeof(frame));
+    memcpy(s->lcd_shown, panels[0].shown, sizeof(panels[0].shown));
+    s->lcd_cursor = panels[0].cursor;
+    s->expander_levels = expander_levels;
+    for (uint8_t i = 0; i < EXPANDER_QUEUE_SIZE; i++) {
+        s->expander_queue_age_us[i] = now_us - expander_queue[i];
+    }
+    s->expander_queue_head = expander_queue_head;
+    s->expander_queue_count = expander_queue_count;
+    s->expander_queue_unoffered = expander_queue_unoffered;
+    s->expander_pressed_before = expander_pressed_before;
+    s->expander_last_press_age_us = now_us - expander_last_press_us;
+#else
+    memset(s->lcd, ' ', sizeof(s->lcd));
+    memset(s->lcd_shown, ' ', sizeof(s->lcd_shown));
+    s->lcd_cursor = 0;
+    s->expander_levels = 0;
+    memset(s->expander_queue_age_us, 0, sizeof(s->expander_queue_age_us));
+    s->expander_queue_head = 0;
+    s->expander_queue_count = 0;
+    s->expander_queue_unoffered = 0;
+    s->expander_pressed_before = 0;
+    s->expander_last_press_age_us = 0;
+#endif
+
+    s->credits = ledger.credits;
+    s->coin_pulses_toward_credit = coin_pulses_toward_credit;
+}
+
+void hal_snapshot_load(const HalSnapshot *s) {
+    uint32_t now_ms = millis();
+    uint32_t now_us = timebase_micros();
+
+    Debouncer debouncer;
+    debouncer.last_edge_us = now_us - s->button_edge_age_us;
+    debouncer.burst_start_us = now_us - s->button_burst_age_us;
+    debouncer.bounce_us = s->button_bounce_us;
+    debouncer.burst_edges = s->button_burst_edges;
+    debouncer.down = s->button_down != 0;
+    noInterrupts();
+    button_debouncer = debouncer;
+    button_presses = s->button_presses;
+    interrupts();
+    button_presses_seen = s->button_presses_seen;
+    bounce_saved_us = s->bounce_saved_us;
+
+    // Scripts first: replaying them draws LED frames and steps the effect
+    anim_state = s->anim_state <= ANIM_SHOWCASE ? (AnimationState)s->anim_state : ANIM_IDLE;
+    track_load(&buzzer_track, animation_scripts[anim_state].buzzer, s->buzzer_pauses,
+               now_ms - s->buzzer_since_age_ms, s->buzzer_wait, s->buzzer_i);
+    track_load(&led_track, animation_scripts[anim_state].leds, s->led_pauses,
+               now_ms - s->led_since_age_ms, s->led_wait, s->led_i);
+    tone_stop();
+    led_effect.preset.kind = s->effect_kind;
+    led_effect.preset.a = s->effect_a;
+    led_effect.preset.b = s->effect_b;
+    led_effect.step = s->effect_step;
+    led_effect.state = s->effect_state;
+    celebration_effect_next = s->celebration_effect_next;
+    attract_effect_next = s->attract_effect_next;
+    led_show(s->leds);
+
+#ifdef BOARD_HAS_I2C
+    memcpy(frame, s->lcd, sizeof(frame));
+    for (uint8_t i = 0; i < panel_count; i++) {
+        LcdPanel *panel = &panels[i];
+        memcpy(panel->shown, s->lcd_shown, sizeof(panel->shown));
+        for (uint8_t row = 0; row < LCD_ROWS; row++) {
+            panel->lcd->setCursor(0, row);
+            for (uint8_t col = 0; col < LCD_COLS; col++) {
+                panel->lcd->write((uint8_t)panel->shown[row][col]);
+            }
+        }
+        panel->cursor = CURSOR_UNKNOWN;
+        if (s->lcd_cursor < LCD_CELLS) {
+            panel->lcd->setCursor(s->lcd_cursor % LCD_COLS, s->lcd_cursor / LCD_COLS);
+            panel->cursor = s->lcd_cursor;
+        }
+        panel->dirty = memcmp(panel->shown, frame, sizeof(frame)) != 0;
+        panel->changed_at = now_us;
+    }
+    expander_levels = s->expander_levels;
+    for (uint8_t i = 0; i < EXPANDER_QUEUE_SIZE; i++) {
+        expander_queue[i] = now_us - s->expander_queue_age_us[i];
+    }
+    expander_queue_head = s->expander_queue_head % EXPANDER_QUEUE_SIZE;
+    expander_queue_count = s->expander_queue_count <= EXPANDER_QUEUE_SIZE ? s->expander_queue_count : 0;
+    expander_queue_unoffered = s->expander_queue_unoffered <= expander_queue_count
+                             ? s->expander_queue_unoffered : expander_queue_count;
+    expander_pressed_before = s->expander_pressed_before != 0;
+    expander_last_press_us = now_us - s->expander_last_press_age_us;
+#endif
+
+    // The coin ISR's counters are this board's: start counting from them
+    ledger.credits = s->credits;
+    coin_pulses_toward_credit = s->coin_pulses_toward_credit;
+    coin_pulses_seen = coin_pulses();
+    coin_rejects_seen = coin_rejects();
+}
+
+#ifdef SNAPSHOT_DUMP
+
+static_assert(uart_error_permille(SNAPSHOT_BAUD) <= UART_MAX_ERROR_PERMILLE,
+              "SNAPSHOT_BAUD is too far off at this F_CPU");
+
+bool snapshot_requested(void) {
+    bool asked = false;
+    while (Serial.available() > 0) {
+        if (Serial.read() == SNAPSHOT_COMMAND) {
+            asked = true;
+        }
+    }
+    return asked;
+}
+
+uint32_t snapshot_ms_until_next_event(void) {
+    return Serial.available() > 0 ? 0 : SNAPSHOT_POLL_MS;
+}
+
+void snapshot_serial_write(const void *data, uint16_t size, void *context) {
+    (void)context;
+    Serial.write((const uint8_t *)data, size);
+}
+
+#endif // SNAPSHOT_DUMP
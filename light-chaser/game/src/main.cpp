@@ -59,6 +59,12 @@
 #include <avr/wdt.h>   // Watchdog Timer library for AVR microcontrollers
 #include "hardware.h"
 #include "game.h"
+#include "trace.h"
+#include "timebase.h"
+#include "coin.h"
+#ifndef BOARD_TINY85
+#include "resources.h"   // Fails the build if two features claim one timer or pin
+#endif
 
 /******************************************************************************
  * setup() - One-Time Initialisation
@@ -89,7 +95,12 @@
  ******************************************************************************/
 
 void setup() {
+    // Start the trace stream first so hardware_init() is on the timeline
+    // (compiles to nothing unless built with -DTRACE_ENABLED, see trace.h)
+    TRACE_INIT();
+
     // Initialise all hardware peripherals (LEDs, button, buzzer, LCD, I2C)
+    // and run the power-on self-test while the LCD powers up
     // See hardware.cpp:hardware_init() for pin configuration details
     hardware_init();
 
@@ -157,6 +168,13 @@ void setup() {
      **************************************************************************/
 
     wdt_enable(WDTO_4S);  // Enable 4-second watchdog timer
+
+    // Hand timekeeping from the 1 kHz Timer0 tick to Timer1 (see timebase.h).
+    // Last, because lcd.init() above waits with delay(), which needs the tick.
+    timebase_init();
+
+    // Count coin pulses from now on (times them with the Timer1 timebase)
+    coin_init();
 }
 
 /******************************************************************************
@@ -218,16 +236,18 @@ void setup() {
  * You might think calling functions every millisecond is wasteful.
  * "Shouldn't we sleep when there's nothing to do?"
  *
- * On Arduino Uno (16 MHz):
- * - Function call overhead: ~1-2 microseconds
- * - Our entire loop(): ~100-500 microseconds
- * - Power savings from sleep: negligible for USB-powered device
- *
- * For battery-powered devices, we'd add sleep modes. For our game, the
- * responsiveness of running full-speed is more important.
+ * We do. game_ms_until_next_event() knows when the next chase step, timer
+ * or animation note is due, so after each pass loop() idles until then
+ * (or until the button changes) with timebase_sleep(). In ATTRACT that is
+ * ~5 wakeups per second instead of ~976 Timer0 ticks. Sleeping is about
+ * interrupt load and jitter more than power: a USB-powered board barely
+ * notices the current saved. See timebase.h.
  ******************************************************************************/
 
 void loop() {
+    // Bring millis() up to date (it doesn't tick by itself, see timebase.h)
+    timebase_sync();
+
     // Update game state machine and all animations
     // This function:
     // 1. Calls animation_update() to advance any playing animations
@@ -240,4 +260,22 @@ void loop() {
     // If we forget this call, Arduino resets after 4 seconds
     // The wdt_reset() macro is defined in <avr/wdt.h>
     wdt_reset();
+
+#ifdef TIMEBASE_STATS
+    GameStatus status;
+    game_get_status(&status);
+    timebase_stats_poll(status.state == STATE_ATTRACT);
+#endif
+
+#ifdef COIN_STALL_MS
+    // Pulse-loss test build (uno_coin_stall, see tools/simavr_coin.cpp):
+    // loop() is busy COIN_STALL_MS at a time and never sleeps, so every coin
+    // pulse starts or ends while loop() is looking the other way
+    for (uint16_t ms = 0; ms < COIN_STALL_MS; ms++) {
+        delayMicroseconds(1000);  // Busy wait; works without the Timer0 tick
+    }
+#else
+    // Idle until the next thing is due; a button change or a coin wakes us
+    timebase_sleep(game_ms_until_next_event());
+#endif
 }
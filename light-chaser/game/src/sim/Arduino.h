@@ -0,0 +1,86 @@
+/******************************************************************************
+ * ARDUINO.H (HOST) - Minimal Arduino Core for the Host Simulator
+ *
+ * The firmware sources (game.cpp, hardware.cpp) include <Arduino.h>. When
+ * they are compiled for the desktop (the native PlatformIO environments),
+ * this file is found first on the include path and stands in for the real
+ * Arduino core.
+ *
+ * Only the part of the core the firmware actually uses is provided:
+ * - Pin functions: pinMode(), digitalWrite(), digitalRead()
+ * - Timing: millis(), micros()
+ * - Serial: begin() and write() (used by trace.cpp)
+ * - yield(): declared only; hardware.cpp provides it, as on the board
+ * - noInterrupts() / interrupts(): nothing to mask, the simulator runs
+ *   "interrupt handlers" (button_edge()) only between loop() calls
+ * - F_CPU: the simulated board is a 16 MHz Uno (clocks.h derives from it)
+ * - PROGMEM, pgm_read_byte(), memcpy_P(): a PC has one address space, so
+ *   flash tables (layout.h) are plain constants read in place
+ *
+ * Each function is implemented in sim.cpp against a "virtual board" (pin
+ * levels, a virtual millisecond clock, a log of the last tone). Nothing here
+ * touches real hardware, so the unchanged firmware logic can be run
+ * thousands of times per second on a PC.
+ *
+ * FIDELITY NOTE:
+ * On the AVR, int is 16 bits and unsigned long is 32 bits. On a 64-bit host
+ * unsigned long is 64 bits, so millis() is declared as uint32_t here to keep
+ * the firmware's rollover arithmetic (now - then) identical.
+ *
+ * Related files:
+ * - sim.h / sim.cpp: The virtual board behind these functions
+ * - EEPROM.h, LiquidCrystal_I2C.h, Wire.h: Host versions of the library headers
+ ******************************************************************************/
+
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x0
+#define OUTPUT       0x1
+#define INPUT_PULLUP 0x2
+
+typedef uint8_t byte;
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+uint32_t millis(void);
+uint32_t micros(void);
+
+void yield(void);
+
+#define noInterrupts()
+#define interrupts()
+
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+#define memcpy_P(dest, src, size) memcpy((dest), (src), (size))
+
+/**
+ * HardwareSerial - Output-only serial port
+ *
+ * Bytes written go to whatever sim_serial_capture() selected (nothing by
+ * default). There is no baud-rate timing: writes are instant.
+ */
+class HardwareSerial {
+public:
+    void begin(unsigned long baud);
+    size_t write(uint8_t value);
+    size_t write(const uint8_t *data, size_t size);
+};
+
+extern HardwareSerial Serial;
+
+#endif // SIM_ARDUINO_H
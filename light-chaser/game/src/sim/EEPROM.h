@@ -0,0 +1,25 @@
+/******************************************************************************
+ * EEPROM.H (HOST) - EEPROM Library for the Host Simulator
+ *
+ * Host stand-in for the Arduino EEPROM library. The 1 KB of EEPROM is a
+ * byte array inside sim.cpp that survives sim_power_on() (just like the real
+ * thing survives a reset) and starts erased (0xFF) until sim_eeprom_erase()
+ * or a firmware write changes it.
+ ******************************************************************************/
+
+#ifndef SIM_EEPROM_H
+#define SIM_EEPROM_H
+
+#include <Arduino.h>
+
+class EEPROMClass {
+public:
+    uint8_t read(int address);
+    void write(int address, uint8_t value);
+    void update(int address, uint8_t value);
+    uint16_t length(void) { return 1024; }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // SIM_EEPROM_H
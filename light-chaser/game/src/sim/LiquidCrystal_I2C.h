@@ -0,0 +1,44 @@
+/******************************************************************************
+ * LIQUIDCRYSTAL_I2C.H (HOST) - Character LCD for the Host Simulator
+ *
+ * Host stand-in for the LiquidCrystal_I2C library. Instead of sending bytes
+ * over I2C it writes characters into a 16x2 text buffer, one per backpack
+ * address, that the simulator tools can read back with sim_lcd_row() (main
+ * LCD) and sim_spectator_lcd_row().
+ *
+ * Only the calls made by hardware.cpp are provided: init(), backlight(),
+ * clear(), setCursor() and print() for strings and numbers. As in the real
+ * library (through Print), print() sends one character at a time through
+ * the virtual write(), so a subclass can act between characters.
+ ******************************************************************************/
+
+#ifndef SIM_LIQUIDCRYSTAL_I2C_H
+#define SIM_LIQUIDCRYSTAL_I2C_H
+
+#include <Arduino.h>
+
+class LiquidCrystal_I2C {
+public:
+    LiquidCrystal_I2C(uint8_t address, uint8_t cols, uint8_t rows);
+
+    void init(void);
+    void backlight(void);
+    void clear(void);
+    void setCursor(uint8_t col, uint8_t row);
+
+    size_t print(const char *text);
+    size_t print(int value);
+    size_t print(unsigned int value);
+    size_t print(long value);
+    size_t print(unsigned long value);
+
+    virtual size_t write(uint8_t value);
+    virtual ~LiquidCrystal_I2C() {}
+
+private:
+    uint8_t address;
+    uint8_t cols;
+    uint8_t rows;
+};
+
+#endif // SIM_LIQUIDCRYSTAL_I2C_H
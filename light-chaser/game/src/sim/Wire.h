@@ -0,0 +1,44 @@
+/******************************************************************************
+ * WIRE.H (HOST) - I2C Library for the Host Simulator
+ *
+ * Host stand-in for the Arduino Wire library. Two devices answer:
+ * - The LCD backpack, at the address set with sim_set_lcd_address(). Only
+ *   its ACK is modelled here (the self-test probe); LCD traffic itself goes
+ *   through the LiquidCrystal_I2C stand-in.
+ * - The MCP23017 input expander, if fitted (sim_set_expander_present()), as
+ *   a register file: writes set the register pointer then fill registers,
+ *   requestFrom() reads from the pointer on, both auto-incrementing.
+ *
+ * Every transfer costs bus time on micros() (see sim.h), ~90 µs per byte at
+ * 100 kHz.
+ ******************************************************************************/
+
+#ifndef SIM_WIRE_H
+#define SIM_WIRE_H
+
+#include <Arduino.h>
+
+class TwoWire {
+public:
+    void begin(void);
+    void setClock(uint32_t hz);
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t value);
+    uint8_t endTransmission(bool stop = true);  // 0 = ACK, 2 = address NACK (like the AVR)
+    uint8_t requestFrom(uint8_t address, uint8_t count);  // Bytes received
+    int available(void);
+    int read(void);
+
+private:
+    static const uint8_t BUFFER_SIZE = 32;  // Same as the AVR library
+    uint8_t address;
+    uint8_t tx[BUFFER_SIZE];
+    uint8_t tx_count;
+    uint8_t rx[BUFFER_SIZE];
+    uint8_t rx_count;
+    uint8_t rx_next;
+};
+
+extern TwoWire Wire;
+
+#endif // SIM_WIRE_H
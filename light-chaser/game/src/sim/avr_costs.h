@@ -0,0 +1,86 @@
+/******************************************************************************
+ * AVR_COSTS.H - What Each Host HAL Call Would Cost on the Uno (Cycles)
+ *
+ * On a PC, game.cpp's own code is a rounding error: an Uno loop() is slow
+ * because of what it asks the hardware for. A digitalWrite() is ~50 cycles
+ * of table lookups, an LCD byte is 1.3 ms of I2C, an EEPROM byte 3.3 ms of
+ * waiting. The host simulator (sim.cpp) charges every HAL call the firmware
+ * makes to a virtual cycle counter at the cost listed here, so a host run
+ * predicts how long each loop() would take on the board, and which call
+ * made a slow one slow (sim_cycles(), tools/cycle_profile.cpp).
+ *
+ * THE TABLE: X(id, name, cycles, bus)
+ *
+ *   cycles   CPU cycles per call at 16 MHz
+ *   bus      1 = the call also waits for a bus: the wire time sim.cpp
+ *            already adds to micros() (sim.h, MICROS() AND BUS TIME) is
+ *            charged on top, at F_CPU cycles per second
+ *
+ * COST_LOOP is everything that isn't a HAL call: loop(), game_update()'s
+ * dispatch and the running state's handler. The simulator can't count the
+ * firmware's own instructions, so this is one average figure per loop().
+ *
+ * WHERE THE NUMBERS COME FROM:
+ * Instruction counts of what avr-gcc -Os emits for the Uno build (core
+ * digitalWrite() and digitalRead(): pin tables in flash, timer PWM off,
+ * SREG save; timebase_micros(): Timer1 and the overflow count with
+ * interrupts off; tone_play(): the precomputed register values written).
+ * They are starting points, not measurements. To calibrate, run the
+ * uno_trace firmware in simavr (tools/simavr_trace.cpp), then
+ * cycle_profile --compare on the capture: it prints predicted against
+ * measured game_update() time per state. Change a figure here, or try one
+ * with cycle_profile --cost NAME=CYCLES, until they agree.
+ *
+ * LED WRITES:
+ * The host builds the LedsPins backend (board.h), so every LED goes through
+ * digitalWrite(). The Uno build writes ports (LedsUnoPorts), so writes to
+ * LED pins are charged COST_LED_WRITE, unless the host is built with
+ * -DLEDS_PINS like env:uno_led_pins.
+ *
+ * Related files:
+ * - sim.cpp: Where each cost is charged
+ * - sim.h: sim_cycles(), sim_set_cost()
+ ******************************************************************************/
+
+#ifndef SIM_AVR_COSTS_H
+#define SIM_AVR_COSTS_H
+
+#include <stdint.h>
+
+#define AVR_COSTS(X)                                                        \
+    X(COST_LOOP,          "loop()",          150,  0)                        \
+    X(COST_PIN_MODE,      "pinMode",          64,  0)                        \
+    X(COST_DIGITAL_WRITE, "digitalWrite",     52,  0)                        \
+    X(COST_LED_WRITE,     "LED port write",    8,  0)                        \
+    X(COST_DIGITAL_READ,  "digitalRead",      44,  0)                        \
+    X(COST_MILLIS,        "millis",           22,  0)                        \
+    X(COST_MICROS,        "micros",           68,  0)                        \
+    X(COST_TONE,          "tone_play",        48,  0)                        \
+    X(COST_TONE_STOP,     "tone_stop",        12,  0)                        \
+    X(COST_EEPROM_READ,   "EEPROM.read",      32,  0)                        \
+    X(COST_EEPROM_WRITE,  "EEPROM.write",     40,  1)                        \
+    X(COST_I2C,           "I2C transfer",    180,  1)                        \
+    X(COST_LCD,           "LCD byte",        120,  1)                        \
+    X(COST_SERIAL,        "Serial byte",      30,  0)                        \
+    X(COST_ISR,           "pin-change ISR",   96,  0)
+
+#define AVR_COST_ID(id, name, cycles, bus) id,
+enum AvrCost {
+    AVR_COSTS(AVR_COST_ID)
+    AVR_COST_COUNT
+};
+#undef AVR_COST_ID
+
+typedef struct {
+    const char *name;
+    uint32_t cycles;
+    bool bus;
+} AvrCostInfo;
+
+#define AVR_COST_INFO(id, name, cycles, bus) {name, cycles, bus != 0},
+static const AvrCostInfo avr_costs[AVR_COST_COUNT] = {
+    AVR_COSTS(AVR_COST_INFO)
+};
+#undef AVR_COST_INFO
+
+#endif // SIM_AVR_COSTS_H
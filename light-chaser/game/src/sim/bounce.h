@@ -0,0 +1,251 @@
+/******************************************************************************
+ * BOUNCE.H - Synthetic Switch Bounce: Waveforms and How a Debouncer Scored
+ *
+ * Debounce settings used to be chosen from one oscilloscope trace and a
+ * guess. This generates button waveforms with known presses in them, so a
+ * debouncer can be scored against the truth: how soon it reported each
+ * press, which it missed, and which presses it made up.
+ *
+ * ONE PRESS OF A WAVEFORM:
+ *
+ *   down  ____      _ _________________        _
+ *   up        \____/ v                 \__/\__/ \_______  ^  ______
+ *             │burst│                  │ burst │         │EMI spike
+ *             ↑ contact (true press)   ↑ release          (idle or held)
+ *
+ * - Each transition is a burst: the first edge, then 0..bounces_max extra
+ *   breaks spread over up to bounce_us_max, ending at the new level
+ * - Holds and gaps are drawn from the profile's ranges (fast tapping is a
+ *   short gap, a lazy press a long hold)
+ * - EMI spikes: emi_per_s on average, 1..emi_us_max (under 1 ms) wide,
+ *   anywhere the contact has settled, to the other level and straight back
+ *
+ * SCORING (bounce_score()):
+ * Press i owns the time from its contact to press i + 1's contact. The
+ * first press a debouncer reports between contact and release is a
+ * detection, and contact → report is its latency. Every other report is a
+ * false press: bounce let through, an EMI spike taken for a press, or a
+ * release counted as a press. A press with no report before its release is
+ * missed.
+ *
+ * Host tools only (std::vector): sim/tools/bounce_suite.cpp scores the
+ * firmware and other filters in the host simulator, and
+ * sim/tools/simavr_bounce.cpp scores the real ISR in simavr, both on the
+ * same waveforms.
+ ******************************************************************************/
+
+#ifndef SIM_BOUNCE_H
+#define SIM_BOUNCE_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+typedef struct {
+    const char *name;
+    uint8_t bounces_max;        // Extra contact breaks per transition (0..max)
+    uint16_t bounce_us_max;     // Longest burst
+    uint16_t hold_ms_min, hold_ms_max;
+    uint16_t gap_ms_min, gap_ms_max;   // Released between presses
+    uint16_t emi_per_s;         // Spikes per second, on average
+    uint16_t emi_us_max;        // Widest spike
+} BounceProfile;
+
+typedef struct {
+    uint32_t at_us;
+    bool down;                  // Level after the edge (true = pressed)
+} BounceEdge;
+
+typedef struct {
+    uint32_t contact_us;        // First edge of the press burst
+    uint32_t release_us;        // First edge of the release burst
+    uint32_t next_us;           // The next press's contact (or the end)
+} BouncePress;
+
+typedef struct {
+    uint32_t presses;
+    uint32_t detected;
+    uint32_t missed;
+    uint32_t false_presses;
+    std::vector<uint32_t> latency_us;  // One per detection, sorted
+} BounceScore;
+
+/**
+ * Built-in profiles - From a new microswitch to a worn leaf switch next to
+ * the coin mech's solenoid
+ */
+static const BounceProfile bounce_profiles[] = {
+    //  name       breaks  burst us  hold ms    gap ms     EMI/s  EMI us
+    {"clean",      2,      800,      80, 200,   150, 600,  0,     0},
+    {"typical",    6,      5000,     80, 200,   150, 600,  0,     0},
+    {"worn",       20,     15000,    80, 200,   150, 600,  0,     0},
+    {"fast-taps",  6,      5000,     30, 60,    40, 80,    0,     0},
+    {"noisy",      6,      5000,     80, 200,   150, 600,  2,     200},
+};
+static const uint8_t BOUNCE_PROFILE_COUNT = sizeof(bounce_profiles) / sizeof(bounce_profiles[0]);
+
+static inline uint32_t bounce_random(uint32_t *s) {
+    uint32_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *s = x;
+    return x;
+}
+
+static inline uint32_t bounce_between(uint32_t *s, uint32_t lo, uint32_t hi) {
+    return hi <= lo ? lo : lo + bounce_random(s) % (hi - lo + 1);
+}
+
+/**
+ * bounce_burst - Edges of one transition to @down, starting at @at_us
+ * @return: When the contact has settled
+ */
+static inline uint32_t bounce_burst(const BounceProfile *p, uint32_t *rng, uint32_t at_us,
+                                    bool down, std::vector<BounceEdge> *edges) {
+    edges->push_back({at_us, down});
+    uint32_t breaks = bounce_between(rng, 0, p->bounces_max);
+    if (breaks == 0 || p->bounce_us_max < 2 * breaks) {
+        return at_us;
+    }
+
+    // 2 edges per break, at sorted times within the burst, 1 µs apart at least
+    uint32_t length = bounce_between(rng, p->bounce_us_max / 3, p->bounce_us_max);
+    std::vector<uint32_t> times;
+    for (uint32_t i = 0; i < 2 * breaks; i++) {
+        times.push_back(bounce_between(rng, 1, length));
+    }
+    std::sort(times.begin(), times.end());
+    uint32_t last = at_us;
+    for (uint32_t i = 0; i < times.size(); i++) {
+        uint32_t t = at_us + times[i] > last ? at_us + times[i] : last + 1;
+        edges->push_back({t, (i & 1) ? down : !down});
+        last = t;
+    }
+    return last;
+}
+
+/**
+ * bounce_spikes - EMI between @from_us and @to_us on a contact settled at @down
+ */
+static inline void bounce_spikes(const BounceProfile *p, uint32_t *rng, uint32_t from_us,
+                                 uint32_t to_us, bool down, std::vector<BounceEdge> *edges) {
+    if (p->emi_per_s == 0 || to_us <= from_us + 2u * p->emi_us_max) {
+        return;
+    }
+    // One chance per ms, emi_per_s in 1000 of them; a spike ends within its ms
+    uint32_t width_max = p->emi_us_max < 999 ? p->emi_us_max : 999;
+    for (uint32_t ms = from_us / 1000 + 1; (ms + 1) * 1000 < to_us; ms++) {
+        if (bounce_random(rng) % 1000 < p->emi_per_s) {
+            uint32_t at = ms * 1000 + bounce_random(rng) % (1000 - width_max);
+            edges->push_back({at, !down});
+            edges->push_back({at + bounce_between(rng, 1, width_max), down});
+        }
+    }
+}
+
+/**
+ * bounce_generate - @presses presses of profile @p
+ * @return: When the waveform ends (the last press's next_us)
+ *
+ * The waveform starts released and quiet at time 0; the first contact
+ * comes after one gap.
+ */
+static inline uint32_t bounce_generate(const BounceProfile *p, uint32_t presses, uint32_t seed,
+                                       std::vector<BounceEdge> *edges,
+                                       std::vector<BouncePress> *truth) {
+    uint32_t rng = seed * 2654435761u + 0x9E3779B9u;
+    uint32_t settled = 0;
+    uint32_t t = bounce_between(&rng, p->gap_ms_min, p->gap_ms_max) * 1000u;
+    edges->clear();
+    truth->clear();
+
+    for (uint32_t i = 0; i < presses; i++) {
+        bounce_spikes(p, &rng, settled, t, false, edges);
+        BouncePress press;
+        press.contact_us = t;
+        settled = bounce_burst(p, &rng, t, true, edges);
+
+        t += bounce_between(&rng, p->hold_ms_min, p->hold_ms_max) * 1000u;
+        if (t <= settled) {
+            t = settled + 1000;
+        }
+        bounce_spikes(p, &rng, settled, t, true, edges);
+        press.release_us = t;
+        settled = bounce_burst(p, &rng, t, false, edges);
+
+        t += bounce_between(&rng, p->gap_ms_min, p->gap_ms_max) * 1000u;
+        if (t <= settled) {
+            t = settled + 1000;
+        }
+        press.next_us = t;
+        truth->push_back(press);
+    }
+    return t;
+}
+
+/**
+ * bounce_score - Judge @reports (press times, in order) against @truth
+ */
+static inline void bounce_score(const std::vector<BouncePress> &truth,
+                                const std::vector<uint32_t> &reports, BounceScore *score) {
+    score->presses = (uint32_t)truth.size();
+    score->detected = 0;
+    score->missed = 0;
+    score->false_presses = 0;
+    score->latency_us.clear();
+
+    size_t r = 0;
+    for (; r < reports.size() && (truth.empty() || reports[r] < truth[0].contact_us); r++) {
+        score->false_presses++;       // Before the first press
+    }
+    for (size_t i = 0; i < truth.size(); i++) {
+        bool found = false;
+        for (; r < reports.size() && reports[r] < truth[i].next_us; r++) {
+            if (!found && reports[r] < truth[i].release_us) {
+                found = true;
+                score->latency_us.push_back(reports[r] - truth[i].contact_us);
+            } else {
+                score->false_presses++;
+            }
+        }
+        if (found) {
+            score->detected++;
+        } else {
+            score->missed++;
+        }
+    }
+    score->false_presses += (uint32_t)(reports.size() - r);  // After the end
+    std::sort(score->latency_us.begin(), score->latency_us.end());
+}
+
+/**
+ * bounce_percentile - The @permille-th latency (0 if nothing was detected)
+ */
+static inline uint32_t bounce_percentile(const BounceScore *score, uint32_t permille) {
+    if (score->latency_us.empty()) {
+        return 0;
+    }
+    size_t i = (size_t)((uint64_t)(score->latency_us.size() - 1) * permille / 1000);
+    return score->latency_us[i];
+}
+
+/**
+ * bounce_profile_find - The built-in profile called @name, or NULL
+ */
+static inline const BounceProfile *bounce_profile_find(const char *name) {
+    for (uint8_t i = 0; i < BOUNCE_PROFILE_COUNT; i++) {
+        const char *a = bounce_profiles[i].name;
+        const char *b = name;
+        while (*a != '\0' && *a == *b) {
+            a++;
+            b++;
+        }
+        if (*a == '\0' && *b == '\0') {
+            return &bounce_profiles[i];
+        }
+    }
+    return NULL;
+}
+
+#endif // SIM_BOUNCE_H
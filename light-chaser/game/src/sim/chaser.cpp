@@ -0,0 +1,936 @@
+/******************************************************************************
+ * CHASER.CPP - libchaser: Batched, Struct-of-Arrays Game Engine
+ *
+ * This file re-expresses game.cpp (and the parts of hardware.cpp's animation
+ * system that game.cpp waits on) so that the compiler can update many games
+ * with each SIMD instruction. See chaser.h for the public interface.
+ *
+ * HOW THE LOOP IS MADE VECTORISABLE:
+ *
+ * Scalar firmware style (one game, branches):
+ *   if (now - last_chase_update >= chase_speed) {
+ *       last_chase_update = now;
+ *       current_position += chase_direction;
+ *   }
+ *
+ * Batched style (8 games per AVX2 instruction, no branches):
+ *   const uint32_t due = lane_mask(now - last_chase[i] >= speed[i]);
+ *   last_chase[i] = lane_pick(due, now, last_chase[i]);
+ *   pos[i] = lane_pick(due, pos[i] + dir[i], pos[i]);
+ *
+ * Every condition becomes an all-ones/all-zeros mask and every assignment a
+ * select, so all lanes execute the same instruction stream. Rules followed
+ * throughout step_block():
+ * - Every field is a 32-bit lane (uint32_t / int32_t), so lanes line up
+ * - Conditions are combined with & | ~ on masks, never && || or "c ? a : b"
+ *   (see LANE MASKS below for why)
+ * - No calls other than the inline mask helpers, no early returns, no table
+ *   lookups in the loop body
+ * - Every array is loaded once and stored once per tick
+ *
+ * LED EFFECTS:
+ * Celebration and attract showcase frames come from effects.h, whose
+ * generators branch and loop. The vector loop only decides which lanes
+ * need an effect frame this tick (the fx lane); step_effects() then runs
+ * the same effect_start()/effect_next() as the firmware on just those
+ * lanes. That is a few lanes in a thousand, and the pass is skipped
+ * entirely on the ticks where no lane needs it.
+ *
+ * BUTTON EDGES:
+ * The firmware debounces in its pin-change ISR (debounce.h), and so does
+ * this: an edge can only happen where the caller changes a button, at the
+ * start of chaser_batch_step(). step_edges() runs debounce_edge() on the
+ * lanes that changed, before the ticks, and the vector loop only sees the
+ * count of presses waiting (press lane). step_profiles() does
+ * button_service()'s EEPROM save after the ticks, for the lanes that spent
+ * a tick between games (attract lane: ATTRACT, CELEBRATION or GAME_OVER,
+ * game.cpp:between_games()): the estimate can't change mid-call, so
+ * that is the value the firmware would have saved.
+ *
+ * ANIMATION SCRIPTS:
+ * hardware.cpp writes its animations as scripts that pause at each wait
+ * (script.h). A lane can't keep a resume address per instance, so here each
+ * script's place is kept as plain counters (anim_step, led_frame,
+ * flash_count, flash_state), as the firmware did before the scripts.
+ *
+ * GAME MODES:
+ * Only the built-in rules (no game mode in EEPROM, rules.h). A rule
+ * program is a branching interpreter: it would take every lane off the
+ * vector path. bench --verify boots the firmware with EEPROM erased, so
+ * the two still play the same game.
+ *
+ * ATTRACT GHOST:
+ * Recorded, saved and replayed as game.cpp does it (ghost.h). The decisions
+ * are lane masks like the game's own: whose showcase slot it is, the pause
+ * and the final hold ending, the chase waiting for the recorded step, the
+ * press judged where it fell. Writing and reading varints loops and
+ * branches, so the vector loop only asks for it (the gx lane) and
+ * step_ghosts() does it, as step_effects() does the effect frames. Each
+ * lane has its own 212-byte recording and a copy of its EEPROM ghost.
+ * The RULE_RND seed and game mode tag bytes are left 0: there are no game
+ * modes here to compare them with. Nor is there a CRC to check: the
+ * firmware writes the magic byte last (ghost_save_service()), so its
+ * EEPROM holds the whole run or none, as the copy here does.
+ *
+ * Check with: g++ -O3 -mavx2 -fopt-info-vec ... should report
+ * "loop vectorized using 32 byte vectors" for step_block's loop.
+ *
+ * BLOCKING:
+ * The batch is processed BLOCK_LANES instances at a time, running all of the
+ * requested ticks on one block before moving to the next. A block's ~30
+ * arrays (30 × 256 × 4 bytes = 30 KB) stay in L1 cache for the whole call.
+ *
+ * BIT-IDENTICAL TO THE FIRMWARE:
+ * Each step below is annotated with the firmware function it mirrors. The
+ * order matters and matches game_update(): animation_update() first, then
+ * the current state's update() (which may perform ONE transition).
+ * chaser-bench --verify compares this engine against game.cpp running in the
+ * host simulator, tick by tick.
+ *
+ * Related files:
+ * - game.cpp: The scalar logic this file must match
+ * - hardware.cpp: animation_update() and button_just_pressed()
+ * - debounce.h: The debouncer, shared with the firmware
+ * - tools/bench_batch.cpp: Throughput benchmark and equivalence check
+ ******************************************************************************/
+
+#include "chaser.h"
+#include "config.h"
+#include "board.h"
+#include "effects.h"
+#include "debounce.h"
+#include "ghost.h"
+#include <stdlib.h>
+#include <string.h>
+
+/******************************************************************************
+ * CONSTANTS MIRRORED FROM THE FIRMWARE
+ *
+ * Values from config.h are used directly. These are private to game.cpp
+ * and hardware.cpp, so they are repeated here (keep them in sync!).
+ ******************************************************************************/
+
+static const uint32_t RESULT_PAUSE_MS = 300;         // game.cpp:RESULT_PAUSE_MS
+static const uint32_t CELEBRATION_HOLD_MS = 2000;    // game.cpp:CELEBRATION_HOLD_MS
+static const uint32_t BULLSEYE_NOTES = 3;            // hardware.cpp ANIM_BULLSEYE
+static const uint32_t GAME_OVER_NOTES = 3;           // hardware.cpp ANIM_GAME_OVER
+static const uint32_t CELEBRATION_NOTES = 5;         // hardware.cpp ANIM_CELEBRATION
+static const uint32_t CELEBRATION_NOTE_GAP = 50;     // Silence after each note
+
+// hardware.cpp: celebration_durations[] = {150, 150, 150, 150, 300}
+static const uint32_t CELEBRATION_NOTE_MS_0 = 150;
+static const uint32_t CELEBRATION_NOTE_MS_1 = 150;
+static const uint32_t CELEBRATION_NOTE_MS_2 = 150;
+static const uint32_t CELEBRATION_NOTE_MS_3 = 150;
+
+// hardware.cpp AnimationState (private to that file)
+enum {
+    LANE_ANIM_IDLE,
+    LANE_ANIM_BULLSEYE,
+    LANE_ANIM_CELEBRATION,
+    LANE_ANIM_GAME_OVER,
+    LANE_ANIM_SHOWCASE
+};
+
+// hardware.cpp:CELEBRATION_FRAMES
+static const uint32_t CELEBRATION_FRAMES = CELEBRATION_SWEEPS * NUM_LEDS;
+
+// What step_effects() does for a lane this tick (fx lane)
+enum {
+    FX_NONE,
+    FX_NEXT,                      // Show the next frame of its effect
+    FX_CELEBRATION,               // animation_start_celebration()
+    FX_SHOWCASE                   // animation_start_showcase()
+};
+
+// game.cpp:GhostPhase
+enum {
+    LANE_GHOST_IDLE,
+    LANE_GHOST_CHASE,
+    LANE_GHOST_PAUSE,
+    LANE_GHOST_OVER
+};
+
+// What step_ghosts() does for a lane this tick (gx lane, one bit each, in
+// the order game_update() does them)
+enum {
+    GX_SAVE = 1,                  // ghost_save_service() wrote a byte
+    GX_NEXT_PRESS = 2,            // ghost_next_press() after a replayed hit
+    GX_SLOT = 4,                  // ghost_take_slot() started the replay
+    GX_RECORD_START = 8,          // ghost_record_start()
+    GX_RECORD_PRESS = 16,         // ghost_record_press()
+    GX_RECORD_END = 32            // ghost_record_end()
+};
+
+// ghost_high with no ghost (ghost_size == 0): equal to no high score
+static const uint32_t GHOST_NONE = 0x10000;
+
+// A record's run is only kept with GHOST_REPLAY (board.h, -DGHOST_OFF)
+#ifdef GHOST_REPLAY
+static const bool GHOST_KEPT = true;
+#else
+static const bool GHOST_KEPT = false;
+#endif
+
+static const uint32_t BLOCK_LANES = 256;
+static const uint32_t ALL_LEDS = (1u << NUM_LEDS) - 1;
+
+/******************************************************************************
+ * BATCH STORAGE - One array per variable
+ *
+ * Left column: the firmware variable each array mirrors.
+ ******************************************************************************/
+
+struct ChaserBatch {
+    uint32_t count;
+    uint32_t now;                 // Shared virtual millis()
+
+    // game.cpp
+    uint32_t *state;              // current_state
+    uint32_t *pos;                // current_position
+    int32_t *dir;                 // chase_direction
+    uint32_t *speed;              // chase_speed
+    uint32_t *last_chase;         // last_chase_update
+    uint32_t *score;              // current_score
+    uint32_t *high;               // high_score
+    uint32_t *new_high;           // is_new_high_score
+    uint32_t *entry;              // state_entry_time
+    uint32_t *saved_high;         // EEPROM high score record
+
+    // hardware.cpp (button)
+    uint32_t *press;              // button_presses - button_presses_seen
+    uint32_t *attract;            // A tick in ATTRACT this call (button_service())
+
+    // hardware.cpp (animation)
+    uint32_t *anim;               // anim_state
+    uint32_t *anim_step;          // buzzer_track.i (notes played)
+    uint32_t *anim_last;          // buzzer_track.since
+    uint32_t *led_frame;          // led_track.i (celebration, showcase frames)
+    uint32_t *flash_count;        // led_track.i (game over flashes)
+    uint32_t *flash_state;        // Game over LED script: lit, waiting to go dark
+    uint32_t *led_last;           // led_track.since
+    uint32_t *show_from;          // game.cpp:attract_show_from
+    uint32_t *fx;                 // FX_* request from step_block() to step_effects()
+
+    // game.cpp (the attract ghost)
+    uint32_t *rally;              // rally_steps
+    uint32_t *ghost_phase;        // ghost_phase (LANE_GHOST_*)
+    uint32_t *ghost_next;         // attract_ghost_next
+    uint32_t *press_steps;        // ghost_press_steps
+    uint32_t *press_ms;           // ghost_press_ms
+    uint32_t *paused_at;          // ghost_paused_at
+    uint32_t *unsaved;            // ghost_unsaved
+    uint32_t *ghost_high;         // Score in ghost_image (GHOST_NONE if ghost_size is 0)
+    uint32_t *gx;                 // GX_* requests from step_block() to step_ghosts()
+
+    // Virtual board
+    uint32_t *leds;               // LED pin levels
+
+    // hardware.cpp effect state, touched only by step_effects()
+    LedEffect *effect;            // led_effect
+    uint8_t *celebration_next;    // celebration_effect_next
+    uint8_t *attract_next;        // attract_effect_next
+
+    // hardware.cpp button debouncer, touched only by step_edges() / step_profiles()
+    Debouncer *debouncer;         // button_debouncer
+    uint16_t *bounce_saved;       // EEPROM bounce profile (bounce_saved_us)
+
+    // game.cpp ghost buffer, touched only by step_ghosts() (GHOST_IMAGE_MAX per lane)
+    uint8_t *ghost_image;         // ghost_image
+    uint8_t *ghost_size;          // ghost_size
+    uint8_t *ghost_read;          // ghost_read
+    uint8_t *record_at;           // ghost_record_at
+    uint8_t *stored_image;        // EEPROM ghost image (EEPROM_GHOST_ADDR)
+    uint8_t *stored_size;         // Its size, 0 if none is stored
+};
+
+static void *lane_alloc(uint32_t count) {
+    // 64-byte alignment = one cache line, lets the compiler use aligned loads
+    size_t bytes = ((size_t)count * sizeof(uint32_t) + 63) & ~(size_t)63;
+    void *p = aligned_alloc(64, bytes ? bytes : 64);
+    if (p != NULL) {
+        memset(p, 0, bytes);
+    }
+    return p;
+}
+
+/******************************************************************************
+ * LANE MASKS
+ *
+ * A condition is held as a 32-bit mask: all ones = true, all zeros = false.
+ * lane_pick(m, a, b) then selects with plain AND/OR, which the compiler
+ * cannot turn back into branches (a chain of "c ? a : b" on related bools
+ * gets merged into a multi-way branch that stops vectorisation).
+ ******************************************************************************/
+
+static inline uint32_t lane_mask(bool condition) {
+    return 0u - (uint32_t)condition;
+}
+
+static inline uint32_t lane_pick(uint32_t mask, uint32_t if_set, uint32_t if_clear) {
+    return (if_set & mask) | (if_clear & ~mask);
+}
+
+/******************************************************************************
+ * step_block - Advance BLOCK_LANES (or fewer) instances by one tick
+ * @return: Non-zero if some lane needs step_effects() or step_ghosts() this tick
+ *
+ * One iteration of the loop = one game_update() for one instance.
+ ******************************************************************************/
+
+static uint32_t step_block(ChaserBatch *b, uint32_t base, uint32_t len, uint32_t now) {
+    uint32_t *__restrict state = b->state + base;
+    uint32_t *__restrict pos = b->pos + base;
+    int32_t *__restrict dir = b->dir + base;
+    uint32_t *__restrict speed = b->speed + base;
+    uint32_t *__restrict last_chase = b->last_chase + base;
+    uint32_t *__restrict score = b->score + base;
+    uint32_t *__restrict high = b->high + base;
+    uint32_t *__restrict new_high = b->new_high + base;
+    uint32_t *__restrict entry = b->entry + base;
+    uint32_t *__restrict saved_high = b->saved_high + base;
+    uint32_t *__restrict press_lane = b->press + base;
+    uint32_t *__restrict attract_lane = b->attract + base;
+    uint32_t *__restrict anim = b->anim + base;
+    uint32_t *__restrict anim_step = b->anim_step + base;
+    uint32_t *__restrict anim_last = b->anim_last + base;
+    uint32_t *__restrict led_frame = b->led_frame + base;
+    uint32_t *__restrict flash_count = b->flash_count + base;
+    uint32_t *__restrict flash_state = b->flash_state + base;
+    uint32_t *__restrict led_last = b->led_last + base;
+    uint32_t *__restrict show_from = b->show_from + base;
+    uint32_t *__restrict fx_lane = b->fx + base;
+    uint32_t *__restrict rally = b->rally + base;
+    uint32_t *__restrict ghost_phase = b->ghost_phase + base;
+    uint32_t *__restrict ghost_next = b->ghost_next + base;
+    uint32_t *__restrict press_steps = b->press_steps + base;
+    uint32_t *__restrict press_ms = b->press_ms + base;
+    uint32_t *__restrict paused_at = b->paused_at + base;
+    uint32_t *__restrict unsaved = b->unsaved + base;
+    uint32_t *__restrict ghost_high = b->ghost_high + base;
+    uint32_t *__restrict gx_lane = b->gx + base;
+    uint32_t *__restrict leds = b->leds + base;
+    uint32_t work_any = 0;
+
+    // The lanes never overlap; saying so spares GCC 20+ run-time alias checks
+#pragma GCC ivdep
+    for (uint32_t i = 0; i < len; i++) {
+        uint32_t st = state[i];
+        uint32_t p = pos[i];
+        uint32_t d = (uint32_t)dir[i];
+        uint32_t spd = speed[i];
+        uint32_t lc = last_chase[i];
+        uint32_t sc = score[i];
+        uint32_t hi = high[i];
+        uint32_t nh = new_high[i];
+        uint32_t en = entry[i];
+        uint32_t sh = saved_high[i];
+        uint32_t pr = press_lane[i];
+        uint32_t at = attract_lane[i];
+        uint32_t an = anim[i];
+        uint32_t stp = anim_step[i];
+        uint32_t al = anim_last[i];
+        uint32_t lf = led_frame[i];
+        uint32_t fc = flash_count[i];
+        uint32_t fs = flash_state[i];
+        uint32_t ll = led_last[i];
+        uint32_t sf = show_from[i];
+        uint32_t gr = rally[i];
+        uint32_t gph = ghost_phase[i];
+        uint32_t gnx = ghost_next[i];
+        uint32_t gps = press_steps[i];
+        uint32_t gpm = press_ms[i];
+        uint32_t gpa = paused_at[i];
+        uint32_t gun = unsaved[i];
+        uint32_t gh = ghost_high[i];
+        uint32_t lv = leds[i];
+
+        /**********************************************************************
+         * hardware.cpp:animation_update()
+         **********************************************************************/
+
+        const uint32_t since_note = now - al;
+        const uint32_t since_led = now - ll;
+        const uint32_t is_bullseye = lane_mask(an == LANE_ANIM_BULLSEYE);
+        const uint32_t is_celebration = lane_mask(an == LANE_ANIM_CELEBRATION);
+        const uint32_t is_game_over = lane_mask(an == LANE_ANIM_GAME_OVER);
+
+        // ANIM_BULLSEYE: next note every DURATION_BULLSEYE_NOTE
+        const uint32_t b_note = is_bullseye & lane_mask(since_note >= DURATION_BULLSEYE_NOTE);
+
+        // ANIM_CELEBRATION buzzer: first note at once, then note length + gap
+        uint32_t gap = 0;
+        gap = lane_pick(lane_mask(stp == 1), CELEBRATION_NOTE_MS_0 + CELEBRATION_NOTE_GAP, gap);
+        gap = lane_pick(lane_mask(stp == 2), CELEBRATION_NOTE_MS_1 + CELEBRATION_NOTE_GAP, gap);
+        gap = lane_pick(lane_mask(stp == 3), CELEBRATION_NOTE_MS_2 + CELEBRATION_NOTE_GAP, gap);
+        gap = lane_pick(lane_mask(stp == 4), CELEBRATION_NOTE_MS_3 + CELEBRATION_NOTE_GAP, gap);
+        const uint32_t c_note = is_celebration & lane_mask(stp < CELEBRATION_NOTES)
+                              & lane_mask(since_note >= gap);
+
+        // ANIM_GAME_OVER buzzer: timer restarts every period, notes stop after 3
+        const uint32_t g_period = is_game_over & lane_mask(since_note >= DURATION_GAME_OVER_NOTE);
+        const uint32_t g_note = g_period & lane_mask(stp < GAME_OVER_NOTES);
+
+        al = lane_pick(b_note | c_note | g_period, now, al);
+        stp += (b_note | c_note | g_note) & 1u;
+        const uint32_t b_done = b_note & lane_mask(stp >= BULLSEYE_NOTES);
+
+        // ANIM_CELEBRATION LEDs: effect frames, all off on the last frame tick
+        const uint32_t c_led = is_celebration & lane_mask(since_led >= CELEBRATION_LED_DELAY);
+        const uint32_t c_move = c_led & lane_mask(lf < CELEBRATION_FRAMES);
+        lf += c_move & 1u;
+        const uint32_t c_frame = c_move & lane_mask(lf < CELEBRATION_FRAMES);
+        lv &= ~(c_move & ~c_frame);
+        uint32_t fx = c_frame & FX_NEXT;
+
+        // ANIM_SHOWCASE LEDs: ATTRACT_SHOW_FRAMES frames, then all off
+        const uint32_t is_showcase = lane_mask(an == LANE_ANIM_SHOWCASE);
+        const uint32_t s_led = is_showcase & lane_mask(since_led >= ATTRACT_SHOW_FRAME_MS);
+        const uint32_t s_frame = s_led & lane_mask(lf < ATTRACT_SHOW_FRAMES);
+        const uint32_t s_done = s_led & ~s_frame;
+        lf += s_frame & 1u;
+        fx |= s_frame & FX_NEXT;
+        lv &= ~s_done;
+
+        // ANIM_GAME_OVER LEDs: all on / all off, GAME_OVER_LED_FLASH_COUNT times
+        const uint32_t g_led = is_game_over & lane_mask(since_led >= GAME_OVER_LED_FLASH_DURATION);
+        const uint32_t next_fs = fs ^ 1u;
+        fs = lane_pick(g_led, next_fs, fs);
+        fc += g_led & next_fs;
+        lv = lane_pick(g_led, ALL_LEDS * next_fs, lv);
+        const uint32_t g_done = g_led & lane_mask(fc >= GAME_OVER_LED_FLASH_COUNT);
+
+        ll = lane_pick(c_led | g_led | s_led, now, ll);
+
+        // Completion (back to ANIM_IDLE)
+        const uint32_t c_done = is_celebration & lane_mask(stp >= CELEBRATION_NOTES)
+                              & lane_mask(lf >= CELEBRATION_FRAMES);
+        an = lane_pick(b_done | c_done | g_done | s_done, LANE_ANIM_IDLE, an);
+        lf &= ~(c_done | s_done);
+        fc &= ~g_done;
+        lv &= ~g_done;
+
+        /**********************************************************************
+         * game.cpp: state_handlers[current_state].update()
+         **********************************************************************/
+
+        const uint32_t in_attract = lane_mask(st == STATE_ATTRACT);
+        const uint32_t in_playing = lane_mask(st == STATE_PLAYING);
+        const uint32_t in_celebration = lane_mask(st == STATE_CELEBRATION);
+        const uint32_t in_game_over = lane_mask(st == STATE_GAME_OVER);
+        const uint32_t anim_idle = lane_mask(an == LANE_ANIM_IDLE);
+
+        // button_service() and ghost_save_service() (before the state
+        // update: the state they saw, game.cpp:between_games())
+        const uint32_t ending = in_celebration | in_game_over;
+        at |= in_attract | ending;
+        const uint32_t g_save = (in_attract | ending) & lane_mask(gun != 0);
+        gun -= g_save & 1u;
+        uint32_t gx = g_save & GX_SAVE;
+
+        // ghost_update() (ATTRACT, while the ghost replays): the pause
+        // after a hit ends, or the final hold does
+        const uint32_t ghosting = in_attract & lane_mask(gph != LANE_GHOST_IDLE);
+        const uint32_t g_rally = ghosting & lane_mask(gph == LANE_GHOST_PAUSE)
+                               & lane_mask(now - gpa >= RESULT_PAUSE_MS);
+        gph = lane_pick(g_rally, lane_pick(lane_mask(gps == GHOST_NO_PRESS), LANE_GHOST_OVER,
+                                           LANE_GHOST_CHASE), gph);
+        lc = lane_pick(g_rally, now, lc);
+        gr &= ~g_rally;
+        const uint32_t g_end = ghosting & lane_mask(gph == LANE_GHOST_OVER)
+                             & lane_mask(now - gpa >= GHOST_END_HOLD_MS);
+        gph = lane_pick(g_end, LANE_GHOST_IDLE, gph);
+        spd = lane_pick(g_end, INITIAL_CHASE_SPEED, spd);
+        lc = lane_pick(g_end, now, lc);
+        sf = lane_pick(g_end, now, sf);
+
+        // ...then the chase, unless the recorded press is already due
+        const uint32_t g_chase = ghosting & lane_mask(gph == LANE_GHOST_CHASE);
+        const uint32_t g_early = g_chase & ~(lane_mask(gr == gps) & lane_mask(now - lc >= gpm));
+
+        // update_chase_position() (ATTRACT and PLAYING only; a showcase
+        // hides the LED but not the movement, a replay moves it itself)
+        const uint32_t chasing = in_attract | in_playing;
+        const uint32_t chase_due = ((chasing & ~ghosting) | g_early) & lane_mask(now - lc >= spd);
+        p = lane_pick(chase_due, p + d, p);
+        d = lane_pick(chase_due & lane_mask(p == 0), 1u, d);
+        d = lane_pick(chase_due & lane_mask(p == NUM_LEDS - 1u), (uint32_t)-1, d);
+        lc = lane_pick(chase_due, now, lc);
+        lv = lane_pick(chase_due & ~(in_attract & ~anim_idle & ~ghosting), 1u << p, lv);  // clear all, set one
+        gr += chase_due & lane_mask(gr < GHOST_NO_PRESS - 1u) & 1u;
+
+        // restart_update(): presses too soon after the miss are dropped
+        pr &= ~(ending & lane_mask(now - en < RESTART_MIN_SHOW_MS));
+
+        // button_just_pressed() (read in ATTRACT, PLAYING, and for a skip in
+        // CELEBRATION / GAME_OVER): one of the presses step_edges() counted
+        const uint32_t press = (chasing | ending) & lane_mask(pr != 0);
+        pr -= press & 1u;
+
+        // Transition triggers (at most one is set)
+        const uint32_t in_zone = lane_mask(p >= TARGET_ZONE_START) & lane_mask(p <= TARGET_ZONE_END);
+        const uint32_t had_record = lane_mask(nh != 0);
+        const uint32_t start = in_attract & press;
+        const uint32_t skip = ending & press;
+        const uint32_t judged = in_playing & press;
+        const uint32_t hit = judged & in_zone;
+        const uint32_t miss = judged & ~in_zone;
+        const uint32_t miss_record = miss & had_record;
+        const uint32_t miss_plain = miss & ~had_record;
+        const uint32_t resume = lane_mask(st == STATE_RESULT) & lane_mask(now - en >= RESULT_PAUSE_MS);
+        const uint32_t c_exit = in_celebration & ~skip & lane_mask(now - en >= CELEBRATION_HOLD_MS);
+        const uint32_t g_exit = in_game_over & ~skip & anim_idle;
+        const uint32_t to_attract = c_exit | g_exit;
+        uint32_t faster = spd - SPEED_DECREASE;                  // speed_up()
+        faster = lane_pick(lane_mask(faster < MIN_CHASE_SPEED), MIN_CHASE_SPEED, faster);
+
+        // ghost_update(): the recorded press, judged where the game judged
+        // it (before a real press: that one starts a game over the replay)
+        const uint32_t g_due = g_chase & lane_mask(gr == gps) & lane_mask(now - lc >= gpm);
+        const uint32_t g_hit = g_due & in_zone;
+        gpa = lane_pick(g_due, now, gpa);
+        gph = lane_pick(g_due, lane_pick(g_hit, LANE_GHOST_PAUSE, LANE_GHOST_OVER), gph);
+        sc = lane_pick(g_hit, (sc + BULLSEYE_SCORE) & 0xFFFFu, sc);
+        an = lane_pick(g_hit, LANE_ANIM_BULLSEYE, an);           // animation_start_bullseye()
+        stp &= ~g_hit;
+        al = lane_pick(g_hit, now, al);
+        spd = lane_pick(g_hit & lane_mask(spd > MIN_CHASE_SPEED), faster, spd);
+        gx |= g_hit & GX_NEXT_PRESS;
+
+        // ATTRACT / CELEBRATION / GAME_OVER -> PLAYING: new_game_setup()
+        const uint32_t new_game = start | skip;
+        sc &= ~new_game;
+        nh &= ~new_game;
+        spd = lane_pick(new_game, INITIAL_CHASE_SPEED, spd);
+        const uint32_t s_abort = new_game & lane_mask(an != LANE_ANIM_IDLE);  // animation_stop()
+        an = lane_pick(s_abort, LANE_ANIM_IDLE, an);
+        lf &= ~s_abort;
+        fc &= ~s_abort;
+        lv &= ~s_abort;
+        fx &= ~s_abort;
+        gph = lane_pick(new_game, LANE_GHOST_IDLE, gph);         // ghost_record_start()
+        gx |= new_game & GX_RECORD_START;
+
+        // Still in ATTRACT, nothing playing: a showcase slot every
+        // ATTRACT_SHOW_PERIOD_MS. Every other one is the ghost's, if it
+        // still holds the record (ghost_take_slot()), else
+        // animation_start_showcase()
+        const uint32_t slot = in_attract & ~start & lane_mask(gph == LANE_GHOST_IDLE)
+                            & lane_mask(an == LANE_ANIM_IDLE)
+                            & lane_mask(now - sf >= ATTRACT_SHOW_PERIOD_MS);
+        const uint32_t g_start = slot & lane_mask(gnx != 0) & lane_mask(gh == hi);
+        gnx = lane_pick(slot, gnx ^ 1u, gnx);
+        sf = lane_pick(slot, now, sf);
+        gx |= g_start & GX_SLOT;
+        const uint32_t show = slot & ~g_start;
+        an = lane_pick(show, LANE_ANIM_SHOWCASE, an);
+        lf = lane_pick(show, 1u, lf);
+        ll = lane_pick(show, now, ll);
+        fx = lane_pick(show, FX_SHOWCASE, fx);
+
+        // PLAYING -> RESULT: scoring in playing_update() + result_enter()
+        sc = lane_pick(hit, (sc + BULLSEYE_SCORE) & 0xFFFFu, sc);
+        const uint32_t beat = hit & lane_mask(sc > hi);
+        nh = lane_pick(beat, 1u, nh);
+        hi = lane_pick(beat, sc, hi);
+        an = lane_pick(hit, LANE_ANIM_BULLSEYE, an);             // animation_start_bullseye()
+        spd = lane_pick(hit & lane_mask(spd > MIN_CHASE_SPEED), faster, spd);
+        gx |= judged & GX_RECORD_PRESS;                          // ghost_record_press()
+
+        // Either way the recording ends: ghost_record_end()
+        gx |= miss & GX_RECORD_END;
+
+        // PLAYING -> CELEBRATION: eeprom_write_high_score() + celebration_enter()
+        sh = lane_pick(miss_record, hi, sh);
+        an = lane_pick(miss_record, LANE_ANIM_CELEBRATION, an);
+        lf &= ~miss_record;
+        fx = lane_pick(miss_record, FX_CELEBRATION, fx);
+
+        // PLAYING -> GAME_OVER: game_over_enter()
+        an = lane_pick(miss_plain, LANE_ANIM_GAME_OVER, an);
+        fc &= ~miss_plain;
+        fs &= ~miss_plain;
+        lv &= ~miss_plain;
+
+        // Common to every animation_start_*() (hit or miss)
+        stp &= ~judged;
+        al = lane_pick(judged, now, al);
+        ll = lane_pick(miss, now, ll);
+        en = lane_pick(hit | miss, now, en);
+
+        // Every -> PLAYING: resync the chase timer, count steps afresh (playing_enter())
+        lc = lane_pick(new_game | resume, now, lc);
+        gr &= ~(new_game | resume);
+
+        // CELEBRATION / GAME_OVER -> ATTRACT: *_exit() + attract_enter()
+        sc &= ~g_exit;
+        pr &= ~(new_game | resume | to_attract);                    // button_clear_state()
+        spd = lane_pick(to_attract, INITIAL_CHASE_SPEED, spd);
+        sf = lane_pick(to_attract, now, sf);
+
+        st = lane_pick(new_game | resume, STATE_PLAYING, st);
+        st = lane_pick(hit, STATE_RESULT, st);
+        st = lane_pick(miss_record, STATE_CELEBRATION, st);
+        st = lane_pick(miss_plain, STATE_GAME_OVER, st);
+        st = lane_pick(to_attract, STATE_ATTRACT, st);
+
+        state[i] = st;
+        pos[i] = p;
+        dir[i] = (int32_t)d;
+        speed[i] = spd;
+        last_chase[i] = lc;
+        score[i] = sc;
+        high[i] = hi;
+        new_high[i] = nh;
+        entry[i] = en;
+        saved_high[i] = sh;
+        press_lane[i] = pr;
+        attract_lane[i] = at;
+        anim[i] = an;
+        anim_step[i] = stp;
+        anim_last[i] = al;
+        led_frame[i] = lf;
+        flash_count[i] = fc;
+        flash_state[i] = fs;
+        led_last[i] = ll;
+        show_from[i] = sf;
+        fx_lane[i] = fx;
+        rally[i] = gr;
+        ghost_phase[i] = gph;
+        ghost_next[i] = gnx;
+        press_steps[i] = gps;
+        press_ms[i] = gpm;
+        paused_at[i] = gpa;
+        unsaved[i] = gun;
+        ghost_high[i] = gh;
+        gx_lane[i] = gx;
+        leds[i] = lv;
+        work_any |= fx | gx;
+    }
+    return work_any;
+}
+
+/******************************************************************************
+ * step_edges - Button changes since the last call, through the debouncer
+ *
+ * Scalar, like the firmware's ISR: button_edge() for every lane whose
+ * button differs from the level its debouncer last saw, at the start of
+ * this millisecond (where sim_set_button() puts it).
+ ******************************************************************************/
+
+static void step_edges(ChaserBatch *b, const uint8_t *buttons) {
+    for (uint32_t i = 0; i < b->count; i++) {
+        if (debounce_edge(&b->debouncer[i], b->now * 1000u, buttons[i] != 0)) {
+            b->press[i]++;
+        }
+    }
+}
+
+/******************************************************************************
+ * step_profiles - button_service() for this call's ATTRACT ticks
+ *
+ * The firmware saves at the first such tick once the estimate has drifted
+ * BOUNCE_SAVE_STEP_US from the saved one; step_edges() is the only thing
+ * that moves the estimate, so it saved the value it has now.
+ ******************************************************************************/
+
+static void step_profiles(ChaserBatch *b) {
+    for (uint32_t i = 0; i < b->count; i++) {
+        uint16_t bounce_us = b->debouncer[i].bounce_us;
+        uint16_t saved_us = b->bounce_saved[i];
+        uint16_t drift = bounce_us > saved_us ? bounce_us - saved_us : saved_us - bounce_us;
+        if (b->attract[i] != 0 && drift >= BOUNCE_SAVE_STEP_US) {
+            b->bounce_saved[i] = bounce_us;
+        }
+        b->attract[i] = 0;
+    }
+}
+
+/******************************************************************************
+ * step_effects - The effect work step_block() left for this tick
+ *
+ * Scalar: the same effect_start()/effect_next() calls as hardware.cpp's
+ * animation code, on the lanes whose fx says so, then clears fx.
+ ******************************************************************************/
+
+static void step_effects(ChaserBatch *b, uint32_t base, uint32_t len, uint32_t now) {
+    for (uint32_t i = base; i < base + len; i++) {
+        uint32_t fx = b->fx[i];
+        if (fx == FX_NONE) {
+            continue;
+        }
+        LedEffect *e = &b->effect[i];
+        if (fx == FX_CELEBRATION) {
+            // animation_start_celebration(): no frame until the first LED tick
+            effect_start(e, &celebration_effects[b->celebration_next[i]], (uint16_t)now);
+            b->celebration_next[i] = (uint8_t)((b->celebration_next[i] + 1) % CELEBRATION_EFFECT_COUNT);
+        } else {
+            if (fx == FX_SHOWCASE) {
+                effect_start(e, &attract_effects[b->attract_next[i]], (uint16_t)now);
+                b->attract_next[i] = (uint8_t)((b->attract_next[i] + 1) % ATTRACT_EFFECT_COUNT);
+            }
+            b->leds[i] = effect_next(e);
+        }
+        b->fx[i] = FX_NONE;
+    }
+}
+
+/******************************************************************************
+ * step_ghosts - The ghost work step_block() left for this tick
+ *
+ * Scalar, like step_effects(): game.cpp's ghost_*() functions on the lanes
+ * whose gx says so, with ghost.h's varints, then clears gx. The vector
+ * loop has already made each decision; what is left is bytes.
+ ******************************************************************************/
+
+/**
+ * ghost_load - game.cpp:ghost_load(), from the lane's EEPROM copy
+ */
+static void ghost_load(ChaserBatch *b, uint32_t i) {
+    uint8_t *image = b->ghost_image + (size_t)i * GHOST_IMAGE_MAX;
+    uint8_t size = b->stored_size[i];
+    memcpy(image, b->stored_image + (size_t)i * GHOST_IMAGE_MAX, size);
+    b->ghost_size[i] = size;
+    b->ghost_high[i] = size == 0 ? GHOST_NONE : (uint32_t)(image[GHOST_SCORE] | image[GHOST_SCORE + 1] << 8);
+    b->unsaved[i] = 0;
+    b->record_at[i] = 0;
+}
+
+/**
+ * ghost_next_press - game.cpp:ghost_next_press()
+ */
+static void ghost_next_press(ChaserBatch *b, uint32_t i, const uint8_t *image) {
+    uint8_t *read = &b->ghost_read[i];
+    uint16_t steps = ghost_get(image, read, b->ghost_size[i]);
+    uint16_t ms = ghost_get(image, read, b->ghost_size[i]);
+    b->press_steps[i] = ms == GHOST_NO_PRESS ? GHOST_NO_PRESS : steps;
+    b->press_ms[i] = ms;
+}
+
+static void step_ghosts(ChaserBatch *b, uint32_t base, uint32_t len, uint32_t now) {
+    for (uint32_t i = base; i < base + len; i++) {
+        uint32_t gx = b->gx[i];
+        if (gx == 0) {
+            continue;
+        }
+        uint8_t *image = b->ghost_image + (size_t)i * GHOST_IMAGE_MAX;
+        uint8_t size = b->ghost_size[i];
+
+        if (gx & GX_SAVE) {
+            // ghost_save_service(): no ghost from its first write (the
+            // magic byte cleared), the new one at its last (written back)
+            if (b->unsaved[i] == size) {
+                b->stored_size[i] = 0;
+            } else if (b->unsaved[i] == 0) {
+                memcpy(b->stored_image + (size_t)i * GHOST_IMAGE_MAX, image, size);
+                b->stored_size[i] = size;
+            }
+        }
+        if (gx & GX_NEXT_PRESS) {
+            ghost_next_press(b, i, image);
+        }
+        if (gx & GX_SLOT) {
+            // ghost_take_slot(): start as the recorded game did
+            b->pos[i] = image[GHOST_POSITION];
+            b->dir[i] = (int8_t)image[GHOST_DIRECTION];
+            b->speed[i] = INITIAL_CHASE_SPEED;
+            b->score[i] = 0;
+            b->ghost_read[i] = GHOST_HEADER_SIZE;
+            ghost_next_press(b, i, image);
+            b->ghost_phase[i] = LANE_GHOST_CHASE;
+            b->last_chase[i] = now;
+            b->rally[i] = 0;
+            b->leds[i] = 1u << b->pos[i];
+        }
+        if (gx & GX_RECORD_START) {
+            // ghost_record_start(): not over a ghost still being saved
+            b->record_at[i] = 0;
+            if (b->unsaved[i] == 0) {
+                b->ghost_size[i] = 0;
+                b->ghost_high[i] = GHOST_NONE;
+                memset(image, 0, GHOST_HEADER_SIZE);   // No latency, seed or game mode
+                image[GHOST_POSITION] = (uint8_t)b->pos[i];
+                image[GHOST_DIRECTION] = (uint8_t)b->dir[i];
+                b->record_at[i] = GHOST_HEADER_SIZE;
+            }
+        }
+        if ((gx & GX_RECORD_PRESS) && b->record_at[i] != 0) {
+            // ghost_record_press()
+            uint8_t at = ghost_put(image, b->record_at[i], (uint16_t)b->rally[i]);
+            b->record_at[i] = at == 0 ? 0 : ghost_put(image, at, (uint16_t)(now - b->last_chase[i]));
+        }
+        if (gx & GX_RECORD_END) {
+            // ghost_record_end(): a record keeps the recording, any other
+            // miss reads back the stored ghost it was recorded over
+            if (GHOST_KEPT && b->new_high[i] != 0 && b->record_at[i] != 0) {
+                uint32_t score = b->score[i];
+                image[GHOST_SCORE] = (uint8_t)score;
+                image[GHOST_SCORE + 1] = (uint8_t)(score >> 8);
+                ghost_image_seal(image, b->record_at[i]);
+                b->ghost_size[i] = b->record_at[i];
+                b->ghost_high[i] = score;
+                b->unsaved[i] = (uint32_t)b->record_at[i] + 1;
+            } else if (b->ghost_size[i] == 0) {
+                ghost_load(b, i);
+            }
+            b->record_at[i] = 0;
+        }
+        b->gx[i] = 0;
+    }
+}
+
+/******************************************************************************
+ * PUBLIC INTERFACE
+ ******************************************************************************/
+
+ChaserBatch *chaser_batch_create(uint32_t count, uint16_t saved_high_score) {
+    ChaserBatch *b = (ChaserBatch *)calloc(1, sizeof(ChaserBatch));
+    if (b == NULL) {
+        return NULL;
+    }
+    b->count = count;
+    b->now = 0;
+
+    uint32_t **lanes[] = {
+        &b->state, &b->pos, (uint32_t **)&b->dir, &b->speed, &b->last_chase,
+        &b->score, &b->high, &b->new_high, &b->entry, &b->saved_high,
+        &b->press, &b->attract, &b->anim, &b->anim_step, &b->anim_last,
+        &b->led_frame, &b->flash_count, &b->flash_state, &b->led_last,
+        &b->show_from, &b->fx, &b->rally, &b->ghost_phase, &b->ghost_next,
+        &b->press_steps, &b->press_ms, &b->paused_at, &b->unsaved,
+        &b->ghost_high, &b->gx, &b->leds
+    };
+    for (size_t f = 0; f < sizeof(lanes) / sizeof(lanes[0]); f++) {
+        *lanes[f] = (uint32_t *)lane_alloc(count);
+        if (*lanes[f] == NULL) {
+            chaser_batch_destroy(b);
+            return NULL;
+        }
+    }
+    b->effect = (LedEffect *)calloc(count ? count : 1, sizeof(LedEffect));
+    b->celebration_next = (uint8_t *)calloc(count ? count : 1, 1);
+    b->attract_next = (uint8_t *)calloc(count ? count : 1, 1);
+    b->debouncer = (Debouncer *)calloc(count ? count : 1, sizeof(Debouncer));
+    b->bounce_saved = (uint16_t *)calloc(count ? count : 1, sizeof(uint16_t));
+    b->ghost_image = (uint8_t *)calloc(count ? count : 1, GHOST_IMAGE_MAX);
+    b->ghost_size = (uint8_t *)calloc(count ? count : 1, 1);
+    b->ghost_read = (uint8_t *)calloc(count ? count : 1, 1);
+    b->record_at = (uint8_t *)calloc(count ? count : 1, 1);
+    b->stored_image = (uint8_t *)calloc(count ? count : 1, GHOST_IMAGE_MAX);
+    b->stored_size = (uint8_t *)calloc(count ? count : 1, 1);   // EEPROM erased: no ghost
+    if (b->effect == NULL || b->celebration_next == NULL || b->attract_next == NULL ||
+        b->debouncer == NULL || b->bounce_saved == NULL || b->ghost_image == NULL ||
+        b->ghost_size == NULL || b->ghost_read == NULL || b->record_at == NULL ||
+        b->stored_image == NULL || b->stored_size == NULL) {
+        chaser_batch_destroy(b);
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        b->saved_high[i] = saved_high_score;
+        b->bounce_saved[i] = BOUNCE_DEFAULT_US;   // Nothing learned yet
+        chaser_batch_reset(b, i);
+    }
+    return b;
+}
+
+void chaser_batch_destroy(ChaserBatch *b) {
+    if (b == NULL) {
+        return;
+    }
+    void *lanes[] = {
+        b->state, b->pos, b->dir, b->speed, b->last_chase, b->score, b->high,
+        b->new_high, b->entry, b->saved_high, b->press, b->attract,
+        b->anim, b->anim_step, b->anim_last, b->led_frame, b->flash_count,
+        b->flash_state, b->led_last, b->show_from, b->fx, b->rally,
+        b->ghost_phase, b->ghost_next, b->press_steps, b->press_ms,
+        b->paused_at, b->unsaved, b->ghost_high, b->gx, b->leds,
+        b->effect, b->celebration_next, b->attract_next, b->debouncer,
+        b->bounce_saved, b->ghost_image, b->ghost_size, b->ghost_read,
+        b->record_at, b->stored_image, b->stored_size
+    };
+    for (size_t f = 0; f < sizeof(lanes) / sizeof(lanes[0]); f++) {
+        free(lanes[f]);
+    }
+    free(b);
+}
+
+uint32_t chaser_batch_count(const ChaserBatch *b) {
+    return b->count;
+}
+
+uint32_t chaser_batch_millis(const ChaserBatch *b) {
+    return b->now;
+}
+
+/**
+ * chaser_batch_reset - setup() for one instance
+ *
+ * Mirrors hardware_init() + game_init() with the button released. Note that
+ * game_init() enters STATE_ATTRACT through game_transition_to(), so
+ * attract_exit() runs once at boot and calls button_clear_state(), which
+ * finds no presses to forget.
+ */
+void chaser_batch_reset(ChaserBatch *b, uint32_t i) {
+    if (i >= b->count) {
+        return;
+    }
+    const uint32_t now = b->now;
+
+    // hardware_init()
+    b->leds[i] = 0;
+    b->anim[i] = LANE_ANIM_IDLE;
+    b->led_frame[i] = 0;
+    b->flash_count[i] = 0;
+    b->fx[i] = FX_NONE;
+    b->celebration_next[i] = 0;                // animation_rewind_playlists()
+    b->attract_next[i] = 0;
+    debounce_start(&b->debouncer[i], false, b->bounce_saved[i]);
+    b->press[i] = 0;
+    b->attract[i] = 0;
+
+    // game_init()
+    b->pos[i] = 0;
+    b->dir[i] = 1;
+    b->speed[i] = INITIAL_CHASE_SPEED;
+    b->last_chase[i] = now;
+    b->high[i] = b->saved_high[i];
+    b->score[i] = 0;
+    b->new_high[i] = 0;
+    b->state[i] = STATE_ATTRACT;
+    b->show_from[i] = now;                     // attract_enter()
+    b->ghost_phase[i] = LANE_GHOST_IDLE;
+    b->ghost_next[i] = 1;
+    b->rally[i] = 0;
+    b->ghost_read[i] = 0;
+    b->press_steps[i] = 0;
+    b->press_ms[i] = 0;
+    b->paused_at[i] = 0;
+    b->gx[i] = 0;
+    ghost_load(b, i);                          // What the EEPROM holds
+}
+
+void chaser_batch_step(ChaserBatch *b, const uint8_t *buttons, uint32_t ticks) {
+    step_edges(b, buttons);
+    for (uint32_t base = 0; base < b->count; base += BLOCK_LANES) {
+        const uint32_t len = (b->count - base < BLOCK_LANES) ? b->count - base : BLOCK_LANES;
+        for (uint32_t t = 0; t < ticks; t++) {
+            if (step_block(b, base, len, b->now + t) != 0) {
+                step_effects(b, base, len, b->now + t);
+                step_ghosts(b, base, len, b->now + t);
+            }
+        }
+    }
+    step_profiles(b);
+    b->now += ticks;
+}
+
+void chaser_batch_view(const ChaserBatch *b, ChaserView *view) {
+    view->state = b->state;
+    view->position = b->pos;
+    view->direction = b->dir;
+    view->chase_speed = b->speed;
+    view->score = b->score;
+    view->high_score = b->high;
+    view->leds = b->leds;
+}
@@ -0,0 +1,130 @@
+/******************************************************************************
+ * CHASER.H - libchaser: Batched Game Engine (Host C ABI)
+ *
+ * Offline bot training needs millions of game steps per second. Stepping one
+ * simulated board at a time through sim.h is far too slow for that, so
+ * libchaser re-expresses the game logic of game.cpp (plus the animation
+ * timing from hardware.cpp that game.cpp waits on) for THOUSANDS of game
+ * instances at once.
+ *
+ * STRUCT-OF-ARRAYS LAYOUT:
+ *
+ * Array-of-structs (one struct per game) interleaves unrelated fields:
+ *   [state pos speed score ...][state pos speed score ...] ...
+ *
+ * Struct-of-arrays (what we do) keeps each field contiguous:
+ *   state: [g0 g1 g2 g3 g4 g5 g6 g7 ...]
+ *   pos:   [g0 g1 g2 g3 g4 g5 g6 g7 ...]
+ *
+ * With every field stored as a 32-bit lane, one AVX2 register holds the same
+ * field for 8 games, and the compiler can update 8 games per instruction.
+ *
+ * TICKS:
+ * One tick = one loop() iteration at one millisecond of virtual time, the
+ * same unit the host simulator uses (see sim.h). All instances share one
+ * clock. Results are bit-identical to running game.cpp in the simulator
+ * with the same button levels (check with: chaser-bench --verify).
+ *
+ * Instances model an uncalibrated cabinet (latency offset 0, see config.h)
+ * whose self-test passes, so they never enter STATE_CALIBRATION or
+ * STATE_SELF_TEST (they always boot with the button released).
+ *
+ * USAGE (from C, Python ctypes, etc.):
+ *   ChaserBatch *batch = chaser_batch_create(4096, 0);
+ *   uint8_t buttons[4096];          // 1 = button held during the step
+ *   ChaserView view;
+ *   for (;;) {
+ *       chaser_batch_view(batch, &view);
+ *       decide_buttons(&view, buttons);
+ *       chaser_batch_step(batch, buttons, 16);  // 16 ms per decision
+ *   }
+ *   chaser_batch_destroy(batch);
+ ******************************************************************************/
+
+#ifndef CHASER_H
+#define CHASER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define CHASER_API __attribute__((visibility("default")))
+#else
+#define CHASER_API
+#endif
+
+typedef struct ChaserBatch ChaserBatch;
+
+/**
+ * ChaserView - Read-only pointers to the per-instance arrays
+ *
+ * Each pointer addresses chaser_batch_count() values, index = instance.
+ * The pointers stay valid until chaser_batch_destroy().
+ *
+ * state: GameState value (see config.h)
+ * position: Chase LED index (0-7)
+ * direction: +1 = moving right, -1 = moving left
+ * chase_speed: ms between LED movements
+ * score / high_score: Same meaning as in game.cpp
+ * leds: LED output as a bit mask (bit 0 = LED 0)
+ */
+typedef struct {
+    const uint32_t *state;
+    const uint32_t *position;
+    const int32_t *direction;
+    const uint32_t *chase_speed;
+    const uint32_t *score;
+    const uint32_t *high_score;
+    const uint32_t *leds;
+} ChaserView;
+
+/**
+ * chaser_batch_create - Allocate and boot a batch of games
+ * @param count: Number of game instances
+ * @param saved_high_score: High score every instance finds in "EEPROM"
+ *                          (with no bounce profile saved yet)
+ * @return: New batch (all instances in STATE_ATTRACT at t = 0), NULL on failure
+ *
+ * chaser_batch_destroy - Free a batch
+ */
+CHASER_API ChaserBatch *chaser_batch_create(uint32_t count, uint16_t saved_high_score);
+CHASER_API void chaser_batch_destroy(ChaserBatch *batch);
+
+/**
+ * chaser_batch_count - Number of instances in the batch
+ * chaser_batch_millis - Shared virtual time (ms) of the next tick
+ */
+CHASER_API uint32_t chaser_batch_count(const ChaserBatch *batch);
+CHASER_API uint32_t chaser_batch_millis(const ChaserBatch *batch);
+
+/**
+ * chaser_batch_reset - Power-cycle one instance at the current time
+ * @param index: Instance to reset
+ *
+ * Equivalent to sim_power_on(chaser_batch_millis()) with the button released.
+ * The instance keeps its saved ("EEPROM") high score and bounce profile.
+ */
+CHASER_API void chaser_batch_reset(ChaserBatch *batch, uint32_t index);
+
+/**
+ * chaser_batch_step - Advance every instance by a number of ticks
+ * @param buttons: One byte per instance, non-zero = button held down for
+ *                 all of these ticks. A change from the last call is one
+ *                 clean edge at the first tick, as from sim_set_button()
+ * @param ticks: Milliseconds of game time to simulate
+ */
+CHASER_API void chaser_batch_step(ChaserBatch *batch, const uint8_t *buttons, uint32_t ticks);
+
+/**
+ * chaser_batch_view - Get pointers to the per-instance arrays
+ */
+CHASER_API void chaser_batch_view(const ChaserBatch *batch, ChaserView *view);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CHASER_H
@@ -0,0 +1,383 @@
+/******************************************************************************
+ * CORPUS.CPP - Replay Corpus Reader, Writer and Session Replay
+ *
+ * See corpus.h for the file layout. Integers are assembled byte by byte so
+ * the format does not depend on host endianness or struct padding, and every
+ * read is bounds-checked against the mapping (a truncated file must produce
+ * an error, not a crash in a worker process).
+ *
+ * Related files:
+ * - corpus.h: Format description and interface
+ * - sim.h: sim_run_until() and sim_set_loop_hook() used by the replay
+ ******************************************************************************/
+
+#include "corpus.h"
+#include "sim.h"
+#include "game.h"
+#include "hardware.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char CORPUS_MAGIC[4] = {'L', 'C', 'R', 'P'};
+static const uint32_t FILE_HEADER_SIZE = 32;
+static const uint32_t SESSION_HEADER_SIZE = 24;
+static const uint32_t INDEX_ENTRY_SIZE = 16;
+
+/******************************************************************************
+ * LITTLE-ENDIAN AND VARINT ENCODING
+ ******************************************************************************/
+
+static uint16_t get_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get_u64(const uint8_t *p) {
+    return (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+static void put_u16(std::vector<uint8_t> *out, uint16_t v) {
+    out->push_back((uint8_t)v);
+    out->push_back((uint8_t)(v >> 8));
+}
+
+static void put_u32(std::vector<uint8_t> *out, uint32_t v) {
+    put_u16(out, (uint16_t)v);
+    put_u16(out, (uint16_t)(v >> 16));
+}
+
+static void put_u64(std::vector<uint8_t> *out, uint64_t v) {
+    put_u32(out, (uint32_t)v);
+    put_u32(out, (uint32_t)(v >> 32));
+}
+
+static void put_varint(std::vector<uint8_t> *out, uint32_t v) {
+    while (v >= 0x80) {
+        out->push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out->push_back((uint8_t)v);
+}
+
+/**
+ * get_varint - Decode one varint
+ * @return: false if the stream ends (or the value overflows) before its end
+ */
+static bool get_varint(const uint8_t **p, const uint8_t *end, uint32_t *value) {
+    uint32_t v = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7) {
+        if (*p >= end) {
+            return false;
+        }
+        uint8_t b = *(*p)++;
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) {
+            *value = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+/******************************************************************************
+ * READING (mmap)
+ ******************************************************************************/
+
+bool corpus_open(const char *path, Corpus *corpus) {
+    memset(corpus, 0, sizeof(*corpus));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < FILE_HEADER_SIZE) {
+        fprintf(stderr, "%s: not a replay corpus (too short)\n", path);
+        close(fd);
+        return false;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);  // The mapping keeps the file alive
+    if (map == MAP_FAILED) {
+        perror(path);
+        return false;
+    }
+
+    const uint8_t *data = (const uint8_t *)map;
+    size_t size = (size_t)st.st_size;
+    uint32_t count = get_u32(data + 8);
+    uint64_t index_offset = get_u64(data + 16);
+
+    if (memcmp(data, CORPUS_MAGIC, 4) != 0 || get_u16(data + 4) != CORPUS_VERSION ||
+        index_offset > size || (size - index_offset) / INDEX_ENTRY_SIZE < count) {
+        fprintf(stderr, "%s: not a version %u replay corpus\n", path, CORPUS_VERSION);
+        munmap(map, size);
+        return false;
+    }
+
+    // Index is read sequentially by every worker; tell the kernel
+    madvise(map, size, MADV_WILLNEED);
+
+    corpus->data = data;
+    corpus->size = size;
+    corpus->session_count = count;
+    corpus->index = data + index_offset;
+    return true;
+}
+
+void corpus_close(Corpus *corpus) {
+    if (corpus->data != NULL) {
+        munmap((void *)corpus->data, corpus->size);
+    }
+    memset(corpus, 0, sizeof(*corpus));
+}
+
+bool corpus_get_session(const Corpus *corpus, uint32_t index, CorpusSession *session) {
+    if (index >= corpus->session_count) {
+        return false;
+    }
+    const uint8_t *entry = corpus->index + (size_t)index * INDEX_ENTRY_SIZE;
+    uint64_t offset = get_u64(entry);
+    uint32_t size = get_u32(entry + 8);
+    if (offset > corpus->size || corpus->size - offset < size || size < SESSION_HEADER_SIZE) {
+        return false;
+    }
+
+    const uint8_t *p = corpus->data + offset;
+    session->saved_high_score = get_u16(p);
+    session->duration_ms = get_u32(p + 4);
+    session->input_count = get_u32(p + 8);
+    session->transition_count = get_u32(p + 12);
+    session->final_score = get_u16(p + 16);
+    session->final_high_score = get_u16(p + 18);
+    session->games = get_u32(p + 20);
+    session->inputs = p + SESSION_HEADER_SIZE;
+    session->end = p + size;
+
+    // The transition stream starts where the input varints end. The last
+    // input must come by duration_ms: corpus_replay() runs on to it
+    const uint8_t *q = session->inputs;
+    uint64_t t = 0;
+    for (uint32_t i = 0; i < session->input_count; i++) {
+        uint32_t delta;
+        if (!get_varint(&q, session->end, &delta)) {
+            return false;
+        }
+        t += delta;
+    }
+    if (t > session->duration_ms) {
+        return false;
+    }
+    session->transitions = q;
+    return true;
+}
+
+/******************************************************************************
+ * WRITING
+ ******************************************************************************/
+
+bool corpus_write(const char *path, const std::vector<CorpusRecording> &sessions) {
+    std::vector<uint8_t> out;
+    std::vector<uint64_t> offsets;
+
+    out.insert(out.end(), CORPUS_MAGIC, CORPUS_MAGIC + 4);
+    put_u16(&out, CORPUS_VERSION);
+    put_u16(&out, (uint16_t)FILE_HEADER_SIZE);
+    put_u32(&out, (uint32_t)sessions.size());
+    put_u32(&out, 0);                       // Reserved
+    put_u64(&out, 0);                       // Index offset, patched below
+    put_u64(&out, 0);                       // Reserved
+
+    for (const CorpusRecording &rec : sessions) {
+        offsets.push_back(out.size());
+        put_u16(&out, rec.saved_high_score);
+        put_u16(&out, 0);                   // Flags (none defined yet)
+        put_u32(&out, rec.duration_ms);
+        put_u32(&out, (uint32_t)rec.input_times.size());
+        put_u32(&out, (uint32_t)rec.transitions.size());
+        put_u16(&out, rec.final_score);
+        put_u16(&out, rec.final_high_score);
+        put_u32(&out, rec.games);
+
+        uint32_t last = 0;
+        for (uint32_t t : rec.input_times) {
+            put_varint(&out, t - last);
+            last = t;
+        }
+        last = 0;
+        for (const CorpusTransition &tr : rec.transitions) {
+            put_varint(&out, tr.time - last);
+            out.push_back((uint8_t)tr.state);
+            last = tr.time;
+        }
+    }
+
+    uint64_t index_offset = out.size();
+    for (size_t i = 0; i < offsets.size(); i++) {
+        uint64_t end = (i + 1 < offsets.size()) ? offsets[i + 1] : index_offset;
+        put_u64(&out, offsets[i]);
+        put_u32(&out, (uint32_t)(end - offsets[i]));
+        put_u32(&out, 0);                   // Reserved
+    }
+    for (uint8_t b = 0; b < 8; b++) {
+        out[16 + b] = (uint8_t)(index_offset >> (8 * b));
+    }
+
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+    bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+    ok = (fclose(f) == 0) && ok;
+    return ok;
+}
+
+/******************************************************************************
+ * REPLAY
+ *
+ * The loop hook sees every loop() the simulator runs. It notices state
+ * changes by comparing against the previous state, which is exact because
+ * game_update() performs at most one transition per call.
+ ******************************************************************************/
+
+typedef struct {
+    GameState last_state;
+    uint32_t games;
+
+    // Recording mode
+    CorpusRecording *recording;
+
+    // Verify mode
+    const CorpusSession *session;
+    const uint8_t *next;         // Next expected transition in the stream
+    uint32_t checked;            // Transitions compared so far
+    uint32_t expected_time;
+    ReplayResult *result;
+} ReplayContext;
+
+static ReplayContext ctx;
+
+static void on_transition(uint32_t now, GameState state) {
+    if (ctx.recording != NULL) {
+        ctx.recording->transitions.push_back({now, state});
+        return;
+    }
+    if (ctx.result->diverged) {
+        return;  // Only the first difference is reported
+    }
+
+    uint32_t delta;
+    const CorpusSession *s = ctx.session;
+    if (ctx.checked >= s->transition_count || !get_varint(&ctx.next, s->end, &delta) ||
+        ctx.next >= s->end) {
+        ctx.result->diverged = true;
+        snprintf(ctx.result->message, sizeof(ctx.result->message),
+                 "extra transition #%u to state %d at t=%u ms", ctx.checked, (int)state, now);
+        return;
+    }
+    ctx.expected_time += delta;
+    GameState expected = (GameState)*ctx.next++;
+    if (expected != state || ctx.expected_time != now) {
+        ctx.result->diverged = true;
+        snprintf(ctx.result->message, sizeof(ctx.result->message),
+                 "transition #%u: expected state %d at t=%u ms, got state %d at t=%u ms",
+                 ctx.checked, (int)expected, ctx.expected_time, (int)state, now);
+    }
+    ctx.checked++;
+}
+
+static void replay_loop_hook(void) {
+    GameStatus status;
+    game_get_status(&status);
+    if (status.state != ctx.last_state) {
+        if (ctx.last_state == STATE_PLAYING &&
+            (status.state == STATE_CELEBRATION || status.state == STATE_GAME_OVER)) {
+            ctx.games++;
+        }
+        on_transition(sim_millis(), status.state);
+        ctx.last_state = status.state;
+    }
+}
+
+static void power_on(uint16_t saved_high_score) {
+    sim_eeprom_erase();
+    eeprom_write_high_score(saved_high_score);
+    sim_set_button(false);
+    sim_power_on(0);
+    ctx.last_state = STATE_ATTRACT;
+    ctx.games = 0;
+    sim_set_loop_hook(replay_loop_hook);
+}
+
+void corpus_record_outcome(CorpusRecording *rec) {
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.recording = rec;
+    rec->transitions.clear();
+    power_on(rec->saved_high_score);
+
+    bool pressed = false;
+    for (uint32_t t : rec->input_times) {
+        sim_run_until(t);
+        pressed = !pressed;
+        sim_set_button(pressed);
+    }
+    sim_run_until(rec->duration_ms);
+    sim_set_loop_hook(NULL);
+
+    GameStatus status;
+    game_get_status(&status);
+    rec->final_score = status.score;
+    rec->final_high_score = status.high_score;
+    rec->games = ctx.games;
+}
+
+void corpus_replay(const CorpusSession *s, ReplayResult *result) {
+    memset(result, 0, sizeof(*result));
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.session = s;
+    ctx.next = s->transitions;
+    ctx.result = result;
+    power_on(s->saved_high_score);
+
+    const uint8_t *p = s->inputs;
+    uint32_t t = 0;
+    bool pressed = false;
+    for (uint32_t i = 0; i < s->input_count && !result->diverged; i++) {
+        uint32_t delta = 0;
+        get_varint(&p, s->transitions, &delta);  // Validated by corpus_get_session()
+        t += delta;
+        result->loops += sim_run_until(t);
+        pressed = !pressed;
+        sim_set_button(pressed);
+    }
+    if (!result->diverged) {
+        result->loops += sim_run_until(s->duration_ms);
+    }
+    sim_set_loop_hook(NULL);
+    result->games = ctx.games;
+
+    if (result->diverged) {
+        return;
+    }
+    GameStatus status;
+    game_get_status(&status);
+    if (ctx.checked != s->transition_count) {
+        result->diverged = true;
+        snprintf(result->message, sizeof(result->message),
+                 "only %u of %u transitions happened", ctx.checked, s->transition_count);
+    } else if (status.score != s->final_score || status.high_score != s->final_high_score) {
+        result->diverged = true;
+        snprintf(result->message, sizeof(result->message),
+                 "final score %u / high %u, expected %u / %u",
+                 status.score, status.high_score, s->final_score, s->final_high_score);
+    }
+}
@@ -0,0 +1,160 @@
+/******************************************************************************
+ * CORPUS.H - Replay Corpus: Recorded Sessions and Their Expected Outcomes
+ *
+ * A replay corpus is one file holding thousands of player sessions. Each
+ * session is the button input of one power-on (when the button went down and
+ * up) plus what the firmware did with it: every state transition with its
+ * time, and the final scores. Replaying a session through game.cpp and
+ * comparing against the recording shows whether a firmware change altered
+ * gameplay.
+ *
+ * FILE LAYOUT (all integers little-endian):
+ *
+ *   ┌──────────────────────────────┐  offset 0
+ *   │ file header (32 bytes)       │  magic "LCRP", version, session count,
+ *   │                              │  index offset
+ *   ├──────────────────────────────┤  offset 32
+ *   │ session 0                    │  session header (24 bytes)
+ *   │ session 1                    │  + input stream
+ *   │ ...                          │  + transition stream
+ *   ├──────────────────────────────┤  index offset
+ *   │ index: offset + size of      │  16 bytes per session
+ *   │ every session                │
+ *   └──────────────────────────────┘
+ *
+ * Session header: saved high score (u16), flags (u16), duration ms (u32),
+ * input count (u32), transition count (u32), final score (u16), final high
+ * score (u16), completed games (u32).
+ *
+ * Input stream: one varint per button change, the ms since the previous
+ * change (or since power-on). Levels alternate, starting with "pressed".
+ *
+ * Transition stream: per state change, a varint of ms since the previous
+ * transition (or power-on) followed by the new GameState byte.
+ *
+ * Varints are LEB128: 7 bits per byte, high bit set = more bytes follow.
+ * A typical press costs 2-3 bytes, so a long session is a few hundred bytes.
+ *
+ * ZERO-COPY LOADING:
+ * corpus_open() maps the file with mmap() and corpus_get_session() returns
+ * pointers straight into the mapping. Nothing is parsed up front, and forked
+ * worker processes share the same physical pages.
+ *
+ * Related files:
+ * - tools/replay_corpus.cpp: Corpus generator and parallel verifier
+ * - sim.h: The virtual board sessions are replayed on
+ ******************************************************************************/
+
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "config.h"
+
+const uint16_t CORPUS_VERSION = 1;
+
+/**
+ * CorpusSession - One session, pointing into the mapped file
+ */
+typedef struct {
+    uint16_t saved_high_score;   // In EEPROM before power-on
+    uint32_t duration_ms;        // Session length (power-on to power-off)
+    uint32_t input_count;        // Button changes
+    uint32_t transition_count;   // State transitions (excluding power-on)
+    uint16_t final_score;        // Expected game_get_status() at the end
+    uint16_t final_high_score;
+    uint32_t games;              // Completed games in the session
+    const uint8_t *inputs;       // Input stream (see layout above)
+    const uint8_t *transitions;  // Transition stream
+    const uint8_t *end;          // First byte after this session
+} CorpusSession;
+
+/**
+ * Corpus - An open, memory-mapped corpus file
+ */
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    uint32_t session_count;
+    const uint8_t *index;
+} Corpus;
+
+/**
+ * corpus_open - Map a corpus file read-only
+ * @return: false (with a message on stderr) if missing or malformed
+ *
+ * corpus_close - Unmap it
+ */
+bool corpus_open(const char *path, Corpus *corpus);
+void corpus_close(Corpus *corpus);
+
+/**
+ * corpus_get_session - Locate session @index inside the mapping
+ * @return: false if the index entry or session header is out of bounds, or
+ *          the inputs run past duration_ms (replay would wait ~49 days)
+ */
+bool corpus_get_session(const Corpus *corpus, uint32_t index, CorpusSession *session);
+
+/**
+ * CorpusTransition / CorpusRecording - A session being recorded
+ *
+ * input_times holds the absolute time of every button change (press,
+ * release, press, ...). Filled in by the generator, written by
+ * corpus_write().
+ */
+typedef struct {
+    uint32_t time;
+    GameState state;
+} CorpusTransition;
+
+typedef struct {
+    uint16_t saved_high_score;
+    uint32_t duration_ms;
+    std::vector<uint32_t> input_times;
+    std::vector<CorpusTransition> transitions;
+    uint16_t final_score;
+    uint16_t final_high_score;
+    uint32_t games;
+} CorpusRecording;
+
+/**
+ * corpus_write - Write a whole corpus file
+ * @return: false if the file could not be written
+ */
+bool corpus_write(const char *path, const std::vector<CorpusRecording> &sessions);
+
+/**
+ * ReplayResult - Outcome of replaying one session
+ *
+ * diverged: false if every transition (state and time) and the final scores
+ * matched. Otherwise message describes the FIRST difference.
+ */
+typedef struct {
+    bool diverged;
+    uint32_t games;              // Completed games seen during the replay
+    uint32_t loops;              // loop() calls executed
+    char message[160];
+} ReplayResult;
+
+/**
+ * corpus_replay - Replay one session through game.cpp and compare
+ *
+ * Power-cycles the virtual board with the session's saved high score, feeds
+ * the inputs with the event-skipping clock (sim_run_until()) and checks
+ * every transition as it happens.
+ */
+void corpus_replay(const CorpusSession *session, ReplayResult *result);
+
+/**
+ * corpus_record_outcome - Fill in the expected outputs of a recording
+ * @param recording: saved_high_score, duration_ms and input_times set;
+ *                   transitions, final scores and games are filled in
+ *
+ * Runs the inputs through the CURRENT firmware, so the corpus captures
+ * today's behaviour as the reference for future changes.
+ */
+void corpus_record_outcome(CorpusRecording *recording);
+
+#endif // CORPUS_H
@@ -0,0 +1,692 @@
+/******************************************************************************
+ * SIM.CPP - Host Simulator ("Virtual Board") Implementation
+ *
+ * Implements the host Arduino core declared in Arduino.h, EEPROM.h and
+ * LiquidCrystal_I2C.h, plus the sim_* control functions from sim.h.
+ *
+ * All board state lives in one static struct so that sim_power_on() can put
+ * the board back into a known state with a single assignment.
+ *
+ * Every HAL call also charges what it would cost on the Uno (avr_costs.h)
+ * to the virtual cycle counter. The counter is only ever read by tools: it
+ * never feeds back into millis(), micros() or the game.
+ *
+ * Related files:
+ * - sim.h: Public simulator interface used by the host tools
+ * - hardware.cpp / game.cpp: The firmware being simulated
+ ******************************************************************************/
+
+#include "sim.h"
+#include "avr_costs.h"
+#include "config.h"
+#include "hardware.h"
+#include "game.h"
+#include "timebase.h"
+#include "coin.h"
+#include "tone_timer.h"
+#include <EEPROM.h>
+#include <LiquidCrystal_I2C.h>
+#include <Wire.h>
+#include <stdio.h>
+
+static const uint8_t SIM_NUM_PINS = 20;  // D0-D13 + A0-A5
+
+// Bus time model for micros() (see sim.h). A PCF8574 LCD backpack sends each
+// LCD byte as 2 nibbles x 3 expander writes of ~200 us at 100 kHz, plus the
+// library's enable-pulse delays.
+static const uint32_t SIM_LCD_BYTE_US = 1300;
+static const uint32_t SIM_LCD_CLEAR_US = 2000;       // HD44780 clear command
+static const uint32_t SIM_EEPROM_WRITE_US = 3300;    // Per byte actually written
+static const uint32_t SIM_I2C_PROBE_US = 100;        // Start + address + stop
+static const uint32_t SIM_I2C_BYTE_US = 90;          // 8 bits + ACK at 100 kHz
+
+// MCP23017 registers (IOCON.BANK = 0 layout, see hardware.cpp section 6)
+static const uint8_t MCP_REGISTERS = 0x16;
+static const uint8_t MCP_GPINTENA = 0x04;
+static const uint8_t MCP_IOCON = 0x0A;
+static const uint8_t MCP_INTFA = 0x0E;
+static const uint8_t MCP_INTCAPA = 0x10;
+static const uint8_t MCP_GPIOA = 0x12;
+static const uint8_t MCP_IOCON_MIRROR = 0x40;
+static const uint8_t SIM_EXPANDER_SCHEDULE = 64;
+
+typedef struct {
+    char text[LCD_ROWS][LCD_COLS + 1];
+    uint8_t col;
+    uint8_t row;
+} SimLcd;
+
+// Everything that is lost on reset (pins, peripherals, clock)
+typedef struct {
+    uint32_t now;                        // Virtual millis()
+    uint32_t cpu_us;                     // Virtual micros() (see sim.h)
+    uint8_t pin_mode[SIM_NUM_PINS];
+    uint8_t pin_out[SIM_NUM_PINS];       // Level driven by digitalWrite()
+    bool button_pressed;                 // Physical button level
+    uint16_t tone_frequency;             // Most recent tone_play() frequency
+    uint32_t tone_count;                 // tone_play() calls since power on
+    SimLcd lcd[2];                       // By backpack: LCD_ADDRESS, LCD_ALT_ADDRESS
+    uint32_t pin_change_us;              // timebase_pin_change_us()
+    uint8_t mcp[MCP_REGISTERS];          // Expander register file
+    uint8_t mcp_pointer;                 // Expander register pointer
+    uint8_t coin_pulses;                 // coin.cpp's ISR counters
+    uint8_t coin_rejects;
+    SimCycles cycles;                    // sim_cycles()
+} SimBoard;
+
+static SimBoard board;
+
+// Tool callbacks and capture files survive resets too
+static void (*loop_hook)(void) = NULL;
+static FILE *serial_out = NULL;
+
+// EEPROM survives resets, so it is kept outside SimBoard
+static uint8_t eeprom_data[SIM_EEPROM_SIZE];
+static bool eeprom_initialised = false;
+static uint8_t lcd_i2c_address = LCD_ADDRESS;
+static bool spectator_fitted = false;     // A second LCD on the other address
+
+// The expander (if fitted) and the contacts wired to it
+typedef struct {
+    uint8_t input;
+    bool pressed;
+    uint32_t at_us;
+} SimExpanderChange;
+
+static bool expander_fitted = false;
+static uint16_t expander_closed = 0;      // Bit n = input n closed
+static SimExpanderChange expander_schedule[SIM_EXPANDER_SCHEDULE];  // By at_us
+static uint8_t expander_schedule_count = 0;
+
+// Cycle costs in use: avr_costs.h unless a tool overrides one (survive resets)
+#define AVR_COST_CYCLES(id, name, cycles, bus) cycles,
+static uint32_t cost_cycles[AVR_COST_COUNT] = {AVR_COSTS(AVR_COST_CYCLES)};
+#undef AVR_COST_CYCLES
+
+EEPROMClass EEPROM;
+HardwareSerial Serial;
+TwoWire Wire;
+
+/******************************************************************************
+ * SIMULATOR CONTROL
+ ******************************************************************************/
+
+static SimLcd *lcd_at(uint8_t address) {
+    return &board.lcd[address == LCD_ALT_ADDRESS ? 1 : 0];
+}
+
+static uint8_t spectator_address(void) {
+    return lcd_i2c_address == LCD_ALT_ADDRESS ? LCD_ADDRESS : LCD_ALT_ADDRESS;
+}
+
+static void lcd_blank(SimLcd *lcd) {
+    for (uint8_t row = 0; row < LCD_ROWS; row++) {
+        memset(lcd->text[row], ' ', LCD_COLS);
+        lcd->text[row][LCD_COLS] = '\0';
+    }
+    lcd->col = 0;
+    lcd->row = 0;
+}
+
+static void bus_busy(uint32_t us);
+
+/**
+ * charge - Count @cost on the virtual cycle counter, plus @bus_us of waiting
+ */
+static void charge(uint8_t cost, uint32_t bus_us) {
+    uint32_t cycles = cost_cycles[cost] + bus_us * (uint32_t)(F_CPU / 1000000UL);
+    board.cycles.calls[cost]++;
+    board.cycles.cycles[cost] += cycles;
+    board.cycles.loop_cycles += cycles;
+    board.cycles.loop_by_cost[cost] += cycles;
+}
+
+void sim_eeprom_erase(void) {
+    memset(eeprom_data, 0xFF, sizeof(eeprom_data));
+    eeprom_initialised = true;
+}
+
+uint8_t *sim_eeprom(void) {
+    if (!eeprom_initialised) {
+        sim_eeprom_erase();
+    }
+    return eeprom_data;
+}
+
+void sim_power_on(uint32_t now) {
+    if (!eeprom_initialised) {
+        sim_eeprom_erase();
+    }
+
+    bool button_pressed = board.button_pressed;  // The player's finger survives a reset
+    memset(&board, 0, sizeof(board));
+    board.now = now;
+    board.button_pressed = button_pressed;
+    board.mcp[0] = board.mcp[1] = 0xFF;          // IODIRA/B: all inputs after reset
+    lcd_blank(&board.lcd[0]);
+    lcd_blank(&board.lcd[1]);
+
+    // Same sequence as main.cpp:setup() (the watchdog is not simulated)
+    hardware_init();
+    game_init();
+}
+
+void sim_set_lcd_address(uint8_t address) {
+    lcd_i2c_address = address;
+}
+
+void sim_set_spectator_lcd(bool fitted) {
+    spectator_fitted = fitted;
+}
+
+void sim_set_expander_present(bool present) {
+    expander_fitted = present;
+}
+
+/**
+ * expander_gpio - Level of one expander port pin by pin (1 = open, pulled up)
+ */
+static uint8_t expander_gpio(uint8_t port) {
+    return (uint8_t)~(expander_closed >> (8 * port));
+}
+
+/**
+ * expander_change - One contact changes at @at_us
+ *
+ * Interrupt-on-change as on the chip: a port with no interrupt pending
+ * latches its levels into INTCAP and sets INTF; while one is pending,
+ * further changes only show in GPIO.
+ */
+static void expander_change(uint8_t input, bool pressed, uint32_t at_us) {
+    uint16_t bit = (uint16_t)(1u << (input & 15));
+    uint16_t before = expander_closed;
+    expander_closed = pressed ? (expander_closed | bit) : (expander_closed & (uint16_t)~bit);
+    if (!expander_fitted || expander_closed == before) {
+        return;
+    }
+    uint8_t port = input >= 8 ? 1 : 0;
+    uint8_t pin = (uint8_t)(1u << (input & 7));
+    if ((board.mcp[MCP_GPINTENA + port] & pin) && board.mcp[MCP_INTFA + port] == 0) {
+        board.mcp[MCP_INTFA + port] = pin;
+        board.mcp[MCP_INTCAPA + port] = expander_gpio(port);
+        board.pin_change_us = at_us;  // INTA falls: the pin-change interrupt
+    }
+}
+
+/**
+ * expander_inta_low - Is INTA asserted? (MIRROR: either port's INTF)
+ */
+static bool expander_inta_low(void) {
+    if (!expander_fitted) {
+        return false;
+    }
+    bool mirror = board.mcp[MCP_IOCON] & MCP_IOCON_MIRROR;
+    return board.mcp[MCP_INTFA] != 0 || (mirror && board.mcp[MCP_INTFA + 1] != 0);
+}
+
+void sim_set_expander_input(uint8_t input, bool pressed) {
+    bus_busy(0);
+    expander_change(input, pressed, board.cpu_us);
+}
+
+void sim_schedule_expander_input(uint8_t input, bool pressed, uint32_t at_us) {
+    if (expander_schedule_count >= SIM_EXPANDER_SCHEDULE) {
+        return;
+    }
+    // Insert in time order (after changes at the same time)
+    uint8_t i = expander_schedule_count++;
+    for (; i > 0 && (int32_t)(expander_schedule[i - 1].at_us - at_us) > 0; i--) {
+        expander_schedule[i] = expander_schedule[i - 1];
+    }
+    expander_schedule[i] = {input, pressed, at_us};
+}
+
+/**
+ * expander_apply_due - Make every scheduled change up to micros() happen
+ */
+static void expander_apply_due(void) {
+    uint8_t due = 0;
+    while (due < expander_schedule_count &&
+           (int32_t)(board.cpu_us - expander_schedule[due].at_us) >= 0) {
+        expander_change(expander_schedule[due].input, expander_schedule[due].pressed,
+                        expander_schedule[due].at_us);
+        due++;
+    }
+    if (due > 0) {
+        expander_schedule_count -= due;
+        memmove(expander_schedule, expander_schedule + due,
+                expander_schedule_count * sizeof(expander_schedule[0]));
+    }
+}
+
+void sim_coin_pulse(uint32_t width_us) {
+    if (coin_pulse_valid(width_us)) {
+        board.coin_pulses++;
+    } else {
+        board.coin_rejects++;
+    }
+}
+
+void sim_set_button(bool pressed) {
+    board.button_pressed = pressed;
+    bus_busy(0);
+    board.pin_change_us = board.cpu_us;
+    charge(COST_ISR, 0);
+    // The board's PCINT0 ISR: input is set between loop()s, at the start of
+    // the millisecond (micros() may be further on, after a long bus wait)
+    button_edge(board.now * 1000u, pressed);
+}
+
+void sim_set_button_at_us(bool pressed, uint32_t at_us) {
+    board.button_pressed = pressed;
+    board.pin_change_us = at_us;
+    charge(COST_ISR, 0);
+    button_edge(at_us, pressed);
+}
+
+/**
+ * bus_busy - The CPU spends @us waiting for a bus (I2C, EEPROM)
+ *
+ * Never moves micros() behind the start of the current millisecond.
+ * Scheduled expander input that falls in the wait happens during it.
+ */
+static void bus_busy(uint32_t us) {
+    uint32_t tick_start = board.now * 1000u;
+    if ((int32_t)(tick_start - board.cpu_us) > 0) {
+        board.cpu_us = tick_start;
+    }
+    board.cpu_us += us;
+    expander_apply_due();
+}
+
+void sim_idle_until_us(uint32_t at_us) {
+    bus_busy(0);
+    if ((int32_t)(at_us - board.cpu_us) > 0) {
+        bus_busy(at_us - board.cpu_us);
+    }
+}
+
+void sim_clock_sync(void) {
+    board.cpu_us = board.now * 1000u;
+}
+
+static void run_loop(void) {
+    bus_busy(0);  // Sync micros() to the start of this millisecond
+    charge(COST_LOOP, 0);
+    game_update();
+    if (loop_hook != NULL) {
+        loop_hook();
+    }
+    // ISRs between now and the next loop() are charged to that one
+    board.cycles.loop_cycles = 0;
+    memset(board.cycles.loop_by_cost, 0, sizeof(board.cycles.loop_by_cost));
+}
+
+void sim_loop(void) {
+    run_loop();
+}
+
+void sim_tick(void) {
+    run_loop();
+    board.now++;
+}
+
+void sim_advance(uint32_t ms) {
+    board.now += ms;
+}
+
+uint32_t sim_run_until(uint32_t end) {
+    uint32_t loops = 0;
+    uint32_t remaining = end - board.now;
+
+    while (remaining > 0) {
+        run_loop();
+        loops++;
+
+        // Next loop() that can change anything: at least 1 ms on (like
+        // sim_tick()), at most the caller's end time (the next input)
+        uint32_t step = game_ms_until_next_event();
+        if (step == 0) {
+            step = 1;
+        }
+        if (step > remaining) {
+            step = remaining;
+        }
+        board.now += step;
+        remaining -= step;
+    }
+    return loops;
+}
+
+void sim_set_loop_hook(void (*hook)(void)) {
+    loop_hook = hook;
+}
+
+void sim_serial_capture(FILE *out) {
+    serial_out = out;
+}
+
+const SimCycles *sim_cycles(void) {
+    return &board.cycles;
+}
+
+void sim_set_cost(uint8_t cost, uint32_t cycles) {
+    if (cost < AVR_COST_COUNT) {
+        cost_cycles[cost] = cycles;
+    }
+}
+
+uint32_t sim_millis(void) {
+    return board.now;
+}
+
+uint8_t sim_leds(void) {
+    uint8_t mask = 0;
+    for (uint8_t i = 0; i < NUM_LEDS; i++) {
+        if (board.pin_out[LED_PIN_START + i]) {
+            mask |= (uint8_t)(1 << i);
+        }
+    }
+    return mask;
+}
+
+const char *sim_lcd_row(uint8_t row) {
+    return row < LCD_ROWS ? lcd_at(lcd_i2c_address)->text[row] : "";
+}
+
+const char *sim_spectator_lcd_row(uint8_t row) {
+    return row < LCD_ROWS ? lcd_at(spectator_address())->text[row] : "";
+}
+
+uint16_t sim_tone_frequency(void) {
+    return board.tone_frequency;
+}
+
+uint32_t sim_tone_count(void) {
+    return board.tone_count;
+}
+
+/******************************************************************************
+ * HOST ARDUINO CORE - Pins, Time and Sound
+ ******************************************************************************/
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    charge(COST_PIN_MODE, 0);
+    if (pin < SIM_NUM_PINS) {
+        board.pin_mode[pin] = mode;
+    }
+}
+
+// LED pins cost a port write on the Uno build (avr_costs.h, LED WRITES)
+static bool led_port_pin(uint8_t pin) {
+#ifdef LEDS_PINS
+    (void)pin;
+    return false;
+#else
+    return pin >= LED_PIN_START && pin < LED_PIN_START + NUM_LEDS;
+#endif
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    charge(led_port_pin(pin) ? COST_LED_WRITE : COST_DIGITAL_WRITE, 0);
+    if (pin < SIM_NUM_PINS) {
+        board.pin_out[pin] = val ? HIGH : LOW;
+    }
+}
+
+int digitalRead(uint8_t pin) {
+    charge(COST_DIGITAL_READ, 0);
+    if (pin == BUTTON_PIN) {
+        // INPUT_PULLUP: released = HIGH, pressed = LOW (see config.h)
+        return board.button_pressed ? LOW : HIGH;
+    }
+    if (pin == EXPANDER_INT_PIN) {
+        // Open drain INTA with the AVR's pull-up; idle HIGH if not fitted
+        return expander_inta_low() ? LOW : HIGH;
+    }
+    return pin < SIM_NUM_PINS ? board.pin_out[pin] : LOW;
+}
+
+uint32_t millis(void) {
+    charge(COST_MILLIS, 0);
+    return board.now;
+}
+
+uint32_t micros(void) {
+    charge(COST_MICROS, 0);
+    bus_busy(0);
+    return board.cpu_us;
+}
+
+// The firmware's tickless clock (timebase.h). The virtual clock is tickless
+// already, so it is just micros(); timebase.cpp itself is AVR-only.
+uint32_t timebase_micros(void) {
+    return micros();
+}
+
+uint32_t timebase_isr_micros(void) {
+    return micros();
+}
+
+// Set by sim_set_button() and the expander model where the board's PCINT0
+// interrupt would stamp it
+uint32_t timebase_pin_change_us(void) {
+    return board.pin_change_us;
+}
+
+// coin.h: the ISR's counters, advanced by sim_coin_pulse() (coin.cpp is
+// AVR-only; its interrupt handler runs under simavr instead)
+void coin_init(void) {
+}
+
+uint8_t coin_pulses(void) {
+    return board.coin_pulses;
+}
+
+uint8_t coin_rejects(void) {
+    return board.coin_rejects;
+}
+
+// tone_timer.h: Timer2 isn't modelled; keep a log of the notes started
+void tone_play(ToneNote note) {
+    charge(COST_TONE, 0);
+    board.tone_frequency = note.hz;
+    board.tone_count++;
+}
+
+void tone_stop(void) {
+    charge(COST_TONE_STOP, 0);
+}
+
+void HardwareSerial::begin(unsigned long baud) {
+    (void)baud;
+}
+
+size_t HardwareSerial::write(uint8_t value) {
+    return write(&value, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        charge(COST_SERIAL, 0);
+    }
+    if (serial_out != NULL) {
+        fwrite(data, 1, size, serial_out);
+    }
+    return size;
+}
+
+/******************************************************************************
+ * HOST LIBRARIES - EEPROM, Wire and LiquidCrystal_I2C
+ ******************************************************************************/
+
+void TwoWire::begin(void) {
+}
+
+void TwoWire::setClock(uint32_t hz) {
+    (void)hz;
+}
+
+void TwoWire::beginTransmission(uint8_t to) {
+    address = to;
+    tx_count = 0;
+}
+
+size_t TwoWire::write(uint8_t value) {
+    if (tx_count >= BUFFER_SIZE) {
+        return 0;
+    }
+    tx[tx_count++] = value;
+    return 1;
+}
+
+static bool expander_addressed(uint8_t address) {
+    return expander_fitted && address == EXPANDER_ADDRESS;
+}
+
+uint8_t TwoWire::endTransmission(bool stop) {
+    (void)stop;  // A repeated start costs the same as stop + start here
+    bus_busy(SIM_I2C_PROBE_US + SIM_I2C_BYTE_US * tx_count);
+    charge(COST_I2C, SIM_I2C_PROBE_US + SIM_I2C_BYTE_US * tx_count);
+    if (expander_addressed(address)) {
+        // First byte: register pointer; the rest fill registers from there
+        for (uint8_t i = 0; i < tx_count; i++) {
+            if (i == 0) {
+                board.mcp_pointer = tx[i];
+            } else {
+                if (board.mcp_pointer < MCP_REGISTERS) {
+                    board.mcp[board.mcp_pointer] = tx[i];
+                }
+                board.mcp_pointer++;
+            }
+        }
+        return 0;
+    }
+    if (lcd_i2c_address != 0 && address == lcd_i2c_address) {
+        return 0;
+    }
+    bool spectator = spectator_fitted && lcd_i2c_address != 0 && address == spectator_address();
+    return spectator ? 0 : 2;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t from, uint8_t count) {
+    rx_count = 0;
+    rx_next = 0;
+    bus_busy(SIM_I2C_PROBE_US + SIM_I2C_BYTE_US * count);
+    charge(COST_I2C, SIM_I2C_PROBE_US + SIM_I2C_BYTE_US * count);
+    if (!expander_addressed(from)) {
+        return 0;
+    }
+    for (; rx_count < count && rx_count < BUFFER_SIZE; rx_count++) {
+        uint8_t reg = board.mcp_pointer++;
+        uint8_t value = 0;
+        if (reg == MCP_GPIOA || reg == MCP_GPIOA + 1) {
+            value = expander_gpio(reg - MCP_GPIOA);
+        } else if (reg < MCP_REGISTERS) {
+            value = board.mcp[reg];
+        }
+        // Reading a port's INTCAP or GPIO clears its interrupt
+        if (reg >= MCP_INTCAPA && reg <= MCP_GPIOA + 1) {
+            board.mcp[MCP_INTFA + (reg & 1)] = 0;
+        }
+        rx[rx_count] = value;
+    }
+    return rx_count;
+}
+
+int TwoWire::available(void) {
+    return rx_count - rx_next;
+}
+
+int TwoWire::read(void) {
+    return rx_next < rx_count ? rx[rx_next++] : -1;
+}
+
+uint8_t EEPROMClass::read(int address) {
+    charge(COST_EEPROM_READ, 0);
+    if (!eeprom_initialised) {
+        sim_eeprom_erase();
+    }
+    return (address >= 0 && address < SIM_EEPROM_SIZE) ? eeprom_data[address] : 0xFF;
+}
+
+void EEPROMClass::write(int address, uint8_t value) {
+    if (!eeprom_initialised) {
+        sim_eeprom_erase();
+    }
+    if (address >= 0 && address < SIM_EEPROM_SIZE) {
+        eeprom_data[address] = value;
+        bus_busy(SIM_EEPROM_WRITE_US);
+        charge(COST_EEPROM_WRITE, SIM_EEPROM_WRITE_US);
+    }
+}
+
+void EEPROMClass::update(int address, uint8_t value) {
+    if (read(address) != value) {
+        write(address, value);
+    }
+}
+
+LiquidCrystal_I2C::LiquidCrystal_I2C(uint8_t address, uint8_t cols, uint8_t rows)
+    : address(address), cols(cols), rows(rows) {
+}
+
+void LiquidCrystal_I2C::init(void) {
+    lcd_blank(lcd_at(address));
+}
+
+void LiquidCrystal_I2C::backlight(void) {
+}
+
+void LiquidCrystal_I2C::clear(void) {
+    lcd_blank(lcd_at(address));
+    bus_busy(SIM_LCD_BYTE_US + SIM_LCD_CLEAR_US);
+    charge(COST_LCD, SIM_LCD_BYTE_US + SIM_LCD_CLEAR_US);
+}
+
+void LiquidCrystal_I2C::setCursor(uint8_t col, uint8_t row) {
+    bus_busy(SIM_LCD_BYTE_US);  // One "set DDRAM address" command
+    charge(COST_LCD, SIM_LCD_BYTE_US);
+    lcd_at(address)->col = col;
+    lcd_at(address)->row = row;
+}
+
+size_t LiquidCrystal_I2C::write(uint8_t value) {
+    // Characters past the visible area go nowhere, like on a real 16x2
+    SimLcd *lcd = lcd_at(address);
+    if (lcd->row < rows && lcd->col < cols) {
+        lcd->text[lcd->row][lcd->col] = (char)value;
+    }
+    lcd->col++;
+    bus_busy(SIM_LCD_BYTE_US);
+    charge(COST_LCD, SIM_LCD_BYTE_US);
+    return 1;
+}
+
+size_t LiquidCrystal_I2C::print(const char *text) {
+    size_t n = 0;
+    while (text[n] != '\0') {
+        n += write((uint8_t)text[n]);
+    }
+    return n;
+}
+
+size_t LiquidCrystal_I2C::print(int value) {
+    return print((long)value);
+}
+
+size_t LiquidCrystal_I2C::print(unsigned int value) {
+    return print((unsigned long)value);
+}
+
+size_t LiquidCrystal_I2C::print(long value) {
+    char text[12];
+    snprintf(text, sizeof(text), "%ld", value);
+    return print(text);
+}
+
+size_t LiquidCrystal_I2C::print(unsigned long value) {
+    char text[12];
+    snprintf(text, sizeof(text), "%lu", value);
+    return print(text);
+}
@@ -0,0 +1,259 @@
+/******************************************************************************
+ * SIM.H - Host Simulator ("Virtual Board") Interface
+ *
+ * The host simulator runs the REAL firmware logic (game.cpp and hardware.cpp,
+ * unchanged) on a PC. The Arduino core functions they call - millis(),
+ * digitalWrite(), tone_play(), EEPROM, the LCD - are provided by the files in
+ * src/sim/ and operate on a virtual board instead of a microcontroller.
+ *
+ * ┌──────────────┐
+ * │  game.cpp    │  Unchanged firmware logic
+ * ├──────────────┤
+ * │ hardware.cpp │  Unchanged HAL implementation
+ * ├──────────────┤
+ * │  src/sim/    │  Host Arduino core: virtual pins, clock, EEPROM, LCD
+ * └──────────────┘
+ *
+ * VIRTUAL TIME:
+ * The virtual clock only moves when a tool asks it to. One "tick" is one
+ * loop() iteration at one millisecond of virtual time:
+ *
+ *   sim_power_on(0);          // setup() at t = 0
+ *   for (...) {
+ *       sim_set_button(...);  // Scripted input
+ *       sim_tick();           // loop() at t, then t = t + 1
+ *   }
+ *
+ * On the real board loop() runs many times per millisecond, but millis() is
+ * constant within that millisecond and every state handler is idempotent
+ * for a fixed millis() value, so one iteration per millisecond produces the
+ * same game behaviour.
+ *
+ * MICROS() AND BUS TIME:
+ * micros() starts each loop() at millis() × 1000 and then advances by the
+ * time the real buses would have been busy: ~1.3 ms per LCD byte over the
+ * I2C backpack (plus 2 ms for clear()), ~90 µs per byte to the input
+ * expander, and 3.3 ms per EEPROM byte written.
+ * If a loop() "overruns" its millisecond, micros() runs ahead of millis()
+ * until the virtual clock catches up. Game timing still follows millis()
+ * only, so results are unchanged; micros() is what trace timelines use.
+ *
+ * CYCLE COSTS:
+ * Separately, every HAL call charges what it would cost the Uno's CPU
+ * (avr_costs.h) to a virtual cycle counter: ~50 cycles per digitalWrite(),
+ * the bus wait at 16 cycles/µs for an LCD byte. Summed per loop(), that is
+ * a prediction of the board's loop() time, which the host can't measure
+ * (tools/cycle_profile.cpp). The counter changes nothing the firmware sees.
+ *
+ * LIMITATION:
+ * The firmware keeps its state in file-scope statics, so there is exactly one
+ * simulated board per process. Tools that want many boards in parallel use
+ * several processes (or the batched engine in chaser.h).
+ ******************************************************************************/
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <Arduino.h>
+#include "avr_costs.h"
+#include <stdio.h>
+
+/**
+ * sim_power_on - Reset the virtual board and run setup()
+ * @param now: Virtual time (ms) at which the board boots
+ *
+ * Clears pins, LCD and tone log (RAM and peripherals lose their contents on
+ * reset), keeps EEPROM, then calls hardware_init() and game_init() exactly
+ * like main.cpp:setup(). The button is not part of the board: it keeps the
+ * level last set with sim_set_button() (hold it to boot into calibration).
+ */
+void sim_power_on(uint32_t now);
+
+/**
+ * sim_eeprom_erase - Return EEPROM to its factory state (all 0xFF)
+ *
+ * sim_eeprom - The EEPROM's SIM_EEPROM_SIZE bytes, to copy out or fill in
+ *
+ * Between runs only: bytes changed here cost no write time.
+ */
+const uint16_t SIM_EEPROM_SIZE = 1024;           // ATmega328P
+
+void sim_eeprom_erase(void);
+uint8_t *sim_eeprom(void);
+
+/**
+ * sim_set_lcd_address - Move (or remove) the virtual LCD backpack
+ * @param address: I2C address it answers on (default LCD_ADDRESS), 0 = none
+ *
+ * Hardware, not board state: survives sim_power_on() like the EEPROM.
+ */
+void sim_set_lcd_address(uint8_t address);
+
+/**
+ * sim_set_spectator_lcd - Fit (or remove) a second LCD on the other address
+ *
+ * It answers on whichever of LCD_ADDRESS / LCD_ALT_ADDRESS the main LCD
+ * doesn't use (and not at all with the main LCD removed). Absent by
+ * default; hardware, so it survives sim_power_on().
+ */
+void sim_set_spectator_lcd(bool fitted);
+
+/**
+ * sim_set_expander_present - Fit (or remove) the MCP23017 input expander
+ *
+ * Absent by default. Hardware, like the LCD address: survives sim_power_on().
+ * Its registers don't (it shares the board's supply).
+ */
+void sim_set_expander_present(bool present);
+
+/**
+ * sim_set_expander_input - Close or open one expander input now
+ * @param input: 0-7 = GPA0-7 (player buttons), 8-15 = GPB0-7 (switches)
+ *
+ * sim_schedule_expander_input - The same at a given micros() time
+ * @param at_us: When the contact changes (any order; kept sorted)
+ *
+ * A scheduled change happens as soon as the virtual CPU reaches @at_us: in
+ * the middle of an LCD update if the bus is busy then, otherwise at the start
+ * of the first loop() after it. The expander latches it and asserts INTA, and
+ * timebase_pin_change_us() reports @at_us, just as the pin-change interrupt
+ * would on the board. Inputs are the player's fingers: they survive resets.
+ */
+void sim_set_expander_input(uint8_t input, bool pressed);
+void sim_schedule_expander_input(uint8_t input, bool pressed, uint32_t at_us);
+
+/**
+ * sim_idle_until_us - Let the virtual CPU sleep until @at_us
+ *
+ * For a wake-up inside the current millisecond: after a sim_loop(), moves
+ * micros() on to @at_us (applying scheduled input due by then) so the next
+ * sim_loop() runs as the loop() the wake-up interrupt starts. Does nothing if
+ * micros() is already past @at_us.
+ */
+void sim_idle_until_us(uint32_t at_us);
+
+/**
+ * sim_clock_sync - Forget bus time still owed: micros() = millis() × 1000
+ *
+ * For tools that set a board up outside the game's timeline (loading a
+ * snapshot after sim_power_on()), so the setup's LCD and EEPROM traffic
+ * doesn't hold up the loop()s that follow.
+ */
+void sim_clock_sync(void);
+
+/**
+ * sim_coin_pulse - The coin mech sends one pulse of @width_us
+ *
+ * Judged like the board's coin ISR does (coin_pulse_valid()); the new count
+ * is what credit_service() collects in the next loop().
+ */
+void sim_coin_pulse(uint32_t width_us);
+
+/**
+ * sim_set_button - Set the physical button level
+ * @param pressed: true = button held down (pin reads LOW)
+ */
+void sim_set_button(bool pressed);
+
+/**
+ * sim_set_button_at_us - Change the button level at a given micros() time
+ *
+ * For bounce waveforms (sim/bounce.h), whose edges are microseconds apart:
+ * the pin-change ISR sees the edge at @at_us rather than at the start of
+ * the millisecond. Runs no loop(); times must not go backwards.
+ */
+void sim_set_button_at_us(bool pressed, uint32_t at_us);
+
+/**
+ * sim_loop - Run one loop() iteration at the current virtual time
+ *
+ * sim_tick - Run one loop() iteration, then advance virtual time by 1 ms
+ *
+ * sim_advance - Advance virtual time without running the firmware
+ * @param ms: Milliseconds to add to the virtual clock
+ */
+void sim_loop(void);
+void sim_tick(void);
+void sim_advance(uint32_t ms);
+
+/**
+ * sim_run_until - Run the firmware up to a virtual time, skipping idle time
+ * @param end: Virtual time (ms) to stop at, normally the time of the next
+ *             scripted input (must not be before sim_millis())
+ * @return: Number of loop() iterations actually executed
+ *
+ * Same result as calling sim_tick() until sim_millis() == end, but after
+ * each loop() the clock jumps straight to the earliest pending deadline
+ * (game_ms_until_next_event(): chase step, animation note, state timeout,
+ * unread button change) instead of visiting every millisecond in between.
+ * Those skipped loop() calls are exactly the ones that would change nothing.
+ *
+ *   sim_set_button(true);
+ *   sim_run_until(press_time + 120);   // Held for 120 ms
+ *   sim_set_button(false);
+ *   sim_run_until(next_press_time);
+ */
+uint32_t sim_run_until(uint32_t end);
+
+/**
+ * sim_set_loop_hook - Call a function after every simulated loop()
+ * @param hook: Called after each game_update() run by sim_loop(), sim_tick()
+ *              or sim_run_until(); NULL to remove
+ *
+ * With the event-skipping clock, every state change happens inside one of
+ * these loop() calls, so a hook that reads game_get_status() sees each
+ * transition at its exact virtual time.
+ */
+void sim_set_loop_hook(void (*hook)(void));
+
+/**
+ * SimCycles - The virtual cycle counter (see CYCLE COSTS)
+ *
+ * cycles / calls: By AvrCost, since sim_power_on() (setup() included)
+ * loop_cycles / loop_by_cost: The loop() in progress, with any pin-change
+ * ISRs since the one before. Read from a loop hook to get one whole loop();
+ * cleared after the hook returns.
+ */
+typedef struct {
+    uint64_t cycles[AVR_COST_COUNT];
+    uint64_t calls[AVR_COST_COUNT];
+    uint32_t loop_cycles;
+    uint32_t loop_by_cost[AVR_COST_COUNT];
+} SimCycles;
+
+/**
+ * sim_cycles - The virtual cycle counter
+ *
+ * sim_set_cost - Charge @cycles per call for @cost from now on
+ * @param cost: AvrCost (avr_costs.h); bus waits are still added on top
+ *
+ * For "what if" runs and calibration. The override is not board state:
+ * it survives sim_power_on().
+ */
+const SimCycles *sim_cycles(void);
+void sim_set_cost(uint8_t cost, uint32_t cycles);
+
+/**
+ * sim_serial_capture - Send the firmware's Serial output to a file
+ * @param out: Open binary file, or NULL to discard output (the default)
+ */
+void sim_serial_capture(FILE *out);
+
+/**
+ * OBSERVATION - Read back what the firmware did to the virtual board
+ *
+ * sim_millis: Current virtual time (what millis() returns)
+ * sim_leds: LED pin levels as a bit mask (bit 0 = LED 0)
+ * sim_lcd_row: Text currently on a main LCD row (always LCD_COLS characters)
+ * sim_spectator_lcd_row: Same for the spectator LCD (blank if not fitted)
+ * sim_tone_frequency: Frequency of the most recent tone_play() (0 = none)
+ * sim_tone_count: Number of tone_play() calls since sim_power_on()
+ */
+uint32_t sim_millis(void);
+uint8_t sim_leds(void);
+const char *sim_lcd_row(uint8_t row);
+const char *sim_spectator_lcd_row(uint8_t row);
+uint16_t sim_tone_frequency(void);
+uint32_t sim_tone_count(void);
+
+#endif // SIM_H
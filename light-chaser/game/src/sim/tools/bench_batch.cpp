@@ -0,0 +1,291 @@
+/******************************************************************************
+ * BENCH_BATCH.CPP - libchaser Throughput Benchmark and Equivalence Check
+ *
+ * Usage:
+ *   chaser-bench [--instances N] [--step TICKS] [--ticks TOTAL]
+ *   chaser-bench --verify [--instances N] [--calls C]
+ *
+ * BENCHMARK MODE (default):
+ * Runs N instances driven by a simple bot for TOTAL ticks, TICKS per call,
+ * and reports instance-steps per second (one instance-step = one game
+ * advanced by one 1 ms tick). For comparison it also times the scalar
+ * firmware logic in the host simulator (one game, one tick per loop()).
+ *
+ * VERIFY MODE:
+ * Runs N instances through libchaser, then replays every instance one by one
+ * through game.cpp in the host simulator with the same button levels, resets
+ * and tick counts, comparing state, position, direction, speed, score, high
+ * score and LEDs after every call. Exits with status 1 on the first
+ * difference.
+ ******************************************************************************/
+
+#include "chaser.h"
+#include "sim.h"
+#include "game.h"
+#include "hardware.h"
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+/******************************************************************************
+ * BOT POLICY
+ *
+ * Deterministic per instance (xorshift32 seeded from the index), and decided
+ * only from values that both engines expose, so both sides of --verify make
+ * identical choices for as long as they agree.
+ *
+ * In --verify, every fourth instance is "patient": it starts its first game
+ * at once, then hardly ever presses in attract mode, so its attract spells
+ * last long enough for LED showcases and for the replay of the record it
+ * has usually just set (the attract ghost, ghost.h).
+ ******************************************************************************/
+
+static uint32_t xorshift32(uint32_t *s) {
+    uint32_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *s = x;
+    return x;
+}
+
+static bool bot_patient(uint32_t instance) {
+    return instance % 4 == 3;
+}
+
+/**
+ * bot_button - The button level for the next call
+ * @param played: Set once the bot has been in a game (only patient bots wait)
+ */
+static uint8_t bot_button(uint32_t *rng, uint32_t state, uint32_t position, bool patient,
+                          uint8_t *played) {
+    uint32_t r = xorshift32(rng) % 100;
+    if (state != STATE_ATTRACT) {
+        *played = 1;
+    }
+    if (state == STATE_PLAYING && position >= TARGET_ZONE_START && position <= TARGET_ZONE_END) {
+        return r < 70;  // Usually press in the zone...
+    }
+    if (patient && *played && state == STATE_ATTRACT) {
+        return xorshift32(rng) % 6000 == 0;
+    }
+    return r < 8;       // ...occasionally anywhere (misses, bounces, restarts)
+}
+
+static bool bot_reset(uint32_t *rng) {
+    return xorshift32(rng) % 4000 == 0;  // Rare power cycle mid-game
+}
+
+static uint32_t step_ticks(uint32_t *rng) {
+    return 1 + xorshift32(rng) % 24;     // Vary the call granularity
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/******************************************************************************
+ * VERIFY MODE
+ ******************************************************************************/
+
+typedef struct {
+    uint32_t state, position, speed, score, high_score, leds;
+    int32_t direction;
+} LaneSnapshot;
+
+static int run_verify(uint32_t instances, uint32_t calls) {
+    const uint16_t saved_high = 40;
+
+    ChaserBatch *batch = chaser_batch_create(instances, saved_high);
+    if (batch == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+
+    std::vector<uint32_t> rng(instances);
+    std::vector<uint8_t> played(instances);
+    std::vector<uint8_t> buttons(instances);
+    std::vector<uint32_t> ticks(calls);
+    std::vector<LaneSnapshot> expect((size_t)instances * calls);
+    uint32_t tick_rng = 12345;
+    for (uint32_t c = 0; c < calls; c++) {
+        ticks[c] = step_ticks(&tick_rng);
+    }
+    for (uint32_t k = 0; k < instances; k++) {
+        rng[k] = 0x9E3779B9u ^ (k * 2654435761u) ^ 1u;
+    }
+
+    // Pass 1: every instance through libchaser
+    ChaserView v;
+    for (uint32_t c = 0; c < calls; c++) {
+        chaser_batch_view(batch, &v);
+        for (uint32_t k = 0; k < instances; k++) {
+            if (bot_reset(&rng[k])) {
+                chaser_batch_reset(batch, k);
+            }
+            buttons[k] = bot_button(&rng[k], v.state[k], v.position[k], bot_patient(k),
+                                    &played[k]);
+        }
+        chaser_batch_step(batch, buttons.data(), ticks[c]);
+        for (uint32_t k = 0; k < instances; k++) {
+            LaneSnapshot *s = &expect[(size_t)c * instances + k];
+            s->state = v.state[k];
+            s->position = v.position[k];
+            s->direction = v.direction[k];
+            s->speed = v.chase_speed[k];
+            s->score = v.score[k];
+            s->high_score = v.high_score[k];
+            s->leds = v.leds[k];
+        }
+    }
+    chaser_batch_destroy(batch);
+
+    // Pass 2: the same instances, one at a time, through game.cpp
+    uint32_t games = 0;
+    for (uint32_t k = 0; k < instances; k++) {
+        uint32_t r = 0x9E3779B9u ^ (k * 2654435761u) ^ 1u;
+        uint8_t has_played = 0;
+        sim_eeprom_erase();
+        eeprom_write_high_score(saved_high);
+        sim_set_button(false);
+        sim_power_on(0);
+
+        for (uint32_t c = 0; c < calls; c++) {
+            GameStatus gs;
+            game_get_status(&gs);
+            if (bot_reset(&r)) {
+                sim_set_button(false);  // libchaser resets with the button released
+                sim_power_on(sim_millis());
+                game_get_status(&gs);
+            }
+            sim_set_button(bot_button(&r, gs.state, gs.position, bot_patient(k), &has_played));
+            for (uint32_t t = 0; t < ticks[c]; t++) {
+                GameState before = gs.state;
+                sim_tick();
+                game_get_status(&gs);
+                if (before == STATE_PLAYING && gs.state != STATE_PLAYING && gs.state != STATE_RESULT) {
+                    games++;
+                }
+            }
+
+            const LaneSnapshot *s = &expect[(size_t)c * instances + k];
+            if (s->state != (uint32_t)gs.state || s->position != gs.position ||
+                s->direction != gs.direction || s->speed != gs.chase_speed ||
+                s->score != gs.score || s->high_score != gs.high_score ||
+                s->leds != sim_leds()) {
+                printf("MISMATCH instance %u call %u (t=%u ms)\n", k, c, sim_millis());
+                printf("  libchaser: state=%u pos=%u dir=%d speed=%u score=%u high=%u leds=%02X\n",
+                       s->state, s->position, s->direction, s->speed, s->score,
+                       s->high_score, s->leds);
+                printf("  game.cpp:  state=%u pos=%u dir=%d speed=%u score=%u high=%u leds=%02X\n",
+                       (unsigned)gs.state, gs.position, gs.direction, gs.chase_speed,
+                       gs.score, gs.high_score, sim_leds());
+                return 1;
+            }
+        }
+    }
+
+    printf("OK: %u instances x %u calls identical (%u completed games)\n",
+           instances, calls, games);
+    return 0;
+}
+
+/******************************************************************************
+ * BENCHMARK MODE
+ ******************************************************************************/
+
+static int run_bench(uint32_t instances, uint32_t step, uint32_t total) {
+    ChaserBatch *batch = chaser_batch_create(instances, 0);
+    if (batch == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+
+    std::vector<uint32_t> rng(instances);
+    std::vector<uint8_t> played(instances);
+    std::vector<uint8_t> buttons(instances);
+    for (uint32_t k = 0; k < instances; k++) {
+        rng[k] = 0x9E3779B9u ^ (k * 2654435761u) ^ 1u;
+    }
+
+    ChaserView v;
+    double step_time = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t done = 0; done < total; done += step) {
+        chaser_batch_view(batch, &v);
+        for (uint32_t k = 0; k < instances; k++) {
+            buttons[k] = bot_button(&rng[k], v.state[k], v.position[k], false, &played[k]);
+        }
+        auto t0 = std::chrono::steady_clock::now();
+        chaser_batch_step(batch, buttons.data(), step);
+        step_time += seconds_since(t0);
+    }
+    double wall = seconds_since(start);
+    chaser_batch_destroy(batch);
+
+    // Scalar reference: game.cpp in the host simulator, one tick per loop()
+    const uint32_t scalar_ticks = 2000000;
+    uint32_t r = 1;
+    uint8_t has_played = 0;
+    sim_eeprom_erase();
+    sim_set_button(false);
+    sim_power_on(0);
+    auto s0 = std::chrono::steady_clock::now();
+    for (uint32_t t = 0; t < scalar_ticks; t++) {
+        if (t % step == 0) {
+            GameStatus gs;
+            game_get_status(&gs);
+            sim_set_button(bot_button(&r, gs.state, gs.position, false, &has_played));
+        }
+        sim_tick();
+    }
+    double scalar = seconds_since(s0);
+
+    double steps = (double)instances * (double)total;
+    printf("instances:            %u\n", instances);
+    printf("ticks per call:       %u\n", step);
+    printf("ticks per instance:   %u\n", total);
+    printf("libchaser step time:  %.3f s\n", step_time);
+    printf("libchaser throughput: %.3e instance-steps/s (%.3e incl. bot)\n",
+           steps / step_time, steps / wall);
+    printf("scalar throughput:    %.3e instance-steps/s (game.cpp in host sim)\n",
+           scalar_ticks / scalar);
+    printf("speed-up:             %.1fx\n", (steps / step_time) / (scalar_ticks / scalar));
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    bool verify = false;
+    uint32_t instances = 0;
+    uint32_t step = 16;
+    uint32_t total = 60000;
+    uint32_t calls = 4000;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--verify") == 0) {
+            verify = true;
+        } else if (strcmp(argv[i], "--instances") == 0 && i + 1 < argc) {
+            instances = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--step") == 0 && i + 1 < argc) {
+            step = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            total = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--calls") == 0 && i + 1 < argc) {
+            calls = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [--verify] [--instances N] [--step TICKS] "
+                            "[--ticks TOTAL] [--calls C]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (step == 0) {
+        step = 1;
+    }
+
+    if (verify) {
+        return run_verify(instances ? instances : 256, calls);
+    }
+    return run_bench(instances ? instances : 8192, step, total);
+}
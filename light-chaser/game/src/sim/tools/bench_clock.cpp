@@ -0,0 +1,170 @@
+/******************************************************************************
+ * BENCH_CLOCK.CPP - Event-Skipping Virtual Clock: Speed and Equivalence
+ *
+ * Usage:
+ *   sim-clock [--sessions N] [--minutes M] [--seed S]
+ *
+ * Generates N random input scripts (presses of 40-200 ms separated by short
+ * gaps during play and by long idle stretches in ATTRACT), each M minutes of
+ * virtual time, and runs every script twice through game.cpp:
+ *
+ *   1. Fine-grained: sim_tick() for every millisecond
+ *   2. Event-skipping: sim_run_until() from one scripted input to the next
+ *
+ * After every scripted input both runs must agree on the game variables,
+ * LEDs, LCD text and tone log. Reports simulated game time per wall-clock
+ * second and loop() calls per simulated second for both clocks. Exits with
+ * status 1 on the first difference.
+ ******************************************************************************/
+
+#include "sim.h"
+#include "game.h"
+#include "hardware.h"
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+typedef struct {
+    uint32_t time;      // Virtual ms at which the button level changes
+    bool pressed;
+} InputEvent;
+
+typedef struct {
+    GameStatus game;
+    uint8_t leds;
+    uint16_t tone_frequency;
+    uint32_t tone_count;
+    char lcd[LCD_ROWS][LCD_COLS + 1];
+} Observation;
+
+static uint32_t xorshift32(uint32_t *s) {
+    uint32_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *s = x;
+    return x;
+}
+
+static void make_script(uint32_t seed, uint32_t end, std::vector<InputEvent> *script) {
+    uint32_t rng = seed * 2654435761u + 1u;
+    uint32_t t = 500;
+    script->clear();
+    for (;;) {
+        uint32_t release = t + 40 + xorshift32(&rng) % 161;  // Hold 40-200 ms
+        if (release >= end) {
+            break;
+        }
+        script->push_back({t, true});
+        script->push_back({release, false});
+        t = release;
+        if (xorshift32(&rng) % 10 < 7) {
+            t += 60 + xorshift32(&rng) % 1500;         // Playing: next press soon
+        } else {
+            t += 2000 + xorshift32(&rng) % 60000;      // Walked away: long ATTRACT
+        }
+    }
+}
+
+static void observe(Observation *o) {
+    memset(o, 0, sizeof(*o));
+    game_get_status(&o->game);
+    o->leds = sim_leds();
+    o->tone_frequency = sim_tone_frequency();
+    o->tone_count = sim_tone_count();
+    for (uint8_t row = 0; row < LCD_ROWS; row++) {
+        memcpy(o->lcd[row], sim_lcd_row(row), LCD_COLS);
+    }
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv) {
+    uint32_t sessions = 200;
+    uint32_t minutes = 10;
+    uint32_t seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--sessions") == 0 && i + 1 < argc) {
+            sessions = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--minutes") == 0 && i + 1 < argc) {
+            minutes = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [--sessions N] [--minutes M] [--seed S]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    const uint32_t end = minutes * 60000u;
+    std::vector<InputEvent> script;
+    std::vector<Observation> expect;
+    double fine_time = 0.0, skip_time = 0.0;
+    uint64_t fine_loops = 0, skip_loops = 0, checks = 0;
+
+    for (uint32_t s = 0; s < sessions; s++) {
+        make_script(seed + s, end, &script);
+        expect.resize(script.size() + 1);
+
+        // Pass 1: one loop() per millisecond
+        sim_eeprom_erase();
+        sim_set_button(false);
+        sim_power_on(0);
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t e = 0; e <= script.size(); e++) {
+            uint32_t until = e < script.size() ? script[e].time : end;
+            while (sim_millis() != until) {
+                sim_tick();
+                fine_loops++;
+            }
+            observe(&expect[e]);
+            if (e < script.size()) {
+                sim_set_button(script[e].pressed);
+            }
+        }
+        fine_time += seconds_since(t0);
+
+        // Pass 2: jump from deadline to deadline
+        sim_eeprom_erase();
+        sim_set_button(false);
+        sim_power_on(0);
+        t0 = std::chrono::steady_clock::now();
+        for (size_t e = 0; e <= script.size(); e++) {
+            uint32_t until = e < script.size() ? script[e].time : end;
+            skip_loops += sim_run_until(until);
+
+            Observation got;
+            observe(&got);
+            checks++;
+            if (memcmp(&got, &expect[e], sizeof(got)) != 0) {
+                printf("MISMATCH session %u at t=%u ms\n", s, until);
+                printf("  fine: state=%d pos=%u score=%u leds=%02X tones=%u lcd=\"%s|%s\"\n",
+                       (int)expect[e].game.state, expect[e].game.position, expect[e].game.score,
+                       expect[e].leds, expect[e].tone_count, expect[e].lcd[0], expect[e].lcd[1]);
+                printf("  skip: state=%d pos=%u score=%u leds=%02X tones=%u lcd=\"%s|%s\"\n",
+                       (int)got.game.state, got.game.position, got.game.score,
+                       got.leds, got.tone_count, got.lcd[0], got.lcd[1]);
+                return 1;
+            }
+            if (e < script.size()) {
+                sim_set_button(script[e].pressed);
+            }
+        }
+        skip_time += seconds_since(t0);
+    }
+
+    double simulated = (double)sessions * end / 1000.0;  // Seconds of game time
+    printf("OK: %u sessions x %u min identical (%llu checkpoints)\n",
+           sessions, minutes, (unsigned long long)checks);
+    printf("fine-grained:   %.3e game-s per wall-s, %.0f loop() per game-s\n",
+           simulated / fine_time, fine_loops / simulated);
+    printf("event-skipping: %.3e game-s per wall-s, %.1f loop() per game-s\n",
+           simulated / skip_time, skip_loops / simulated);
+    printf("speed-up:       %.1fx\n", fine_time / skip_time);
+    return 0;
+}
@@ -0,0 +1,301 @@
+/******************************************************************************
+ * BOUNCE_SUITE.CPP - Debouncers Scored on Synthetic Bounce (sim/bounce.h)
+ *
+ * Usage:
+ *   bounce-suite [--presses N] [--seed S] [--profile NAME]
+ *                [--bounces N] [--bounce-us US] [--emi-per-s R] [--emi-us US]
+ *
+ * Generates N presses of each bounce profile (or only --profile NAME; the
+ * other options change that profile, or "typical" if none is named) and
+ * feeds the same waveform to every filter below. For each it prints the
+ * detection latency (contact -> press reported: 50th, 95th percentile,
+ * worst), missed presses and false presses:
+ *
+ *   firmware     hardware.cpp: button_edge() as the ISR calls it, then
+ *                button_just_pressed(), on a simulated board (EEPROM
+ *                erased: it starts from BOUNCE_DEFAULT_US and learns)
+ *   learned      debounce.h on its own. Must report exactly what firmware
+ *                does, or the suite fails
+ *   lockout 50   The old rule: a press, then DEBOUNCE_MS of deafness
+ *   quiet N      debounce.h's rule with a fixed lockout of N ms: a press
+ *                only after N ms without an edge
+ *   sample N     Polled at 1 kHz, a press after N samples in a row read
+ *                down (a counter that saturates, so EMI shorter than a
+ *                sample period is unseen)
+ *
+ * The last table adds every profile up per filter: its latency against
+ * the presses it got wrong, the curve to pick DEBOUNCE_* from. Exits with
+ * status 1 if firmware and learned disagree, or if firmware gets a press
+ * wrong on the clean, typical or worn profile.
+ ******************************************************************************/
+
+#include "sim.h"
+#include "bounce.h"
+#include "debounce.h"
+#include "hardware.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const uint32_t SAMPLE_US = 1000;       // Polled filters: 1 kHz
+
+typedef struct {
+    Debouncer learned;
+    uint32_t last_edge_us;
+    uint32_t last_press_us;
+    bool any_edge;
+    bool any_press;
+    bool level;               // Sampled filters: the debounced level
+    uint8_t count;            // Sampled filters: the integrator
+} FilterState;
+
+typedef struct {
+    const char *name;
+    uint32_t param;
+    bool (*edge)(FilterState *s, uint32_t param, uint32_t at_us, bool down);
+    bool (*sample)(FilterState *s, uint32_t param, bool down);
+} Filter;
+
+static bool firmware_edge(FilterState *s, uint32_t param, uint32_t at_us, bool down) {
+    (void)s;
+    (void)param;
+    sim_set_button_at_us(down, at_us);
+    return button_just_pressed();
+}
+
+static bool learned_edge(FilterState *s, uint32_t param, uint32_t at_us, bool down) {
+    (void)param;
+    return debounce_edge(&s->learned, at_us, down);
+}
+
+static bool lockout_edge(FilterState *s, uint32_t param, uint32_t at_us, bool down) {
+    if (!down || (s->any_press && at_us - s->last_press_us < param * 1000)) {
+        return false;
+    }
+    s->any_press = true;
+    s->last_press_us = at_us;
+    return true;
+}
+
+static bool quiet_edge(FilterState *s, uint32_t param, uint32_t at_us, bool down) {
+    bool quiet = !s->any_edge || at_us - s->last_edge_us >= param * 1000;
+    s->any_edge = true;
+    s->last_edge_us = at_us;
+    return down && quiet;
+}
+
+static bool integrator_sample(FilterState *s, uint32_t param, bool down) {
+    if (down && s->count < param) {
+        s->count++;
+    } else if (!down && s->count > 0) {
+        s->count--;
+    }
+    bool was = s->level;
+    if (s->count == param) {
+        s->level = true;
+    } else if (s->count == 0) {
+        s->level = false;
+    }
+    return s->level && !was;
+}
+
+static const Filter filters[] = {
+    {"firmware", 0, firmware_edge, NULL},
+    {"learned", 0, learned_edge, NULL},
+    {"lockout 50", DEBOUNCE_MS, lockout_edge, NULL},
+    {"quiet 1", 1, quiet_edge, NULL},
+    {"quiet 3", 3, quiet_edge, NULL},
+    {"quiet 5", 5, quiet_edge, NULL},
+    {"quiet 10", 10, quiet_edge, NULL},
+    {"quiet 20", 20, quiet_edge, NULL},
+    {"sample 2", 2, NULL, integrator_sample},
+    {"sample 5", 5, NULL, integrator_sample},
+    {"sample 10", 10, NULL, integrator_sample},
+};
+static const uint8_t FILTER_COUNT = sizeof(filters) / sizeof(filters[0]);
+
+/**
+ * run_filter - Feed @edges to @f; its press reports go to @reports
+ */
+static void run_filter(const Filter *f, const std::vector<BounceEdge> &edges, uint32_t end_us,
+                       std::vector<uint32_t> *reports) {
+    FilterState s;
+    memset(&s, 0, sizeof(s));
+    debounce_start(&s.learned, false, BOUNCE_DEFAULT_US);
+    if (f->edge == firmware_edge) {
+        sim_eeprom_erase();
+        sim_set_button(false);
+        sim_power_on(0);
+    }
+    reports->clear();
+
+    if (f->sample != NULL) {
+        size_t next = 0;
+        bool level = false;
+        for (uint32_t t = 0; t < end_us; t += SAMPLE_US) {
+            while (next < edges.size() && edges[next].at_us <= t) {
+                level = edges[next++].down;
+            }
+            if (f->sample(&s, f->param, level)) {
+                reports->push_back(t);
+            }
+        }
+        return;
+    }
+    for (size_t i = 0; i < edges.size(); i++) {
+        if (f->edge(&s, f->param, edges[i].at_us, edges[i].down)) {
+            reports->push_back(edges[i].at_us);
+        }
+    }
+}
+
+typedef struct {
+    BounceScore score;        // Every profile's presses together
+} FilterTotal;
+
+static void print_score_row(const char *name, const BounceScore *score) {
+    printf("  %-11s %7u %7u %7u %7u %7u\n", name, bounce_percentile(score, 500),
+           bounce_percentile(score, 950),
+           score->latency_us.empty() ? 0 : score->latency_us.back(), score->missed,
+           score->false_presses);
+}
+
+/**
+ * run_profile - Every filter on @presses presses of @p
+ * @return: Problems (firmware != learned, or firmware wrong where it mustn't be)
+ */
+static uint32_t run_profile(const BounceProfile *p, uint32_t presses, uint32_t seed,
+                            FilterTotal totals[]) {
+    std::vector<BounceEdge> edges;
+    std::vector<BouncePress> truth;
+    uint32_t end_us = bounce_generate(p, presses, seed, &edges, &truth);
+
+    printf("%s: %u presses, %u edges, bursts of 0-%u breaks over up to %u us",
+           p->name, presses, (uint32_t)edges.size(), p->bounces_max, p->bounce_us_max);
+    if (p->emi_per_s != 0) {
+        printf(", %u EMI spikes/s up to %u us", p->emi_per_s, p->emi_us_max);
+    }
+    printf("\n  %-11s %7s %7s %7s %7s %7s\n", "filter", "p50 us", "p95 us", "max us",
+           "missed", "false");
+
+    uint32_t failed = 0;
+    std::vector<uint32_t> firmware_reports;
+    for (uint8_t i = 0; i < FILTER_COUNT; i++) {
+        std::vector<uint32_t> reports;
+        run_filter(&filters[i], edges, end_us, &reports);
+        BounceScore score;
+        bounce_score(truth, reports, &score);
+        print_score_row(filters[i].name, &score);
+
+        FilterTotal *total = &totals[i];
+        total->score.presses += score.presses;
+        total->score.detected += score.detected;
+        total->score.missed += score.missed;
+        total->score.false_presses += score.false_presses;
+        total->score.latency_us.insert(total->score.latency_us.end(), score.latency_us.begin(),
+                                       score.latency_us.end());
+
+        if (filters[i].edge == firmware_edge) {
+            firmware_reports = reports;
+            bool strict = strcmp(p->name, "clean") == 0 || strcmp(p->name, "typical") == 0 ||
+                          strcmp(p->name, "worn") == 0;
+            if (strict && (score.missed != 0 || score.false_presses != 0)) {
+                printf("FAIL: %s: firmware missed %u and invented %u presses\n", p->name,
+                       score.missed, score.false_presses);
+                failed++;
+            }
+        } else if (filters[i].edge == learned_edge && reports != firmware_reports) {
+            printf("FAIL: %s: firmware and debounce.h reported different presses\n", p->name);
+            failed++;
+        }
+    }
+    printf("\n");
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    uint32_t presses = 2000;
+    uint32_t seed = 1;
+    BounceProfile custom;
+    const BounceProfile *only = NULL;
+    bool changed = false;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char *option = argv[i];
+        if (strcmp(option, "--profile") == 0) {
+            only = bounce_profile_find(argv[i + 1]);
+            if (only == NULL) {
+                fprintf(stderr, "no profile called %s\n", argv[i + 1]);
+                return 2;
+            }
+            continue;
+        }
+        uint32_t value = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+        if (strcmp(option, "--presses") == 0) {
+            presses = value;
+        } else if (strcmp(option, "--seed") == 0) {
+            seed = value;
+        } else if (strcmp(option, "--bounces") == 0 || strcmp(option, "--bounce-us") == 0 ||
+                   strcmp(option, "--emi-per-s") == 0 || strcmp(option, "--emi-us") == 0) {
+            changed = true;   // Applied below, once the profile is known
+        } else {
+            fprintf(stderr, "usage: %s [--presses N] [--seed S] [--profile NAME] [--bounces N]"
+                    " [--bounce-us US] [--emi-per-s R] [--emi-us US]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (changed) {
+        custom = only != NULL ? *only : *bounce_profile_find("typical");
+        custom.name = "custom";
+        for (int i = 1; i + 1 < argc; i += 2) {
+            uint32_t value = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+            if (strcmp(argv[i], "--bounces") == 0) {
+                custom.bounces_max = (uint8_t)value;
+            } else if (strcmp(argv[i], "--bounce-us") == 0) {
+                custom.bounce_us_max = (uint16_t)value;
+            } else if (strcmp(argv[i], "--emi-per-s") == 0) {
+                custom.emi_per_s = (uint16_t)value;
+            } else if (strcmp(argv[i], "--emi-us") == 0) {
+                custom.emi_us_max = (uint16_t)value;
+            }
+        }
+        only = &custom;
+    }
+
+    FilterTotal totals[FILTER_COUNT];
+    for (uint8_t i = 0; i < FILTER_COUNT; i++) {
+        totals[i].score = BounceScore();
+    }
+    uint32_t failed = 0;
+    uint32_t runs = 0;
+    for (uint8_t p = 0; p < BOUNCE_PROFILE_COUNT; p++) {
+        if (only == NULL || only == &bounce_profiles[p]) {
+            failed += run_profile(&bounce_profiles[p], presses, seed + p, totals);
+            runs++;
+        }
+    }
+    if (only == &custom) {
+        failed += run_profile(&custom, presses, seed, totals);
+        runs++;
+    }
+
+    if (runs > 1) {
+        printf("all profiles: latency against presses got wrong (per 1000)\n");
+        printf("  %-11s %7s %7s %7s %7s\n", "filter", "p50 us", "p95 us", "missed", "false");
+        for (uint8_t i = 0; i < FILTER_COUNT; i++) {
+            BounceScore *score = &totals[i].score;
+            std::sort(score->latency_us.begin(), score->latency_us.end());
+            uint32_t n = score->presses != 0 ? score->presses : 1;
+            printf("  %-11s %7u %7u %7.1f %7.1f\n", filters[i].name,
+                   bounce_percentile(score, 500), bounce_percentile(score, 950),
+                   score->missed * 1000.0 / n, score->false_presses * 1000.0 / n);
+        }
+    }
+
+    if (failed != 0) {
+        printf("FAIL: %u problems\n", failed);
+        return 1;
+    }
+    printf("OK: firmware matches debounce.h and gets every clean, typical and worn press\n");
+    return 0;
+}
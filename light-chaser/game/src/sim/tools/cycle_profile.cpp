@@ -0,0 +1,410 @@
+/******************************************************************************
+ * CYCLE_PROFILE.CPP - Predicted Uno loop() Time per State (Host Simulator)
+ *
+ * Usage:
+ *   cycle-profile [--seconds N] [--seed S] [--no-lcd] [--cost NAME=CYCLES]...
+ *   cycle-profile --compare CAPTURE.bin [--seconds N] [--cost NAME=CYCLES]...
+ *
+ * Plays a session in the host simulator with every HAL call charged its Uno
+ * cycle cost (avr_costs.h, sim.h CYCLE COSTS) and reports, per game state:
+ * how many loop()s ran, the typical and 99th percentile predicted loop()
+ * time, and the worst one - the longest the board would go without reading
+ * the button - with the calls that made it slow. Then what each kind of HAL
+ * call cost over the whole session, and setup()'s share.
+ *
+ * Trying a design change takes seconds: edit, rebuild, rerun with the same
+ * --seed, compare the tables. --cost tries another price for one call
+ * without editing avr_costs.h (NAME is its name column), e.g.
+ * --cost "LCD byte=0" for a display that never waited on the bus.
+ *
+ * CHECKING THE PREDICTION (--compare):
+ * Needs the trace build (env:native_cycles_trace), so the host pays for the
+ * trace records as well, like the uno_trace firmware does. CAPTURE.bin is
+ * that firmware's output under simavr (tools/simavr_trace.cpp); the session
+ * here copies that tool's setup: no LCD, fresh EEPROM, and its button
+ * script (3 s of boot, then an 80 ms press every 1.7 s). Only loop()s whose
+ * game_update() span reached the capture can be compared (empty spans are
+ * elided), so the host counts only loop()s that sent trace bytes. Per state:
+ * predicted and measured mean and worst, and measured / predicted.
+ *
+ *   simavr-trace .pio/build/uno_trace/firmware.elf uno.bin --seconds 30
+ *   .pio/build/native_cycles_trace/program --compare uno.bin --seconds 30
+ ******************************************************************************/
+
+#include "sim.h"
+#include "game.h"
+#include "hardware.h"
+#include "trace.h"
+#include "trace_records.h"
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static const uint8_t NUM_STATES = sizeof(state_names) / sizeof(state_names[0]);
+static const uint32_t CYCLES_PER_US = (uint32_t)(F_CPU / 1000000UL);
+static const uint32_t BOT_STEP_MS = 5;           // Bot looks at the game this often
+static const uint32_t ATTRACT_PAUSE_MS = 1500;   // Bot: reads the screen, then starts
+
+// tools/simavr_trace.cpp's button script
+static const uint32_t SCRIPT_BOOT_MS = 3000;
+static const uint32_t SCRIPT_PERIOD_MS = 1700;
+static const uint32_t SCRIPT_HOLD_MS = 80;
+
+typedef struct {
+    std::vector<uint32_t> loops;                 // Cycles per loop()
+    uint32_t worst;
+    uint32_t worst_at_ms;
+    uint32_t worst_by_cost[AVR_COST_COUNT];
+} StateProfile;
+
+static StateProfile profiles[NUM_STATES];
+static GameState loop_state = STATE_ATTRACT;     // The state each loop() starts in
+static bool traced_only = false;                 // --compare: loop()s that sent records
+
+static uint32_t xorshift32(uint32_t *s) {
+    uint32_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *s = x;
+    return x;
+}
+
+static uint32_t cycles_to_us(uint64_t cycles) {
+    return (uint32_t)((cycles + CYCLES_PER_US / 2) / CYCLES_PER_US);
+}
+
+/**
+ * profile_loop - Loop hook: file the loop() that just ran under its state
+ */
+static void profile_loop(void) {
+    const SimCycles *c = sim_cycles();
+    if (!traced_only || c->loop_by_cost[COST_SERIAL] > 0) {
+        StateProfile *p = &profiles[loop_state];
+        p->loops.push_back(c->loop_cycles);
+        if (c->loop_cycles > p->worst) {
+            p->worst = c->loop_cycles;
+            p->worst_at_ms = sim_millis();
+            memcpy(p->worst_by_cost, c->loop_by_cost, sizeof(p->worst_by_cost));
+        }
+    }
+    GameStatus gs;
+    game_get_status(&gs);
+    loop_state = gs.state;
+}
+
+static void start_session(void) {
+    sim_eeprom_erase();
+    sim_set_button(false);
+    sim_power_on(0);
+    GameStatus gs;
+    game_get_status(&gs);
+    loop_state = gs.state;
+    sim_set_loop_hook(profile_loop);
+}
+
+/**
+ * play_bot - A player: starts games from ATTRACT, aims for the target zone
+ */
+static void play_bot(uint32_t seconds, uint32_t seed) {
+    uint32_t rng = seed * 2654435761u + 0x9E3779B9u;
+    bool pressed = false;
+    uint32_t release_at = 0;
+    GameState seen = STATE_ATTRACT;
+    uint32_t seen_since = 0;
+
+    while (sim_millis() < seconds * 1000u) {
+        uint32_t now = sim_millis();
+        GameStatus gs;
+        game_get_status(&gs);
+        if (gs.state != seen) {
+            seen = gs.state;
+            seen_since = now;
+        }
+
+        if (pressed) {
+            if (now >= release_at) {
+                pressed = false;
+                sim_set_button(false);
+            }
+        } else {
+            bool press = false;
+            if (gs.state == STATE_PLAYING) {
+                bool in_zone = gs.position >= TARGET_ZONE_START && gs.position <= TARGET_ZONE_END;
+                press = xorshift32(&rng) % 1000 < (in_zone ? 200u : 5u);
+            } else if (gs.state == STATE_ATTRACT) {
+                press = now - seen_since >= ATTRACT_PAUSE_MS;
+            }
+            if (press) {
+                pressed = true;
+                release_at = now + 50 + xorshift32(&rng) % 100;
+                sim_set_button(true);
+            }
+        }
+        uint32_t next = now + BOT_STEP_MS;
+        sim_run_until(next < seconds * 1000u ? next : seconds * 1000u);
+    }
+}
+
+#ifdef TRACE_ENABLED
+
+/**
+ * play_script - simavr_trace.cpp's button script, edge for edge
+ */
+static void play_script(uint32_t seconds) {
+    uint32_t end = seconds * 1000u;
+    uint32_t edge = SCRIPT_BOOT_MS;
+    bool pressed = false;
+    while (edge < end) {
+        sim_run_until(edge);
+        pressed = !pressed;
+        sim_set_button(pressed);
+        edge += pressed ? SCRIPT_HOLD_MS : SCRIPT_PERIOD_MS - SCRIPT_HOLD_MS;
+    }
+    sim_run_until(end);
+}
+
+#endif // TRACE_ENABLED
+
+static uint32_t percentile_us(std::vector<uint32_t> sorted, uint32_t percent) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    std::sort(sorted.begin(), sorted.end());
+    size_t i = (sorted.size() - 1) * percent / 100;
+    return cycles_to_us(sorted[i]);
+}
+
+/**
+ * print_worst_costs - The (up to) three costs that made a loop() slowest
+ */
+static void print_worst_costs(const uint32_t *by_cost) {
+    bool used[AVR_COST_COUNT] = {false};
+    for (uint8_t n = 0; n < 3; n++) {
+        int best = -1;
+        for (uint8_t i = 0; i < AVR_COST_COUNT; i++) {
+            if (!used[i] && by_cost[i] > 0 && (best < 0 || by_cost[i] > by_cost[best])) {
+                best = i;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        used[best] = true;
+        printf("%s%s %u", n == 0 ? "" : ", ", avr_costs[best].name, cycles_to_us(by_cost[best]));
+    }
+}
+
+static void report_states(void) {
+    printf("\n%-12s %7s %10s %10s %10s  %s\n",
+           "state", "loops", "median us", "p99 us", "worst us", "worst loop() (ms: us by call)");
+    uint32_t stall = 0;
+    uint8_t stall_state = 0;
+    for (uint8_t s = 0; s < NUM_STATES; s++) {
+        const StateProfile *p = &profiles[s];
+        if (p->loops.empty()) {
+            continue;
+        }
+        printf("%-12s %7zu %10u %10u %10u  %u: ", state_names[s], p->loops.size(),
+               percentile_us(p->loops, 50), percentile_us(p->loops, 99),
+               cycles_to_us(p->worst), p->worst_at_ms);
+        print_worst_costs(p->worst_by_cost);
+        printf("\n");
+        if (p->worst > stall) {
+            stall = p->worst;
+            stall_state = s;
+        }
+    }
+
+    const SimCycles *c = sim_cycles();
+    uint64_t total = 0;
+    for (uint8_t i = 0; i < AVR_COST_COUNT; i++) {
+        total += c->cycles[i];
+    }
+    printf("\n%-16s %10s %12s %6s\n", "call", "calls", "total us", "share");
+    for (uint8_t i = 0; i < AVR_COST_COUNT; i++) {
+        if (c->calls[i] == 0) {
+            continue;
+        }
+        printf("%-16s %10llu %12u %5.1f%%\n", avr_costs[i].name,
+               (unsigned long long)c->calls[i], cycles_to_us(c->cycles[i]),
+               total > 0 ? 100.0 * (double)c->cycles[i] / (double)total : 0.0);
+    }
+    printf("\nworst stall: %u us in %s at %u ms\n",
+           cycles_to_us(stall), state_names[stall_state], profiles[stall_state].worst_at_ms);
+}
+
+#ifdef TRACE_ENABLED
+
+/**
+ * report_compare - Predicted against simavr-measured game_update() spans
+ */
+static int report_compare(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return 2;
+    }
+    std::vector<uint8_t> data;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    fclose(f);
+
+    std::vector<Record> records;
+    parse_records(data.data(), data.size(), &records);
+    std::vector<uint32_t> measured[NUM_STATES];  // µs per game_update() span
+    uint64_t begin = 0;
+    uint8_t begin_state = NUM_STATES;
+    for (size_t i = 0; i < records.size(); i++) {
+        const Record *r = &records[i];
+        if (r->event != TRACE_GAME_UPDATE) {
+            continue;
+        }
+        if (r->phase == 'B') {
+            begin = r->time;
+            begin_state = r->arg;
+        } else if (r->phase == 'E' && begin_state < NUM_STATES) {
+            measured[begin_state].push_back((uint32_t)(r->time - begin));
+            begin_state = NUM_STATES;
+        }
+    }
+
+    printf("\n%-12s %13s %19s %19s %7s\n", "", "loop()s", "mean us", "worst us", "mean");
+    printf("%-12s %6s %6s %9s %9s %9s %9s %7s\n",
+           "state", "host", "simavr", "host", "simavr", "host", "simavr", "ratio");
+    for (uint8_t s = 0; s < NUM_STATES; s++) {
+        const StateProfile *p = &profiles[s];
+        if (p->loops.empty() && measured[s].empty()) {
+            continue;
+        }
+        uint64_t predicted_sum = 0;
+        for (size_t i = 0; i < p->loops.size(); i++) {
+            predicted_sum += p->loops[i];
+        }
+        uint64_t measured_sum = 0;
+        uint32_t measured_worst = 0;
+        for (size_t i = 0; i < measured[s].size(); i++) {
+            measured_sum += measured[s][i];
+            measured_worst = std::max(measured_worst, measured[s][i]);
+        }
+        double predicted_mean = p->loops.empty() ? 0.0 :
+            (double)predicted_sum / CYCLES_PER_US / (double)p->loops.size();
+        double measured_mean = measured[s].empty() ? 0.0 :
+            (double)measured_sum / (double)measured[s].size();
+        printf("%-12s %6zu %6zu %9.0f %9.0f %9u %9u", state_names[s],
+               p->loops.size(), measured[s].size(), predicted_mean, measured_mean,
+               cycles_to_us(p->worst), measured_worst);
+        if (predicted_mean > 0.0 && measured_mean > 0.0) {
+            printf(" %7.2f\n", measured_mean / predicted_mean);
+        } else {
+            printf(" %7s\n", "-");
+        }
+    }
+    printf("\nratio > 1: the board is slower than avr_costs.h says\n");
+    return 0;
+}
+
+#endif // TRACE_ENABLED
+
+/**
+ * set_cost - Apply one --cost NAME=CYCLES
+ */
+static bool set_cost(const char *arg) {
+    const char *equals = strrchr(arg, '=');
+    if (equals == NULL) {
+        return false;
+    }
+    size_t length = (size_t)(equals - arg);
+    for (uint8_t i = 0; i < AVR_COST_COUNT; i++) {
+        if (strlen(avr_costs[i].name) == length && strncmp(avr_costs[i].name, arg, length) == 0) {
+            sim_set_cost(i, (uint32_t)strtoul(equals + 1, NULL, 0));
+            return true;
+        }
+    }
+    return false;
+}
+
+static int usage(const char *program) {
+    fprintf(stderr, "usage: %s [--seconds N] [--seed S] [--no-lcd] [--cost NAME=CYCLES]...\n"
+                    "       %s --compare CAPTURE.bin [--seconds N] [--cost NAME=CYCLES]...\n"
+                    "costs:", program, program);
+    for (uint8_t i = 0; i < AVR_COST_COUNT; i++) {
+        fprintf(stderr, " \"%s\"", avr_costs[i].name);
+    }
+    fprintf(stderr, "\n");
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    uint32_t seconds = 0;
+    uint32_t seed = 1;
+    bool lcd = true;
+    const char *compare = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-lcd") == 0) {
+            lcd = false;
+        } else if (i + 1 >= argc) {
+            return usage(argv[0]);
+        } else if (strcmp(argv[i], "--seconds") == 0) {
+            seconds = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            seed = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--compare") == 0) {
+            compare = argv[++i];
+        } else if (strcmp(argv[i], "--cost") == 0) {
+            if (!set_cost(argv[++i])) {
+                fprintf(stderr, "bad --cost %s\n", argv[i]);
+                return usage(argv[0]);
+            }
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (seconds == 0) {
+        seconds = compare != NULL ? 30 : 600;  // simavr_trace.cpp's default
+    }
+
+    if (compare != NULL) {
+#ifndef TRACE_ENABLED
+        fprintf(stderr, "--compare needs the trace build (env:native_cycles_trace)\n");
+        return 2;
+#else
+        FILE *sink = fopen("/dev/null", "wb");
+        sim_serial_capture(sink);
+        sim_set_lcd_address(0);
+        traced_only = true;
+        trace_init();
+        start_session();
+        play_script(seconds);
+        sim_set_loop_hook(NULL);
+        sim_serial_capture(NULL);
+        if (sink != NULL) {
+            fclose(sink);
+        }
+        printf("%u s of simavr_trace's button script, %u cycles/us\n", seconds, CYCLES_PER_US);
+        return report_compare(compare);
+#endif
+    }
+
+    if (!lcd) {
+        sim_set_lcd_address(0);
+    }
+    start_session();
+    uint64_t setup_cycles = 0;
+    for (uint8_t i = 0; i < AVR_COST_COUNT; i++) {
+        setup_cycles += sim_cycles()->cycles[i];
+    }
+    play_bot(seconds, seed);
+    sim_set_loop_hook(NULL);
+
+    printf("%u s simulated, seed %u, %s, %u cycles/us\n", seconds, seed,
+           lcd ? "LCD fitted" : "no LCD", CYCLES_PER_US);
+    printf("setup(): %u us of HAL calls\n", cycles_to_us(setup_cycles));
+    report_states();
+    return 0;
+}
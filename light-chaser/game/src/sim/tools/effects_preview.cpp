@@ -0,0 +1,118 @@
+/******************************************************************************
+ * EFFECTS_PREVIEW.CPP - Every LED Effect Preset, Frame by Frame
+ *
+ * Usage:
+ *   effects-preview [--frames N] [--seed S]
+ *
+ * Prints the celebration and attract playlists from effects.h as they would
+ * play, one row per frame ('#' lit, '.' dark, LED 0 on the left), so a new
+ * preset can be judged before it is flashed:
+ *
+ *   attract 1: AUTOMATON a=30 b=0x10
+ *     0  ....#...
+ *     1  ...###..
+ *     2  ..##..#.
+ *
+ * Also checks what the header promises: the step counter wraps without a
+ * jump (the frame after EFFECT_STEP_WRAP steps is the frame after 0 steps
+ * for every periodic kind), and no preset goes dark for a whole run.
+ * Exits with status 1 if either fails.
+ ******************************************************************************/
+
+#include "effects.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *const kind_names[] = {"WAVE", "SPARKLE", "AUTOMATON", "BOUNCE", "SCANNER"};
+
+static void print_frame(uint32_t n, uint8_t frame) {
+    char row[NUM_LEDS + 1];
+    for (uint8_t i = 0; i < NUM_LEDS; i++) {
+        row[i] = (frame & (1 << i)) ? '#' : '.';
+    }
+    row[NUM_LEDS] = '\0';
+    printf("  %3u  %s\n", n, row);
+}
+
+/**
+ * preview - Print @frames frames of @preset; @return false if it never lit
+ */
+static bool preview(const char *list, uint8_t index, const EffectPreset *preset,
+                    uint32_t frames, uint16_t seed) {
+    printf("%s %u: %s a=%u b=0x%02X\n", list, index, kind_names[preset->kind],
+           preset->a, preset->b);
+    LedEffect e;
+    effect_start(&e, preset, seed);
+    uint8_t lit = 0;
+    for (uint32_t n = 0; n < frames; n++) {
+        uint8_t frame = effect_next(&e);
+        lit |= frame;
+        print_frame(n, frame);
+    }
+    return lit != 0;
+}
+
+/**
+ * wraps_cleanly - Periodic kinds repeat exactly across the step wrap
+ *
+ * SPARKLE and AUTOMATON carry their own state, so only the kinds that are
+ * pure functions of the step are checked.
+ */
+static bool wraps_cleanly(const EffectPreset *preset) {
+    if (preset->kind == EFFECT_SPARKLE || preset->kind == EFFECT_AUTOMATON) {
+        return true;
+    }
+    LedEffect e;
+    effect_start(&e, preset, 1);
+    uint8_t first[NUM_LEDS * 2];
+    for (uint8_t n = 0; n < sizeof(first); n++) {
+        first[n] = effect_next(&e);
+    }
+    for (uint16_t n = sizeof(first); n < EFFECT_STEP_WRAP; n++) {
+        effect_next(&e);
+    }
+    for (uint8_t n = 0; n < sizeof(first); n++) {
+        if (effect_next(&e) != first[n]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    uint32_t frames = 24;
+    uint16_t seed = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        uint32_t value = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+        if (strcmp(argv[i], "--frames") == 0) {
+            frames = value;
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            seed = (uint16_t)value;
+        } else {
+            fprintf(stderr, "usage: %s [--frames N] [--seed S]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    uint32_t failures = 0;
+    for (uint8_t i = 0; i < CELEBRATION_EFFECT_COUNT; i++) {
+        bool ok = preview("celebration", i, &celebration_effects[i], frames, seed);
+        ok = wraps_cleanly(&celebration_effects[i]) && ok;
+        failures += !ok;
+    }
+    for (uint8_t i = 0; i < ATTRACT_EFFECT_COUNT; i++) {
+        bool ok = preview("attract", i, &attract_effects[i], frames, seed);
+        ok = wraps_cleanly(&attract_effects[i]) && ok;
+        failures += !ok;
+    }
+
+    printf("%u presets, %u bytes of RAM per playing effect\n",
+           CELEBRATION_EFFECT_COUNT + ATTRACT_EFFECT_COUNT, (unsigned)sizeof(LedEffect));
+    if (failures != 0) {
+        printf("FAIL: %u presets dark or jumping at the step wrap\n", failures);
+        return 1;
+    }
+    printf("OK: every preset lights up and wraps cleanly\n");
+    return 0;
+}
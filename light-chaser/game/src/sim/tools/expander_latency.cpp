@@ -0,0 +1,176 @@
+/******************************************************************************
+ * EXPANDER_LATENCY.CPP - Input Expander Press Latency in the Host Simulator
+ *
+ * Usage:
+ *   expander-latency [--seconds N] [--seed S]
+ *
+ * Fits the virtual MCP23017 and plays N seconds of the game with a bot on
+ * expander input GPA0 (player button 1). Every press lands at a random µs:
+ * usually while the CPU sleeps, sometimes in the middle of an LCD update.
+ * An operator switch on GPB0 is flipped at random times as well, so INTA
+ * also fires when nobody is waiting for a press.
+ *
+ * Reports, from the firmware's own expander_get_latency() counters:
+ * - read:  INTA edge -> burst read finished (expander_service())
+ * - press: INTA edge -> button_just_pressed() handed the press to the game
+ * as count, mean, p50, p99 and max. Mean and max cover every event; the
+ * percentiles sample the last event of each loop() (two INTA events in one
+ * loop() are rare).
+ *
+ * The bus model is sim.cpp's: ~90 µs per I2C byte, 1.3 ms per LCD character.
+ * The board's pin-change wake-up (a few µs) is not modelled.
+ ******************************************************************************/
+
+#include "sim.h"
+#include "game.h"
+#include "hardware.h"
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static const uint8_t BOT_INPUT = 0;      // GPA0: player button 1
+static const uint8_t NOISE_INPUT = 8;    // GPB0: operator switch 1
+
+static std::vector<uint32_t> read_samples;
+static std::vector<uint32_t> press_samples;
+static uint16_t seen_reads = 0;
+static uint16_t seen_presses = 0;
+
+static uint32_t xorshift32(uint32_t *s) {
+    uint32_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *s = x;
+    return x;
+}
+
+/**
+ * sample_latency - Loop hook: keep the newest read and press latency
+ */
+static void sample_latency(void) {
+    const ExpanderLatency *l = expander_get_latency();
+    if (l->reads != seen_reads) {
+        seen_reads = l->reads;
+        read_samples.push_back(l->read_last_us);
+    }
+    if (l->presses != seen_presses) {
+        seen_presses = l->presses;
+        press_samples.push_back(l->press_last_us);
+    }
+}
+
+static void report(const char *name, uint16_t count, uint32_t total_us, uint32_t max_us,
+                   std::vector<uint32_t> *samples) {
+    if (count == 0 || samples->empty()) {
+        printf("%-6s none\n", name);
+        return;
+    }
+    std::sort(samples->begin(), samples->end());
+    uint32_t p50 = (*samples)[samples->size() / 2];
+    uint32_t p99 = (*samples)[samples->size() * 99 / 100];
+    printf("%-6s %6u events  mean %6u us  p50 %6u us  p99 %6u us  max %6u us\n",
+           name, count, total_us / count, p50, p99, max_us);
+}
+
+/**
+ * press_at - One bot press at a random µs of the current millisecond
+ *
+ * The change is scheduled before loop() runs, so an LCD update in this
+ * loop() that is still going at @at_us sees it mid-transfer. Otherwise the
+ * CPU idles until @at_us and the wake-up loop() collects it.
+ */
+static void press_at(uint32_t at_us, bool pressed) {
+    sim_schedule_expander_input(BOT_INPUT, pressed, at_us);
+    sim_loop();
+    sim_idle_until_us(at_us);
+    sim_loop();
+    sim_advance(1);
+}
+
+static void bot_session(uint32_t seconds, uint32_t seed) {
+    uint32_t rng = seed * 2654435761u + 0x9E3779B9u;
+    bool pressed = false;
+    uint32_t release_at = 0;
+    uint32_t next_noise_us = 0;
+    bool noise_on = false;
+
+    while (sim_millis() < seconds * 1000u) {
+        uint32_t now = sim_millis();
+
+        // Switch flips are scheduled ahead, so they can fall inside the
+        // bus traffic of a loop() that hasn't run yet
+        if (next_noise_us <= now * 1000u + 1000u) {
+            next_noise_us = now * 1000u + 50000u + xorshift32(&rng) % 450000u;
+            noise_on = !noise_on;
+            sim_schedule_expander_input(NOISE_INPUT, noise_on, next_noise_us);
+        }
+
+        // A press can't happen in the past: if the last loop() overran its
+        // millisecond, the CPU is already further on than millis()
+        uint32_t at_us = now * 1000u + xorshift32(&rng) % 1000;
+        if ((int32_t)(micros() - at_us) > 0) {
+            at_us = micros();
+        }
+
+        if (pressed) {
+            if (now >= release_at) {
+                pressed = false;
+                press_at(at_us, false);
+                continue;
+            }
+        } else {
+            GameStatus gs;
+            game_get_status(&gs);
+            uint32_t chance = 0;
+            if (gs.state == STATE_PLAYING) {
+                bool in_zone = gs.position >= TARGET_ZONE_START && gs.position <= TARGET_ZONE_END;
+                chance = in_zone ? 40 : 1;
+            } else if (gs.state == STATE_ATTRACT || gs.state == STATE_RESULT) {
+                chance = 2;  // RESULT: the press lands during its LCD update
+            }
+            if (xorshift32(&rng) % 1000 < chance) {
+                pressed = true;
+                release_at = now + 50 + xorshift32(&rng) % 100;
+                press_at(at_us, true);
+                continue;
+            }
+        }
+        sim_tick();
+    }
+}
+
+int main(int argc, char **argv) {
+    uint32_t seconds = 600;
+    uint32_t seed = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        uint32_t value = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+        if (strcmp(argv[i], "--seconds") == 0) {
+            seconds = value;
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            seed = value;
+        } else {
+            fprintf(stderr, "usage: %s [--seconds N] [--seed S]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    sim_eeprom_erase();
+    sim_set_button(false);
+    sim_set_expander_present(true);
+    sim_power_on(0);
+    if (!expander_present()) {
+        fprintf(stderr, "expander not detected\n");
+        return 1;
+    }
+    sim_set_loop_hook(sample_latency);
+    bot_session(seconds, seed);
+
+    const ExpanderLatency *l = expander_get_latency();
+    printf("%u s simulated\n", seconds);
+    report("read", l->reads, l->read_total_us, l->read_max_us, &read_samples);
+    report("press", l->presses, l->press_total_us, l->press_max_us, &press_samples);
+    return 0;
+}
@@ -0,0 +1,744 @@
+/******************************************************************************
+ * FIDELITY_CHECK.CPP - Host Simulator Against the Real Firmware (simavr)
+ *
+ * Usage:
+ *   fidelity-check FIRMWARE.elf [--scripts N] [--seconds S] [--seed S]
+ *                  [--jobs J] [--tolerance-us T] [--hz F_CPU] [--shrink-runs R]
+ *   fidelity-check FIRMWARE.elf --presses AT:HOLD,AT:HOLD,... [--end-ms T]
+ *
+ * Every tuning number that comes out of the host tools (bench_batch,
+ * restart_throughput, bounce_suite...) assumes the host simulator plays
+ * the game the board plays. This checks it. Each script is a list of button
+ * presses; it is played twice:
+ *
+ *   host     game.cpp, hardware.cpp and trace.cpp on the virtual board
+ *            (sim.cpp), traced to a temporary file
+ *   simavr   a tracing firmware (pio run -e uno_trace) on a simulated
+ *            ATmega328P, traced through its UART
+ *
+ * Neither side has an LCD, expander or coin mech fitted, and both start
+ * with EEPROM erased. The two record streams are compared the way
+ * trace-export diff compares two clocks (sim/trace_records.h): what the
+ * player sees or hears must come in the same order with the same values,
+ * each within --tolerance-us (default 2000: two millis() steps, one for
+ * each side's rounding). Afterwards all 1 KB of EEPROM must match.
+ *
+ * WHAT A DIVERGENCE LOOKS LIKE:
+ *
+ *   Kind      First difference                 Usual cause
+ *   event     a different event                State logic that depends on
+ *                                              something the host models
+ *                                              differently
+ *   value     same event, another argument     Integer width (int is 16 bits
+ *                                              on the AVR), overflow, rounding
+ *   timing    same record, out of tolerance    Within 2 ms: millis()
+ *                                              granularity. Growing with time:
+ *                                              a timer rate. Otherwise timer or
+ *                                              interrupt semantics
+ *   length    one side has more records        A hang, a reset, a lost press
+ *   eeprom    a stored byte                    Score (bytes 0-3) or a learned
+ *                                              value (latency, debounce)
+ *   stopped   simavr: the CPU stopped          Crash, or sleep with
+ *                                              interrupts off
+ *
+ * The cause column is printed as a hint, not a verdict.
+ *
+ * MINIMAL REPRODUCTION:
+ * A diverging script is shrunk before it is reported: presses after the
+ * first difference are dropped and the run ends 2 s after it, then each
+ * remaining press is taken out in turn (last first) and left out if the
+ * same kind of divergence still happens. At most --shrink-runs reruns
+ * (default 40). The report ends with the --presses line that replays the
+ * smallest script, and the records just before the difference on both
+ * sides.
+ *
+ * BATCH:
+ * --scripts N random scripts (default 1000, seeded from --seed; each
+ * --seconds long, default 30): after the 3 s boot, presses of 30-250 ms with
+ * gaps of 40 ms to 2.5 s. Like replay_corpus, the host side keeps its state
+ * in statics, so the batch forks --jobs worker processes (default: one per
+ * core); each runs its own simavr. Exits with status 1 if any script
+ * diverged.
+ *
+ * Build: pio run -e uno_trace -e simavr_fidelity (needs simavr and libelf)
+ ******************************************************************************/
+
+#include "sim.h"
+#include "game.h"
+#include "hardware.h"
+#include "trace.h"
+#include "trace_records.h"
+#include <EEPROM.h>
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_cycle_timers.h>
+#include <simavr/avr_ioport.h>
+#include <simavr/avr_uart.h>
+#include <simavr/avr_eeprom.h>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+static const uint32_t BOOT_MS = 3000;               // Self-test, LCD fault hold
+static const uint32_t SHRINK_TAIL_MS = 2000;        // Kept after the first difference
+static const uint32_t MAX_REPORTS_PER_WORKER = 3;
+static const uint16_t EEPROM_BYTES = 1024;
+static const uint8_t CONTEXT_RECORDS = 3;           // Printed before a difference
+
+typedef struct {
+    uint32_t at_ms;
+    uint16_t hold_ms;
+} Press;
+
+typedef struct {
+    uint32_t seed;              // 0 for a script from --presses
+    uint32_t end_ms;
+    std::vector<Press> presses;
+} Script;
+
+typedef struct {
+    std::vector<Record> outputs;
+    uint8_t eeprom[EEPROM_BYTES];
+    bool stopped;               // simavr: the CPU stopped before end_ms
+} RunOutput;
+
+enum DivergenceKind {
+    DIV_NONE,
+    DIV_EVENT,
+    DIV_VALUE,
+    DIV_TIMING,
+    DIV_LENGTH,
+    DIV_EEPROM,
+    DIV_STOPPED,
+    DIV_KIND_COUNT
+};
+
+static const char *const kind_names[DIV_KIND_COUNT] = {
+    "none", "event", "value", "timing", "length", "eeprom", "stopped"
+};
+
+typedef struct {
+    DivergenceKind kind;
+    size_t index;               // Output record, or EEPROM address
+    int64_t skew_us;            // simavr - host, for timing
+    const char *hint;
+} Divergence;
+
+typedef struct {
+    const char *firmware_path;
+    elf_firmware_t firmware;
+    uint32_t hz;
+    uint32_t tolerance_us;
+    uint32_t shrink_runs;
+} Options;
+
+typedef struct {
+    uint64_t scripts;
+    uint64_t records;           // Output records compared
+    uint64_t diverged[DIV_KIND_COUNT];
+    uint64_t worst_skew_us;     // Among records that matched
+} WorkerSummary;
+
+static uint32_t xorshift32(uint32_t *s) {
+    uint32_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *s = x;
+    return x;
+}
+
+/**
+ * script_generate - Random presses over @seconds, the same for the same @seed
+ *
+ * One gap in four is short (40-200 ms), for fast retries and presses that
+ * land right after a state change.
+ */
+static void script_generate(uint32_t seed, uint32_t seconds, Script *s) {
+    uint32_t rng = seed * 2654435761u + 0x9E3779B9u;
+    s->seed = seed;
+    s->end_ms = seconds * 1000;
+    s->presses.clear();
+    uint32_t t = BOOT_MS + xorshift32(&rng) % 1000;
+    while (t + 300 < s->end_ms) {
+        Press p;
+        p.at_ms = t;
+        p.hold_ms = (uint16_t)(30 + xorshift32(&rng) % 221);
+        s->presses.push_back(p);
+        uint32_t gap = xorshift32(&rng) % 4 == 0 ? 40 + xorshift32(&rng) % 161
+                                                 : 200 + xorshift32(&rng) % 2301;
+        t += p.hold_ms + gap;
+    }
+}
+
+/**
+ * script_parse - "AT:HOLD,AT:HOLD,..." (ms) into @s
+ * @return: false if it isn't in that form or the presses overlap
+ */
+static bool script_parse(const char *text, uint32_t end_ms, Script *s) {
+    s->seed = 0;
+    s->presses.clear();
+    const char *p = text;
+    uint32_t last_release = 0;
+    while (*p != '\0') {
+        char *end;
+        Press press;
+        press.at_ms = (uint32_t)strtoul(p, &end, 10);
+        if (*end != ':') {
+            return false;
+        }
+        press.hold_ms = (uint16_t)strtoul(end + 1, &end, 10);
+        if ((*end != ',' && *end != '\0') || press.at_ms < last_release) {
+            return false;
+        }
+        last_release = press.at_ms + press.hold_ms;
+        s->presses.push_back(press);
+        p = *end == ',' ? end + 1 : end;
+    }
+    s->end_ms = end_ms != 0 ? end_ms : last_release + SHRINK_TAIL_MS;
+    return true;
+}
+
+static void script_print(const Script *s) {
+    printf("--presses %s", s->presses.empty() ? "\"\"" : "");
+    for (size_t i = 0; i < s->presses.size(); i++) {
+        printf("%s%u:%u", i == 0 ? "" : ",", s->presses[i].at_ms, s->presses[i].hold_ms);
+    }
+    printf(" --end-ms %u\n", s->end_ms);
+}
+
+/******************************************************************************
+ * HOST SIDE
+ ******************************************************************************/
+
+/**
+ * run_host - Play @s on the virtual board, tracing to a temporary file
+ */
+static void run_host(const Script *s, RunOutput *out) {
+    FILE *capture = tmpfile();
+    if (capture == NULL) {
+        perror("tmpfile");
+        exit(2);
+    }
+    sim_serial_capture(capture);
+    sim_eeprom_erase();
+    sim_set_lcd_address(0);      // As in simavr: nothing on the I2C bus
+    sim_set_button(false);
+    trace_init();
+    sim_power_on(0);
+    for (size_t i = 0; i < s->presses.size(); i++) {
+        sim_run_until(s->presses[i].at_ms);
+        sim_set_button(true);
+        sim_run_until(s->presses[i].at_ms + s->presses[i].hold_ms);
+        sim_set_button(false);
+    }
+    sim_run_until(s->end_ms);
+    sim_serial_capture(NULL);
+
+    std::vector<uint8_t> data((size_t)ftell(capture));
+    rewind(capture);
+    data.resize(fread(data.data(), 1, data.size(), capture));
+    fclose(capture);
+    out->outputs.clear();
+    output_records(data, &out->outputs);
+    for (uint16_t a = 0; a < EEPROM_BYTES; a++) {
+        out->eeprom[a] = EEPROM.read(a);
+    }
+    out->stopped = false;
+}
+
+/******************************************************************************
+ * SIMAVR SIDE
+ ******************************************************************************/
+
+typedef struct {
+    avr_irq_t *button;
+    std::vector<uint32_t> edges_us;     // Press, release, press, ...
+    size_t next;
+} ButtonScript;
+
+/**
+ * uart_byte - UART0 output hook: append one byte to the capture
+ */
+static void uart_byte(avr_irq_t *irq, uint32_t value, void *param) {
+    (void)irq;
+    ((std::vector<uint8_t> *)param)->push_back((uint8_t)value);
+}
+
+/**
+ * button_edge - Cycle timer callback: the next press or release, schedule the one after
+ */
+static avr_cycle_count_t button_edge(avr_t *avr, avr_cycle_count_t when, void *param) {
+    (void)when;
+    ButtonScript *script = (ButtonScript *)param;
+    avr_raise_irq(script->button, (script->next & 1) ? 1 : 0);   // Active LOW
+    script->next++;
+    if (script->next >= script->edges_us.size()) {
+        return 0;
+    }
+    return avr_usec_to_cycles(avr, script->edges_us[script->next]);
+}
+
+/**
+ * run_avr - Play @s on a fresh simulated ATmega328P running the firmware
+ */
+static void run_avr(const Options *opt, const Script *s, RunOutput *out) {
+    avr_t *avr = avr_make_mcu_by_name("atmega328p");
+    if (avr == NULL) {
+        fprintf(stderr, "simavr has no atmega328p core\n");
+        exit(2);
+    }
+    avr_init(avr);
+    avr->frequency = opt->hz;
+    elf_firmware_t firmware = opt->firmware;
+    avr_load_firmware(avr, &firmware);
+
+    std::vector<uint8_t> data;
+    uint32_t flags = 0;
+    avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+    flags &= ~AVR_UART_FLAG_STDIO;
+    avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT),
+                            uart_byte, &data);
+
+    // Inputs idle HIGH (pull-ups): button PB2 (D10), INTA PB4 (D12), coin PC0 (A0)
+    ButtonScript script;
+    script.button = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 2);
+    script.next = 0;
+    for (size_t i = 0; i < s->presses.size(); i++) {
+        script.edges_us.push_back(s->presses[i].at_ms * 1000u);
+        script.edges_us.push_back((s->presses[i].at_ms + s->presses[i].hold_ms) * 1000u);
+    }
+    avr_raise_irq(script.button, 1);
+    avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 4), 1);
+    avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('C'), 0), 1);
+    if (!script.edges_us.empty()) {
+        avr_cycle_timer_register(avr, avr_usec_to_cycles(avr, script.edges_us[0]), button_edge,
+                                 &script);
+    }
+
+    avr_cycle_count_t end = avr_usec_to_cycles(avr, s->end_ms * 1000u);
+    int state = cpu_Running;
+    while (avr->cycle < end && state != cpu_Done && state != cpu_Crashed) {
+        state = avr_run(avr);
+    }
+    out->stopped = state == cpu_Done || state == cpu_Crashed;
+    out->outputs.clear();
+    output_records(data, &out->outputs);
+
+    avr_eeprom_desc_t ee;
+    ee.ee = out->eeprom;
+    ee.offset = 0;
+    ee.size = EEPROM_BYTES;
+    memset(out->eeprom, 0xFF, sizeof(out->eeprom));
+    avr_ioctl(avr, AVR_IOCTL_EEPROM_GET, &ee);
+    avr_terminate(avr);
+    free(avr);
+}
+
+/******************************************************************************
+ * COMPARING
+ ******************************************************************************/
+
+/**
+ * timing_hint - Likely cause of a record @skew_us late (or early) at @at_us
+ */
+static const char *timing_hint(int64_t skew_us, uint64_t at_us) {
+    uint64_t skew = skew_us < 0 ? (uint64_t)-skew_us : (uint64_t)skew_us;
+    if (skew <= 2048) {
+        return "within two ms: millis() granularity";
+    }
+    if (at_us != 0 && skew * 1000000u / at_us >= 1000) {
+        return "a drift of 0.1% or more: a timer's rate or prescaler";
+    }
+    return "one step out of place: timer or interrupt semantics";
+}
+
+/**
+ * compare_runs - First difference between @host and @avr, if any
+ * @return: true if they differ (@d says how)
+ *
+ * Records within @tolerance_us of @end_us are left out of the count: one
+ * side may have sent a record the other sends a moment after the end.
+ */
+static bool compare_runs(const RunOutput *host, const RunOutput *avr, uint64_t end_us,
+                         uint32_t tolerance_us, Divergence *d, WorkerSummary *sum) {
+    d->kind = DIV_NONE;
+    d->index = 0;
+    d->skew_us = 0;
+    d->hint = "";
+    if (avr->stopped) {
+        d->kind = DIV_STOPPED;
+        d->hint = "crash, or sleep with interrupts off";
+        return true;
+    }
+    size_t host_end = 0;
+    while (host_end < host->outputs.size() &&
+           host->outputs[host_end].time + tolerance_us < end_us) {
+        host_end++;
+    }
+    size_t avr_end = 0;
+    while (avr_end < avr->outputs.size() && avr->outputs[avr_end].time + tolerance_us < end_us) {
+        avr_end++;
+    }
+
+    size_t count = host_end < avr_end ? host_end : avr_end;
+    for (size_t i = 0; i < count; i++) {
+        const Record *h = &host->outputs[i];
+        const Record *a = &avr->outputs[i];
+        int64_t skew = (int64_t)a->time - (int64_t)h->time;
+        uint64_t magnitude = skew < 0 ? (uint64_t)-skew : (uint64_t)skew;
+        d->index = i;
+        d->skew_us = skew;
+        if (h->event != a->event) {
+            d->kind = DIV_EVENT;
+            d->hint = "different paths through the state logic";
+            return true;
+        }
+        if (h->arg != a->arg) {
+            d->kind = DIV_VALUE;
+            d->hint = "same event, another value: integer width or arithmetic";
+            return true;
+        }
+        if (magnitude > tolerance_us) {
+            d->kind = DIV_TIMING;
+            d->hint = timing_hint(skew, h->time);
+            return true;
+        }
+        if (sum != NULL) {
+            sum->records++;
+            sum->worst_skew_us = magnitude > sum->worst_skew_us ? magnitude : sum->worst_skew_us;
+        }
+    }
+    if (host_end != avr_end) {
+        d->index = count;
+        d->kind = DIV_LENGTH;
+        d->hint = "one side stopped reacting: a hang, a reset or a lost press";
+        return true;
+    }
+    for (uint16_t a = 0; a < EEPROM_BYTES; a++) {
+        if (host->eeprom[a] != avr->eeprom[a]) {
+            d->index = a;
+            d->kind = DIV_EEPROM;
+            d->hint = a < 4 ? "the high score record" : "a stored record (latency, debounce...)";
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * play - Run @s on both sides and compare them
+ * @return: true if they differ
+ */
+static bool play(const Options *opt, const Script *s, RunOutput *host, RunOutput *avr,
+                 Divergence *d, WorkerSummary *sum) {
+    run_host(s, host);
+    run_avr(opt, s, avr);
+    return compare_runs(host, avr, (uint64_t)s->end_ms * 1000u, opt->tolerance_us, d, sum);
+}
+
+/**
+ * divergence_ms - When @d happened (the later side), or 0 if it has no time
+ */
+static uint32_t divergence_ms(const RunOutput *host, const RunOutput *avr, const Divergence *d) {
+    if (d->kind != DIV_EVENT && d->kind != DIV_VALUE && d->kind != DIV_TIMING &&
+        d->kind != DIV_LENGTH) {
+        return 0;
+    }
+    uint64_t at = 0;
+    if (d->index < host->outputs.size()) {
+        at = host->outputs[d->index].time;
+    }
+    if (d->index < avr->outputs.size() && avr->outputs[d->index].time > at) {
+        at = avr->outputs[d->index].time;
+    }
+    return (uint32_t)(at / 1000);
+}
+
+/**
+ * shrink - Smallest script found that still diverges the way @s does
+ * @return: Reruns used
+ */
+static uint32_t shrink(const Options *opt, const Script *s, const RunOutput *host,
+                       const RunOutput *avr, const Divergence *d, Script *best) {
+    *best = *s;
+    uint32_t runs = 0;
+    RunOutput h, a;
+    Divergence again;
+
+    uint32_t at_ms = divergence_ms(host, avr, d);
+    if (at_ms != 0 && at_ms + SHRINK_TAIL_MS < s->end_ms && runs < opt->shrink_runs) {
+        Script cut = *s;
+        cut.end_ms = at_ms + SHRINK_TAIL_MS;
+        while (!cut.presses.empty() && cut.presses.back().at_ms > at_ms) {
+            cut.presses.pop_back();
+        }
+        runs++;
+        if (play(opt, &cut, &h, &a, &again, NULL) && again.kind == d->kind) {
+            *best = cut;
+        }
+    }
+    for (size_t i = best->presses.size(); i-- > 0 && runs < opt->shrink_runs;) {
+        Script fewer = *best;
+        fewer.presses.erase(fewer.presses.begin() + (ptrdiff_t)i);
+        runs++;
+        if (play(opt, &fewer, &h, &a, &again, NULL) && again.kind == d->kind) {
+            *best = fewer;
+        }
+    }
+    return runs;
+}
+
+static void print_record(const char *side, const Record *r) {
+    char name[64];
+    event_name(r->event, r->arg, name, sizeof(name));
+    printf("    %-7s %10.6f s  %s\n", side, r->time / 1e6, name);
+}
+
+/**
+ * report - Print @d for script @s, shrunk to its smallest form
+ */
+static void report(const Options *opt, uint32_t number, const Script *s, const RunOutput *host,
+                   const RunOutput *avr, const Divergence *d) {
+    Script small = *s;
+    RunOutput h = *host;
+    RunOutput a = *avr;
+    Divergence shown = *d;
+    uint32_t runs = opt->shrink_runs != 0 ? shrink(opt, s, host, avr, d, &small) : 0;
+    if (small.presses.size() != s->presses.size() || small.end_ms != s->end_ms) {
+        RunOutput h2, a2;
+        Divergence again;
+        // Shrinking can't lose it (each step was checked), but play it
+        // again to print its records
+        if (play(opt, &small, &h2, &a2, &again, NULL) && again.kind == d->kind) {
+            h = h2;
+            a = a2;
+            shown = again;
+        } else {
+            small = *s;
+        }
+    }
+
+    printf("DIVERGED script %u (seed %u): %s at ", number, s->seed, kind_names[shown.kind]);
+    if (shown.kind == DIV_EEPROM) {
+        printf("address %zu: host 0x%02X, simavr 0x%02X\n", shown.index,
+               h.eeprom[shown.index], a.eeprom[shown.index]);
+    } else if (shown.kind == DIV_STOPPED) {
+        printf("the end\n");
+    } else {
+        printf("output record %zu", shown.index);
+        if (shown.kind == DIV_TIMING) {
+            printf(" (simavr %+.3f ms)", shown.skew_us / 1000.0);
+        }
+        printf("\n");
+    }
+    printf("  hint: %s\n", shown.hint);
+    printf("  smallest script: %zu of %zu presses, %.1f s (%u reruns)\n", small.presses.size(),
+           s->presses.size(), small.end_ms / 1000.0, runs);
+    printf("    fidelity-check %s ", opt->firmware_path);
+    script_print(&small);
+    size_t from = shown.index > CONTEXT_RECORDS ? shown.index - CONTEXT_RECORDS : 0;
+    for (size_t i = from; i <= shown.index && shown.kind != DIV_EEPROM; i++) {
+        if (i < h.outputs.size()) {
+            print_record("host", &h.outputs[i]);
+        }
+        if (i < a.outputs.size()) {
+            print_record("simavr", &a.outputs[i]);
+        }
+    }
+    fflush(stdout);
+}
+
+/******************************************************************************
+ * BATCH
+ ******************************************************************************/
+
+/**
+ * check_shard - Scripts @worker, @worker + @jobs, ... of @scripts
+ */
+static void check_shard(const Options *opt, uint32_t worker, uint32_t jobs, uint32_t scripts,
+                        uint32_t seconds, uint32_t seed, WorkerSummary *sum) {
+    memset(sum, 0, sizeof(*sum));
+    uint32_t reported = 0;
+    Script s;
+    RunOutput host, avr;
+    Divergence d;
+    for (uint32_t i = worker; i < scripts; i += jobs) {
+        script_generate(seed + i, seconds, &s);
+        sum->scripts++;
+        if (!play(opt, &s, &host, &avr, &d, sum)) {
+            continue;
+        }
+        sum->diverged[d.kind]++;
+        if (reported < MAX_REPORTS_PER_WORKER) {
+            report(opt, i, &s, &host, &avr, &d);
+            reported++;
+        }
+    }
+}
+
+static int run_batch(const Options *opt, uint32_t scripts, uint32_t seconds, uint32_t seed,
+                     uint32_t jobs) {
+    if (jobs == 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = cores > 0 ? (uint32_t)cores : 1;
+    }
+    if (jobs > scripts && scripts != 0) {
+        jobs = scripts;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<int> pipes(jobs);
+    std::vector<pid_t> pids(jobs);
+    fflush(stdout);
+    for (uint32_t w = 0; w < jobs; w++) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            perror("pipe");
+            return 2;
+        }
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            return 2;
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            WorkerSummary sum;
+            check_shard(opt, w, jobs, scripts, seconds, seed, &sum);
+            bool ok = write(fds[1], &sum, sizeof(sum)) == (ssize_t)sizeof(sum);
+            _exit(ok ? 0 : 2);
+        }
+        close(fds[1]);
+        pipes[w] = fds[0];
+        pids[w] = pid;
+    }
+
+    WorkerSummary total;
+    memset(&total, 0, sizeof(total));
+    bool worker_failed = false;
+    for (uint32_t w = 0; w < jobs; w++) {
+        WorkerSummary sum;
+        if (read(pipes[w], &sum, sizeof(sum)) == (ssize_t)sizeof(sum)) {
+            total.scripts += sum.scripts;
+            total.records += sum.records;
+            for (uint8_t k = 0; k < DIV_KIND_COUNT; k++) {
+                total.diverged[k] += sum.diverged[k];
+            }
+            if (sum.worst_skew_us > total.worst_skew_us) {
+                total.worst_skew_us = sum.worst_skew_us;
+            }
+        } else {
+            worker_failed = true;
+        }
+        close(pipes[w]);
+        int status;
+        waitpid(pids[w], &status, 0);
+        worker_failed |= !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    }
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t diverged = 0;
+    for (uint8_t k = DIV_NONE + 1; k < DIV_KIND_COUNT; k++) {
+        diverged += total.diverged[k];
+    }
+    printf("%llu scripts of %u s, %u workers, %.1f s; %llu output records matched, "
+           "worst skew %llu us\n", (unsigned long long)total.scripts, seconds, jobs, wall,
+           (unsigned long long)total.records, (unsigned long long)total.worst_skew_us);
+    if (worker_failed) {
+        printf("FAILED: a worker process crashed\n");
+        return 2;
+    }
+    if (diverged != 0) {
+        printf("FAILED: %llu of %llu scripts diverged:", (unsigned long long)diverged,
+               (unsigned long long)total.scripts);
+        for (uint8_t k = DIV_NONE + 1; k < DIV_KIND_COUNT; k++) {
+            if (total.diverged[k] != 0) {
+                printf(" %s %llu", kind_names[k], (unsigned long long)total.diverged[k]);
+            }
+        }
+        printf("\n");
+        return 1;
+    }
+    printf("OK: the host simulator and simavr agree on every script\n");
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s FIRMWARE.elf [--scripts N] [--seconds S] [--seed S] "
+                        "[--jobs J] [--tolerance-us T] [--hz F_CPU] [--shrink-runs R]\n"
+                        "       %s FIRMWARE.elf --presses AT:HOLD,... [--end-ms T]\n",
+                argv[0], argv[0]);
+        return 2;
+    }
+    Options opt;
+    opt.firmware_path = argv[1];
+    opt.hz = 16000000;
+    opt.tolerance_us = 2000;
+    opt.shrink_runs = 40;
+    uint32_t scripts = 1000;
+    uint32_t seconds = 30;
+    uint32_t seed = 1;
+    uint32_t jobs = 0;
+    uint32_t end_ms = 0;
+    const char *presses = NULL;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        uint32_t value = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+        if (strcmp(argv[i], "--scripts") == 0) {
+            scripts = value;
+        } else if (strcmp(argv[i], "--seconds") == 0) {
+            seconds = value;
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            seed = value;
+        } else if (strcmp(argv[i], "--jobs") == 0) {
+            jobs = value;
+        } else if (strcmp(argv[i], "--tolerance-us") == 0) {
+            opt.tolerance_us = value;
+        } else if (strcmp(argv[i], "--hz") == 0) {
+            opt.hz = value;
+        } else if (strcmp(argv[i], "--shrink-runs") == 0) {
+            opt.shrink_runs = value;
+        } else if (strcmp(argv[i], "--presses") == 0) {
+            presses = argv[i + 1];
+        } else if (strcmp(argv[i], "--end-ms") == 0) {
+            end_ms = value;
+        } else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    // Loaded once; every run (and every worker, after fork()) copies it
+    memset(&opt.firmware, 0, sizeof(opt.firmware));
+    if (elf_read_firmware(opt.firmware_path, &opt.firmware) != 0) {
+        fprintf(stderr, "%s: can't load firmware\n", opt.firmware_path);
+        return 2;
+    }
+
+    if (presses == NULL) {
+        return run_batch(&opt, scripts, seconds, seed, jobs);
+    }
+    Script s;
+    if (!script_parse(presses, end_ms, &s)) {
+        fprintf(stderr, "--presses: expected AT:HOLD,AT:HOLD,... in order, in ms\n");
+        return 2;
+    }
+    RunOutput host, avr;
+    Divergence d;
+    WorkerSummary sum;
+    memset(&sum, 0, sizeof(sum));
+    opt.shrink_runs = 0;        // Already the script to look at
+    if (play(&opt, &s, &host, &avr, &d, &sum)) {
+        report(&opt, 0, &s, &host, &avr, &d);
+        return 1;
+    }
+    printf("OK: %llu output records and EEPROM match, worst skew %llu us\n",
+           (unsigned long long)sum.records, (unsigned long long)sum.worst_skew_us);
+    return 0;
+}
@@ -0,0 +1,410 @@
+/******************************************************************************
+ * GHOST_CHECK.CPP - Does Attract Mode Replay the Record Exactly? (Host)
+ *
+ * Usage:
+ *   ghost-check [--games N] [--seed S]
+ *
+ * Plays N games (default 20) from a fresh board with a seeded bot that
+ * presses mostly in the target zone (restart_throughput.cpp's, a little
+ * less sure of itself, so its records fit in GHOST_DATA_MAX). Each game is
+ * logged from STATE_PLAYING to the miss: every chase step and every score,
+ * with its time. After a game that sets the record, the bot waits in
+ * attract mode for the ghost (ghost.h) and logs the replay the same way,
+ * from the ghost screen appearing to it going. The two logs must be the
+ * same events at the same times, the miss included.
+ *
+ * It also checks:
+ * - A game that doesn't set the record leaves the stored ghost alone
+ * - So does a record too long for GHOST_DATA_MAX (which isn't replayed)
+ * - The first ghost survives a power cycle (it is read back from EEPROM),
+ *   also one that boots into STATE_SELF_TEST (a bad latency record)
+ * - One damaged bit in it, and attract mode plays showcases alone
+ * - A power cut part-way through saving a new record leaves no ghost at
+ *   all: neither the old one nor part of the new one
+ *
+ * Reports the stored size of each record and its bytes per press. Exits
+ * with status 1 on the first difference.
+ ******************************************************************************/
+
+#include "sim.h"
+#include "game.h"
+#include "hardware.h"
+#include "ghost.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static const uint32_t WAIT_MS = 120000;        // For a replay to come round
+static const uint32_t ATTRACT_PAUSE_MS = 1500; // Bot: reads the screen, then starts
+
+typedef struct {
+    uint32_t t;              // ms from the start
+    char kind;               // 'P' chase position, 'S' score
+    uint16_t value;
+} Event;
+
+static uint32_t xorshift32(uint32_t *s) {
+    uint32_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *s = x;
+    return x;
+}
+
+/**
+ * ghost_shown - Is the LCD showing the replay (display_show_ghost())?
+ */
+static bool ghost_shown(void) {
+    for (uint8_t row = 0; row < LCD_ROWS; row++) {
+        const char *text = sim_lcd_row(row);
+        for (uint8_t col = 0; col + 8 <= LCD_COLS; col++) {
+            if (memcmp(text + col, "est run", 7) == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * log_change - Add an event for each of position and score that changed
+ */
+static void log_change(std::vector<Event> *log, uint32_t t, const GameStatus *gs,
+                       GameStatus *last) {
+    if (log->empty() || gs->position != last->position) {
+        Event e = {t, 'P', gs->position};
+        log->push_back(e);
+    }
+    if (log->size() == 1 || gs->score != last->score) {
+        Event e = {t, 'S', gs->score};
+        log->push_back(e);
+    }
+    *last = *gs;
+}
+
+/**
+ * play_game - Start a game from attract mode and play it to the miss
+ * @return: The game's log
+ */
+static std::vector<Event> play_game(uint32_t *rng) {
+    GameStatus gs;
+    for (uint32_t i = 0; i < ATTRACT_PAUSE_MS; i++) {
+        sim_tick();
+    }
+    sim_set_button(true);
+    uint32_t release_at = sim_millis() + 80;
+    bool pressed = true;
+    game_get_status(&gs);
+    while (gs.state != STATE_PLAYING) {
+        sim_tick();
+        game_get_status(&gs);
+    }
+
+    std::vector<Event> log;
+    GameStatus last;
+    uint32_t start = sim_millis();
+    while (gs.state == STATE_PLAYING || gs.state == STATE_RESULT) {
+        log_change(&log, sim_millis() - start, &gs, &last);
+        uint32_t now = sim_millis();
+        if (pressed) {
+            if (now >= release_at) {
+                pressed = false;
+                sim_set_button(false);
+            }
+        } else if (gs.state == STATE_PLAYING) {
+            bool in_zone = gs.position >= TARGET_ZONE_START && gs.position <= TARGET_ZONE_END;
+            if (xorshift32(rng) % 1000 < (in_zone ? 15u : 1u)) {
+                pressed = true;
+                release_at = now + 50 + xorshift32(rng) % 100;
+                sim_set_button(true);
+            }
+        }
+        sim_tick();
+        game_get_status(&gs);
+    }
+    log_change(&log, sim_millis() - start, &gs, &last);   // The miss's loop can take a step
+    sim_set_button(false);
+    return log;
+}
+
+/**
+ * wait_for_ghost - Idle in attract mode until the ghost plays, and log it
+ * @return: false if it didn't start within WAIT_MS
+ */
+static bool wait_for_ghost(std::vector<Event> *log) {
+    uint32_t give_up = sim_millis() + WAIT_MS;
+    while (!ghost_shown()) {
+        if (sim_millis() >= give_up) {
+            return false;
+        }
+        sim_tick();
+    }
+    GameStatus gs;
+    GameStatus last;
+    uint32_t start = sim_millis();
+    game_get_status(&gs);
+    while (ghost_shown()) {
+        log_change(log, sim_millis() - start, &gs, &last);
+        sim_tick();
+        game_get_status(&gs);
+    }
+    return true;
+}
+
+/**
+ * dump - Both logs around event @at, for a FAIL
+ */
+static void dump(const std::vector<Event> &game, const std::vector<Event> &ghost, size_t at) {
+    for (size_t i = at > 8 ? at - 8 : 0; i < at + 3; i++) {
+        if (i < game.size()) {
+            printf("  game  %c=%u at %u ms\n", game[i].kind, game[i].value, game[i].t);
+        }
+        if (i < ghost.size()) {
+            printf("  ghost %c=%u at %u ms\n", ghost[i].kind, ghost[i].value, ghost[i].t);
+        }
+    }
+}
+
+/**
+ * compare - Are the replay's events the game's, at the same times?
+ *
+ * Times are taken from each log's first chase step: the ghost screen can
+ * reach the LCD a few ms after the replay started (the frame is sent a
+ * little per loop()). The replay goes on showing the miss for
+ * GHOST_END_HOLD_MS, where the game left PLAYING at once, without a step.
+ */
+static bool compare(const std::vector<Event> &game, const std::vector<Event> &ghost) {
+    size_t n = game.size() < ghost.size() ? game.size() : ghost.size();
+    uint32_t game_from = n > 2 ? game[2].t : 0;
+    uint32_t ghost_from = n > 2 ? ghost[2].t : 0;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t game_t = game[i].t - game_from;
+        uint32_t ghost_t = ghost[i].t - ghost_from;
+        if (i < 2) {
+            game_t = ghost_t = 0;               // The start, before the first step
+        }
+        if (game_t != ghost_t || game[i].kind != ghost[i].kind ||
+            game[i].value != ghost[i].value) {
+            dump(game, ghost, i);
+            printf("FAIL: event %u: game %c=%u at %d ms, ghost %c=%u at %d ms\n", (unsigned)i,
+                   game[i].kind, game[i].value, (int)game_t, ghost[i].kind, ghost[i].value,
+                   (int)ghost_t);
+            return false;
+        }
+    }
+    if (game.size() != ghost.size()) {
+        dump(game, ghost, n);
+        const Event &extra = game.size() > n ? game[n] : ghost[n];
+        printf("FAIL: the %s goes on after %u events: %c=%u at %u ms\n",
+               game.size() > n ? "game" : "ghost", (unsigned)n, extra.kind, extra.value,
+               extra.t);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * stored_ghost - The ghost image in the simulated EEPROM (empty if none)
+ */
+static std::vector<uint8_t> stored_ghost(void) {
+    const uint8_t *image = sim_eeprom() + EEPROM_GHOST_ADDR;
+    uint8_t size = ghost_image_check(image, ghost_image_size(image));
+    return std::vector<uint8_t>(image, image + size);
+}
+
+static uint32_t hits(const std::vector<Event> &log) {
+    uint32_t count = 0;
+    for (size_t i = 1; i < log.size(); i++) {
+        count += log[i].kind == 'S';
+    }
+    return count;
+}
+
+/**
+ * power_cycle_plays - Power on again with the same EEPROM: does the ghost play?
+ */
+static bool power_cycle_plays(void) {
+    std::vector<Event> log;
+    sim_set_button(false);
+    sim_power_on(sim_millis());
+    return wait_for_ghost(&log);
+}
+
+/**
+ * torn_save_refused - Cut the power a few bytes into a new record's save
+ * @return: false if EEPROM still holds a ghost, or one plays
+ *
+ * The magic byte is cleared first and written last (ghost_save_service()),
+ * so nothing may be left to load. The high score goes back to 0 first, so
+ * any game that scores is a record.
+ */
+static bool torn_save_refused(uint32_t *rng) {
+    eeprom_write_high_score(0);
+    sim_power_on(sim_millis());
+    for (uint32_t tries = 0; tries < 200; tries++) {
+        std::vector<uint8_t> before = stored_ghost();
+        GameStatus gs;
+        game_get_status(&gs);
+        uint16_t record = gs.high_score;
+        play_game(rng);
+        game_get_status(&gs);
+        if (gs.high_score == record) {
+            continue;
+        }
+        for (uint32_t i = 0; i < GHOST_HEADER_SIZE / 2; i++) {
+            sim_tick();                         // A few bytes of the save
+        }
+        if (stored_ghost() == before && !before.empty()) {
+            continue;                           // Too long to keep: nothing written
+        }
+        if (ghost_image_size(sim_eeprom() + EEPROM_GHOST_ADDR) != 0) {
+            // Not even a header: a torn one would be down to the CRC to catch
+            printf("FAIL: a ghost header is left in EEPROM part-way through a save\n");
+            return false;
+        }
+        if (power_cycle_plays()) {
+            printf("FAIL: a ghost played after a power cut part-way through its save\n");
+            return false;
+        }
+        return true;
+    }
+    printf("FAIL: no record to cut the save of\n");
+    return false;
+}
+
+/**
+ * self_test_boot_plays - Power on into STATE_SELF_TEST: is the ghost kept?
+ *
+ * A latency record with a bad checksum fails the self-test, so game_init()
+ * goes on from ATTRACT to SELF_TEST, through attract_exit(). The ghost must
+ * still be there when attract mode comes back.
+ */
+static bool self_test_boot_plays(void) {
+    uint8_t *latency = sim_eeprom() + EEPROM_LATENCY_ADDR;
+    uint8_t saved[3];
+    memcpy(saved, latency, sizeof(saved));
+    latency[0] = 0;
+    latency[1] = EEPROM_MAGIC_BYTE;
+    latency[2] = (uint8_t)~EEPROM_MAGIC_BYTE;   // Checksum of 0 is the magic byte
+
+    std::vector<Event> log;
+    sim_set_button(false);
+    sim_power_on(sim_millis());
+    GameStatus gs;
+    game_get_status(&gs);
+    bool plays = gs.state == STATE_SELF_TEST && wait_for_ghost(&log);
+    if (gs.state != STATE_SELF_TEST) {
+        printf("FAIL: a bad latency record didn't boot into the self-test\n");
+    }
+    memcpy(latency, saved, sizeof(saved));
+    return plays;
+}
+
+int main(int argc, char **argv) {
+    uint32_t games = 20;
+    uint32_t seed = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        uint32_t value = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+        if (strcmp(argv[i], "--games") == 0) {
+            games = value;
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            seed = value;
+        } else {
+            fprintf(stderr, "usage: %s [--games N] [--seed S]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    uint32_t rng = seed * 2654435761u + 0x9E3779B9u;
+    sim_eeprom_erase();
+    sim_set_button(false);
+    sim_power_on(0);
+
+    uint32_t replays = 0;
+    uint32_t too_long = 0;
+    for (uint32_t g = 0; g < games; g++) {
+        std::vector<uint8_t> before = stored_ghost();
+        GameStatus gs;
+        game_get_status(&gs);
+        uint16_t record = gs.high_score;
+        std::vector<Event> game = play_game(&rng);
+        game_get_status(&gs);
+        uint16_t score = game.empty() ? 0 : game.back().kind == 'S' ? game.back().value : gs.score;
+
+        if (gs.high_score == record) {
+            // Left alone: wait out the end-of-game screens, then compare bytes
+            while (gs.state != STATE_ATTRACT) {
+                sim_tick();
+                game_get_status(&gs);
+            }
+            if (stored_ghost() != before) {
+                printf("FAIL: game %u (%u, record %u) rewrote the ghost\n", g + 1, score, record);
+                return 1;
+            }
+            continue;
+        }
+
+        std::vector<Event> ghost;
+        uint32_t hit_count = hits(game);
+        if (!wait_for_ghost(&ghost)) {
+            // Fine if the run can't fit: then the old ghost is kept, unplayed
+            if ((hit_count + 1) * 3 > GHOST_DATA_MAX && stored_ghost() == before) {
+                printf("game %2u: record %4u, %3u hits: too long to keep, no replay\n",
+                       g + 1, gs.high_score, hit_count);
+                too_long++;
+                continue;
+            }
+            printf("FAIL: game %u set the record (%u) and no replay came in %u ms\n",
+                   g + 1, gs.high_score, WAIT_MS);
+            return 1;
+        }
+        if (!compare(game, ghost)) {
+            printf("  (game %u, record %u)\n", g + 1, gs.high_score);
+            return 1;
+        }
+        std::vector<uint8_t> stored = stored_ghost();
+        if (stored.empty()) {
+            printf("FAIL: game %u's ghost isn't in EEPROM after its replay\n", g + 1);
+            return 1;
+        }
+        printf("game %2u: record %4u, %3u hits, %3u events replayed, %3u bytes stored "
+               "(%u header + %.2f per press)\n",
+               g + 1, gs.high_score, hit_count, (unsigned)game.size(), (unsigned)stored.size(),
+               GHOST_HEADER_SIZE,
+               (double)(stored.size() - GHOST_HEADER_SIZE) / (hit_count + 1));
+        if (replays++ == 0) {
+            // The first one: kept through a power cycle, refused when damaged
+            if (!power_cycle_plays()) {
+                printf("FAIL: no replay after a power cycle\n");
+                return 1;
+            }
+            if (!self_test_boot_plays()) {
+                printf("FAIL: no replay after a power cycle into the self-test\n");
+                return 1;
+            }
+            uint8_t *bit = sim_eeprom() + EEPROM_GHOST_ADDR + stored.size() - 1;
+            *bit ^= 0x10;
+            if (power_cycle_plays()) {
+                printf("FAIL: a ghost with a damaged bit was replayed\n");
+                return 1;
+            }
+            *bit ^= 0x10;
+            sim_power_on(sim_millis());
+        }
+    }
+    if (replays == 0) {
+        printf("FAIL: no game set a record to replay\n");
+        return 1;
+    }
+
+    if (!torn_save_refused(&rng)) {
+        return 1;
+    }
+
+    printf("OK: %u records replayed event for event (%u too long to keep), "
+           "kept through a power cycle (and one into the self-test), refused when damaged or "
+           "half-saved\n", replays, too_long);
+    return 0;
+}
@@ -0,0 +1,104 @@
+/******************************************************************************
+ * LAYOUT_PREVIEW.CPP - Every Screen Layout, Drawn
+ *
+ * Usage:
+ *   layout-preview
+ *
+ * Renders each screen in layout.h twice, with everyday values and with the
+ * widest ones (score 65535, 99 credits, -128 ms, every tap), for the LCD
+ * this is built for (16×2, or 20×4 with -DLCD_20X4):
+ *
+ *   game (widest)
+ *   ┌────────────────┐
+ *   │Score:   65535  │
+ *   │HiScore: 65535  │
+ *   └────────────────┘
+ *
+ * The compiler already checks that every field is on the screen and every
+ * fixed label fits. This checks what it can't: that the widest value of
+ * each field fits its width. Exits with status 1 if one would be cut.
+ ******************************************************************************/
+
+#include "layout.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *const screen_names[SCREEN_COUNT] = {
+    "blank", "attract", "game", "celebration", "calibration", "latency", "post", "ghost"
+};
+
+static void print_border(const char *left, const char *right) {
+    printf("%s", left);
+    for (uint8_t c = 0; c < LCD_COLS; c++) {
+        printf("─");
+    }
+    printf("%s\n", right);
+}
+
+static void print_screen(const char *name, const char *which, ScreenId id,
+                         const LayoutValues *values) {
+    char screen[LCD_ROWS][LCD_COLS];
+    layout_render(id, values, screen);
+    printf("%s (%s)\n", name, which);
+    print_border("┌", "┐");
+    for (uint8_t r = 0; r < LCD_ROWS; r++) {
+        printf("│%.*s│\n", (int)LCD_COLS, screen[r]);
+    }
+    print_border("└", "┘");
+}
+
+/**
+ * cut_fields - Fields of @id whose text @values makes wider than the field
+ */
+static uint8_t cut_fields(ScreenId id, const LayoutValues *values) {
+    uint8_t cut = 0;
+    for (uint8_t i = 0; i < layout_count(id); i++) {
+        LayoutField field;
+        layout_field(id, i, &field);
+        char text[LAYOUT_TEXT_MAX];
+        uint8_t length = layout_format(&field, values, text);
+        if (length > field.width) {
+            printf("FAIL: %s field %u: \"%.*s\" is wider than %u\n", screen_names[id], i,
+                   (int)length, text, field.width);
+            cut++;
+        }
+    }
+    return cut;
+}
+
+int main(void) {
+    LayoutValues usual = {};
+    usual.score = 45;
+    usual.high_score = 100;
+    usual.credits = 2;
+    usual.taps = 3;
+    usual.latency_ms = 12;
+    usual.title = "Self-test FAIL";
+
+    LayoutValues widest = {};
+    widest.score = 65535;
+    widest.high_score = 65535;
+    widest.credits = COIN_MAX_CREDITS;
+    widest.taps = CALIBRATION_TAPS;
+    widest.latency_ms = -128;
+    widest.title = "Self-test FAIL";
+
+    uint32_t cut = 0;
+    for (uint8_t id = SCREEN_ATTRACT; id < SCREEN_COUNT; id++) {
+        // Detail lines: the calibration result, or the longest self-test line
+        bool latency = id == SCREEN_LATENCY;
+        usual.detail = latency ? "Saved" : "LED 3 shorted";
+        widest.detail = latency ? "Too uneven" : "LCDs 0x27+0x3F";
+        print_screen(screen_names[id], "usual", (ScreenId)id, &usual);
+        print_screen(screen_names[id], "widest", (ScreenId)id, &widest);
+        cut += cut_fields((ScreenId)id, &widest);
+    }
+
+    printf("%u screens on %ux%u\n", SCREEN_COUNT - 1, LCD_COLS, LCD_ROWS);
+    if (cut != 0) {
+        printf("FAIL: %u fields would cut their widest value\n", cut);
+        return 1;
+    }
+    printf("OK: every field fits its widest value\n");
+    return 0;
+}
@@ -0,0 +1,160 @@
+/******************************************************************************
+ * LCD_MIRROR.CPP - Spectator LCD Cost and Consistency in the Host Simulator
+ *
+ * Usage:
+ *   lcd-mirror [--seconds N] [--seed S]
+ *
+ * Plays N seconds of the game twice with the same bot: first with only the
+ * main LCD, then with a spectator LCD fitted on the other backpack address.
+ * For each run it reports the firmware's display_get_stats() counters:
+ *
+ *   chars / cursor moves   Bus commands sent, all panels
+ *   bus                    Time spent in budgeted flushes (loop() time)
+ *   worst flush            Longest single loop() stall the display caused
+ *   lag                    Per panel: frame change -> panel up to date, worst
+ *
+ * and checks, after every loop() that left nothing pending, that the
+ * spectator shows exactly what the main LCD shows. Exits with status 1 on
+ * a mismatch, or if the worst flush exceeds the budget by more than one
+ * character per panel.
+ *
+ * The bus model is sim.cpp's: 1.3 ms per LCD character or setCursor().
+ ******************************************************************************/
+
+#include "sim.h"
+#include "game.h"
+#include "hardware.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const uint32_t CHAR_US = 1300;    // sim.cpp's SIM_LCD_BYTE_US
+
+static bool check_mirror = false;
+static uint32_t mirror_checks = 0;
+static uint32_t mirror_mismatches = 0;
+
+static uint32_t xorshift32(uint32_t *s) {
+    uint32_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *s = x;
+    return x;
+}
+
+/**
+ * compare_panels - Loop hook: once a screen is fully sent, both LCDs agree
+ */
+static void compare_panels(void) {
+    if (!check_mirror || display_pending()) {
+        return;
+    }
+    mirror_checks++;
+    for (uint8_t row = 0; row < LCD_ROWS; row++) {
+        if (strcmp(sim_lcd_row(row), sim_spectator_lcd_row(row)) != 0) {
+            if (mirror_mismatches++ == 0) {
+                printf("mismatch at %u ms, row %u: main \"%s\", spectator \"%s\"\n",
+                       sim_millis(), row, sim_lcd_row(row), sim_spectator_lcd_row(row));
+            }
+            return;
+        }
+    }
+}
+
+/**
+ * bot_session - Play for @seconds: presses near the target zone, random taps
+ * elsewhere, so every screen (attract, game, result, high score) comes up
+ */
+static void bot_session(uint32_t seconds, uint32_t seed) {
+    uint32_t rng = seed * 2654435761u + 0x9E3779B9u;
+    bool pressed = false;
+    uint32_t release_at = 0;
+
+    while (sim_millis() < seconds * 1000u) {
+        uint32_t now = sim_millis();
+        if (pressed) {
+            if (now >= release_at) {
+                pressed = false;
+                sim_set_button(false);
+            }
+        } else {
+            GameStatus gs;
+            game_get_status(&gs);
+            uint32_t chance = 0;
+            if (gs.state == STATE_PLAYING) {
+                bool in_zone = gs.position >= TARGET_ZONE_START && gs.position <= TARGET_ZONE_END;
+                chance = in_zone ? 40 : 1;
+            } else if (gs.state == STATE_ATTRACT) {
+                chance = 2;
+            }
+            if (xorshift32(&rng) % 1000 < chance) {
+                pressed = true;
+                release_at = now + 50 + xorshift32(&rng) % 100;
+                sim_set_button(true);
+            }
+        }
+        sim_tick();
+    }
+}
+
+/**
+ * run - One session; @return false if the flush budget was overrun
+ */
+static bool run(const char *name, bool spectator, uint32_t seconds, uint32_t seed) {
+    sim_eeprom_erase();
+    sim_set_button(false);
+    sim_set_spectator_lcd(spectator);
+    sim_power_on(0);
+    check_mirror = spectator;
+    bot_session(seconds, seed);
+
+    const DisplayStats *d = display_get_stats();
+    printf("%-10s panels %u  chars %6u  cursor moves %6u  bus %7.1f ms/min  worst flush %5u us",
+           name, d->panels, d->chars, d->cursor_moves,
+           d->flush_total_us / 1000.0 / (seconds / 60.0), d->flush_max_us);
+    for (uint8_t i = 0; i < d->panels; i++) {
+        printf("  lag%u %6u us", i, d->lag_max_us[i]);
+    }
+    printf("\n");
+
+    if (spectator && d->panels != 2) {
+        printf("FAIL: spectator LCD not detected\n");
+        return false;
+    }
+    // The budget is checked between passes: one more character per panel
+    uint32_t limit = DISPLAY_FLUSH_BUDGET_US + d->panels * 2 * CHAR_US;
+    if (d->flush_max_us > limit) {
+        printf("FAIL: a flush took %u us (budget %u us + one character per panel)\n",
+               d->flush_max_us, DISPLAY_FLUSH_BUDGET_US);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    uint32_t seconds = 600;
+    uint32_t seed = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        uint32_t value = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+        if (strcmp(argv[i], "--seconds") == 0) {
+            seconds = value;
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            seed = value;
+        } else {
+            fprintf(stderr, "usage: %s [--seconds N] [--seed S]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    sim_set_loop_hook(compare_panels);
+    bool ok = run("main only", false, seconds, seed);
+    ok = run("mirrored", true, seconds, seed) && ok;
+
+    printf("%u s per run; %u mirror checks, %u mismatches\n", seconds, mirror_checks, mirror_mismatches);
+    if (!ok || mirror_mismatches != 0) {
+        return 1;
+    }
+    printf("OK: spectator matches the main LCD whenever a screen is complete\n");
+    return 0;
+}
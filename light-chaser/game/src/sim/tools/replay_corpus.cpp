@@ -0,0 +1,265 @@
+/******************************************************************************
+ * REPLAY_CORPUS.CPP - Replay Corpus Generator and Parallel Verifier
+ *
+ * Usage:
+ *   replay-corpus generate FILE [--sessions N] [--seed S]
+ *   replay-corpus verify FILE [--jobs J]
+ *
+ * GENERATE:
+ * Plays N sessions with a simple reactive bot (random skill per session,
+ * 30-180 s each), records the button changes, then runs them through the
+ * current firmware to capture the expected transitions and scores. Until
+ * real cabinet logs are converted to this format, this gives a corpus that
+ * pins down today's behaviour.
+ *
+ * VERIFY:
+ * Maps FILE once and forks J worker processes (default: one per core). The
+ * firmware keeps its state in statics, so parallelism has to be processes,
+ * not threads; all workers share the mapping's pages. Worker w replays
+ * sessions w, w + J, w + 2J, ... (interleaved, so long and short sessions
+ * spread evenly) and reports divergences as it finds them. Prints games per
+ * minute and exits with status 1 if any session diverged.
+ ******************************************************************************/
+
+#include "corpus.h"
+#include "sim.h"
+#include "game.h"
+#include "hardware.h"
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static const uint32_t MAX_REPORTS_PER_WORKER = 10;
+
+static uint32_t xorshift32(uint32_t *s) {
+    uint32_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *s = x;
+    return x;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/******************************************************************************
+ * GENERATE
+ ******************************************************************************/
+
+/**
+ * bot_session - Play one session tick by tick, recording button changes
+ *
+ * Per millisecond: in PLAYING with the light in the target zone the bot
+ * presses with probability "skill" (a reaction-time stand-in), elsewhere
+ * rarely (misses). In ATTRACT it starts a new game every ~1.5 s on average.
+ */
+static void bot_session(uint32_t seed, CorpusRecording *rec) {
+    uint32_t rng = seed * 2654435761u + 0x9E3779B9u;
+    uint32_t skill = 10 + xorshift32(&rng) % 70;        // Per mille per tick in zone
+
+    rec->saved_high_score = (uint16_t)(xorshift32(&rng) % 4 == 0 ? 0 : xorshift32(&rng) % 200);
+    rec->duration_ms = 30000 + xorshift32(&rng) % 150000;
+    rec->input_times.clear();
+
+    sim_eeprom_erase();
+    eeprom_write_high_score(rec->saved_high_score);
+    sim_set_button(false);
+    sim_power_on(0);
+
+    bool pressed = false;
+    uint32_t release_at = 0;
+    while (sim_millis() < rec->duration_ms) {
+        uint32_t now = sim_millis();
+        if (pressed) {
+            if (now >= release_at) {
+                pressed = false;
+                sim_set_button(false);
+                rec->input_times.push_back(now);
+            }
+        } else {
+            GameStatus gs;
+            game_get_status(&gs);
+            uint32_t chance = 0;
+            if (gs.state == STATE_PLAYING) {
+                bool in_zone = gs.position >= TARGET_ZONE_START && gs.position <= TARGET_ZONE_END;
+                chance = in_zone ? skill : 1;
+            } else if (gs.state == STATE_ATTRACT) {
+                chance = 1;
+            }
+            if (xorshift32(&rng) % 1000 < chance) {
+                pressed = true;
+                release_at = now + 50 + xorshift32(&rng) % 100;
+                sim_set_button(true);
+                rec->input_times.push_back(now);
+            }
+        }
+        sim_tick();
+    }
+    // A press still held at power-off has no release; drop it
+    if (pressed) {
+        rec->input_times.pop_back();
+    }
+}
+
+static int run_generate(const char *path, uint32_t sessions, uint32_t seed) {
+    std::vector<CorpusRecording> recs(sessions);
+    uint64_t games = 0, inputs = 0;
+    for (uint32_t s = 0; s < sessions; s++) {
+        bot_session(seed + s, &recs[s]);
+        corpus_record_outcome(&recs[s]);
+        games += recs[s].games;
+        inputs += recs[s].input_times.size();
+    }
+    if (!corpus_write(path, recs)) {
+        return 2;
+    }
+    printf("%s: %u sessions, %llu games, %llu button changes\n", path, sessions,
+           (unsigned long long)games, (unsigned long long)inputs);
+    return 0;
+}
+
+/******************************************************************************
+ * VERIFY
+ ******************************************************************************/
+
+typedef struct {
+    uint64_t sessions;
+    uint64_t games;
+    uint64_t loops;
+    uint64_t diverged;
+} WorkerSummary;
+
+static void verify_shard(const Corpus *corpus, uint32_t worker, uint32_t jobs, WorkerSummary *sum) {
+    memset(sum, 0, sizeof(*sum));
+    for (uint32_t i = worker; i < corpus->session_count; i += jobs) {
+        CorpusSession session;
+        ReplayResult result;
+        sum->sessions++;
+        if (!corpus_get_session(corpus, i, &session)) {
+            result.diverged = true;
+            snprintf(result.message, sizeof(result.message), "corrupt session record");
+            result.games = 0;
+            result.loops = 0;
+        } else {
+            corpus_replay(&session, &result);
+        }
+        sum->games += result.games;
+        sum->loops += result.loops;
+        if (result.diverged) {
+            if (sum->diverged < MAX_REPORTS_PER_WORKER) {
+                printf("DIVERGED session %u: %s\n", i, result.message);
+                fflush(stdout);
+            }
+            sum->diverged++;
+        }
+    }
+}
+
+static int run_verify(const char *path, uint32_t jobs) {
+    Corpus corpus;
+    if (!corpus_open(path, &corpus)) {
+        return 2;
+    }
+    if (jobs == 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = cores > 0 ? (uint32_t)cores : 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<int> pipes(jobs);
+    std::vector<pid_t> pids(jobs);
+    fflush(stdout);
+    for (uint32_t w = 0; w < jobs; w++) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            perror("pipe");
+            return 2;
+        }
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            return 2;
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            WorkerSummary sum;
+            verify_shard(&corpus, w, jobs, &sum);
+            bool ok = write(fds[1], &sum, sizeof(sum)) == (ssize_t)sizeof(sum);
+            _exit(ok ? 0 : 2);
+        }
+        close(fds[1]);
+        pipes[w] = fds[0];
+        pids[w] = pid;
+    }
+
+    WorkerSummary total = {0, 0, 0, 0};
+    bool worker_failed = false;
+    for (uint32_t w = 0; w < jobs; w++) {
+        WorkerSummary sum;
+        if (read(pipes[w], &sum, sizeof(sum)) == (ssize_t)sizeof(sum)) {
+            total.sessions += sum.sessions;
+            total.games += sum.games;
+            total.loops += sum.loops;
+            total.diverged += sum.diverged;
+        } else {
+            worker_failed = true;
+        }
+        close(pipes[w]);
+        int status;
+        waitpid(pids[w], &status, 0);
+        worker_failed |= !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    }
+    double wall = seconds_since(start);
+    corpus_close(&corpus);
+
+    printf("%llu sessions, %llu games, %llu loop() calls, %u workers, %.3f s\n",
+           (unsigned long long)total.sessions, (unsigned long long)total.games,
+           (unsigned long long)total.loops, jobs, wall);
+    printf("throughput: %.3e games/min (%.0f sessions/s)\n",
+           total.games / wall * 60.0, total.sessions / wall);
+    if (worker_failed) {
+        printf("FAILED: a worker process crashed\n");
+        return 2;
+    }
+    if (total.diverged != 0) {
+        printf("FAILED: %llu of %llu sessions diverged\n",
+               (unsigned long long)total.diverged, (unsigned long long)total.sessions);
+        return 1;
+    }
+    printf("OK: every session matches\n");
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3 || (strcmp(argv[1], "generate") != 0 && strcmp(argv[1], "verify") != 0)) {
+        fprintf(stderr, "usage: %s generate FILE [--sessions N] [--seed S]\n"
+                        "       %s verify FILE [--jobs J]\n", argv[0], argv[0]);
+        return 2;
+    }
+    uint32_t sessions = 2000;
+    uint32_t seed = 1;
+    uint32_t jobs = 0;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        uint32_t value = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+        if (strcmp(argv[i], "--sessions") == 0) {
+            sessions = value;
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            seed = value;
+        } else if (strcmp(argv[i], "--jobs") == 0) {
+            jobs = value;
+        } else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    if (strcmp(argv[1], "generate") == 0) {
+        return run_generate(argv[2], sessions, seed);
+    }
+    return run_verify(argv[2], jobs);
+}
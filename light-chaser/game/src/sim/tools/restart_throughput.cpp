@@ -0,0 +1,133 @@
+/******************************************************************************
+ * RESTART_THROUGHPUT.CPP - Games per Hour With and Without the Skip
+ *
+ * Usage:
+ *   restart-throughput [--seconds N] [--seed S]
+ *
+ * Plays N seconds of the game twice with the same bot, from a fresh board
+ * each time:
+ * - patient: after a miss it waits for ATTRACT, then presses to start
+ * - eager:   it presses as soon as the end-of-game animation accepts a skip
+ *            (RESTART_MIN_SHOW_MS), plus a human reaction time
+ *
+ * Reports, from the firmware's own game_get_throughput() counters: games
+ * per hour, mean dead time per game (miss -> next game), skips, and the
+ * worst skip latency (press edge -> STATE_PLAYING entered). Exits with
+ * status 1 if the eager bot never skipped or a skip took RESTART_BUDGET_US
+ * or more.
+ ******************************************************************************/
+
+#include "sim.h"
+#include "game.h"
+#include "hardware.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const uint32_t RESTART_BUDGET_US = 50000;
+static const uint32_t REACTION_MS = 180;       // Bot: sees the miss -> presses
+static const uint32_t ATTRACT_PAUSE_MS = 1500; // Patient bot: reads the screen
+
+static uint32_t xorshift32(uint32_t *s) {
+    uint32_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *s = x;
+    return x;
+}
+
+/**
+ * play - One session; @eager chooses when the bot starts the next game
+ */
+static void play(uint32_t seconds, uint32_t seed, bool eager, GameThroughput *t) {
+    sim_eeprom_erase();
+    sim_set_button(false);
+    sim_power_on(0);
+
+    uint32_t rng = seed * 2654435761u + 0x9E3779B9u;
+    bool pressed = false;
+    uint32_t release_at = 0;
+    GameState seen = STATE_ATTRACT;
+    uint32_t seen_since = 0;
+
+    while (sim_millis() < seconds * 1000u) {
+        uint32_t now = sim_millis();
+        GameStatus gs;
+        game_get_status(&gs);
+        if (gs.state != seen) {
+            seen = gs.state;
+            seen_since = now;
+        }
+
+        if (pressed) {
+            if (now >= release_at) {
+                pressed = false;
+                sim_set_button(false);
+            }
+        } else {
+            bool press = false;
+            if (gs.state == STATE_PLAYING) {
+                bool in_zone = gs.position >= TARGET_ZONE_START && gs.position <= TARGET_ZONE_END;
+                press = xorshift32(&rng) % 1000 < (in_zone ? 40u : 1u);
+            } else if (gs.state == STATE_ATTRACT) {
+                press = now - seen_since >= ATTRACT_PAUSE_MS;
+            } else if (eager && (gs.state == STATE_GAME_OVER || gs.state == STATE_CELEBRATION)) {
+                press = now - seen_since >= RESTART_MIN_SHOW_MS + REACTION_MS;
+            }
+            if (press) {
+                pressed = true;
+                release_at = now + 50 + xorshift32(&rng) % 100;
+                sim_set_button(true);
+            }
+        }
+        sim_tick();
+    }
+    game_get_throughput(t);
+}
+
+static void report(const char *name, uint32_t seconds, const GameThroughput *t) {
+    uint32_t per_hour = (uint32_t)((uint64_t)t->games * 3600u / seconds);
+    uint32_t dead_mean = t->games > 1 ? t->dead_ms_total / (t->games - 1) : 0;
+    printf("%-8s %5u games  %5u/hour  dead %5u ms/game  skips %5u  worst skip %5u us\n",
+           name, t->games, per_hour, dead_mean, t->restarts, t->restart_latency_max_us);
+}
+
+int main(int argc, char **argv) {
+    uint32_t seconds = 600;
+    uint32_t seed = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        uint32_t value = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+        if (strcmp(argv[i], "--seconds") == 0) {
+            seconds = value;
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            seed = value;
+        } else {
+            fprintf(stderr, "usage: %s [--seconds N] [--seed S]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (seconds == 0) {
+        seconds = 1;
+    }
+
+    GameThroughput patient, eager;
+    play(seconds, seed, false, &patient);
+    play(seconds, seed, true, &eager);
+
+    printf("%u s simulated per bot\n", seconds);
+    report("patient", seconds, &patient);
+    report("eager", seconds, &eager);
+
+    if (eager.restarts == 0) {
+        printf("FAIL: the eager bot never skipped\n");
+        return 1;
+    }
+    if (eager.restart_latency_max_us >= RESTART_BUDGET_US) {
+        printf("FAIL: a skip took %u us (budget %u us)\n",
+               eager.restart_latency_max_us, RESTART_BUDGET_US);
+        return 1;
+    }
+    printf("OK: every skip started the next game within %u ms\n", RESTART_BUDGET_US / 1000);
+    return 0;
+}
@@ -0,0 +1,378 @@
+/******************************************************************************
+ * RULES_CHECK.CPP - Check, Cost and Play Every Example Game Mode
+ *
+ * Usage:
+ *   rules-check [--seconds N] [--seed S]
+ *   rules-check --image NAME > NAME.bin      (classic, wrap, sniper, lucky)
+ *
+ * Without --image, four checks (exit status 1 if any fails):
+ *
+ * 1. Every example mode in rules.h passes rules_check(); prints each
+ *    part's worst case in cycles against RULES_HOOK_BUDGET_CYCLES.
+ * 2. rules_classic gives the built-in answer for every input its hooks
+ *    can see: each position and direction, each speed a game reaches.
+ * 3. Broken programs are refused, each with the right RulesError and
+ *    location: one per error, plus a bad checksum.
+ * 4. The firmware plays each mode. The image is written with
+ *    eeprom_write_rules() and the board re-powered, as after an upload.
+ *    Then a bot plays N seconds, and every chase step the firmware takes is
+ *    checked against the mode's own RULE_MOVE. rules_classic must play the
+ *    exact game (state, LED, score and speed on every tick) that the
+ *    firmware plays with nothing stored.
+ *
+ * --image writes the mode as an EEPROM image, the bytes to send to a
+ * RULES_UPLOAD build's serial port (hardware.cpp section 8).
+ ******************************************************************************/
+
+#include "sim.h"
+#include "game.h"
+#include "hardware.h"
+#include "rules.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    const char *name;
+    const RuleSet *set;
+} ExampleMode;
+
+static const ExampleMode examples[] = {
+    {"classic", &rules_classic},
+    {"wrap", &rules_wrap},
+    {"sniper", &rules_sniper},
+    {"lucky", &rules_lucky},
+};
+static const uint8_t EXAMPLE_COUNT = sizeof(examples) / sizeof(examples[0]);
+
+static const char *const hook_names[RULE_HOOK_COUNT] = {"move", "score", "speed"};
+
+static uint32_t xorshift32(uint32_t *s) {
+    uint32_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *s = x;
+    return x;
+}
+
+/**
+ * run_hook - rules_run() with the registers rules.h promises on entry
+ */
+static void run_hook(const RuleSet *set, uint8_t hook, int16_t position, int16_t direction,
+                     int16_t score, int16_t speed, int16_t points, int16_t reg[RULE_REGS]) {
+    uint16_t random = 1;
+    memset(reg, 0, RULE_REGS * sizeof(reg[0]));
+    reg[0] = position;
+    reg[1] = direction;
+    reg[2] = score;
+    reg[3] = speed;
+    reg[4] = points;
+    rules_run(set, hook, reg, &random);
+}
+
+/******************************************************************************
+ * 1. THE EXAMPLES PASS, WITHIN BUDGET
+ ******************************************************************************/
+
+static uint32_t check_examples(void) {
+    uint32_t failed = 0;
+    printf("mode      move score speed  (worst-case cycles, budget %u per hook)\n",
+           RULES_HOOK_BUDGET_CYCLES);
+    for (uint8_t m = 0; m < EXAMPLE_COUNT; m++) {
+        uint8_t image[RULES_IMAGE_MAX];
+        uint8_t size = rules_image_build(examples[m].set, image);
+        RuleSet set;
+        RulesReport report;
+        uint8_t error = rules_image_load(image, size, &set, &report);
+        printf("%-8s %5u %5u %5u  %3u-byte image\n", examples[m].name, report.cycles[RULE_MOVE],
+               report.cycles[RULE_SCORE], report.cycles[RULE_SPEED], size);
+        if (error != RULES_OK) {
+            printf("FAIL: %s refused: error %u in %s step %u\n", examples[m].name, error,
+                   hook_names[report.hook], report.step);
+            failed++;
+        }
+    }
+    return failed;
+}
+
+/******************************************************************************
+ * 2. rules_classic IS THE BUILT-IN GAME
+ *
+ * The reference answers are game.cpp's chase_next(), calculate_score() and
+ * speed-up, written out again (they are static there). Check 4 compares
+ * against the firmware itself.
+ ******************************************************************************/
+
+static uint32_t check_classic(void) {
+    uint32_t failed = 0;
+    uint32_t cases = 0;
+    int16_t reg[RULE_REGS];
+
+    for (int16_t position = 0; position < NUM_LEDS; position++) {
+        for (int16_t direction = -1; direction <= 1; direction += 2) {
+            // The bounce never leaves an edge LED pointing off the strip
+            if ((position == 0 && direction < 0) || (position == NUM_LEDS - 1 && direction > 0)) {
+                continue;
+            }
+            int16_t next = position + direction;
+            int16_t turned = next == 0 ? 1 : next == NUM_LEDS - 1 ? -1 : direction;
+            run_hook(&rules_classic, RULE_MOVE, position, direction, 0, INITIAL_CHASE_SPEED, 0, reg);
+            cases++;
+            if (reg[0] != next || reg[1] != turned) {
+                printf("FAIL: move from %d (%+d): %d (%+d), built-in %d (%+d)\n", position,
+                       direction, reg[0], reg[1], next, turned);
+                failed++;
+            }
+        }
+
+        bool green = position >= TARGET_ZONE_START && position <= TARGET_ZONE_END;
+        int16_t points = green ? BULLSEYE_SCORE : 0;
+        run_hook(&rules_classic, RULE_SCORE, position, 1, 0, INITIAL_CHASE_SPEED, 0, reg);
+        cases++;
+        if (reg[4] != points) {
+            printf("FAIL: score at %d: %d, built-in %d\n", position, reg[4], points);
+            failed++;
+        }
+    }
+
+    for (int16_t speed = MIN_CHASE_SPEED; speed <= INITIAL_CHASE_SPEED; speed++) {
+        int16_t faster = speed - SPEED_DECREASE < MIN_CHASE_SPEED ? MIN_CHASE_SPEED
+                       : speed - SPEED_DECREASE;
+        run_hook(&rules_classic, RULE_SPEED, 3, 1, 100, speed, BULLSEYE_SCORE, reg);
+        cases++;
+        if (reg[3] != faster) {
+            printf("FAIL: speed-up from %d ms: %d, built-in %d\n", speed, reg[3], faster);
+            failed++;
+        }
+    }
+
+    if (failed == 0) {
+        printf("classic == built-in rules in all %u cases\n", cases);
+    }
+    return failed;
+}
+
+/******************************************************************************
+ * 3. BROKEN PROGRAMS ARE REFUSED
+ ******************************************************************************/
+
+typedef struct {
+    const char *what;
+    RuleSet set;
+    uint8_t error;
+    uint8_t hook;
+    uint8_t step;
+} BrokenCase;
+
+static const uint8_t code_bad_op[] = { RULE(RULE_ADD, 0, 1), RULE(31, 0, 0) };
+static const uint8_t code_bad_register[] = { RULE(RULE_MOV, 4, 9) };
+static const uint8_t code_bad_shift[] = { RULE(RULE_LDI, 4, 1), RULE(RULE_SHL, 4, 16) };
+static const uint8_t code_skip_off_end[] = { RULE(RULE_LDI, 3, 90), RULE(RULE_SKEQ, 3, 3) };
+static const uint8_t code_jump_zero[] = { RULE(RULE_JMP, 0, 0), RULE(RULE_END, 0, 0) };
+static const uint8_t code_jump_off_end[] = { RULE(RULE_JMP, 0, 2), RULE(RULE_END, 0, 0) };
+static const uint8_t code_random_move[] = { RULE(RULE_RND, 0, 0), RULE(RULE_ANDI, 0, 7) };
+static const uint8_t code_slow[] = {
+    // 24 shifts by 15: ~90 cycles each, twice the budget
+    RULE(RULE_SHL, 5, 15), RULE(RULE_SHL, 5, 15), RULE(RULE_SHL, 5, 15), RULE(RULE_SHL, 5, 15),
+    RULE(RULE_SHL, 5, 15), RULE(RULE_SHL, 5, 15), RULE(RULE_SHL, 5, 15), RULE(RULE_SHL, 5, 15),
+    RULE(RULE_SHL, 5, 15), RULE(RULE_SHL, 5, 15), RULE(RULE_SHL, 5, 15), RULE(RULE_SHL, 5, 15),
+    RULE(RULE_SHL, 5, 15), RULE(RULE_SHL, 5, 15), RULE(RULE_SHL, 5, 15), RULE(RULE_SHL, 5, 15),
+    RULE(RULE_SHL, 5, 15), RULE(RULE_SHL, 5, 15), RULE(RULE_SHL, 5, 15), RULE(RULE_SHL, 5, 15),
+    RULE(RULE_SHL, 5, 15), RULE(RULE_SHL, 5, 15), RULE(RULE_SHL, 5, 15), RULE(RULE_SHL, 5, 15),
+};
+
+static const BrokenCase broken[] = {
+    {"part over RULES_MAX_STEPS", {{0, RULES_MAX_STEPS + 1, 0}, code_slow},
+     RULES_TOO_LONG, RULE_SCORE, RULES_MAX_STEPS},
+    {"unknown opcode", {{2, 0, 0}, code_bad_op}, RULES_BAD_OP, RULE_MOVE, 1},
+    {"register 9", {{0, 1, 0}, code_bad_register}, RULES_BAD_OPERAND, RULE_SCORE, 0},
+    {"shift by 16", {{0, 0, 2}, code_bad_shift}, RULES_BAD_OPERAND, RULE_SPEED, 1},
+    {"skip past the end", {{0, 0, 2}, code_skip_off_end}, RULES_BAD_JUMP, RULE_SPEED, 1},
+    {"jump by 0", {{0, 2, 0}, code_jump_zero}, RULES_BAD_JUMP, RULE_SCORE, 0},
+    {"jump past the end", {{2, 0, 0}, code_jump_off_end}, RULES_BAD_JUMP, RULE_MOVE, 0},
+    {"random in RULE_MOVE", {{2, 0, 0}, code_random_move}, RULES_RANDOM_MOVE, RULE_MOVE, 0},
+    {"over budget", {{0, 0, RULES_MAX_STEPS}, code_slow}, RULES_OVER_BUDGET, RULE_SPEED, 0},
+};
+
+static uint32_t check_broken(void) {
+    uint32_t failed = 0;
+    uint8_t cases = sizeof(broken) / sizeof(broken[0]);
+
+    for (uint8_t i = 0; i < cases; i++) {
+        const BrokenCase *c = &broken[i];
+        RulesReport report = {};
+        uint8_t error = rules_check(&c->set, &report);
+        if (error != c->error || report.hook != c->hook || report.step != c->step) {
+            printf("FAIL: %s: error %u at %s step %u, expected %u at %s step %u\n", c->what,
+                   error, hook_names[report.hook], report.step, c->error, hook_names[c->hook],
+                   c->step);
+            failed++;
+        }
+    }
+
+    // A good image with one bit flipped fails its checksum, and loads nothing
+    uint8_t image[RULES_IMAGE_MAX];
+    uint8_t size = rules_image_build(&rules_sniper, image);
+    image[RULES_IMAGE_HEADER] ^= 0x01;
+    RuleSet set;
+    RulesReport report;
+    uint8_t error = rules_image_load(image, size, &set, &report);
+    if (error != RULES_BAD_IMAGE || set.length[RULE_SCORE] != 0) {
+        printf("FAIL: corrupted image: error %u, %u score steps loaded\n", error,
+               set.length[RULE_SCORE]);
+        failed++;
+    }
+
+    if (failed == 0) {
+        printf("%u broken programs and a corrupted image refused\n", cases);
+    }
+    return failed;
+}
+
+/******************************************************************************
+ * 4. THE FIRMWARE PLAYS EACH MODE
+ ******************************************************************************/
+
+typedef struct {
+    uint32_t games;
+    uint32_t steps;            // Chase steps seen
+    uint32_t wrong_steps;      // Steps that weren't the mode's RULE_MOVE
+    uint16_t best;
+    uint64_t hash;             // Every tick's state, LED, score and speed
+} PlayResult;
+
+/**
+ * play - @seconds of a bot playing the firmware with @set stored (NULL: none)
+ */
+static void play(const RuleSet *set, uint32_t seconds, uint32_t seed, PlayResult *r) {
+    memset(r, 0, sizeof(*r));
+    r->hash = 14695981039346656037ull;
+    sim_eeprom_erase();
+    sim_set_button(false);
+    sim_power_on(0);
+    if (set != NULL) {
+        uint8_t image[RULES_IMAGE_MAX];
+        eeprom_write_rules(image, rules_image_build(set, image));
+        sim_power_on(sim_millis());    // game_init() loads it
+    }
+
+    uint32_t rng = seed * 2654435761u + 0x9E3779B9u;
+    bool pressed = false;
+    uint32_t release_at = 0;
+    GameStatus last;
+    game_get_status(&last);
+
+    while (sim_millis() < seconds * 1000u) {
+        uint32_t now = sim_millis();
+        GameStatus gs;
+        game_get_status(&gs);
+
+        if (gs.position != last.position || gs.direction != last.direction) {
+            int16_t reg[RULE_REGS];
+            const RuleSet *mover = set != NULL && set->length[RULE_MOVE] != 0 ? set : &rules_classic;
+            run_hook(mover, RULE_MOVE, last.position, last.direction, 0, 0, 0, reg);
+            r->steps++;
+            r->wrong_steps += reg[0] != gs.position || reg[1] != gs.direction;
+        }
+        if (gs.state == STATE_PLAYING && last.state != STATE_PLAYING && last.state != STATE_RESULT) {
+            r->games++;
+        }
+        if (gs.score > r->best) {
+            r->best = gs.score;
+        }
+        uint32_t tick = (uint32_t)gs.state | (uint32_t)gs.position << 4 |
+                        (uint32_t)gs.score << 8 | (uint64_t)gs.chase_speed << 24;
+        r->hash = (r->hash ^ tick) * 1099511628211ull;
+        last = gs;
+
+        if (pressed) {
+            if (now >= release_at) {
+                pressed = false;
+                sim_set_button(false);
+            }
+        } else {
+            bool press = false;
+            if (gs.state == STATE_PLAYING) {
+                bool in_zone = gs.position >= TARGET_ZONE_START && gs.position <= TARGET_ZONE_END;
+                press = xorshift32(&rng) % 1000 < (in_zone ? 40u : 1u);
+            } else if (gs.state == STATE_ATTRACT) {
+                press = xorshift32(&rng) % 1000 < 2u;
+            }
+            if (press) {
+                pressed = true;
+                release_at = now + 50 + xorshift32(&rng) % 100;
+                sim_set_button(true);
+            }
+        }
+        sim_tick();
+    }
+}
+
+static uint32_t check_play(uint32_t seconds, uint32_t seed) {
+    uint32_t failed = 0;
+    PlayResult builtin;
+    play(NULL, seconds, seed, &builtin);
+    printf("mode     games  best  chase steps\n");
+    printf("%-8s %5u %5u %12u\n", "built-in", builtin.games, builtin.best, builtin.steps);
+
+    for (uint8_t m = 0; m < EXAMPLE_COUNT; m++) {
+        PlayResult r;
+        play(examples[m].set, seconds, seed, &r);
+        printf("%-8s %5u %5u %12u\n", examples[m].name, r.games, r.best, r.steps);
+        if (r.steps == 0 || r.wrong_steps != 0) {
+            printf("FAIL: %s: %u of %u chase steps weren't its RULE_MOVE\n", examples[m].name,
+                   r.wrong_steps, r.steps);
+            failed++;
+        }
+        if (examples[m].set == &rules_classic && r.hash != builtin.hash) {
+            printf("FAIL: classic played a different game from the built-in rules\n");
+            failed++;
+        }
+    }
+    return failed;
+}
+
+static int write_image(const char *name) {
+    for (uint8_t m = 0; m < EXAMPLE_COUNT; m++) {
+        if (strcmp(examples[m].name, name) == 0) {
+            uint8_t image[RULES_IMAGE_MAX];
+            uint8_t size = rules_image_build(examples[m].set, image);
+            fwrite(image, 1, size, stdout);
+            return 0;
+        }
+    }
+    fprintf(stderr, "no mode called %s\n", name);
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    uint32_t seconds = 300;
+    uint32_t seed = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--image") == 0) {
+            return write_image(argv[i + 1]);
+        }
+        uint32_t value = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+        if (strcmp(argv[i], "--seconds") == 0) {
+            seconds = value;
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            seed = value;
+        } else {
+            fprintf(stderr, "usage: %s [--seconds N] [--seed S] | --image NAME\n", argv[0]);
+            return 2;
+        }
+    }
+
+    uint32_t failed = check_examples();
+    failed += check_classic();
+    failed += check_broken();
+    failed += check_play(seconds, seed);
+
+    if (failed != 0) {
+        printf("FAIL: %u problems\n", failed);
+        return 1;
+    }
+    printf("OK: every mode checked, costed and played as written\n");
+    return 0;
+}
@@ -0,0 +1,230 @@
+/******************************************************************************
+ * SIMAVR_COIN.CPP - Coin Pulse Injection Against the Real Firmware (simavr)
+ *
+ * Usage:
+ *   simavr-coin FIRMWARE.elf [--pulses N] [--seed S]
+ *
+ * The host simulator replaces coin.cpp (it has no interrupts), so it can't
+ * show that the ISR loses nothing. This tool runs the AVR build itself in
+ * simavr and drives the coin pin like a coin mech would:
+ *
+ *   valid pulses   20-50 ms LOW                    (a coin)
+ *   bursts         3 x 30 ms LOW, 30 ms apart       (a high-value coin)
+ *   glitches       1-5 ms LOW                       (noise: no credit)
+ *   jams           150-300 ms LOW                   (stuck or strung coin)
+ *
+ * Build the firmware as uno_coin_stall: coin-op, and loop() busy-waits
+ * COIN_STALL_MS = 20 ms at a time without ever sleeping, so every pulse
+ * edge lands while loop() is blocked. After the last pulse the firmware
+ * gets time to settle and save its ledger; the tool then reads the ledger
+ * out of the simulated EEPROM and checks it against what was injected:
+ *
+ *   coins   == valid pulses sent (glitches and jams not counted)
+ *   credits == the same, capped at COIN_MAX_CREDITS (no game was started)
+ *
+ * Exits with status 1 on a mismatch. No I2C devices are attached: the
+ * firmware reports the missing LCD and carries on to ATTRACT.
+ *
+ * Build: pio run -e uno_coin_stall && pio run -e simavr_coin
+ *        (needs simavr and libelf installed on the host)
+ ******************************************************************************/
+
+#include "config.h"
+#include "coin.h"
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_cycle_timers.h>
+#include <simavr/avr_ioport.h>
+#include <simavr/avr_eeprom.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static const uint32_t CPU_HZ = 16000000;        // board = uno
+static const uint32_t BOOT_US = 3000000;        // Self-test, LCD fault hold, ATTRACT
+static const uint32_t SETTLE_US = 2000000;      // Ledger settle time + save, generously
+
+typedef struct {
+    uint64_t at_us;
+    uint8_t level;
+} PinEdge;
+
+typedef struct {
+    avr_irq_t *pin;
+    std::vector<PinEdge> edges;
+    size_t next;
+} Injector;
+
+static uint32_t xorshift32(uint32_t *s) {
+    uint32_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *s = x;
+    return x;
+}
+
+/**
+ * add_pulse - One LOW pulse of @width_us at @*t, then @gap_us of HIGH
+ * @return: 1 if the firmware should count it
+ */
+static uint32_t add_pulse(std::vector<PinEdge> *edges, uint64_t *t, uint32_t width_us, uint32_t gap_us) {
+    edges->push_back({*t, 0});
+    edges->push_back({*t + width_us, 1});
+    *t += width_us + gap_us;
+    return coin_pulse_valid(width_us) ? 1 : 0;
+}
+
+/**
+ * make_script - N coin-mech events; returns how many pulses are valid
+ */
+static uint32_t make_script(uint32_t count, uint32_t seed, std::vector<PinEdge> *edges) {
+    uint32_t rng = seed * 2654435761u + 7u;
+    uint64_t t = BOOT_US;
+    uint32_t valid = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t gap = 40000 + xorshift32(&rng) % 260000;
+        uint32_t kind = xorshift32(&rng) % 10;
+        if (kind < 7) {
+            valid += add_pulse(edges, &t, 20000 + xorshift32(&rng) % 30001, gap);
+        } else if (kind == 7) {
+            valid += add_pulse(edges, &t, 30000, 30000);
+            valid += add_pulse(edges, &t, 30000, 30000);
+            valid += add_pulse(edges, &t, 30000, gap);
+        } else if (kind == 8) {
+            valid += add_pulse(edges, &t, 1000 + xorshift32(&rng) % 4001, gap);
+        } else {
+            valid += add_pulse(edges, &t, 150000 + xorshift32(&rng) % 150001, gap);
+        }
+    }
+    return valid;
+}
+
+/**
+ * inject_edge - Cycle timer callback: drive the next edge, schedule the one after
+ */
+static avr_cycle_count_t inject_edge(avr_t *avr, avr_cycle_count_t when, void *param) {
+    (void)when;
+    Injector *inj = (Injector *)param;
+    avr_raise_irq(inj->pin, inj->edges[inj->next].level);
+    inj->next++;
+    if (inj->next >= inj->edges.size()) {
+        return 0;
+    }
+    return avr_usec_to_cycles(avr, inj->edges[inj->next].at_us);
+}
+
+/**
+ * read_ledger - Decode the newest valid ledger slot (same rules as
+ * hardware.cpp:ledger_load())
+ */
+static bool read_ledger(avr_t *avr, uint32_t *coins, uint32_t *games, uint8_t *credits) {
+    avr_eeprom_desc_t ee;
+    memset(&ee, 0, sizeof(ee));
+    ee.offset = EEPROM_LEDGER_ADDR;
+    ee.size = LEDGER_SLOTS * LEDGER_SLOT_SIZE;
+    if (avr_ioctl(avr, AVR_IOCTL_EEPROM_GET, &ee) != 0 || ee.ee == NULL) {
+        return false;
+    }
+
+    int newest = -1;
+    uint8_t newest_seq = 0;
+    for (uint8_t slot = 0; slot < LEDGER_SLOTS; slot++) {
+        const uint8_t *r = ee.ee + slot * LEDGER_SLOT_SIZE;
+        uint8_t checksum = 0;
+        for (uint8_t i = 0; i < LEDGER_SLOT_SIZE - 1; i++) {
+            checksum ^= r[i];
+        }
+        if (r[LEDGER_SLOT_SIZE - 2] != EEPROM_MAGIC_BYTE || r[LEDGER_SLOT_SIZE - 1] != checksum) {
+            continue;
+        }
+        if (newest < 0 || (int8_t)(r[0] - newest_seq) > 0) {
+            newest = slot;
+            newest_seq = r[0];
+        }
+    }
+    if (newest < 0) {
+        return false;
+    }
+    const uint8_t *r = ee.ee + newest * LEDGER_SLOT_SIZE;
+    *coins = r[1] | (r[2] << 8) | (r[3] << 16) | ((uint32_t)r[4] << 24);
+    *games = r[5] | (r[6] << 8) | (r[7] << 16) | ((uint32_t)r[8] << 24);
+    *credits = r[9];
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s FIRMWARE.elf [--pulses N] [--seed S]\n", argv[0]);
+        return 2;
+    }
+    uint32_t count = 200;
+    uint32_t seed = 1;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        uint32_t value = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+        if (strcmp(argv[i], "--pulses") == 0) {
+            count = value;
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            seed = value;
+        } else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    elf_firmware_t firmware;
+    memset(&firmware, 0, sizeof(firmware));
+    if (elf_read_firmware(argv[1], &firmware) != 0) {
+        fprintf(stderr, "%s: can't load firmware\n", argv[1]);
+        return 2;
+    }
+    avr_t *avr = avr_make_mcu_by_name("atmega328p");
+    if (avr == NULL) {
+        fprintf(stderr, "simavr has no atmega328p core\n");
+        return 2;
+    }
+    avr_init(avr);
+    avr->frequency = CPU_HZ;
+    avr_load_firmware(avr, &firmware);
+
+    // Inputs idle HIGH, as with their pull-ups: a LOW button at boot would
+    // start calibration. Arduino pins 10 and 12 are PB2 and PB4; A0 is PC0.
+    avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 2), 1);
+    avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 4), 1);
+    Injector inj;
+    inj.pin = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('C'), 0);
+    inj.next = 0;
+    avr_raise_irq(inj.pin, 1);
+
+    uint32_t valid = make_script(count, seed, &inj.edges);
+    uint64_t end_us = inj.edges.back().at_us + SETTLE_US;
+    avr_cycle_timer_register(avr, avr_usec_to_cycles(avr, inj.edges[0].at_us), inject_edge, &inj);
+
+    avr_cycle_count_t end = avr_usec_to_cycles(avr, end_us);
+    int state = cpu_Running;
+    while (avr->cycle < end && state != cpu_Done && state != cpu_Crashed) {
+        state = avr_run(avr);
+    }
+    if (state == cpu_Done || state == cpu_Crashed) {
+        fprintf(stderr, "firmware stopped after %.3f s\n", avr->cycle / (double)CPU_HZ);
+        return 1;
+    }
+
+    uint32_t coins = 0, games = 0;
+    uint8_t credits = 0;
+    if (!read_ledger(avr, &coins, &games, &credits)) {
+        fprintf(stderr, "no valid ledger slot in EEPROM\n");
+        return 1;
+    }
+    uint32_t expected_credits = valid < COIN_MAX_CREDITS ? valid : COIN_MAX_CREDITS;
+    printf("%u events, %zu edges over %.1f s: %u valid pulses\n",
+           count, inj.edges.size(), end_us / 1e6, valid);
+    printf("ledger: coins %u, games %u, credits %u\n", coins, games, credits);
+    if (coins != valid || credits != expected_credits || games != 0) {
+        printf("FAIL: expected coins %u, games 0, credits %u\n", valid, expected_credits);
+        return 1;
+    }
+    printf("OK: every pulse counted, every glitch and jam rejected\n");
+    return 0;
+}
@@ -0,0 +1,409 @@
+/******************************************************************************
+ * SIMAVR_TINY.CPP - The ATtiny85 Build Played Against the Uno's (simavr)
+ *
+ * Usage:
+ *   simavr-tiny TINY.elf UNO.elf [--seconds N] [--tolerance-ms T]
+ *
+ * The tiny85 build shares game.cpp with the Uno's, but not its timebase,
+ * LED driver or clock. This runs both in simavr under the button script
+ * simavr_trace.cpp uses (after 3 s of boot, an 80 ms press every 1.7 s)
+ * and records what the eight LEDs show and when:
+ *
+ *   Uno    pins 2-9 (PD2-PD7, PB0-PB1), read from the port pins. A frame
+ *          written as two port writes a few cycles apart counts once
+ *   tiny   the 74HC595's outputs: the bits shifted in, copied to the
+ *          outputs on each rising edge of RCLK (PB0)
+ *
+ * The Uno's timeline is the reference. From SETTLE_US after the first press
+ * (boot differs: the Uno waits out its missing-LCD fault) both must show
+ * the same frames in the same order, each within --tolerance-ms (default
+ * 3: the tiny's millis() ticks every 1.024 ms and it wakes on that tick).
+ * Exits with status 1 on the first difference, printed with its time.
+ *
+ * STACK:
+ * Before the tiny85 runs, its SRAM from __heap_start (the end of .data and
+ * .bss) up to RAMEND is filled with 0xA5. The lowest byte no longer 0xA5
+ * at the end is as deep as the stack went; the rest is headroom. It fails
+ * if nothing is left.
+ *
+ * simavr has no model of the ATtiny85's USI, so this tool plays it: a
+ * write of USISR clears the flag and sets the 4-bit counter, and each
+ * USITC strobe in USICR toggles USCK and counts, shifting USIDR's MSB into
+ * the 595 on every rising edge, as in three-wire mode. The flag is set
+ * when the counter wraps, which ends the firmware's shift loop (leds.h).
+ *
+ * Build: pio run -e uno -e tiny85 -e simavr_tiny (needs simavr and libelf)
+ ******************************************************************************/
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_cycle_timers.h>
+#include <simavr/sim_io.h>
+#include <simavr/avr_ioport.h>
+#include <gelf.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static const uint32_t UNO_HZ = 16000000;          // board = uno
+static const uint32_t TINY_HZ = 8000000;          // env:tiny85's board_build.f_cpu
+static const uint32_t BOOT_US = 3000000;
+static const uint32_t PRESS_PERIOD_US = 1700000;
+static const uint32_t PRESS_HOLD_US = 80000;
+static const uint32_t SETTLE_US = 20000;           // First press to the compare
+static const uint32_t SAME_FRAME_US = 20;          // Port writes of one Uno frame
+static const uint32_t AVR_DATA_OFFSET = 0x800000;  // Where avr-ld puts SRAM symbols
+static const uint8_t STACK_PAINT = 0xA5;
+
+// ATtiny85 USI registers, data-space addresses (I/O address + 0x20)
+static const avr_io_addr_t TINY_USICR = 0x2D;
+static const avr_io_addr_t TINY_USISR = 0x2E;
+static const avr_io_addr_t TINY_USIDR = 0x2F;
+static const uint8_t USIOIF = 6;
+static const uint8_t USITC = 0;
+
+typedef struct {
+    uint32_t at_us;
+    uint8_t frame;
+} LedChange;
+
+typedef struct {
+    avr_t *avr;
+    uint8_t frame;
+    std::vector<LedChange> changes;
+} LedTimeline;
+
+typedef struct {
+    LedTimeline *timeline;
+    uint8_t bit;                // LED number this pin drives
+} UnoPin;
+
+typedef struct {
+    LedTimeline *timeline;
+    uint8_t counter;            // USISR's 4-bit counter
+    bool usck;                  // Level of USCK (PB2)
+    uint8_t shifted;            // The 595's shift register
+} TinyUsi;
+
+typedef struct {
+    avr_irq_t *button;
+    bool pressed;
+    uint64_t next_us;
+} ButtonScript;
+
+static uint32_t now_us(avr_t *avr) {
+    return (uint32_t)(avr->cycle * 1000000ull / avr->frequency);
+}
+
+/**
+ * timeline_show - Note that the LEDs now show @frame
+ *
+ * A change within SAME_FRAME_US of the last replaces it: the Uno writes
+ * PORTD and PORTB one after the other, and the frame in between was never
+ * visible.
+ */
+static void timeline_show(LedTimeline *t, uint8_t frame) {
+    uint32_t at = now_us(t->avr);
+    if (!t->changes.empty() && at - t->changes.back().at_us < SAME_FRAME_US) {
+        t->changes.back().frame = frame;
+    } else {
+        t->changes.push_back({at, frame});
+    }
+    t->frame = frame;
+}
+
+/**
+ * uno_pin_changed - Port pin hook: one of the Uno's LED pins changed level
+ */
+static void uno_pin_changed(avr_irq_t *irq, uint32_t value, void *param) {
+    (void)irq;
+    UnoPin *pin = (UnoPin *)param;
+    uint8_t mask = (uint8_t)(1 << pin->bit);
+    uint8_t frame = value ? (uint8_t)(pin->timeline->frame | mask)
+                          : (uint8_t)(pin->timeline->frame & ~mask);
+    if (frame != pin->timeline->frame) {
+        timeline_show(pin->timeline, frame);
+    }
+}
+
+/**
+ * tiny_latch_changed - Port pin hook: RCLK (PB0) rose, the 595 shows its shift register
+ */
+static void tiny_latch_changed(avr_irq_t *irq, uint32_t value, void *param) {
+    (void)irq;
+    TinyUsi *usi = (TinyUsi *)param;
+    if (value && usi->shifted != usi->timeline->frame) {
+        timeline_show(usi->timeline, usi->shifted);
+    }
+}
+
+/**
+ * usisr_write - USISR: writing USIOIF clears it, the low nibble sets the counter
+ */
+static void usisr_write(avr_t *avr, avr_io_addr_t addr, uint8_t v, void *param) {
+    TinyUsi *usi = (TinyUsi *)param;
+    uint8_t flags = avr->data[addr] & (uint8_t)(1 << USIOIF);
+    if (v & (1 << USIOIF)) {
+        flags = 0;
+    }
+    usi->counter = v & 0x0F;
+    avr->data[addr] = (uint8_t)(flags | usi->counter);
+}
+
+/**
+ * usicr_write - USICR: a USITC strobe toggles USCK and counts; rising edges shift
+ */
+static void usicr_write(avr_t *avr, avr_io_addr_t addr, uint8_t v, void *param) {
+    TinyUsi *usi = (TinyUsi *)param;
+    avr->data[addr] = (uint8_t)(v & ~(1 << USITC));     // Strobe bits read as 0
+    if (!(v & (1 << USITC))) {
+        return;
+    }
+    usi->usck = !usi->usck;
+    if (usi->usck) {
+        uint8_t data = avr->data[TINY_USIDR];
+        usi->shifted = (uint8_t)((usi->shifted << 1) | (data >> 7));
+        avr->data[TINY_USIDR] = (uint8_t)(data << 1);
+    }
+    usi->counter = (usi->counter + 1) & 0x0F;
+    uint8_t flags = avr->data[TINY_USISR] & (uint8_t)(1 << USIOIF);
+    if (usi->counter == 0) {
+        flags = (uint8_t)(1 << USIOIF);
+    }
+    avr->data[TINY_USISR] = (uint8_t)(flags | usi->counter);
+}
+
+/**
+ * button_step - Cycle timer callback: press or release, schedule the next
+ */
+static avr_cycle_count_t button_step(avr_t *avr, avr_cycle_count_t when, void *param) {
+    (void)when;
+    ButtonScript *script = (ButtonScript *)param;
+    script->pressed = !script->pressed;
+    avr_raise_irq(script->button, script->pressed ? 0 : 1);  // Active LOW
+    script->next_us += script->pressed ? PRESS_HOLD_US : PRESS_PERIOD_US - PRESS_HOLD_US;
+    return avr_usec_to_cycles(avr, (uint32_t)script->next_us);
+}
+
+/**
+ * find_symbol - Data-space address of the symbol called @name, any type
+ * @return: 0 if there is none
+ */
+static uint16_t find_symbol(const char *path, const char *name) {
+    uint16_t address = 0;
+    elf_version(EV_CURRENT);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    Elf *elf = elf_begin(fd, ELF_C_READ, NULL);
+    Elf_Scn *section = NULL;
+    while (elf != NULL && address == 0 && (section = elf_nextscn(elf, section)) != NULL) {
+        GElf_Shdr header;
+        if (gelf_getshdr(section, &header) == NULL || header.sh_type != SHT_SYMTAB) {
+            continue;
+        }
+        Elf_Data *data = elf_getdata(section, NULL);
+        size_t count = header.sh_entsize != 0 ? header.sh_size / header.sh_entsize : 0;
+        for (size_t i = 0; i < count; i++) {
+            GElf_Sym symbol;
+            if (gelf_getsym(data, (int)i, &symbol) == NULL) {
+                continue;
+            }
+            const char *found = elf_strptr(elf, header.sh_link, symbol.st_name);
+            if (found != NULL && strcmp(found, name) == 0) {
+                address = (uint16_t)(symbol.st_value - AVR_DATA_OFFSET);
+                break;
+            }
+        }
+    }
+    if (elf != NULL) {
+        elf_end(elf);
+    }
+    close(fd);
+    return address;
+}
+
+/**
+ * load - A simavr core for @mcu at @hz running @path
+ * @return: NULL (and a message) if either can't be had
+ */
+static avr_t *load(const char *path, const char *mcu, uint32_t hz) {
+    elf_firmware_t firmware;
+    memset(&firmware, 0, sizeof(firmware));
+    if (elf_read_firmware(path, &firmware) != 0) {
+        fprintf(stderr, "%s: can't load firmware\n", path);
+        return NULL;
+    }
+    avr_t *avr = avr_make_mcu_by_name(mcu);
+    if (avr == NULL) {
+        fprintf(stderr, "simavr has no %s core\n", mcu);
+        return NULL;
+    }
+    avr_init(avr);
+    avr->frequency = hz;
+    avr_load_firmware(avr, &firmware);
+    return avr;
+}
+
+/**
+ * run - Play the button script on @avr until @seconds have passed
+ * @return: false if the firmware stopped first
+ */
+static bool run(avr_t *avr, avr_irq_t *button, uint32_t seconds, const char *name) {
+    ButtonScript script;
+    script.button = button;
+    script.pressed = false;
+    script.next_us = BOOT_US;
+    avr_raise_irq(button, 1);
+    avr_cycle_timer_register(avr, avr_usec_to_cycles(avr, BOOT_US), button_step, &script);
+
+    avr_cycle_count_t end = avr_usec_to_cycles(avr, seconds * 1000000u);
+    int state = cpu_Running;
+    while (avr->cycle < end && state != cpu_Done && state != cpu_Crashed) {
+        state = avr_run(avr);
+    }
+    if (state == cpu_Done || state == cpu_Crashed) {
+        fprintf(stderr, "%s: firmware stopped after %.3f s\n", name,
+                avr->cycle / (double)avr->frequency);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * first_at - Index of the first change at or after @at_us (or the count)
+ */
+static size_t first_at(const std::vector<LedChange> &changes, uint32_t at_us) {
+    size_t i = 0;
+    while (i < changes.size() && changes[i].at_us < at_us) {
+        i++;
+    }
+    return i;
+}
+
+static void print_frame(uint8_t frame) {
+    for (uint8_t i = 0; i < 8; i++) {
+        putchar((frame >> i) & 1 ? '*' : '.');
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s TINY.elf UNO.elf [--seconds N] [--tolerance-ms T]\n",
+                argv[0]);
+        return 2;
+    }
+    uint32_t seconds = 30;
+    uint32_t tolerance_us = 3000;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        uint32_t value = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+        if (strcmp(argv[i], "--seconds") == 0) {
+            seconds = value;
+        } else if (strcmp(argv[i], "--tolerance-ms") == 0) {
+            tolerance_us = value * 1000;
+        } else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    // The Uno: LEDs 0-5 on PD2-PD7, 6-7 on PB0-PB1; inputs idle HIGH
+    avr_t *uno = load(argv[2], "atmega328p", UNO_HZ);
+    if (uno == NULL) {
+        return 2;
+    }
+    LedTimeline uno_leds;
+    uno_leds.avr = uno;
+    uno_leds.frame = 0;
+    UnoPin uno_pins[8];
+    for (uint8_t i = 0; i < 8; i++) {
+        uno_pins[i].timeline = &uno_leds;
+        uno_pins[i].bit = i;
+        avr_irq_t *irq = i < 6 ? avr_io_getirq(uno, AVR_IOCTL_IOPORT_GETIRQ('D'), i + 2)
+                               : avr_io_getirq(uno, AVR_IOCTL_IOPORT_GETIRQ('B'), i - 6);
+        avr_irq_register_notify(irq, uno_pin_changed, &uno_pins[i]);
+    }
+    avr_raise_irq(avr_io_getirq(uno, AVR_IOCTL_IOPORT_GETIRQ('B'), 4), 1);   // INTA
+    avr_raise_irq(avr_io_getirq(uno, AVR_IOCTL_IOPORT_GETIRQ('C'), 0), 1);   // Coin
+    if (!run(uno, avr_io_getirq(uno, AVR_IOCTL_IOPORT_GETIRQ('B'), 2), seconds, argv[2])) {
+        return 1;
+    }
+
+    // The tiny85: the USI and 595 played here, RCLK on PB0, button on PB3
+    uint16_t heap_start = find_symbol(argv[1], "__heap_start");
+    if (heap_start == 0) {
+        fprintf(stderr, "%s: no __heap_start symbol (stripped?)\n", argv[1]);
+        return 2;
+    }
+    avr_t *tiny = load(argv[1], "attiny85", TINY_HZ);
+    if (tiny == NULL) {
+        return 2;
+    }
+    for (uint32_t a = heap_start; a <= tiny->ramend; a++) {
+        tiny->data[a] = STACK_PAINT;
+    }
+    LedTimeline tiny_leds;
+    tiny_leds.avr = tiny;
+    tiny_leds.frame = 0;
+    TinyUsi usi;
+    usi.timeline = &tiny_leds;
+    usi.counter = 0;
+    usi.usck = false;
+    usi.shifted = 0;
+    avr_register_io_write(tiny, TINY_USISR, usisr_write, &usi);
+    avr_register_io_write(tiny, TINY_USICR, usicr_write, &usi);
+    avr_irq_register_notify(avr_io_getirq(tiny, AVR_IOCTL_IOPORT_GETIRQ('B'), 0),
+                            tiny_latch_changed, &usi);
+    if (!run(tiny, avr_io_getirq(tiny, AVR_IOCTL_IOPORT_GETIRQ('B'), 3), seconds, argv[1])) {
+        return 1;
+    }
+
+    uint32_t deepest = heap_start;
+    while (deepest <= tiny->ramend && tiny->data[deepest] == STACK_PAINT) {
+        deepest++;
+    }
+    uint32_t headroom = deepest - heap_start;
+    printf("tiny85 stack: %u bytes used, %u never touched (static data ends at 0x%03X)\n",
+           tiny->ramend - deepest + 1, headroom, heap_start);
+
+    // A change within the tolerance of the end may be in one run and not the other
+    uint32_t until_us = seconds * 1000000u - tolerance_us;
+    size_t u = first_at(uno_leds.changes, BOOT_US + SETTLE_US);
+    size_t t = first_at(tiny_leds.changes, BOOT_US + SETTLE_US);
+    size_t u_end = first_at(uno_leds.changes, until_us);
+    size_t t_end = first_at(tiny_leds.changes, until_us);
+    uint32_t compared = 0;
+    uint32_t worst_us = 0;
+    for (; u < u_end && t < t_end; u++, t++) {
+        const LedChange *a = &uno_leds.changes[u];
+        const LedChange *b = &tiny_leds.changes[t];
+        uint32_t skew = a->at_us > b->at_us ? a->at_us - b->at_us : b->at_us - a->at_us;
+        if (a->frame != b->frame || skew > tolerance_us) {
+            printf("FAIL: change %u: uno ", compared);
+            print_frame(a->frame);
+            printf(" at %.3f s, tiny85 ", a->at_us / 1e6);
+            print_frame(b->frame);
+            printf(" at %.3f s\n", b->at_us / 1e6);
+            return 1;
+        }
+        worst_us = skew > worst_us ? skew : worst_us;
+        compared++;
+    }
+    if (u != u_end || t != t_end) {
+        printf("FAIL: after %u matching changes, uno has %zu more and tiny85 %zu more\n",
+               compared, u_end - u, t_end - t);
+        return 1;
+    }
+    if (headroom == 0) {
+        printf("FAIL: the tiny85's stack reached its static data\n");
+        return 1;
+    }
+    printf("OK: %u LED changes over %u s match the Uno's, worst skew %u us\n", compared,
+           seconds, worst_us);
+    return 0;
+}
@@ -0,0 +1,135 @@
+/******************************************************************************
+ * SIMAVR_TRACE.CPP - Trace Capture from the Real Firmware (simavr)
+ *
+ * Usage:
+ *   simavr-trace FIRMWARE.elf OUT.bin [--hz F_CPU] [--seconds N]
+ *
+ * Runs a tracing firmware (uno_trace, pro8mhz_trace) in simavr at the clock
+ * it was built for and writes its UART output - the raw trace record stream
+ * of trace.h - to OUT.bin. The button follows a fixed script, the same at
+ * every clock speed: after 3 s of boot, an 80 ms press every 1.7 s, so the
+ * capture covers ATTRACT, PLAYING and the result screens.
+ *
+ * Comparing clock speeds (output timing must not depend on F_CPU):
+ *   simavr-trace .pio/build/uno_trace/firmware.elf uno.bin --hz 16000000
+ *   simavr-trace .pio/build/pro8mhz_trace/firmware.elf pro.bin --hz 8000000
+ *   trace-export diff uno.bin pro.bin
+ *
+ * The ELF doesn't record F_CPU, so --hz must match the build (default 16 MHz).
+ * No I2C devices are attached: the firmware reports the missing LCD and
+ * carries on, and its display spans still time the (unanswered) bus traffic.
+ *
+ * Build: pio run -e simavr_trace (needs simavr and libelf installed)
+ ******************************************************************************/
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_cycle_timers.h>
+#include <simavr/avr_ioport.h>
+#include <simavr/avr_uart.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const uint32_t BOOT_US = 3000000;         // Self-test, LCD fault hold, ATTRACT
+static const uint32_t PRESS_PERIOD_US = 1700000;
+static const uint32_t PRESS_HOLD_US = 80000;
+
+typedef struct {
+    avr_irq_t *button;
+    bool pressed;
+    uint64_t next_us;
+} ButtonScript;
+
+/**
+ * uart_byte - UART0 output hook: append one byte to the capture
+ */
+static void uart_byte(avr_irq_t *irq, uint32_t value, void *param) {
+    (void)irq;
+    fputc((int)(value & 0xFF), (FILE *)param);
+}
+
+/**
+ * button_step - Cycle timer callback: press or release, schedule the next
+ */
+static avr_cycle_count_t button_step(avr_t *avr, avr_cycle_count_t when, void *param) {
+    (void)when;
+    ButtonScript *script = (ButtonScript *)param;
+    script->pressed = !script->pressed;
+    avr_raise_irq(script->button, script->pressed ? 0 : 1);  // Active LOW
+    script->next_us += script->pressed ? PRESS_HOLD_US : PRESS_PERIOD_US - PRESS_HOLD_US;
+    return avr_usec_to_cycles(avr, (uint32_t)script->next_us);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s FIRMWARE.elf OUT.bin [--hz F_CPU] [--seconds N]\n", argv[0]);
+        return 2;
+    }
+    uint32_t hz = 16000000;
+    uint32_t seconds = 30;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        uint32_t value = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+        if (strcmp(argv[i], "--hz") == 0) {
+            hz = value;
+        } else if (strcmp(argv[i], "--seconds") == 0) {
+            seconds = value;
+        } else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    elf_firmware_t firmware;
+    memset(&firmware, 0, sizeof(firmware));
+    if (elf_read_firmware(argv[1], &firmware) != 0) {
+        fprintf(stderr, "%s: can't load firmware\n", argv[1]);
+        return 2;
+    }
+    FILE *out = fopen(argv[2], "wb");
+    if (out == NULL) {
+        perror(argv[2]);
+        return 2;
+    }
+    avr_t *avr = avr_make_mcu_by_name("atmega328p");
+    if (avr == NULL) {
+        fprintf(stderr, "simavr has no atmega328p core\n");
+        return 2;
+    }
+    avr_init(avr);
+    avr->frequency = hz;
+    avr_load_firmware(avr, &firmware);
+
+    // Binary records: keep simavr from echoing UART bytes to the console
+    uint32_t flags = 0;
+    avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+    flags &= ~AVR_UART_FLAG_STDIO;
+    avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT),
+                            uart_byte, out);
+
+    // Inputs idle HIGH (pull-ups): button PB2 (D10), INTA PB4 (D12), coin PC0 (A0)
+    ButtonScript script;
+    script.button = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 2);
+    script.pressed = false;
+    script.next_us = BOOT_US;
+    avr_raise_irq(script.button, 1);
+    avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 4), 1);
+    avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('C'), 0), 1);
+    avr_cycle_timer_register(avr, avr_usec_to_cycles(avr, BOOT_US), button_step, &script);
+
+    avr_cycle_count_t end = avr_usec_to_cycles(avr, seconds * 1000000u);
+    int state = cpu_Running;
+    while (avr->cycle < end && state != cpu_Done && state != cpu_Crashed) {
+        state = avr_run(avr);
+    }
+    long bytes = ftell(out);
+    fclose(out);
+    if (state == cpu_Done || state == cpu_Crashed) {
+        fprintf(stderr, "firmware stopped after %.3f s\n", avr->cycle / (double)hz);
+        return 1;
+    }
+    printf("%s: %u s at %u Hz, %ld bytes\n", argv[2], seconds, hz, bytes);
+    return 0;
+}
@@ -0,0 +1,409 @@
+/******************************************************************************
+ * SNAPSHOT_RUN.CPP - Carry On From a Cabinet's Snapshot (Host Simulator)
+ *
+ * Usage:
+ *   snapshot-run SNAPSHOT [--eeprom FILE] [--seconds N] [--press MS,MS,...]
+ *   snapshot-run --size
+ *   snapshot-run --check [--seconds N] [--seed S]
+ *   snapshot-run --take MS FILE [--seed S]
+ *
+ * SNAPSHOT is what a SNAPSHOT_DUMP firmware sent (include/snapshot.h). The
+ * tool powers on a board with a fresh EEPROM, or the cabinet's if read out
+ * separately (--eeprom, raw bytes from address 0), loads the snapshot with
+ * game_snapshot_load() and runs N seconds (default 10) from there. The
+ * board's clock starts at the cabinet's millis() when the snapshot was
+ * taken: a few things are seeded from the clock (effects.h SPARKLE, a game
+ * mode's RULE_RND), and they then come out as they did on the cabinet.
+ * --press holds the button for 80 ms at each time given, in ms after the
+ * snapshot.
+ * It prints what the snapshot says, then every state change with the LCD.
+ *
+ * --size prints the bytes a snapshot takes and the layout hash, for the
+ * capture command line and for telling firmwares apart.
+ *
+ * --take writes a snapshot without a cabinet: --check's session, stopped at
+ * MS (or the first ms after it with the button up), into FILE, and the
+ * EEPROM into FILE.eeprom for --eeprom.
+ *
+ * CHECKING THE ROUND TRIP (--check):
+ * Plays an N-second session (default 120) with a seeded button script,
+ * takes a snapshot and a copy of the EEPROM every SNAPSHOT_EVERY_MS, and
+ * logs what the board shows after every ms. Then, for each snapshot, powers
+ * on a board with that EEPROM, loads the snapshot, plays the same button
+ * script and compares against the log for CHECK_MS: state, position, score,
+ * LCD and LEDs from the first loop(). Every other snapshot is loaded on a
+ * clock CLOCK_SHIFT_MS away from the cabinet's instead, so every age is
+ * really converted; those skip the LEDs, which a SPARKLE seeded from the
+ * other clock lights differently. Exits with status 1 on the first
+ * difference.
+ *
+ * Snapshots are only taken with the button up: the simulated button is not
+ * board state (sim.h), so the loading board couldn't be holding it without
+ * a press edge the cabinet never saw.
+ ******************************************************************************/
+
+#include "sim.h"
+#include "game.h"
+#include "hardware.h"
+#include "trace_records.h"           // state_names
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static const uint32_t PRESS_HOLD_MS = 80;
+static const uint32_t SNAPSHOT_EVERY_MS = 1733;  // Lands in every state over a session
+static const uint32_t CHECK_MS = 6000;           // Compared after each load
+static const uint32_t CLOCK_SHIFT_MS = 123457;   // Odd snapshots: another clock
+
+typedef struct {
+    uint32_t from;
+    uint32_t until;
+} Press;
+
+typedef struct {
+    uint8_t state;
+    uint8_t position;
+    uint16_t score;
+    uint8_t leds;
+    char lcd[LCD_ROWS][LCD_COLS];
+} Seen;
+
+static uint32_t xorshift32(uint32_t *s) {
+    uint32_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *s = x;
+    return x;
+}
+
+static void buffer_write(const void *data, uint16_t size, void *context) {
+    std::vector<uint8_t> *buffer = (std::vector<uint8_t> *)context;
+    buffer->insert(buffer->end(), (const uint8_t *)data, (const uint8_t *)data + size);
+}
+
+static bool pressed_at(const std::vector<Press> &presses, uint32_t t) {
+    for (size_t i = 0; i < presses.size(); i++) {
+        if (t >= presses[i].from && t < presses[i].until) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void look(Seen *seen) {
+    GameStatus gs;
+    game_get_status(&gs);
+    seen->state = (uint8_t)gs.state;
+    seen->position = gs.position;
+    seen->score = gs.score;
+    seen->leds = sim_leds();
+    for (uint8_t row = 0; row < LCD_ROWS; row++) {
+        memcpy(seen->lcd[row], sim_lcd_row(row), LCD_COLS);
+    }
+}
+
+static const char *load_error(uint8_t error) {
+    switch (error) {
+    case SNAPSHOT_BAD_MAGIC:   return "not a snapshot";
+    case SNAPSHOT_BAD_VERSION: return "another SNAPSHOT_VERSION";
+    case SNAPSHOT_BAD_LAYOUT:  return "another firmware's layout (hash differs)";
+    case SNAPSHOT_BAD_SIZE:    return "truncated";
+    case SNAPSHOT_BAD_STATE:   return "no such game state";
+    default:                   return "ok";
+    }
+}
+
+/**
+ * load - Board at @now with @eeprom (NULL: erased), then the snapshot
+ * @return: false (and why) if the snapshot was refused
+ */
+static bool load(const std::vector<uint8_t> &snapshot, const std::vector<uint8_t> *eeprom,
+                 uint32_t now) {
+    sim_eeprom_erase();
+    if (eeprom != NULL) {
+        memcpy(sim_eeprom(), eeprom->data(), eeprom->size());
+    }
+    sim_set_button(false);
+    sim_power_on(now);
+    sim_clock_sync();            // Neither setup() nor the load took the cabinet's time
+    uint8_t error = game_snapshot_load(snapshot.data(), (uint16_t)snapshot.size());
+    sim_clock_sync();
+    if (error != SNAPSHOT_OK) {
+        printf("FAIL: snapshot refused: %s\n", load_error(error));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * bot_script - Presses for a session: start from attract, then a seeded mix
+ */
+static std::vector<Press> bot_script(uint32_t seconds, uint32_t seed) {
+    std::vector<Press> presses;
+    uint32_t rng = seed * 2654435761u + 0x9E3779B9u;
+    uint32_t t = 1500;
+    while (t < seconds * 1000u) {
+        uint32_t hold = 50 + xorshift32(&rng) % 100;
+        Press press = {t, t + hold};
+        presses.push_back(press);
+        t += hold + 150 + xorshift32(&rng) % 2200;
+    }
+    return presses;
+}
+
+/**
+ * write_file - @size bytes to @path; false (and why) if that failed
+ */
+static bool write_file(const char *path, const uint8_t *data, size_t size) {
+    FILE *out = fopen(path, "wb");
+    if (out == NULL || fwrite(data, 1, size, out) != size) {
+        perror(path);
+        if (out != NULL) {
+            fclose(out);
+        }
+        return false;
+    }
+    fclose(out);
+    return true;
+}
+
+static int take(uint32_t at, const char *path, uint32_t seed) {
+    std::vector<Press> presses = bot_script(at / 1000u + 1, seed);
+    sim_eeprom_erase();
+    sim_set_button(false);
+    sim_power_on(0);
+    bool button = false;
+    while (sim_millis() < at || pressed_at(presses, sim_millis())) {
+        if (pressed_at(presses, sim_millis()) != button) {
+            button = !button;
+            sim_set_button(button);
+        }
+        sim_tick();
+    }
+
+    std::vector<uint8_t> snapshot;
+    game_snapshot_write(buffer_write, &snapshot);
+    char eeprom_path[256];
+    snprintf(eeprom_path, sizeof(eeprom_path), "%s.eeprom", path);
+    if (!write_file(path, snapshot.data(), snapshot.size()) ||
+        !write_file(eeprom_path, sim_eeprom(), SIM_EEPROM_SIZE)) {
+        return 2;
+    }
+    GameStatus gs;
+    game_get_status(&gs);
+    printf("%s: %u bytes at %u ms (%s), %s: %u bytes\n", path, (unsigned)snapshot.size(),
+           sim_millis(), state_names[gs.state], eeprom_path, SIM_EEPROM_SIZE);
+    return 0;
+}
+
+static int check(uint32_t seconds, uint32_t seed) {
+    std::vector<Press> presses = bot_script(seconds, seed);
+    uint32_t end = seconds * 1000u;
+
+    // The session: a snapshot every SNAPSHOT_EVERY_MS, and what each ms showed
+    std::vector<Seen> log(end + CHECK_MS + 1);
+    std::vector<std::vector<uint8_t> > snapshots;
+    std::vector<std::vector<uint8_t> > eeproms;
+    std::vector<uint32_t> taken;
+    sim_eeprom_erase();
+    sim_set_button(false);
+    sim_power_on(0);
+    bool button = false;
+    uint32_t next_snapshot = SNAPSHOT_EVERY_MS;
+    while (sim_millis() <= end + CHECK_MS) {
+        uint32_t now = sim_millis();
+        if (now >= next_snapshot && now <= end && !pressed_at(presses, now)) {
+            std::vector<uint8_t> snapshot;
+            game_snapshot_write(buffer_write, &snapshot);
+            snapshots.push_back(snapshot);
+            eeproms.push_back(std::vector<uint8_t>(sim_eeprom(), sim_eeprom() + SIM_EEPROM_SIZE));
+            taken.push_back(now);
+            next_snapshot += SNAPSHOT_EVERY_MS;
+        }
+        if (pressed_at(presses, now) != button) {
+            button = !button;
+            sim_set_button(button);
+        }
+        sim_tick();
+        look(&log[now]);
+    }
+
+    uint32_t states = 0;
+    for (size_t n = 0; n < snapshots.size(); n++) {
+        if (snapshots[n].size() != SNAPSHOT_SIZE) {
+            printf("FAIL: snapshot at %u ms is %u bytes, not %u\n",
+                   taken[n], (unsigned)snapshots[n].size(), SNAPSHOT_SIZE);
+            return 1;
+        }
+        bool shifted = (n % 2) != 0;
+        if (!load(snapshots[n], &eeproms[n], taken[n] + (shifted ? CLOCK_SHIFT_MS : 0))) {
+            return 1;
+        }
+        states |= 1u << log[taken[n]].state;
+        button = false;
+        for (uint32_t r = 0; r < CHECK_MS; r++) {
+            uint32_t t = taken[n] + r;
+            if (pressed_at(presses, t) != button) {
+                button = !button;
+                sim_set_button(button);
+            }
+            sim_tick();
+            Seen seen;
+            look(&seen);
+            const Seen &want = log[t];
+            if (shifted) {
+                seen.leds = want.leds;
+            }
+            if (seen.state != want.state || seen.position != want.position ||
+                seen.score != want.score || seen.leds != want.leds ||
+                memcmp(seen.lcd, want.lcd, sizeof(seen.lcd)) != 0) {
+                printf("FAIL: snapshot at %u ms (%s), %u ms after loading:\n",
+                       taken[n], state_names[log[taken[n]].state], r);
+                printf("  session: %-12s pos %u score %u leds %02X  [%.*s]\n",
+                       state_names[want.state], want.position, want.score, want.leds,
+                       LCD_COLS, want.lcd[0]);
+                printf("  loaded:  %-12s pos %u score %u leds %02X  [%.*s]\n",
+                       state_names[seen.state], seen.position, seen.score, seen.leds,
+                       LCD_COLS, seen.lcd[0]);
+                return 1;
+            }
+        }
+    }
+
+    printf("%u snapshots of %u bytes, layout %08X, states:", (unsigned)snapshots.size(),
+           SNAPSHOT_SIZE, SNAPSHOT_LAYOUT_HASH);
+    for (uint8_t s = 0; s < 32; s++) {
+        if (states & (1u << s)) {
+            printf(" %s", state_names[s]);
+        }
+    }
+    printf("\n");
+    printf("OK: every snapshot carried on exactly as the session did for %u ms\n", CHECK_MS);
+    return 0;
+}
+
+static void print_lcd(void) {
+    for (uint8_t row = 0; row < LCD_ROWS; row++) {
+        printf("    |%.*s|\n", LCD_COLS, sim_lcd_row(row));
+    }
+}
+
+/**
+ * read_file - Up to @limit bytes of @path into @data; false if it won't open
+ */
+static bool read_file(const char *path, size_t limit, std::vector<uint8_t> *data) {
+    FILE *in = fopen(path, "rb");
+    if (in == NULL) {
+        perror(path);
+        return false;
+    }
+    data->resize(limit);
+    data->resize(fread(data->data(), 1, limit, in));
+    fclose(in);
+    return true;
+}
+
+static int run(const char *path, const char *eeprom_path, uint32_t seconds,
+               const std::vector<Press> &presses) {
+    std::vector<uint8_t> snapshot;
+    std::vector<uint8_t> eeprom;
+    if (!read_file(path, SNAPSHOT_SIZE + 1, &snapshot) ||
+        (eeprom_path != NULL && !read_file(eeprom_path, SIM_EEPROM_SIZE, &eeprom))) {
+        return 2;
+    }
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(&header, snapshot.data(), snapshot.size() < sizeof(header) ? snapshot.size() : sizeof(header));
+    if (!load(snapshot, eeprom_path != NULL ? &eeprom : NULL, header.taken_ms)) {
+        return 1;
+    }
+    GameStatus gs;
+    game_get_status(&gs);
+    printf("taken at %u ms on the cabinet: %s, position %u, score %u, high %u\n",
+           header.taken_ms, state_names[gs.state], gs.position, gs.score, gs.high_score);
+    print_lcd();
+
+    bool button = false;
+    GameState seen = gs.state;
+    while (sim_millis() - header.taken_ms < seconds * 1000u) {
+        uint32_t now = sim_millis() - header.taken_ms;   // ms since the snapshot
+        if (pressed_at(presses, now) != button) {
+            button = !button;
+            sim_set_button(button);
+            printf("+%6u ms  button %s\n", now, button ? "down" : "up");
+        }
+        sim_tick();
+        game_get_status(&gs);
+        if (gs.state != seen) {
+            seen = gs.state;
+            printf("+%6u ms  -> %s  position %u score %u\n", now, state_names[gs.state],
+                   gs.position, gs.score);
+            print_lcd();
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *path = NULL;
+    const char *eeprom_path = NULL;
+    bool do_check = false;
+    const char *take_path = NULL;
+    uint32_t take_at = 0;
+    uint32_t seconds = 0;
+    uint32_t seed = 1;
+    std::vector<Press> presses;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--size") == 0) {
+            printf("%u bytes, layout %08X, version %u\n",
+                   SNAPSHOT_SIZE, SNAPSHOT_LAYOUT_HASH, SNAPSHOT_VERSION);
+            return 0;
+        } else if (strcmp(argv[i], "--check") == 0) {
+            do_check = true;
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--take") == 0 && i + 2 < argc) {
+            take_at = (uint32_t)strtoul(argv[++i], NULL, 0);
+            take_path = argv[++i];
+        } else if (strcmp(argv[i], "--eeprom") == 0 && i + 1 < argc) {
+            eeprom_path = argv[++i];
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--press") == 0 && i + 1 < argc) {
+            for (char *p = argv[++i]; *p != '\0';) {
+                uint32_t at = (uint32_t)strtoul(p, &p, 0);
+                Press press = {at, at + PRESS_HOLD_MS};
+                presses.push_back(press);
+                if (*p == ',') {
+                    p++;
+                } else if (*p != '\0') {
+                    break;
+                }
+            }
+        } else if (argv[i][0] != '-' && path == NULL) {
+            path = argv[i];
+        } else {
+            path = NULL;
+            do_check = false;
+            break;
+        }
+    }
+
+    if (take_path != NULL) {
+        return take(take_at, take_path, seed);
+    }
+    if (do_check) {
+        return check(seconds != 0 ? seconds : 120, seed);
+    }
+    if (path == NULL) {
+        fprintf(stderr, "usage: %s SNAPSHOT [--eeprom FILE] [--seconds N] [--press MS,...]\n"
+                        "       %s --size\n"
+                        "       %s --check [--seconds N] [--seed S]\n"
+                        "       %s --take MS FILE [--seed S]\n",
+                argv[0], argv[0], argv[0], argv[0]);
+        return 2;
+    }
+    return run(path, eeprom_path, seconds != 0 ? seconds : 10, presses);
+}
@@ -0,0 +1,298 @@
+/******************************************************************************
+ * TRACE_EXPORT.CPP - Trace Record Stream to Chrome Trace Event JSON
+ *
+ * Usage:
+ *   trace-export convert RECORDS [OUT.json]
+ *   trace-export sim OUT.json [--seconds N] [--seed S]
+ *   trace-export diff RECORDS_A RECORDS_B [--tolerance-us N]
+ *
+ * CONVERT:
+ * Reads a raw record stream (see trace.h) captured from the board's serial
+ * port or from simavr's UART, and writes JSON for chrome://tracing or
+ * ui.perfetto.dev (stdout if OUT.json is omitted). Garbage before the first
+ * record or after a dropped byte is skipped by resynchronising on
+ * TRACE_SYNC.
+ *
+ * SIM:
+ * Plays a bot session in the host simulator with tracing on and converts
+ * the result directly, so a timeline is one command away without hardware.
+ *
+ * DIFF:
+ * Checks that two captures have the same output timing, e.g. the same
+ * firmware at 16 MHz and at 8 MHz (tools/simavr_trace.cpp records both).
+ * Only what a player sees or hears is compared: state transitions, chase
+ * and LED steps, notes, tones and the start of each display update. They
+ * must come in the same order with the same arguments, and at the same time
+ * (counted from the first one) within --tolerance-us, by default one
+ * millis() step. CPU-bound timing (how long game_update or an I2C transfer
+ * takes) is expected to differ with the clock and is not compared. Exits
+ * with status 1 on a difference.
+ *
+ * OUTPUT:
+ * One timeline row ("thread") per track in TRACE_EVENTS. Names include the
+ * record's argument decoded where it has a meaning: the new state for
+ * transitions, which display_show_* call for I2C spans. Decoding, the
+ * micros() unwrapping and the choice of output records are in
+ * sim/trace_records.h, shared with fidelity_check.cpp.
+ ******************************************************************************/
+
+#include "sim.h"
+#include "game.h"
+#include "hardware.h"
+#include "trace.h"
+#include "trace_records.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static uint32_t xorshift32(uint32_t *s) {
+    uint32_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *s = x;
+    return x;
+}
+
+/******************************************************************************
+ * RECORD STREAM
+ ******************************************************************************/
+
+/**
+ * read_file - Whole file into @data
+ * @return: false (after printing why) if it can't be read
+ */
+static bool read_file(const char *path, std::vector<uint8_t> *data) {
+    FILE *in = fopen(path, "rb");
+    if (in == NULL) {
+        perror(path);
+        return false;
+    }
+    uint8_t buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        data->insert(data->end(), buffer, buffer + n);
+    }
+    fclose(in);
+    return true;
+}
+
+/******************************************************************************
+ * CONVERT
+ ******************************************************************************/
+
+/**
+ * track_id - Timeline row of an event: the first event id on the same track
+ */
+static uint8_t track_id(uint8_t event) {
+    for (uint8_t e = 0; e < event; e++) {
+        if (strcmp(event_info[e].track, event_info[event].track) == 0) {
+            return e;
+        }
+    }
+    return event;
+}
+
+/**
+ * write_json - Convert @size bytes of records to Chrome Trace Event JSON
+ * @return: number of records converted
+ */
+static uint32_t write_json(const uint8_t *data, size_t size, FILE *out) {
+    std::vector<Record> records;
+    parse_records(data, size, &records);
+
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(out, "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"light-chaser\"}}");
+    for (uint8_t e = 0; e < TRACE_EVENT_COUNT; e++) {
+        if (track_id(e) == e) {
+            fprintf(out, ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\","
+                         "\"args\":{\"name\":\"%s\"}}", e, event_info[e].track);
+            fprintf(out, ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_sort_index\","
+                         "\"args\":{\"sort_index\":%u}}", e, e);
+        }
+    }
+
+    for (size_t i = 0; i < records.size(); i++) {
+        const Record *r = &records[i];
+        char name[64];
+        event_name(r->event, r->arg, name, sizeof(name));
+        fprintf(out, ",\n{\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%llu,\"name\":\"%s\"",
+                r->phase, track_id(r->event), (unsigned long long)r->time, name);
+        if (r->phase == 'i') {
+            fprintf(out, ",\"s\":\"t\"");
+        }
+        fprintf(out, ",\"args\":{\"arg\":%u}}", r->arg);
+    }
+    fprintf(out, "\n]}\n");
+    return (uint32_t)records.size();
+}
+
+static int run_convert(const char *in_path, const char *out_path) {
+    std::vector<uint8_t> data;
+    if (!read_file(in_path, &data)) {
+        return 2;
+    }
+
+    FILE *out = out_path != NULL ? fopen(out_path, "w") : stdout;
+    if (out == NULL) {
+        perror(out_path);
+        return 2;
+    }
+    uint32_t records = write_json(data.data(), data.size(), out);
+    if (out != stdout) {
+        fclose(out);
+    }
+    fprintf(stderr, "%u records\n", records);
+    return 0;
+}
+
+/******************************************************************************
+ * SIM
+ ******************************************************************************/
+
+/**
+ * bot_session - Play @seconds of the game with a reactive bot (same bot as
+ * replay_corpus: presses in the target zone with a fixed per-tick chance)
+ */
+static void bot_session(uint32_t seconds, uint32_t seed) {
+    uint32_t rng = seed * 2654435761u + 0x9E3779B9u;
+    bool pressed = false;
+    uint32_t release_at = 0;
+    while (sim_millis() < seconds * 1000u) {
+        uint32_t now = sim_millis();
+        if (pressed) {
+            if (now >= release_at) {
+                pressed = false;
+                sim_set_button(false);
+            }
+        } else {
+            GameStatus gs;
+            game_get_status(&gs);
+            uint32_t chance = 0;
+            if (gs.state == STATE_PLAYING) {
+                bool in_zone = gs.position >= TARGET_ZONE_START && gs.position <= TARGET_ZONE_END;
+                chance = in_zone ? 40 : 1;
+            } else if (gs.state == STATE_ATTRACT) {
+                chance = 1;
+            }
+            if (xorshift32(&rng) % 1000 < chance) {
+                pressed = true;
+                release_at = now + 50 + xorshift32(&rng) % 100;
+                sim_set_button(true);
+            }
+        }
+        sim_tick();
+    }
+}
+
+static int run_sim(const char *out_path, uint32_t seconds, uint32_t seed) {
+    FILE *capture = tmpfile();
+    if (capture == NULL) {
+        perror("tmpfile");
+        return 2;
+    }
+    sim_serial_capture(capture);
+    sim_eeprom_erase();
+    sim_set_button(false);
+    trace_init();
+    sim_power_on(0);
+    bot_session(seconds, seed);
+    sim_serial_capture(NULL);
+
+    std::vector<uint8_t> data((size_t)ftell(capture));
+    rewind(capture);
+    size_t got = fread(data.data(), 1, data.size(), capture);
+    fclose(capture);
+
+    FILE *out = fopen(out_path, "w");
+    if (out == NULL) {
+        perror(out_path);
+        return 2;
+    }
+    uint32_t records = write_json(data.data(), got, out);
+    fclose(out);
+    printf("%s: %u s simulated, %u records (%zu bytes on the wire)\n",
+           out_path, seconds, records, got);
+    return 0;
+}
+
+/******************************************************************************
+ * DIFF
+ ******************************************************************************/
+
+static int run_diff(const char *path_a, const char *path_b, uint32_t tolerance_us) {
+    std::vector<uint8_t> data_a, data_b;
+    if (!read_file(path_a, &data_a) || !read_file(path_b, &data_b)) {
+        return 2;
+    }
+    std::vector<Record> a, b;
+    output_records(data_a, &a);
+    output_records(data_b, &b);
+    if (a.empty() || b.empty()) {
+        fprintf(stderr, "no output records to compare\n");
+        return 2;
+    }
+
+    // Both captures are compared up to the shorter one's last record
+    size_t count = a.size() < b.size() ? a.size() : b.size();
+    uint64_t worst = 0;
+    for (size_t i = 0; i < count; i++) {
+        char name_a[64], name_b[64];
+        event_name(a[i].event, a[i].arg, name_a, sizeof(name_a));
+        event_name(b[i].event, b[i].arg, name_b, sizeof(name_b));
+        uint64_t time_a = a[i].time - a[0].time;
+        uint64_t time_b = b[i].time - b[0].time;
+        uint64_t delta = time_a > time_b ? time_a - time_b : time_b - time_a;
+        if (a[i].event != b[i].event || a[i].arg != b[i].arg) {
+            printf("FAIL: output %zu differs: %s at %llu us vs %s at %llu us\n", i,
+                   name_a, (unsigned long long)time_a, name_b, (unsigned long long)time_b);
+            return 1;
+        }
+        if (delta > tolerance_us) {
+            printf("FAIL: output %zu (%s) at %llu us vs %llu us\n", i, name_a,
+                   (unsigned long long)time_a, (unsigned long long)time_b);
+            return 1;
+        }
+        if (delta > worst) {
+            worst = delta;
+        }
+    }
+    printf("OK: %zu output records match (%zu / %zu captured), max time difference %llu us\n",
+           count, a.size(), b.size(), (unsigned long long)worst);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 3 && strcmp(argv[1], "convert") == 0) {
+        return run_convert(argv[2], argc >= 4 ? argv[3] : NULL);
+    }
+    if (argc >= 4 && strcmp(argv[1], "diff") == 0) {
+        uint32_t tolerance_us = 1000;
+        if (argc >= 6 && strcmp(argv[4], "--tolerance-us") == 0) {
+            tolerance_us = (uint32_t)strtoul(argv[5], NULL, 0);
+        }
+        return run_diff(argv[2], argv[3], tolerance_us);
+    }
+    if (argc < 3 || strcmp(argv[1], "sim") != 0) {
+        fprintf(stderr, "usage: %s convert RECORDS [OUT.json]\n"
+                        "       %s sim OUT.json [--seconds N] [--seed S]\n"
+                        "       %s diff RECORDS_A RECORDS_B [--tolerance-us N]\n",
+                argv[0], argv[0], argv[0]);
+        return 2;
+    }
+    uint32_t seconds = 60;
+    uint32_t seed = 1;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        uint32_t value = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+        if (strcmp(argv[i], "--seconds") == 0) {
+            seconds = value;
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            seed = value;
+        } else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+    return run_sim(argv[2], seconds, seed);
+}
@@ -0,0 +1,144 @@
+/******************************************************************************
+ * TRACE_RECORDS.H - Reading a Trace Record Stream Back (Host Tools)
+ *
+ * trace.h defines the 8-byte records the firmware sends; this is the other
+ * end. A captured stream (serial port, simavr's UART, the host simulator's
+ * Serial file) is decoded into Records with their micros() unwrapped, and
+ * the records that mark what a player sees or hears can be picked out for
+ * comparing two runs.
+ *
+ * Garbage before the first record or after a dropped byte is skipped by
+ * resynchronising on TRACE_SYNC. micros() wraps every ~71 minutes on the
+ * board; parse_records() counts the wraps so long captures stay in order.
+ *
+ * Host tools only (std::vector): sim/tools/trace_export.cpp (JSON, diff),
+ * sim/tools/fidelity_check.cpp (host simulator against simavr) and
+ * sim/tools/cycle_profile.cpp (predicted loop() time against simavr).
+ ******************************************************************************/
+
+#ifndef SIM_TRACE_RECORDS_H
+#define SIM_TRACE_RECORDS_H
+
+#include "trace.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+typedef struct {
+    const char *name;
+    const char *track;
+} TraceEventInfo;
+
+#define TRACE_EVENT_INFO(id, name, track, elide) {name, track},
+static const TraceEventInfo event_info[TRACE_EVENT_COUNT] = {
+    TRACE_EVENTS(TRACE_EVENT_INFO)
+};
+#undef TRACE_EVENT_INFO
+
+static const char *const state_names[] = {
+    "ATTRACT", "PLAYING", "RESULT", "CELEBRATION", "GAME_OVER", "CALIBRATION", "SELF_TEST"
+};
+
+static const char *const display_names[] = {
+    "display_show_attract", "display_show_game", "display_show_celebration", "display_clear",
+    "display_show_calibration", "display_show_post", "display_service",
+    "display_show_ghost"
+};
+
+static const char *const isr_names[] = {
+    "TIMER1_COMPA_vect", "PCINT0_vect", "PCINT1_vect"
+};
+
+typedef struct {
+    uint8_t event;
+    char phase;
+    uint8_t arg;
+    uint64_t time;               // µs, unwrapped
+} Record;
+
+/**
+ * parse_records - Decode @size bytes of raw records into @records
+ */
+static inline void parse_records(const uint8_t *data, size_t size, std::vector<Record> *records) {
+    uint32_t skipped = 0;
+    uint64_t epoch = 0;          // Added to micros() to undo 32-bit wraparound
+    uint32_t last_time = 0;
+    size_t i = 0;
+    while (i + TRACE_RECORD_SIZE <= size) {
+        const uint8_t *r = data + i;
+        char phase = (char)r[2];
+        if (r[0] != TRACE_SYNC || r[1] >= TRACE_EVENT_COUNT ||
+            (phase != 'B' && phase != 'E' && phase != 'i')) {
+            i++;
+            skipped++;
+            continue;
+        }
+        uint32_t time = r[4] | (r[5] << 8) | (r[6] << 16) | ((uint32_t)r[7] << 24);
+        if (!records->empty() && time < last_time && last_time - time > 0x80000000u) {
+            epoch += 0x100000000ull;
+        }
+        last_time = time;
+        records->push_back({r[1], phase, r[3], epoch + time});
+        i += TRACE_RECORD_SIZE;
+    }
+    if (skipped > 0) {
+        fprintf(stderr, "skipped %u bytes while resynchronising\n", skipped);
+    }
+}
+
+/**
+ * event_name - Display name of one record, with its argument decoded
+ */
+static inline void event_name(uint8_t event, uint8_t arg, char *out, size_t size) {
+    const char *name = event_info[event].name;
+    if ((event == TRACE_TRANSITION || event == TRACE_STATE_UPDATE) &&
+        arg < sizeof(state_names) / sizeof(state_names[0])) {
+        snprintf(out, size, "%s(%s)", name, state_names[arg]);
+    } else if (event == TRACE_DISPLAY && arg < sizeof(display_names) / sizeof(display_names[0])) {
+        snprintf(out, size, "%s", display_names[arg]);
+    } else if (event == TRACE_ISR && arg < sizeof(isr_names) / sizeof(isr_names[0])) {
+        snprintf(out, size, "%s", isr_names[arg]);
+    } else if (event == TRACE_GAME_UPDATE || event == TRACE_ANIMATION_UPDATE ||
+               event == TRACE_EXPANDER_READ) {
+        snprintf(out, size, "%s", name);
+    } else {
+        snprintf(out, size, "%s %u", name, arg);
+    }
+}
+
+/**
+ * is_output - Does this record mark something the player sees or hears?
+ *
+ * Instants, and the start of display spans: a span's end depends on how
+ * fast the CPU works through it. display_service() spans are left out too:
+ * how many loop()s a screen takes to send is bus timing, not game output.
+ */
+static inline bool is_output(const Record *r) {
+    switch (r->event) {
+        case TRACE_TRANSITION:
+        case TRACE_CHASE_STEP:
+        case TRACE_ANIM_NOTE:
+        case TRACE_ANIM_LEDS:
+        case TRACE_TONE:
+            return r->phase == 'i';
+        case TRACE_DISPLAY:
+            return r->phase == 'B' && r->arg != TRACE_DISPLAY_FLUSH;
+        default:
+            return false;
+    }
+}
+
+/**
+ * output_records - The is_output() records of a raw stream, in order
+ */
+static inline void output_records(const std::vector<uint8_t> &data, std::vector<Record> *out) {
+    std::vector<Record> all;
+    parse_records(data.data(), data.size(), &all);
+    for (size_t i = 0; i < all.size(); i++) {
+        if (is_output(&all[i])) {
+            out->push_back(all[i]);
+        }
+    }
+}
+
+#endif // SIM_TRACE_RECORDS_H
@@ -0,0 +1,497 @@
+/******************************************************************************
+ * TIMEBASE.CPP - Tickless Timekeeping Implementation
+ *
+ * Firmware only (uses AVR timer registers directly); the host simulator has
+ * its own virtual clock and provides timebase_micros() in sim.cpp.
+ *
+ * TIMER USE:
+ * - Timer0: left running for PWM, overflow interrupt switched off
+ * - Timer1: free-running at F_CPU/256, compare A = next deadline
+ * - Timer2: tone(); borrowed for the latency probe in stats builds only
+ * These claims are registered in resources.h, which also stops a stats
+ * build with tracing (both want Serial).
+ *
+ * The ATtiny85 build (BOARD_TINY85) keeps the core's Timer0 tick instead:
+ * see its section below.
+ *
+ * PIN CHANGES:
+ * PCINT0_vect stamps each button and INTA change (timebase_pin_change_us())
+ * and passes the button level with its time to button_edge(), which
+ * debounces it there and then (debounce.h).
+ *
+ * In tracing builds each ISR notes its entry (TRACE_ISR_ENTER) and
+ * timebase_sync() sends the notes from main context (trace.h, INTERRUPTS).
+ *
+ * EXTENDING A 16-BIT COUNTER:
+ * advance() adds (TCNT1 - last_count) to the running totals, with 16-bit
+ * unsigned subtraction so one wrap between reads is handled. Reads are
+ * never more than TIMEBASE_MAX_SLEEP_MS + one loop() apart, well under the
+ * wrap time (1.05 s at 16 MHz, 2.1 s at 8 MHz), so no overflow interrupt is
+ * needed.
+ *
+ * Related files:
+ * - timebase.h: Overview, API and how to measure
+ ******************************************************************************/
+
+#include "timebase.h"
+#include "config.h"
+#include "clocks.h"
+#include "hardware.h"
+#include "trace.h"
+#include <avr/sleep.h>
+#ifdef BOARD_HAS_I2C
+#include <Wire.h>
+#endif
+
+#if defined(BOARD_TINY85)
+/*
+ * ATtiny85: Timer1 plays the notes, so there is no second timer to keep
+ * time with. The core's Timer0 tick stays in charge of millis() (one
+ * interrupt per 2.048 ms at 8 MHz), and timebase_sleep() idles between
+ * ticks until the deadline or a button edge. The button is on PCINT3;
+ * PCINT0_vect is the chip's only pin-change vector.
+ */
+static_assert(BUTTON_PIN == 3, "The button must be on PB3 (PCINT3)");
+
+static volatile bool woken = false;
+static volatile uint32_t pin_change_us = 0;
+
+ISR(PCINT0_vect) {
+    uint32_t now = micros();  // Safe in an ISR (reads the tick count with cli())
+    TRACE_ISR_ENTER(TRACE_ISR_PCINT0);
+    pin_change_us = now;
+    woken = true;
+    button_edge(now, !digitalRead(BUTTON_PIN));
+}
+
+void timebase_init(void) {
+    uint8_t sreg = SREG;
+    cli();
+    PCMSK |= _BV(BUTTON_PIN);
+    GIFR = _BV(PCIF);
+    GIMSK |= _BV(PCIE);
+    SREG = sreg;
+}
+
+void timebase_sync(void) {
+    woken = false;  // Before game_update() looks at the button
+    TRACE_ISR_FLUSH();
+}
+
+void timebase_sleep(uint32_t ms) {
+    if (ms > TIMEBASE_MAX_SLEEP_MS) {
+        ms = TIMEBASE_MAX_SLEEP_MS;
+    }
+    // Each tick wakes the CPU; go back to sleep until the deadline. As on
+    // the Uno, sei() runs sleep_cpu() before any interrupt, so a button
+    // edge between the check and the sleep ends that sleep at once.
+    uint32_t start = millis();
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    cli();
+    while (!woken && millis() - start < ms) {
+        sleep_enable();
+        sei();
+        sleep_cpu();
+        sleep_disable();
+        cli();
+    }
+    sei();
+}
+
+uint32_t timebase_micros(void) {
+    return micros();
+}
+
+uint32_t timebase_pin_change_us(void) {
+    uint8_t sreg = SREG;
+    cli();
+    uint32_t stamp = pin_change_us;
+    SREG = sreg;
+    return stamp;
+}
+
+uint32_t timebase_isr_micros(void) {
+    return micros();
+}
+
+void timebase_wake(void) {
+    woken = true;
+}
+
+#else // ATmega328P
+
+// Defined by the Arduino core (wiring.c), updated by its Timer0 ISR
+extern volatile unsigned long timer0_millis;
+extern volatile unsigned long timer0_overflow_count;
+
+static const uint16_t TIMER1_PRESCALER = 256;
+static const uint32_t TICK_US = TIMER1_PRESCALER * 1000000UL / F_CPU;  // 16 at 16 MHz
+
+static_assert(TIMER1_PRESCALER * 1000000UL % F_CPU == 0,
+              "F_CPU must give a whole number of µs per Timer1 count");
+static_assert(TIMEBASE_MAX_SLEEP_MS * 1000UL / TICK_US < 32768,
+              "A sleep must fit in half the Timer1 range (signed deadline check)");
+#ifdef TIMEBASE_STATS
+static_assert(uart_error_permille(TIMEBASE_STATS_BAUD) <= UART_MAX_ERROR_PERMILLE,
+              "TIMEBASE_STATS_BAUD is too far off at this F_CPU");
+#endif
+
+// The button and the expander's INTA wake the CPU through their pin-change
+// group; the ISR below is PCINT0_vect, which covers D8-D13 on the Uno
+static_assert(digitalPinToPCICRbit(BUTTON_PIN) == 0, "Button must be on PCINT0 (D8-D13)");
+static_assert(digitalPinToPCICRbit(EXPANDER_INT_PIN) == 0, "INTA must be on PCINT0 (D8-D13)");
+
+#ifdef TIMEBASE_STATS
+static volatile uint16_t wake_count = 0;  // Timebase interrupts since boot
+#endif
+
+#ifndef TIMEBASE_TIMER0
+
+static volatile bool woken = false;       // Set by the wake interrupts
+static bool started = false;              // timebase_init() has run
+static uint16_t last_count = 0;           // TCNT1 at the last advance()
+static uint32_t now_us = 0;               // µs since boot
+static uint32_t now_ms = 0;               // ms since boot (what millis() shows)
+static uint16_t us_fract = 0;             // µs since now_ms last went up (< 1000)
+static uint16_t sync_count = 0;           // last_count at timebase_sync()
+static uint16_t sync_fract = 0;           // us_fract at timebase_sync()
+static volatile uint16_t pin_change_count = 0;  // TCNT1 at the last wake pin change
+
+/**
+ * advance - Add the Timer1 counts since the last call to the totals
+ *
+ * Main context only (loop() and the trace points it reaches). Runs with
+ * interrupts off: the pin-change ISRs read TCNT1 too (16-bit timer reads
+ * share one TEMP register), and timebase_isr_micros() reads last_count and
+ * now_us, which must never be seen half updated.
+ */
+static void advance(void) {
+    uint8_t sreg = SREG;
+    cli();
+    uint16_t count = TCNT1;
+    uint32_t us = (uint16_t)(count - last_count) * TICK_US;
+    last_count = count;
+    now_us += us;
+    SREG = sreg;
+    uint32_t fract = us_fract + us;
+    now_ms += fract / 1000;
+    us_fract = (uint16_t)(fract % 1000);
+}
+
+ISR(TIMER1_COMPA_vect) {
+    TRACE_ISR_ENTER(TRACE_ISR_TIMER1_COMPA);
+    TIMSK1 &= ~_BV(OCIE1A);  // One shot: re-armed by the next timebase_sleep()
+    woken = true;
+#ifdef TIMEBASE_STATS
+    wake_count++;
+#endif
+}
+
+ISR(PCINT0_vect) {
+    uint16_t count = TCNT1;
+    TRACE_ISR_ENTER(TRACE_ISR_PCINT0);
+    pin_change_count = count;
+    woken = true;
+    // Time the button's edges as they happen (an INTA change is no button edge)
+    button_edge(now_us + (uint16_t)(count - last_count) * TICK_US, !digitalRead(BUTTON_PIN));
+#ifdef TIMEBASE_STATS
+    wake_count++;
+#endif
+}
+
+void timebase_init(void) {
+#ifdef TIMEBASE_STATS
+    Serial.begin(TIMEBASE_STATS_BAUD);
+#endif
+    // Carry on from the core's clock so time never jumps backwards
+    now_ms = millis();
+    now_us = micros();
+
+    uint8_t sreg = SREG;
+    cli();
+    TCCR1A = 0;                // Normal mode, OC1A/OC1B disconnected
+    TCCR1B = _BV(CS12);        // clk/256
+    TCNT1 = 0;
+    TIMSK1 = 0;
+    last_count = 0;
+    TIMSK0 &= ~_BV(TOIE0);     // Stop the 1 kHz millis() tick
+    *digitalPinToPCMSK(BUTTON_PIN) |= _BV(digitalPinToPCMSKbit(BUTTON_PIN));
+    *digitalPinToPCMSK(EXPANDER_INT_PIN) |= _BV(digitalPinToPCMSKbit(EXPANDER_INT_PIN));
+    PCIFR = _BV(digitalPinToPCICRbit(BUTTON_PIN));
+    PCICR |= _BV(digitalPinToPCICRbit(BUTTON_PIN));
+    SREG = sreg;
+    started = true;
+
+#ifdef WIRE_HAS_TIMEOUT
+    // The I2C timeout is measured with micros(), which no longer advances.
+    // A hung bus is still caught: by the watchdog.
+    Wire.setWireTimeout(0);
+#endif
+}
+
+void timebase_sync(void) {
+    woken = false;  // Before game_update() looks at the button
+    advance();
+    sync_count = last_count;
+    sync_fract = us_fract;
+
+    uint8_t sreg = SREG;
+    cli();
+    timer0_millis = now_ms;
+    SREG = sreg;
+
+    // Interrupts since the last loop(), now that Serial may be used
+    TRACE_ISR_FLUSH();
+}
+
+void timebase_sleep(uint32_t ms) {
+    if (ms == 0) {
+        return;
+    }
+    if (ms > TIMEBASE_MAX_SLEEP_MS) {
+        ms = TIMEBASE_MAX_SLEEP_MS;
+    }
+    // millis() reaches (its value at sync) + ms that many µs after the sync,
+    // minus the part of the current millisecond already gone
+    uint32_t us = ms * 1000 - sync_fract;
+    uint16_t deadline = sync_count + (uint16_t)((us + TICK_US - 1) / TICK_US);
+
+    cli();
+    OCR1A = deadline;
+    TIFR1 = _BV(OCF1A);
+    TIMSK1 |= _BV(OCIE1A);
+    if ((int16_t)(deadline - TCNT1) <= 0) {
+        // loop() ran past the deadline already; the match wouldn't come
+        // until the counter wraps
+        TIMSK1 &= ~_BV(OCIE1A);
+        sei();
+        return;
+    }
+
+    // sei() always runs the next instruction before any interrupt, so a
+    // wake that arrives between the check and sleep_cpu() is not lost: it
+    // interrupts the sleep straight away
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    while (!woken) {
+        sleep_enable();
+        sei();
+        sleep_cpu();
+        sleep_disable();
+        cli();
+    }
+    TIMSK1 &= ~_BV(OCIE1A);
+    sei();
+}
+
+uint32_t timebase_micros(void) {
+    if (!started) {
+        return micros();  // Timer0 still in charge (setup())
+    }
+    advance();
+    return now_us;
+}
+
+uint32_t timebase_pin_change_us(void) {
+    if (!started) {
+        return micros();
+    }
+    advance();
+    uint8_t sreg = SREG;
+    cli();
+    uint16_t stamp = pin_change_count;
+    SREG = sreg;
+    return now_us - (uint16_t)(last_count - stamp) * TICK_US;
+}
+
+uint32_t timebase_isr_micros(void) {
+    if (!started) {
+        return micros();
+    }
+    return now_us + (uint16_t)(TCNT1 - last_count) * TICK_US;
+}
+
+void timebase_wake(void) {
+    woken = true;
+}
+
+#else // TIMEBASE_TIMER0: the core's tick stays in charge, loop() never sleeps
+
+void timebase_init(void) {
+#ifdef TIMEBASE_STATS
+    Serial.begin(TIMEBASE_STATS_BAUD);
+#endif
+}
+
+void timebase_sync(void) {
+    TRACE_ISR_FLUSH();  // The coin ISR, if fitted
+}
+
+void timebase_sleep(uint32_t ms) {
+    (void)ms;
+}
+
+uint32_t timebase_micros(void) {
+    return micros();
+}
+
+uint32_t timebase_pin_change_us(void) {
+    return micros();
+}
+
+uint32_t timebase_isr_micros(void) {
+    return micros();  // Safe in an ISR (reads the tick count with cli())
+}
+
+void timebase_wake(void) {
+}
+
+#endif // TIMEBASE_TIMER0
+
+#endif // BOARD_TINY85
+
+/******************************************************************************
+ * STATS (-DTIMEBASE_STATS)
+ *
+ * Alternates two windows while the game sits in ATTRACT:
+ *
+ *   COUNT (5 s): ISR wakeups = Timer0 overflows + timebase interrupts
+ *   PROBE (1 s): Timer2 in CTC mode at F_CPU/8 raises compare B every
+ *                100 µs. The ISR reads TCNT2 first thing: the counts since
+ *                the match are its latency (8 cycles per count).
+ *
+ * With the Timer0 tick, a probe that lands while the tick ISR runs waits for
+ * it, so the latency spreads out. The probe borrows tone()'s timer, which is
+ * silent in ATTRACT; leaving ATTRACT ends the probe and restores Timer2.
+ ******************************************************************************/
+
+#ifdef TIMEBASE_STATS
+
+static const uint16_t STATS_COUNT_MS = 5000;
+static const uint16_t STATS_PROBE_MS = 1000;
+static_assert(F_CPU / 8 / 10000 - 1 <= 255, "Probe period must fit Timer2's 8 bits");
+static const uint8_t PROBE_TOP = F_CPU / 8 / 10000 - 1;  // 100 µs period
+static const uint8_t PROBE_CYCLES_PER_COUNT = 8;
+
+enum StatsPhase { STATS_IDLE, STATS_COUNT, STATS_PROBE };
+
+static StatsPhase stats_phase = STATS_IDLE;
+static uint32_t stats_start = 0;
+static uint32_t stats_wakes_at_start = 0;
+static uint32_t stats_wakes = 0;
+static uint32_t stats_window_ms = 0;
+
+static volatile uint8_t probe_min = 0xFF;
+static volatile uint8_t probe_max = 0;
+static volatile uint16_t probe_samples = 0;
+static uint8_t saved_tccr2a, saved_tccr2b, saved_ocr2a, saved_ocr2b, saved_timsk2;
+
+ISR(TIMER2_COMPB_vect) {
+    uint8_t late = TCNT2;
+    if (late < probe_min) {
+        probe_min = late;
+    }
+    if (late > probe_max) {
+        probe_max = late;
+    }
+    probe_samples++;
+}
+
+static uint32_t total_wakes(void) {
+    uint8_t sreg = SREG;
+    cli();
+    uint32_t wakes = timer0_overflow_count + wake_count;
+    SREG = sreg;
+    return wakes;
+}
+
+static void probe_start(void) {
+    saved_tccr2a = TCCR2A;
+    saved_tccr2b = TCCR2B;
+    saved_ocr2a = OCR2A;
+    saved_ocr2b = OCR2B;
+    saved_timsk2 = TIMSK2;
+
+    cli();
+    probe_min = 0xFF;
+    probe_max = 0;
+    probe_samples = 0;
+    TCCR2B = 0;
+    TCCR2A = _BV(WGM21);       // CTC, TOP = OCR2A
+    TCNT2 = 0;
+    OCR2A = PROBE_TOP;
+    OCR2B = 0;                 // Match as the counter restarts
+    TIFR2 = _BV(OCF2B) | _BV(OCF2A);
+    TIMSK2 = _BV(OCIE2B);
+    TCCR2B = _BV(CS21);        // clk/8
+    sei();
+}
+
+static void probe_stop(void) {
+    cli();
+    TCCR2B = 0;
+    TIMSK2 = saved_timsk2;
+    TCCR2A = saved_tccr2a;
+    OCR2A = saved_ocr2a;
+    OCR2B = saved_ocr2b;
+    TCCR2B = saved_tccr2b;
+    sei();
+}
+
+static void stats_report(void) {
+    uint32_t tenths = stats_wakes * 10000UL / stats_window_ms;
+#ifdef TIMEBASE_TIMER0
+    Serial.print(F("timebase timer0:   "));
+#else
+    Serial.print(F("timebase tickless: "));
+#endif
+    Serial.print(tenths / 10);
+    Serial.print('.');
+    Serial.print(tenths % 10);
+    Serial.print(F(" wakes/s in ATTRACT, ISR latency "));
+    Serial.print(probe_min * PROBE_CYCLES_PER_COUNT);
+    Serial.print('-');
+    Serial.print(probe_max * PROBE_CYCLES_PER_COUNT);
+    Serial.print(F(" cycles (jitter "));
+    Serial.print((probe_max - probe_min) * PROBE_CYCLES_PER_COUNT);
+    Serial.print(F(") over "));
+    Serial.print(probe_samples);
+    Serial.println(F(" samples"));
+}
+
+void timebase_stats_poll(bool attract) {
+    uint32_t now = millis();
+
+    if (!attract) {
+        if (stats_phase == STATS_PROBE) {
+            probe_stop();
+        }
+        stats_phase = STATS_IDLE;
+        return;
+    }
+
+    switch (stats_phase) {
+        case STATS_IDLE:
+            stats_phase = STATS_COUNT;
+            stats_start = now;
+            stats_wakes_at_start = total_wakes();
+            break;
+        case STATS_COUNT:
+            if (now - stats_start >= STATS_COUNT_MS) {
+                stats_wakes = total_wakes() - stats_wakes_at_start;
+                stats_window_ms = now - stats_start;
+                stats_phase = STATS_PROBE;
+                stats_start = now;
+                probe_start();
+            }
+            break;
+        case STATS_PROBE:
+            if (now - stats_start >= STATS_PROBE_MS) {
+                probe_stop();
+                stats_report();
+                stats_phase = STATS_IDLE;
+            }
+            break;
+    }
+}
+
+#endif // TIMEBASE_STATS
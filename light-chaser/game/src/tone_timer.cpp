@@ -0,0 +1,98 @@
+/******************************************************************************
+ * TONE_TIMER.CPP - Timer2 Buzzer Driver (Timer1 on the ATtiny85)
+ *
+ * Firmware only (uses AVR timer registers directly); the host simulator
+ * provides tone_play() and tone_stop() in sim.cpp.
+ *
+ * TIMER2 SETUP PER NOTE:
+ *   TCCR2A = toggle OC2A on match, CTC (WGM21)
+ *   OCR2A  = note.top
+ *   TCCR2B = note.clock_select (starts the clock)
+ *   TIMSK2 = compare A interrupt (counts toggles)
+ *
+ * This replaces the core's tone(): its Tone.cpp also defines the Timer2
+ * compare A vector, so nothing in the firmware may call tone() or noTone()
+ * (the linker would pull Tone.o in and report the vector twice).
+ *
+ * ATTINY85 (BOARD_TINY85), TIMER1 PER NOTE:
+ *   TCCR1  = CTC1 (clear at OCR1C) | note.clock_select (starts the clock)
+ *   OCR1C  = OCR1B = note.top (compare B fires at top)
+ *   GTCCR  = toggle OC1B (PB4) on compare B
+ *   TIMSK  = compare B interrupt, next to the core's Timer0 overflow bit
+ *
+ * Related files:
+ * - tone_timer.h: Overview, ToneNote and TONE_NOTE()
+ ******************************************************************************/
+
+#include "tone_timer.h"
+#include "config.h"
+#include "board.h"
+
+#if defined(BOARD_TINY85)
+
+static_assert(BUZZER_PIN == 4, "The buzzer must be on OC1B (PB4): Timer1 toggles it in hardware");
+
+static volatile uint16_t toggles_left = 0;
+
+ISR(TIMER1_COMPB_vect) {
+    if (--toggles_left == 0) {
+        TCCR1 = 0;
+        GTCCR &= (uint8_t)~(_BV(COM1B1) | _BV(COM1B0));  // OC1B off: back to PORTB4 (LOW)
+        TIMSK &= (uint8_t)~_BV(OCIE1B);
+    }
+}
+
+void tone_play(ToneNote note) {
+    TIMSK &= (uint8_t)~_BV(OCIE1B);   // TIMSK also holds the millis() tick: no plain writes
+    TCCR1 = 0;
+    toggles_left = note.toggles;
+    TCNT1 = 0;
+    OCR1C = note.top;
+    OCR1B = note.top;
+    GTCCR = (uint8_t)((GTCCR & ~(_BV(PWM1B) | _BV(COM1B1))) | _BV(COM1B0));
+    TIFR = _BV(OCF1B);
+    TIMSK |= _BV(OCIE1B);
+    TCCR1 = (uint8_t)(_BV(CTC1) | note.clock_select);
+}
+
+void tone_stop(void) {
+    TIMSK &= (uint8_t)~_BV(OCIE1B);
+    TCCR1 = 0;
+    GTCCR &= (uint8_t)~(_BV(COM1B1) | _BV(COM1B0));
+    digitalWrite(BUZZER_PIN, LOW);
+}
+
+#else
+
+static_assert(BUZZER_PIN == 11, "The buzzer must be on OC2A (D11): Timer2 toggles it in hardware");
+
+static volatile uint16_t toggles_left = 0;
+
+ISR(TIMER2_COMPA_vect) {
+    if (--toggles_left == 0) {
+        TCCR2B = 0;
+        TCCR2A = 0;            // OC2A disconnected: the pin goes back to PORTB3 (LOW)
+        TIMSK2 = 0;
+    }
+}
+
+void tone_play(ToneNote note) {
+    TIMSK2 = 0;                // The ISR can't run while the count is replaced
+    TCCR2B = 0;
+    toggles_left = note.toggles;
+    TCNT2 = 0;
+    OCR2A = note.top;
+    TCCR2A = _BV(COM2A0) | _BV(WGM21);
+    TIFR2 = _BV(OCF2A);        // Drop a match left over from the last note
+    TIMSK2 = _BV(OCIE2A);
+    TCCR2B = note.clock_select;
+}
+
+void tone_stop(void) {
+    TIMSK2 = 0;
+    TCCR2B = 0;
+    TCCR2A = 0;
+    digitalWrite(BUZZER_PIN, LOW);
+}
+
+#endif // BOARD_TINY85
@@ -0,0 +1,129 @@
+/******************************************************************************
+ * TRACE.CPP - Trace Record Encoding and Serial Transport
+ *
+ * Only does anything in builds with -DTRACE_ENABLED (uno_trace, pro8mhz_trace,
+ * native_trace).
+ * The same file runs on the board, in simavr and in the host simulator; only
+ * what "Serial" and "timebase_micros()" are differs. (The core's micros()
+ * stops once timebase_init() switches off the Timer0 tick, see timebase.h.)
+ *
+ * Records are written with Serial.write(), which copies into the 64-byte TX
+ * buffer and returns; the UART interrupt drains it in the background. A
+ * record is never split across two write() calls, so a receiver that starts
+ * mid-stream can resynchronise on TRACE_SYNC.
+ *
+ * EMPTY-SPAN ELISION:
+ * BEGIN records of "elide" events wait on a small stack. Anything else that
+ * gets recorded first sends every waiting BEGIN (oldest first, with their
+ * original timestamps), so nesting is preserved. An END whose BEGIN is still
+ * waiting just pops it: the whole span vanishes.
+ *
+ * INTERRUPT ENTRIES:
+ * trace_isr_enter() keeps the first entry time per vector in isr_entry[]
+ * and sets its bit in isr_noted; trace_isr_flush() takes both with
+ * interrupts off and sends one instant per set bit. Later entries of a
+ * vector that is already noted are not counted.
+ *
+ * Related files:
+ * - trace.h: Record format and trace macros
+ ******************************************************************************/
+
+#include "trace.h"
+#include "timebase.h"
+#include "clocks.h"
+
+#ifdef TRACE_ENABLED
+
+static_assert(uart_error_permille(TRACE_BAUD) <= UART_MAX_ERROR_PERMILLE,
+              "TRACE_BAUD is too far off at this F_CPU");
+
+// Bit n set = TraceEvent n is elided when empty
+#define TRACE_ELIDE_BIT(id, name, track, elide) | ((uint16_t)(elide) << (id))
+static const uint16_t elide_mask = 0 TRACE_EVENTS(TRACE_ELIDE_BIT);
+#undef TRACE_ELIDE_BIT
+
+static const uint8_t MAX_PENDING = 4;  // game_update > state update is 2 deep
+
+typedef struct {
+    uint8_t event;
+    uint8_t arg;
+    uint32_t time;
+    bool sent;        // BEGIN already on the wire (something happened inside)
+} PendingBegin;
+
+static PendingBegin pending[MAX_PENDING];
+static uint8_t pending_count = 0;
+
+static_assert(TRACE_ISR_COUNT <= 8, "isr_noted has one bit per TraceIsr");
+static volatile uint32_t isr_entry[TRACE_ISR_COUNT];  // timebase_isr_micros() at entry
+static volatile uint8_t isr_noted = 0;                // Bit n: isr_entry[n] not sent yet
+
+static void send_record(uint8_t event, char phase, uint8_t arg, uint32_t time) {
+    uint8_t record[TRACE_RECORD_SIZE] = {
+        TRACE_SYNC, event, (uint8_t)phase, arg,
+        (uint8_t)time, (uint8_t)(time >> 8), (uint8_t)(time >> 16), (uint8_t)(time >> 24)
+    };
+    Serial.write(record, sizeof(record));
+}
+
+static void send_pending(void) {
+    for (uint8_t i = 0; i < pending_count; i++) {
+        if (!pending[i].sent) {
+            send_record(pending[i].event, 'B', pending[i].arg, pending[i].time);
+            pending[i].sent = true;
+        }
+    }
+}
+
+void trace_init(void) {
+    Serial.begin(TRACE_BAUD);
+    pending_count = 0;
+}
+
+void trace_record(uint8_t event, char phase, uint8_t arg) {
+    uint32_t now = timebase_micros();
+    bool elide = (elide_mask >> event) & 1;
+
+    if (elide && phase == 'B' && pending_count < MAX_PENDING) {
+        pending[pending_count++] = {event, arg, now, false};
+        return;
+    }
+    if (elide && phase == 'E' && pending_count > 0) {
+        PendingBegin *top = &pending[--pending_count];
+        if (top->sent) {
+            send_record(event, 'E', arg, now);
+        }
+        return;
+    }
+
+    // Something real happened: the enclosing spans are not empty after all
+    send_pending();
+    send_record(event, phase, arg, now);
+}
+
+void trace_isr_enter(uint8_t vector) {
+    if (!(isr_noted & (1 << vector))) {
+        isr_entry[vector] = timebase_isr_micros();
+        isr_noted |= 1 << vector;
+    }
+}
+
+void trace_isr_flush(void) {
+    uint32_t entry[TRACE_ISR_COUNT];
+    noInterrupts();
+    uint8_t noted = isr_noted;
+    isr_noted = 0;
+    for (uint8_t i = 0; i < TRACE_ISR_COUNT; i++) {
+        entry[i] = isr_entry[i];
+    }
+    interrupts();
+
+    for (uint8_t i = 0; i < TRACE_ISR_COUNT; i++) {
+        if (noted & (1 << i)) {
+            send_pending();
+            send_record(TRACE_ISR, 'i', i, entry[i]);
+        }
+    }
+}
+
+#endif // TRACE_ENABLED